@@ -147,6 +147,10 @@ int DLLEXPORT Initialize( cl_enginefunc_t *pEnginefuncs, int iVersion )
 
 	memcpy(&gEngfuncs, pEnginefuncs, sizeof(cl_enginefunc_t));
 
+	// engines without this cvar don't have PM_TraceMaterial and EV_TraceMaterial
+	cvar_t *pTraceMaterial = gEngfuncs.pfnGetCvarPointer( "host_tracematerial" );
+	g_tracematerial = ( pTraceMaterial && pTraceMaterial->value ) ? 1 : 0;
+
 	EV_HookEvents();
 
 	return 1;
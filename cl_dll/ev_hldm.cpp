@@ -40,6 +40,7 @@ extern engine_studio_api_t IEngineStudio;
 static int tracerCount[ 32 ];
 
 extern "C" char PM_FindTextureType( char *name );
+extern "C" int g_tracematerial;
 
 void V_PunchAxis( int axis, float punch );
 void VectorAngles( const float *forward, float *angles );
@@ -116,6 +117,11 @@ float EV_HLDM_PlayTextureSound( int idx, pmtrace_t *ptr, float *vecSrc, float *v
 		// hit body
 		chTextureType = CHAR_TEX_FLESH;
 	}
+	else if ( entity == 0 && g_tracematerial )
+	{
+		// engine already knows the material of the texture
+		chTextureType = gEngfuncs.pEventAPI->EV_TraceMaterial( ptr->ent, vecSrc, vecEnd );
+	}
 	else if ( entity == 0 )
 	{
 		// get texture from entity or world (world is ent(0))
@@ -94,7 +94,8 @@ typedef struct texture_s
 	struct texture_s	*alternate_anims;	// bmodels in frame 1 use these
 	unsigned short	fb_texturenum;	// auto-luma texturenum
 	unsigned short	dt_texturenum;	// detail-texture binding
-	unsigned int	unused[3];	// reserved 
+	int		material;		// CHAR_TEX_ type from materials.txt, 0 if not looked up yet
+	unsigned int	unused[2];	// reserved 
 } texture_t;
 
 typedef struct
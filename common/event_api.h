@@ -53,6 +53,7 @@ typedef struct event_api_s
 	int	( *EV_TestLine)( const vec3_t start, const vec3_t end, int flags );
 	void	( *EV_PushTraceBounds)( int hullnum, const float *mins, const float *maxs );
 	void	( *EV_PopTraceBounds)( void );
+	char	( *EV_TraceMaterial )( int ground, float *vstart, float *vend );	// materials.txt type of the hit texture, 0 if nothing hit
 } event_api_t;
 
 #endif//EVENT_API_H
\ No newline at end of file
@@ -236,6 +236,9 @@ typedef struct render_api_s
 	void		(*Cvar_Set)( char *name, char *value );
 	void		(*S_FadeMusicVolume)( float fadePercent );	// fade background track (0-100 percents)
 	void		(*SetRandomSeed)( long lSeed );		// set custom seed for RANDOM_FLOAT\RANDOM_LONG for predictable random
+	int		(*pfnProfZone)( const char *name );		// engine profiler zone id, keep it for pfnProfBegin\pfnProfEnd
+	void		(*pfnProfBegin)( int zone );
+	void		(*pfnProfEnd)( int zone );
 	// ONLY ADD NEW FUNCTIONS TO THE END OF THIS STRUCT.  INTERFACE VERSION IS FROZEN AT 37
 } render_api_t;
 
@@ -338,6 +338,7 @@ public:
 
 	virtual	BOOL FVisible ( CBaseEntity *pEntity );
 	virtual	BOOL FVisible ( const Vector &vecOrigin );
+	void FVisibleList ( CBaseEntity **pList, int count, BOOL *pfVisible );
 
 	//We use this variables to store each ammo count.
 	int ammo_9mm;
@@ -990,8 +990,22 @@ we could also use the pas/ pvs that we set in SetupVisibility, if we wanted to.
 */
 int AddToFullPack( struct entity_state_s *state, int e, edict_t *ent, edict_t *host, int hostflags, int player, unsigned char *pSet )
 {
-	int					i;
+	if ( !CheckFullPack( e, ent, host, hostflags, player, pSet ) )
+		return 0;
+
+	EntityState( state, e, ent, player );
+
+	return 1;
+}
 
+/*
+CheckFullPack
+
+The per-viewer half of AddToFullPack: return 1 if the entity should be propagated to the host, 0 otherwise.
+The engine builds the state itself through EntityState only once per frame and shares it between all clients.
+*/
+int CheckFullPack( int e, edict_t *ent, edict_t *host, int hostflags, int player, unsigned char *pSet )
+{
 	// don't send if flagged for NODRAW and it's not the host getting the message
 	if ( ( ent->v.effects == EF_NODRAW ) &&
 		 ( ent != host ) )
@@ -1051,6 +1065,19 @@ int AddToFullPack( struct entity_state_s *state, int e, edict_t *ent, edict_t *h
 		UTIL_UnsetGroupTrace();
 	}
 
+	return 1;
+}
+
+/*
+EntityState
+
+Fill in the network state of the entity. It must not depend on the client it goes to, nor on anything
+but the entvars of the ent: the engine skips the call while they stay the same and sends the old state.
+*/
+void EntityState( struct entity_state_s *state, int e, edict_t *ent, int player )
+{
+	int					i;
+
 	memset( state, 0, sizeof( *state ) );
 
 	// Assign index so we can track this entity from frame to frame and
@@ -1174,8 +1201,6 @@ int AddToFullPack( struct entity_state_s *state, int e, edict_t *ent, edict_t *h
 		state->usehull      = ( ent->v.flags & FL_DUCKING ) ? 1 : 0;
 		state->health		= ent->v.health;
 	}
-
-	return 1;
 }
 
 // defaults for clientinfo messages
@@ -29,6 +29,7 @@
 #include "animation.h"
 #include "weapons.h"
 #include "func_break.h"
+#include "physcallback.h"
 
 extern DLL_GLOBAL Vector		g_vecAttackDir;
 extern DLL_GLOBAL int			g_iSkillLevel;
@@ -1215,6 +1216,84 @@ BOOL CBaseMonster :: FInViewCone ( Vector *pOrigin )
 	}
 }
 
+//=========================================================
+// Visibility cache - FVisible results are kept for the rest
+// of the server frame, keyed on the looker and both ends of
+// the line, so Look and CheckEnemy don't trace the same line
+// twice in one think.
+//=========================================================
+#define VISIBLE_CACHE_SIZE	256		// must be a power of two
+#define MAX_VISIBLE_BATCH	128		// lines handed to the engine at once
+
+typedef struct
+{
+	float	time;
+	edict_t	*pentLooker;
+	Vector	vecStart;
+	Vector	vecEnd;
+	BOOL	fVisible;
+} VISIBLE_CACHE_ENTRY;
+
+static VISIBLE_CACHE_ENTRY	gVisibleCache[ VISIBLE_CACHE_SIZE ];
+static float	gflVisibleCacheTime;
+
+// visible_stats counters
+static int		gcVisibleQueries;
+static int		gcVisibleCached;
+static int		gcVisibleTraced;
+static int		gcVisibleBatches;
+
+static VISIBLE_CACHE_ENTRY *VisibleCacheEntry( edict_t *pentLooker, const Vector &vecStart, const Vector &vecEnd )
+{
+	unsigned int	iHash;
+
+	// time went backwards, this is a new level
+	if ( gpGlobals->time < gflVisibleCacheTime )
+		memset( gVisibleCache, 0, sizeof( gVisibleCache ) );
+	gflVisibleCacheTime = gpGlobals->time;
+
+	iHash = ENTINDEX( pentLooker ) * 31 + (int)vecEnd.x * 7 + (int)vecEnd.y * 13 + (int)vecEnd.z;
+
+	return &gVisibleCache[ iHash & ( VISIBLE_CACHE_SIZE - 1 ) ];
+}
+
+static BOOL VisibleCacheLookup( edict_t *pentLooker, const Vector &vecStart, const Vector &vecEnd, BOOL *pfVisible )
+{
+	VISIBLE_CACHE_ENTRY *pEntry = VisibleCacheEntry( pentLooker, vecStart, vecEnd );
+
+	gcVisibleQueries++;
+
+	if ( pEntry->time != gpGlobals->time || pEntry->pentLooker != pentLooker || pEntry->vecStart != vecStart || pEntry->vecEnd != vecEnd )
+		return FALSE;
+
+	gcVisibleCached++;
+	*pfVisible = pEntry->fVisible;
+	return TRUE;
+}
+
+static void VisibleCacheStore( edict_t *pentLooker, const Vector &vecStart, const Vector &vecEnd, BOOL fVisible )
+{
+	VISIBLE_CACHE_ENTRY *pEntry = VisibleCacheEntry( pentLooker, vecStart, vecEnd );
+
+	pEntry->time = gpGlobals->time;
+	pEntry->pentLooker = pentLooker;
+	pEntry->vecStart = vecStart;
+	pEntry->vecEnd = vecEnd;
+	pEntry->fVisible = fVisible;
+}
+
+//=========================================================
+// VisibleStats - "visible_stats" server command. Prints and
+// resets the FVisible counters.
+//=========================================================
+void VisibleStats( void )
+{
+	SERVER_PRINT( UTIL_VarArgs( "%d visibility checks, %d from the cache, %d traced (%d batches)\n",
+		gcVisibleQueries, gcVisibleCached, gcVisibleTraced, gcVisibleBatches ) );
+
+	gcVisibleQueries = gcVisibleCached = gcVisibleTraced = gcVisibleBatches = 0;
+}
+
 //=========================================================
 // FVisible - returns true if a line can be traced from
 // the caller's eyes to the target
@@ -1224,6 +1303,7 @@ BOOL CBaseEntity :: FVisible ( CBaseEntity *pEntity )
 	TraceResult tr;
 	Vector		vecLookerOrigin;
 	Vector		vecTargetOrigin;
+	BOOL		fVisible;
 	
 	if (FBitSet( pEntity->pev->flags, FL_NOTARGET ))
 		return FALSE;
@@ -1236,15 +1316,87 @@ BOOL CBaseEntity :: FVisible ( CBaseEntity *pEntity )
 	vecLookerOrigin = pev->origin + pev->view_ofs;//look through the caller's 'eyes'
 	vecTargetOrigin = pEntity->EyePosition();
 
+	if ( VisibleCacheLookup( ENT(pev), vecLookerOrigin, vecTargetOrigin, &fVisible ) )
+		return fVisible;
+
 	UTIL_TraceLine(vecLookerOrigin, vecTargetOrigin, ignore_monsters, ignore_glass, ENT(pev)/*pentIgnore*/, &tr);
+	gcVisibleTraced++;
 	
-	if (tr.flFraction != 1.0)
+	// line of sight is valid if nothing was hit
+	fVisible = ( tr.flFraction == 1.0 );
+
+	VisibleCacheStore( ENT(pev), vecLookerOrigin, vecTargetOrigin, fVisible );
+
+	return fVisible;
+}
+
+//=========================================================
+// FVisibleList - FVisible for a list of entities, pfVisible
+// gets the answer for each. The lines that aren't in the
+// cache go to the engine in one pfnTraceLines call.
+//=========================================================
+void CBaseEntity :: FVisibleList ( CBaseEntity **pList, int count, BOOL *pfVisible )
+{
+	linetrace_t	lines[ MAX_VISIBLE_BATCH ];
+	int			iLineEntity[ MAX_VISIBLE_BATCH ];
+	Vector		vecLookerOrigin;
+	Vector		vecTargetOrigin;
+	CBaseEntity	*pEntity;
+	int			i, cLines;
+	BOOL		fVisible;
+
+	if ( !g_physfuncs.pfnTraceLines || count > MAX_VISIBLE_BATCH )
 	{
-		return FALSE;// Line of sight is not established
+		for ( i = 0; i < count; i++ )
+			pfVisible[i] = FVisible( pList[i] );
+		return;
 	}
-	else
+
+	vecLookerOrigin = pev->origin + pev->view_ofs;//look through the caller's 'eyes'
+	cLines = 0;
+
+	for ( i = 0; i < count; i++ )
 	{
-		return TRUE;// line of sight is valid.
+		pEntity = pList[i];
+		pfVisible[i] = FALSE;
+
+		if (FBitSet( pEntity->pev->flags, FL_NOTARGET ))
+			continue;
+
+		// don't look through water
+		if ((pev->waterlevel != 3 && pEntity->pev->waterlevel == 3) 
+			|| (pev->waterlevel == 3 && pEntity->pev->waterlevel == 0))
+			continue;
+
+		vecTargetOrigin = pEntity->EyePosition();
+
+		if ( VisibleCacheLookup( ENT(pev), vecLookerOrigin, vecTargetOrigin, &fVisible ) )
+		{
+			pfVisible[i] = fVisible;
+			continue;
+		}
+
+		// same line UTIL_TraceLine would trace
+		vecLookerOrigin.CopyToArray( lines[cLines].start );
+		vecTargetOrigin.CopyToArray( lines[cLines].end );
+		lines[cLines].type = TRUE | 0x100;	// ignore_monsters, ignore_glass
+		lines[cLines].ignore = ENT(pev);
+		iLineEntity[cLines] = i;
+		cLines++;
+	}
+
+	if ( !cLines )
+		return;
+
+	g_physfuncs.pfnTraceLines( lines, cLines );
+	gcVisibleTraced += cLines;
+	gcVisibleBatches++;
+
+	for ( i = 0; i < cLines; i++ )
+	{
+		fVisible = ( lines[i].fraction == 1.0 );
+		pfVisible[ iLineEntity[i] ] = fVisible;
+		VisibleCacheStore( ENT(pev), vecLookerOrigin, Vector( lines[i].end ), fVisible );
 	}
 }
 
@@ -56,6 +56,8 @@ extern enginefuncs_t g_engfuncs;
 #define GET_AIM_VECTOR	(*g_engfuncs.pfnGetAimVector)
 #define SERVER_COMMAND	(*g_engfuncs.pfnServerCommand)
 #define SERVER_EXECUTE	(*g_engfuncs.pfnServerExecute)
+#define SERVER_PRINT	(*g_engfuncs.pfnServerPrint)
+#define ADD_SERVER_COMMAND	(*g_engfuncs.pfnAddServerCommand)
 #define CLIENT_COMMAND	(*g_engfuncs.pfnClientCommand)
 #define PARTICLE_EFFECT	(*g_engfuncs.pfnParticleEffect)
 #define LIGHT_STYLE		(*g_engfuncs.pfnLightStyle)
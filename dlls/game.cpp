@@ -17,6 +17,8 @@
 #include "util.h"
 #include "game.h"
 
+extern "C" int g_tracematerial;
+
 cvar_t	displaysoundlist = {"displaysoundlist","0"};
 
 // multiplayer server rules
@@ -460,6 +462,10 @@ void GameDLLInit( void )
 	g_psv_aim = CVAR_GET_POINTER( "sv_aim" );
 	g_footsteps = CVAR_GET_POINTER( "mp_footsteps" );
 
+	// engines without this cvar don't have playermove_t::PM_TraceMaterial
+	cvar_t *pTraceMaterial = CVAR_GET_POINTER( "host_tracematerial" );
+	g_tracematerial = ( pTraceMaterial && pTraceMaterial->value ) ? 1 : 0;
+
 	CVAR_REGISTER (&displaysoundlist);
 
 	CVAR_REGISTER (&teamplay);
@@ -484,6 +490,12 @@ void GameDLLInit( void )
 	CVAR_REGISTER (&mp_chattime);
 	CVAR_REGISTER (&saved1);
 
+	ADD_SERVER_COMMAND ("graph_benchmark", GraphBenchmark);
+	ADD_SERVER_COMMAND ("graph_nearest_record", GraphNearestRecord);
+	ADD_SERVER_COMMAND ("graph_nearest_benchmark", GraphNearestBenchmark);
+	ADD_SERVER_COMMAND ("visible_stats", VisibleStats);
+	ADD_SERVER_COMMAND ("saverestore_benchmark", SaveRestoreBenchmark);
+
 // REGISTER CVARS FOR SKILL LEVEL STUFF
 	// Agrunt
 	CVAR_REGISTER ( &sk_agrunt_health1 );// {"sk_agrunt_health1","0"};
@@ -17,6 +17,11 @@
 #define GAME_H
 
 extern void GameDLLInit( void );
+extern void GraphBenchmark( void );
+extern void GraphNearestRecord( void );
+extern void GraphNearestBenchmark( void );
+extern void VisibleStats( void );
+extern void SaveRestoreBenchmark( void );
 
 
 extern cvar_t	displaysoundlist;
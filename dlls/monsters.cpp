@@ -317,12 +317,15 @@ void CBaseMonster :: Look ( int iDistance )
 	if ( !FBitSet( pev->spawnflags, SF_MONSTER_PRISONER ) )
 	{
 		CBaseEntity *pList[100];
+		BOOL		fVisible[100];
+		int			cConsider = 0;
+		int			i;
 
 		Vector delta = Vector( iDistance, iDistance, iDistance );
 
 		// Find only monsters/clients in box, NOT limited to PVS
 		int count = UTIL_EntitiesInBox( pList, 100, pev->origin - delta, pev->origin + delta, FL_CLIENT|FL_MONSTER );
-		for ( int i = 0; i < count; i++ )
+		for ( i = 0; i < count; i++ )
 		{
 			pSightEnt = pList[i];
 			// !!!temporarily only considering other monsters and clients, don't see prisoners
@@ -332,64 +335,77 @@ void CBaseMonster :: Look ( int iDistance )
 			{
 				// the looker will want to consider this entity
 				// don't check anything else about an entity that can't be seen, or an entity that you don't care about.
-				if ( IRelationship( pSightEnt ) != R_NO && FInViewCone( pSightEnt ) && !FBitSet( pSightEnt->pev->flags, FL_NOTARGET ) && FVisible( pSightEnt ) )
+				if ( IRelationship( pSightEnt ) != R_NO && FInViewCone( pSightEnt ) && !FBitSet( pSightEnt->pev->flags, FL_NOTARGET ) )
 				{
-					if ( pSightEnt->IsPlayer() )
-					{
-						if ( pev->spawnflags & SF_MONSTER_WAIT_TILL_SEEN )
-						{
-							CBaseMonster *pClient;
-
-							pClient = pSightEnt->MyMonsterPointer();
-							// don't link this client in the list if the monster is wait till seen and the player isn't facing the monster
-							if ( pSightEnt && !pClient->FInViewCone( this ) )
-							{
-								// we're not in the player's view cone. 
-								continue;
-							}
-							else
-							{
-								// player sees us, become normal now.
-								pev->spawnflags &= ~SF_MONSTER_WAIT_TILL_SEEN;
-							}
-						}
+					pList[ cConsider++ ] = pSightEnt;
+				}
+			}
+		}
 
-						// if we see a client, remember that (mostly for scripted AI)
-						iSighted |= bits_COND_SEE_CLIENT;
-					}
+		// trace all the lines of sight at once
+		FVisibleList( pList, cConsider, fVisible );
+
+		for ( i = 0; i < cConsider; i++ )
+		{
+			pSightEnt = pList[i];
 
-					pSightEnt->m_pLink = m_pLink;
-					m_pLink = pSightEnt;
+			if ( !fVisible[i] )
+				continue;
 
-					if ( pSightEnt == m_hEnemy )
+			if ( pSightEnt->IsPlayer() )
+			{
+				if ( pev->spawnflags & SF_MONSTER_WAIT_TILL_SEEN )
+				{
+					CBaseMonster *pClient;
+
+					pClient = pSightEnt->MyMonsterPointer();
+					// don't link this client in the list if the monster is wait till seen and the player isn't facing the monster
+					if ( pSightEnt && !pClient->FInViewCone( this ) )
 					{
-						// we know this ent is visible, so if it also happens to be our enemy, store that now.
-						iSighted |= bits_COND_SEE_ENEMY;
+						// we're not in the player's view cone. 
+						continue;
 					}
-
-					// don't add the Enemy's relationship to the conditions. We only want to worry about conditions when
-					// we see monsters other than the Enemy.
-					switch ( IRelationship ( pSightEnt ) )
+					else
 					{
-					case	R_NM:
-						iSighted |= bits_COND_SEE_NEMESIS;		
-						break;
-					case	R_HT:		
-						iSighted |= bits_COND_SEE_HATE;		
-						break;
-					case	R_DL:
-						iSighted |= bits_COND_SEE_DISLIKE;
-						break;
-					case	R_FR:
-						iSighted |= bits_COND_SEE_FEAR;
-						break;
-					case    R_AL:
-						break;
-					default:
-						ALERT ( at_aiconsole, "%s can't assess %s\n", STRING(pev->classname), STRING(pSightEnt->pev->classname ) );
-						break;
+						// player sees us, become normal now.
+						pev->spawnflags &= ~SF_MONSTER_WAIT_TILL_SEEN;
 					}
 				}
+
+				// if we see a client, remember that (mostly for scripted AI)
+				iSighted |= bits_COND_SEE_CLIENT;
+			}
+
+			pSightEnt->m_pLink = m_pLink;
+			m_pLink = pSightEnt;
+
+			if ( pSightEnt == m_hEnemy )
+			{
+				// we know this ent is visible, so if it also happens to be our enemy, store that now.
+				iSighted |= bits_COND_SEE_ENEMY;
+			}
+
+			// don't add the Enemy's relationship to the conditions. We only want to worry about conditions when
+			// we see monsters other than the Enemy.
+			switch ( IRelationship ( pSightEnt ) )
+			{
+			case	R_NM:
+				iSighted |= bits_COND_SEE_NEMESIS;		
+				break;
+			case	R_HT:		
+				iSighted |= bits_COND_SEE_HATE;		
+				break;
+			case	R_DL:
+				iSighted |= bits_COND_SEE_DISLIKE;
+				break;
+			case	R_FR:
+				iSighted |= bits_COND_SEE_FEAR;
+				break;
+			case    R_AL:
+				break;
+			default:
+				ALERT ( at_aiconsole, "%s can't assess %s\n", STRING(pev->classname), STRING(pSightEnt->pev->classname ) );
+				break;
 			}
 		}
 	}
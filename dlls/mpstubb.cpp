@@ -36,6 +36,9 @@ int CGraph :: CheckNODFile ( char *szMapName ) { return FALSE; }
 int CGraph :: FSetGraphPointers ( void ) { return 0; }
 void CGraph :: ShowNodeConnections ( int iNode ) { }
 int	CGraph :: FindNearestNode ( const Vector &vecOrigin,  int afNodeTypes ) { return 0; }
+void GraphBenchmark( void ) { }
+void GraphNearestRecord( void ) { }
+void GraphNearestBenchmark( void ) { }
 
 
 /*********************************************************/
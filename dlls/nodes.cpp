@@ -23,6 +23,7 @@
 #include	"nodes.h"
 #include	"animation.h"
 #include	"doors.h"
+#include	"physcallback.h"
 
 #define	HULL_STEP_SIZE 16// how far the test hull moves on each step
 #define	NODE_HEIGHT	8	// how high to lift nodes off the ground after we drop them all (make stair/ramp mapping easier)
@@ -31,6 +32,7 @@
 // any given node is allowed to 'see' in the first stage of graph creation "LinkVisibleNodes()".
 #define	MAX_NODE_INITIAL_LINKS	128
 #define	MAX_NODES               1024
+#define	NODE_LINK_BATCH			64	// nodes traced per pass of the job threads in LinkVisibleNodes
 
 extern DLL_GLOBAL edict_t		*g_pBodyQueueHead;
 
@@ -102,6 +104,8 @@ void CGraph :: InitGraph( void)
 
 	m_iLastActiveIdleSearch = 0;
 	m_iLastCoverSearch = 0;
+
+	FreeNodeGrid();
 }
 	
 //=========================================================
@@ -848,6 +852,317 @@ void CGraph :: CheckNode(Vector vecOrigin, int iNode)
 	}
 }
 
+//=========================================================
+// Node grid - a uniform grid over the node positions that
+// FindNearestNode searches in growing rings of cells, and
+// an LRU cache of its answers. They are kept out of CGraph
+// because the CGraph is written to the .nod file as it is.
+//=========================================================
+#define GRID_CELL_SIZE		256		// starting cell size, doubled until the grid fits in GRID_MAX_CELLS
+#define GRID_MAX_CELLS		32768
+#define NEAREST_CACHE_SETS	256
+#define NEAREST_CACHE_WAYS	4
+#define MAX_NEAREST_RECORD	65536	// queries kept by graph_nearest_record
+
+typedef struct
+{
+	Vector	v;
+	int		types;	// afNodeTypes of the query
+	int		n;		// nearest node or -1
+	int		age;	// last use, 0 for an empty entry
+} NEAREST_CACHE_ENTRY;
+
+typedef struct
+{
+	int		m_iNode;
+	float	m_flDist;
+} NEAREST_CANDIDATE;
+
+typedef struct
+{
+	CNode	*m_pNodes;		// the nodes the grid was built for
+	int		m_cNodes;
+	float	m_flCellSize;
+	float	m_vecMins[3];
+	int		m_Size[3];
+	int		*m_pCellStart;	// first entry of each cell in m_pCellNodes, plus one past the last cell
+	int		*m_pCellNodes;
+	NEAREST_CANDIDATE	*m_pCandidates;
+
+	NEAREST_CACHE_ENTRY	m_Cache[NEAREST_CACHE_SETS][NEAREST_CACHE_WAYS];
+	int		m_iCacheAge;
+	int		m_cCacheHits;
+} NODE_GRID;
+
+typedef struct
+{
+	float	org[3];
+	int		types;
+} NEAREST_QUERY;
+
+static NODE_GRID		gNodeGrid;
+static NEAREST_QUERY	*gpNearestRecord;	// graph_nearest_record
+static int				gcNearestRecord;
+static BOOL				gfNearestRecording;
+
+inline int GridCell( float flPos, float flMins, float flCellSize )
+{
+	return (int)floor( ( flPos - flMins ) / flCellSize );
+}
+
+static int NearestCandidateCompare( const void *a, const void *b )
+{
+	const NEAREST_CANDIDATE *pA = (const NEAREST_CANDIDATE *)a;
+	const NEAREST_CANDIDATE *pB = (const NEAREST_CANDIDATE *)b;
+
+	if ( pA->m_flDist != pB->m_flDist )
+		return ( pA->m_flDist < pB->m_flDist ) ? -1 : 1;
+
+	return pA->m_iNode - pB->m_iNode;
+}
+
+//=========================================================
+// CGraph - BuildNodeGrid - sorts the nodes into grid cells
+// by m_vecOriginPeek, the position FindNearestNode measures
+// from. Called whenever a graph is built or loaded.
+//=========================================================
+void CGraph :: BuildNodeGrid( void )
+{
+	NODE_GRID	*pGrid = &gNodeGrid;
+	float		vecMaxs[3];
+	int			i, j, iCell, cCells;
+
+	FreeNodeGrid();
+
+	if ( !m_pNodes || m_cNodes <= 0 )
+	{
+		return;
+	}
+
+	for ( j = 0 ; j < 3 ; j++ )
+	{
+		pGrid->m_vecMins[j] = vecMaxs[j] = m_pNodes[ 0 ].m_vecOriginPeek[j];
+	}
+
+	for ( i = 1 ; i < m_cNodes ; i++ )
+	{
+		for ( j = 0 ; j < 3 ; j++ )
+		{
+			pGrid->m_vecMins[j] = min( pGrid->m_vecMins[j], m_pNodes[ i ].m_vecOriginPeek[j] );
+			vecMaxs[j] = max( vecMaxs[j], m_pNodes[ i ].m_vecOriginPeek[j] );
+		}
+	}
+
+	pGrid->m_flCellSize = GRID_CELL_SIZE;
+
+	while ( 1 )
+	{
+		cCells = 1;
+
+		for ( j = 0 ; j < 3 ; j++ )
+		{
+			pGrid->m_Size[j] = GridCell( vecMaxs[j], pGrid->m_vecMins[j], pGrid->m_flCellSize ) + 1;
+			cCells *= pGrid->m_Size[j];
+		}
+
+		if ( cCells <= GRID_MAX_CELLS )
+			break;
+
+		pGrid->m_flCellSize *= 2;
+	}
+
+	pGrid->m_pCellStart = (int *)calloc( sizeof( int ), cCells + 1 );
+	pGrid->m_pCellNodes = (int *)calloc( sizeof( int ), m_cNodes );
+	pGrid->m_pCandidates = (NEAREST_CANDIDATE *)calloc( sizeof( NEAREST_CANDIDATE ), m_cNodes );
+
+	if ( !pGrid->m_pCellStart || !pGrid->m_pCellNodes || !pGrid->m_pCandidates )
+	{
+		ALERT ( at_aiconsole, "Couldn't allocate the node grid.\n" );
+		FreeNodeGrid();
+		return;
+	}
+
+	// count the nodes in each cell, turn the counts into offsets, then drop
+	// the nodes in. The nodes in a cell stay in index order.
+	for ( i = 0 ; i < m_cNodes ; i++ )
+	{
+		iCell = GridCell( m_pNodes[ i ].m_vecOriginPeek.x, pGrid->m_vecMins[0], pGrid->m_flCellSize );
+		iCell += GridCell( m_pNodes[ i ].m_vecOriginPeek.y, pGrid->m_vecMins[1], pGrid->m_flCellSize ) * pGrid->m_Size[0];
+		iCell += GridCell( m_pNodes[ i ].m_vecOriginPeek.z, pGrid->m_vecMins[2], pGrid->m_flCellSize ) * pGrid->m_Size[0] * pGrid->m_Size[1];
+		pGrid->m_pCellStart[ iCell + 1 ]++;
+	}
+
+	for ( i = 0 ; i < cCells ; i++ )
+	{
+		pGrid->m_pCellStart[ i + 1 ] += pGrid->m_pCellStart[ i ];
+	}
+
+	for ( i = 0 ; i < m_cNodes ; i++ )
+	{
+		iCell = GridCell( m_pNodes[ i ].m_vecOriginPeek.x, pGrid->m_vecMins[0], pGrid->m_flCellSize );
+		iCell += GridCell( m_pNodes[ i ].m_vecOriginPeek.y, pGrid->m_vecMins[1], pGrid->m_flCellSize ) * pGrid->m_Size[0];
+		iCell += GridCell( m_pNodes[ i ].m_vecOriginPeek.z, pGrid->m_vecMins[2], pGrid->m_flCellSize ) * pGrid->m_Size[0] * pGrid->m_Size[1];
+		pGrid->m_pCellNodes[ pGrid->m_pCellStart[ iCell ]++ ] = i;
+	}
+
+	// the drop moved every start to the next cell, move them back
+	for ( i = cCells ; i > 0 ; i-- )
+	{
+		pGrid->m_pCellStart[ i ] = pGrid->m_pCellStart[ i - 1 ];
+	}
+	pGrid->m_pCellStart[ 0 ] = 0;
+
+	pGrid->m_pNodes = m_pNodes;
+	pGrid->m_cNodes = m_cNodes;
+
+	ALERT ( at_aiconsole, "Node grid: %d x %d x %d cells of %d units\n", pGrid->m_Size[0], pGrid->m_Size[1], pGrid->m_Size[2], (int)pGrid->m_flCellSize );
+}
+
+//=========================================================
+// CGraph - FreeNodeGrid - also empties the nearest node
+// cache, its answers belong to the old graph.
+//=========================================================
+void CGraph :: FreeNodeGrid( void )
+{
+	NODE_GRID	*pGrid = &gNodeGrid;
+
+	if ( pGrid->m_pCellStart )
+		free ( pGrid->m_pCellStart );
+
+	if ( pGrid->m_pCellNodes )
+		free ( pGrid->m_pCellNodes );
+
+	if ( pGrid->m_pCandidates )
+		free ( pGrid->m_pCandidates );
+
+	memset( pGrid, 0, sizeof( NODE_GRID ) );
+}
+
+//=========================================================
+// GridGatherCell - adds the nodes of one grid cell that are
+// of the right type and closer than flShortest to the
+// candidate list.
+//=========================================================
+static int GridGatherCell( CGraph *pGraph, int x, int y, int z, const Vector &vecOrigin, int afNodeTypes, float flShortest, int cCandidates )
+{
+	NODE_GRID	*pGrid = &gNodeGrid;
+	int			iCell, i, iNode;
+	float		flDist;
+
+	iCell = ( z * pGrid->m_Size[1] + y ) * pGrid->m_Size[0] + x;
+
+	for ( i = pGrid->m_pCellStart[ iCell ] ; i < pGrid->m_pCellStart[ iCell + 1 ] ; i++ )
+	{
+		iNode = pGrid->m_pCellNodes[ i ];
+
+		if ( !( pGraph->m_pNodes[ iNode ].m_afNodeInfo & afNodeTypes ) )
+			continue;
+
+		flDist = ( vecOrigin - pGraph->m_pNodes[ iNode ].m_vecOriginPeek ).Length();
+
+		if ( flDist < flShortest )
+		{
+			pGrid->m_pCandidates[ cCandidates ].m_iNode = iNode;
+			pGrid->m_pCandidates[ cCandidates ].m_flDist = flDist;
+			cCandidates++;
+		}
+	}
+
+	return cCandidates;
+}
+
+//=========================================================
+// CGraph - FindNearestNodeInGrid - nearest node of the given
+// types that vecOrigin can trace to. Searches rings of cells
+// around vecOrigin's cell, nearest candidates of a ring are
+// traced first, and stops when the next ring can't hold
+// anything closer than what was found.
+//=========================================================
+int CGraph :: FindNearestNodeInGrid ( const Vector &vecOrigin, int afNodeTypes )
+{
+	NODE_GRID	*pGrid = &gNodeGrid;
+	int			iCell[3], iLo[3], iHi[3];
+	int			i, r, rMax, x, y, z;
+	int			cCandidates, iNode, iNearest;
+	float		flShortest;
+	TraceResult	tr;
+
+	if ( pGrid->m_pNodes != m_pNodes || pGrid->m_cNodes != m_cNodes || !m_cNodes )
+	{// no grid for this graph
+		return FindNearestNodeInRanges( vecOrigin, afNodeTypes );
+	}
+
+	rMax = 0;
+
+	for ( i = 0 ; i < 3 ; i++ )
+	{
+		iCell[i] = GridCell( vecOrigin[i], pGrid->m_vecMins[i], pGrid->m_flCellSize );
+		rMax = max( rMax, max( iCell[i], pGrid->m_Size[i] - 1 - iCell[i] ) );
+	}
+
+	iNearest = -1;
+	flShortest = 999999.0; // just a big number.
+
+	for ( r = 0 ; r <= rMax ; r++ )
+	{
+		// every node in ring r is at least r - 1 cells away
+		if ( ( r - 1 ) * pGrid->m_flCellSize >= flShortest )
+			break;
+
+		for ( i = 0 ; i < 3 ; i++ )
+		{
+			iLo[i] = max( 0, iCell[i] - r );
+			iHi[i] = min( pGrid->m_Size[i] - 1, iCell[i] + r );
+		}
+
+		cCandidates = 0;
+
+		for ( z = iLo[2] ; z <= iHi[2] ; z++ )
+		{
+			for ( y = iLo[1] ; y <= iHi[1] ; y++ )
+			{
+				if ( abs( z - iCell[2] ) == r || abs( y - iCell[1] ) == r )
+				{// the whole row is on the ring
+					for ( x = iLo[0] ; x <= iHi[0] ; x++ )
+					{
+						cCandidates = GridGatherCell( this, x, y, z, vecOrigin, afNodeTypes, flShortest, cCandidates );
+					}
+				}
+				else
+				{// only the two ends of the row
+					if ( iCell[0] - r >= 0 && iCell[0] - r < pGrid->m_Size[0] )
+						cCandidates = GridGatherCell( this, iCell[0] - r, y, z, vecOrigin, afNodeTypes, flShortest, cCandidates );
+
+					if ( iCell[0] + r >= 0 && iCell[0] + r < pGrid->m_Size[0] )
+						cCandidates = GridGatherCell( this, iCell[0] + r, y, z, vecOrigin, afNodeTypes, flShortest, cCandidates );
+				}
+			}
+		}
+
+		if ( !cCandidates )
+			continue;
+
+		qsort( pGrid->m_pCandidates, cCandidates, sizeof( NEAREST_CANDIDATE ), NearestCandidateCompare );
+
+		for ( i = 0 ; i < cCandidates ; i++ )
+		{
+			iNode = pGrid->m_pCandidates[ i ].m_iNode;
+
+			// make sure that vecOrigin can trace to this node!
+			UTIL_TraceLine ( vecOrigin, m_pNodes[ iNode ].m_vecOriginPeek, ignore_monsters, 0, &tr );
+
+			if ( tr.flFraction == 1.0 )
+			{
+				iNearest = iNode;
+				flShortest = pGrid->m_pCandidates[ i ].m_flDist;
+				break;
+			}
+		}
+	}
+
+	return iNearest;
+}
+
 //=========================================================
 // CGraph - FindNearestNode - returns the index of the node nearest
 // the given vector -1 is failure (couldn't find a valid
@@ -860,8 +1175,8 @@ int	CGraph :: FindNearestNode ( const Vector &vecOrigin,  CBaseEntity *pEntity )
 
 int	CGraph :: FindNearestNode ( const Vector &vecOrigin,  int afNodeTypes )
 {
-	int	i;
-	TraceResult tr;
+	NEAREST_CACHE_ENTRY	*pSet, *pEntry;
+	int		i;
 
 	if ( !m_fGraphPresent || !m_fGraphPointersSet )
 	{// protect us in the case that the node graph isn't available
@@ -869,19 +1184,49 @@ int	CGraph :: FindNearestNode ( const Vector &vecOrigin,  int afNodeTypes )
 		return -1;
 	}
 
-	// Check with the cache
-	//
-	ULONG iHash = (CACHE_SIZE-1) & Hash((void *)(const float *)vecOrigin, sizeof(vecOrigin));
-	if (m_Cache[iHash].v == vecOrigin)
+	if ( gfNearestRecording && gcNearestRecord < MAX_NEAREST_RECORD )
 	{
-		//ALERT(at_aiconsole, "Cache Hit.\n");
-		return m_Cache[iHash].n;
+		vecOrigin.CopyToArray( gpNearestRecord[ gcNearestRecord ].org );
+		gpNearestRecord[ gcNearestRecord ].types = afNodeTypes;
+		gcNearestRecord++;
 	}
-	else
+
+	// Check with the cache, replace the least recently used entry of the set on a miss
+	//
+	pSet = gNodeGrid.m_Cache[ ( Hash((void *)(const float *)vecOrigin, sizeof(vecOrigin)) + afNodeTypes ) & ( NEAREST_CACHE_SETS - 1 ) ];
+	pEntry = &pSet[ 0 ];
+
+	for ( i = 0 ; i < NEAREST_CACHE_WAYS ; i++ )
 	{
-		//ALERT(at_aiconsole, "Cache Miss.\n");
+		if ( pSet[ i ].age && pSet[ i ].types == afNodeTypes && pSet[ i ].v == vecOrigin )
+		{
+			pSet[ i ].age = ++gNodeGrid.m_iCacheAge;
+			gNodeGrid.m_cCacheHits++;
+			return pSet[ i ].n;
+		}
+
+		if ( pSet[ i ].age < pEntry->age )
+			pEntry = &pSet[ i ];
 	}
 
+	pEntry->v = vecOrigin;
+	pEntry->types = afNodeTypes;
+	pEntry->n = FindNearestNodeInGrid( vecOrigin, afNodeTypes );
+	pEntry->age = ++gNodeGrid.m_iCacheAge;
+
+	return pEntry->n;
+}
+
+//=========================================================
+// CGraph - FindNearestNodeInRanges - the old search through
+// the sorted range tables, no longer used by FindNearestNode.
+// Kept for graph_nearest_benchmark and as a fallback.
+//=========================================================
+int	CGraph :: FindNearestNodeInRanges ( const Vector &vecOrigin,  int afNodeTypes )
+{
+	int	i;
+	TraceResult tr;
+
 	// Mark all points as unchecked.
 	//
 	m_CheckedCounter++;
@@ -1063,8 +1408,6 @@ int	CGraph :: FindNearestNode ( const Vector &vecOrigin,  int afNodeTypes )
 		ALERT(at_aiconsole, "All that work for nothing.\n");
 	}
 #endif
-	m_Cache[iHash].v = vecOrigin;
-	m_Cache[iHash].n = m_iNearest;
 	return m_iNearest;
 }
 
@@ -1121,6 +1464,148 @@ void CGraph :: ShowNodeConnections ( int iNode )
 	}
 }
 
+//=========================================================
+// GraphParallelFor - runs the graph building jobs on the
+// engine's job threads, or one after another when the
+// engine doesn't provide them.
+//=========================================================
+static void GraphParallelFor( void (*func)( void *data, int index, int thread ), void *data, int count )
+{
+	if ( g_physfuncs.pfnParallelFor )
+	{
+		g_physfuncs.pfnParallelFor( func, data, count );
+		return;
+	}
+
+	for ( int i = 0 ; i < count ; i++ )
+	{
+		func( data, i, 0 );
+	}
+}
+
+static int GraphJobThreads( void )
+{
+	if ( g_physfuncs.pfnJobThreads )
+	{
+		return max( 1, g_physfuncs.pfnJobThreads() );
+	}
+
+	return 1;
+}
+
+//=========================================================
+// GraphTraceLine - the UTIL_TraceLine that LinkVisibleNodes
+// does, but safe to call from a job thread. Only fills in
+// fStartSolid, flFraction and pHit. Returns FALSE if the 
+// engine can't do this trace off the main thread.
+//=========================================================
+static BOOL GraphTraceLine( const Vector &vecStart, const Vector &vecEnd, TraceResult *ptr )
+{
+	float	vecZero[3] = { 0, 0, 0 };
+	trace_t	trace;
+	int		fSerial = TRUE;
+
+	if ( !g_physfuncs.pfnTraceBrushes )
+	{
+		return FALSE;
+	}
+
+	trace = g_physfuncs.pfnTraceBrushes( vecStart, vecZero, vecZero, vecEnd, ignore_monsters, g_pBodyQueueHead, &fSerial );
+
+	if ( fSerial )
+	{
+		return FALSE;
+	}
+
+	ptr->fStartSolid = trace.startsolid;
+	ptr->flFraction = trace.fraction;
+	ptr->pHit = trace.ent;
+
+	return TRUE;
+}
+
+//=========================================================
+// CGraph - FindVisibleLinks - the trace half of 
+// LinkVisibleNodes for a single node. Doesn't change
+// anything, so it runs on the job threads. Fills pCandidates
+// (m_cNodes long) with the nodes that iNode connects to, in
+// the order LinkVisibleNodes visits them, and stops after
+// MAX_NODE_INITIAL_LINKS certain ones. Returns the number of
+// candidates.
+//=========================================================
+int CGraph :: FindVisibleLinks ( int iNode, LINK_CANDIDATE *pCandidates )
+{
+	int			j;
+	int			cCandidates, cLinks;
+	BOOL		fRetrace;
+	edict_t		*pTraceEnt;
+	TraceResult	tr;
+
+	cCandidates = 0;
+	cLinks = 0;
+
+	for ( j = 0 ; j < m_cNodes && cLinks < MAX_NODE_INITIAL_LINKS ; j++ )
+	{
+		if ( j == iNode )
+		{// don't connect to self!
+			continue;
+		}
+
+		if ( (m_pNodes[ iNode ].m_afNodeInfo & bits_NODE_GROUP_REALM) != (m_pNodes[ j ].m_afNodeInfo & bits_NODE_GROUP_REALM) )
+		{
+			continue;
+		}
+
+		pTraceEnt = NULL;
+		fRetrace = !GraphTraceLine ( m_pNodes[ iNode ].m_vecOrigin, m_pNodes[ j ].m_vecOrigin, &tr );
+
+		if ( !fRetrace )
+		{
+			if ( tr.fStartSolid )
+				continue;
+
+			if ( tr.flFraction != 1.0 )
+			{// same as LinkVisibleNodes, only a brush ent may be in the way
+				pTraceEnt = tr.pHit;
+				fRetrace = !GraphTraceLine ( m_pNodes[ j ].m_vecOrigin, m_pNodes[ iNode ].m_vecOrigin, &tr );
+
+				if ( !fRetrace && ( tr.pHit != pTraceEnt || FClassnameIs( tr.pHit, "worldspawn" ) ) )
+					continue;
+			}
+		}
+
+		if ( fRetrace )
+		{// LinkVisibleNodes traces this one again on the main thread
+			pCandidates[ cCandidates ].m_iDestNode = -1 - j;
+			pCandidates[ cCandidates ].m_pLinkEnt = NULL;
+			cCandidates++;
+			continue;
+		}
+
+		pCandidates[ cCandidates ].m_iDestNode = j;
+		pCandidates[ cCandidates ].m_pLinkEnt = pTraceEnt;
+		cCandidates++;
+		cLinks++;
+	}
+
+	return cCandidates;
+}
+
+typedef struct
+{
+	CGraph			*m_pGraph;
+	LINK_CANDIDATE	*m_pCandidates;// m_cNodes for each node of the batch
+	int				m_cCandidates[ NODE_LINK_BATCH ];
+	int				m_iFirstNode;
+} LINK_JOB;
+
+static void LinkVisibleJob( void *data, int index, int thread )
+{
+	LINK_JOB *pJob = (LINK_JOB *)data;
+
+	pJob->m_cCandidates[ index ] = pJob->m_pGraph->FindVisibleLinks( pJob->m_iFirstNode + index, &pJob->m_pCandidates[ index * pJob->m_pGraph->m_cNodes ] );
+}
+
 //=========================================================
 // CGraph - LinkVisibleNodes - the first, most basic
 // function of node graph creation, this connects every
@@ -1129,15 +1614,22 @@ void CGraph :: ShowNodeConnections ( int iNode )
 // to write progress to. Returns the total number of initial
 // links.
 //
+// The traces for NODE_LINK_BATCH nodes at a time are done
+// on the job threads by FindVisibleLinks, then the results
+// are added to the pool here in the same order as before.
+//
 // If there's a problem with this process, the index
 // of the offending node will be written to piBadNode
 //=========================================================
 int CGraph :: LinkVisibleNodes ( CLink *pLinkPool, FILE *file, int *piBadNode )
 {
-	int			i,j,z;
+	int			i,j,z,c;
 	edict_t		*pTraceEnt;
 	int			cTotalLinks, cLinksThisNode, cMaxInitialLinks;
 	TraceResult	tr;
+	LINK_JOB	job;
+	LINK_CANDIDATE	*pCandidate;
+	int			cCandidates;
 	
 	// !!!BUGBUG - this function returns 0 if there is a problem in the middle of connecting the graph
 	// it also returns 0 if none of the nodes in a level can see each other. piBadNode is ALWAYS read
@@ -1152,6 +1644,15 @@ int CGraph :: LinkVisibleNodes ( CLink *pLinkPool, FILE *file, int *piBadNode )
 		return FALSE;
 	}
 
+	job.m_pGraph = this;
+	job.m_pCandidates = (LINK_CANDIDATE *)calloc ( sizeof ( LINK_CANDIDATE ), NODE_LINK_BATCH * m_cNodes );
+
+	if ( !job.m_pCandidates )
+	{
+		ALERT ( at_aiconsole, "**LinkVisibleNodes:\nCould not malloc candidates!\n" );
+		return FALSE;
+	}
+
 	// if the file pointer is bad, don't blow up, just don't write the
 	// file.
 	if ( !file )
@@ -1174,6 +1675,15 @@ int CGraph :: LinkVisibleNodes ( CLink *pLinkPool, FILE *file, int *piBadNode )
 
 	for ( i = 0 ; i < m_cNodes ; i++ )
 	{
+		if ( ( i % NODE_LINK_BATCH ) == 0 )
+		{// trace the next batch of nodes
+			job.m_iFirstNode = i;
+			GraphParallelFor( LinkVisibleJob, &job, min( NODE_LINK_BATCH, m_cNodes - i ) );
+		}
+
+		pCandidate = &job.m_pCandidates[ ( i % NODE_LINK_BATCH ) * m_cNodes ];
+		cCandidates = job.m_cCandidates[ i % NODE_LINK_BATCH ];
+
 		cLinksThisNode = 0;// reset this count for each node.
 
 		if ( file )
@@ -1190,77 +1700,64 @@ int CGraph :: LinkVisibleNodes ( CLink *pLinkPool, FILE *file, int *piBadNode )
 
 		m_pNodes [ i ].m_iFirstLink = cTotalLinks;
 
-		// now build a list of every other node that this node can see
-		for ( j = 0 ; j < m_cNodes ; j++ )
+		// now add every other node that this node can see
+		for ( c = 0 ; c < cCandidates ; c++ )
   		{
-			if ( j == i )
-			{// don't connect to self!
-				continue;
-			}
+			j = pCandidate[ c ].m_iDestNode;
+			pTraceEnt = pCandidate[ c ].m_pLinkEnt;
 
-#if 0
-			
-			if ( (m_pNodes[ i ].m_afNodeInfo & bits_NODE_WATER) != (m_pNodes[ j ].m_afNodeInfo & bits_NODE_WATER) )
-			{
-				// don't connect water nodes to air nodes or land nodes. It just wouldn't be prudent at this juncture.
-				continue;
-			}
-#else
-			if ( (m_pNodes[ i ].m_afNodeInfo & bits_NODE_GROUP_REALM) != (m_pNodes[ j ].m_afNodeInfo & bits_NODE_GROUP_REALM) )
-			{
-				// don't connect air nodes to water nodes to land nodes. It just wouldn't be prudent at this juncture.
-				continue;
-			}
-#endif
+			if ( j < 0 )
+			{// the job couldn't trace this connection, do it here.
+				j = -1 - j;
 
-			tr.pHit = NULL;// clear every time so we don't get stuck with last trace's hit ent
-			pTraceEnt = 0;
+				tr.pHit = NULL;// clear every time so we don't get stuck with last trace's hit ent
+				pTraceEnt = 0;
 
-			UTIL_TraceLine ( m_pNodes[ i ].m_vecOrigin,
-							 m_pNodes[ j ].m_vecOrigin,
-							 ignore_monsters,
-							 g_pBodyQueueHead,//!!!HACKHACK no real ent to supply here, using a global we don't care about
-							 &tr );
-			
-			
-			if ( tr.fStartSolid )
-				continue;
-
-			if ( tr.flFraction != 1.0 )
-			{// trace hit a brush ent, trace backwards to make sure that this ent is the only thing in the way.
-				
-				pTraceEnt = tr.pHit;// store the ent that the trace hit, for comparison
-	
-				UTIL_TraceLine ( m_pNodes[ j ].m_vecOrigin,
-								 m_pNodes[ i ].m_vecOrigin,
+				UTIL_TraceLine ( m_pNodes[ i ].m_vecOrigin,
+								 m_pNodes[ j ].m_vecOrigin,
 								 ignore_monsters,
 								 g_pBodyQueueHead,//!!!HACKHACK no real ent to supply here, using a global we don't care about
 								 &tr );
+				
+				if ( tr.fStartSolid )
+					continue;
 
+				if ( tr.flFraction != 1.0 )
+				{// trace hit a brush ent, trace backwards to make sure that this ent is the only thing in the way.
+					
+					pTraceEnt = tr.pHit;// store the ent that the trace hit, for comparison
+		
+					UTIL_TraceLine ( m_pNodes[ j ].m_vecOrigin,
+									 m_pNodes[ i ].m_vecOrigin,
+									 ignore_monsters,
+									 g_pBodyQueueHead,//!!!HACKHACK no real ent to supply here, using a global we don't care about
+									 &tr );
+
+					if ( tr.pHit != pTraceEnt || FClassnameIs( tr.pHit, "worldspawn" ) )
+					{// even if the ent wasn't there, these nodes couldn't be connected. Skip.
+						continue;
+					}
+				}
+			}
 				
 // there is a solid_bsp ent in the way of these two nodes, so we must record several things about in order to keep
 // track of it in the pathfinding code, as well as through save and restore of the node graph. ANY data that is manipulated 
 // as part of the process of adding a LINKENT to a connection here must also be done in CGraph::SetGraphPointers, where reloaded
 // graphs are prepared for use.
-				if ( tr.pHit == pTraceEnt && !FClassnameIs( tr.pHit, "worldspawn" ) )
-				{
-					// get a pointer
-					pLinkPool [ cTotalLinks ].m_pLinkEnt = VARS( tr.pHit );
+			if ( pTraceEnt )
+			{
+				// get a pointer
+				pLinkPool [ cTotalLinks ].m_pLinkEnt = VARS( pTraceEnt );
 
-					// record the modelname, so that we can save/load node trees
-					memcpy( pLinkPool [ cTotalLinks ].m_szLinkEntModelname, STRING( VARS(tr.pHit)->model ), 4 );
+				// record the modelname, so that we can save/load node trees
+				memcpy( pLinkPool [ cTotalLinks ].m_szLinkEntModelname, STRING( VARS(pTraceEnt)->model ), 4 );
 
-					// set the flag for this ent that indicates that it is attached to the world graph
-					// if this ent is removed from the world, it must also be removed from the connections
-					// that it formerly blocked.
-					if ( !FBitSet( VARS( tr.pHit )->flags, FL_GRAPHED ) )
-					{
-						VARS( tr.pHit )->flags += FL_GRAPHED;
-					}
-				}
-				else
-				{// even if the ent wasn't there, these nodes couldn't be connected. Skip.
-					continue;
+				// set the flag for this ent that indicates that it is attached to the world graph
+				// if this ent is removed from the world, it must also be removed from the connections
+				// that it formerly blocked.
+				if ( !FBitSet( VARS( pTraceEnt )->flags, FL_GRAPHED ) )
+				{
+					VARS( pTraceEnt )->flags += FL_GRAPHED;
 				}
 			}
 
@@ -1270,7 +1767,7 @@ int CGraph :: LinkVisibleNodes ( CLink *pLinkPool, FILE *file, int *piBadNode )
 
 				if ( !FNullEnt( pLinkPool[ cTotalLinks ].m_pLinkEnt ) )
 				{// record info about the ent in the way, if any.
-					fprintf ( file, "  Entity on connection: %s, name: %s  Model: %s", STRING( VARS( pTraceEnt )->classname ), STRING ( VARS( pTraceEnt )->targetname ), STRING ( VARS(tr.pHit)->model ) );
+					fprintf ( file, "  Entity on connection: %s, name: %s  Model: %s", STRING( VARS( pTraceEnt )->classname ), STRING ( VARS( pTraceEnt )->targetname ), STRING ( VARS(pTraceEnt)->model ) );
 				}
 				
 				fprintf ( file, "\n", j );
@@ -1287,12 +1784,14 @@ int CGraph :: LinkVisibleNodes ( CLink *pLinkPool, FILE *file, int *piBadNode )
 				ALERT ( at_aiconsole, "**LinkVisibleNodes:\nNode %d has NodeLinks > MAX_NODE_INITIAL_LINKS", i );
 				fprintf ( file, "** NODE %d HAS NodeLinks > MAX_NODE_INITIAL_LINKS **\n", i );
 				*piBadNode = i;
+				free ( job.m_pCandidates );
 				return	FALSE;
 			}
 			else if ( cTotalLinks > MAX_NODE_INITIAL_LINKS * m_cNodes )
 			{// this is paranoia
 				ALERT ( at_aiconsole, "**LinkVisibleNodes:\nTotalLinks > MAX_NODE_INITIAL_LINKS * NUMNODES" );
 				*piBadNode = i;
+				free ( job.m_pCandidates );
 				return	FALSE;
 			}
 
@@ -1319,6 +1818,8 @@ int CGraph :: LinkVisibleNodes ( CLink *pLinkPool, FILE *file, int *piBadNode )
 		}
 	}
 
+	free ( job.m_pCandidates );
+
 	fprintf ( file, "\n%4d Total Initial Connections - %4d Maximum connections for a single node.\n", cTotalLinks, cMaxInitialLinks );
 	fprintf ( file, "----------------------------------------------------------------------------\n\n\n" );
 
@@ -1631,6 +2132,8 @@ void CTestHull :: BuildNodeGraph( void )
 	float	flDist;
 	int		step;
 
+	float	flStartTime = g_engfuncs.pfnTime();
+
 	SetThink ( SUB_Remove );// no matter what happens, the hull gets rid of itself.
 	pev->nextthink = gpGlobals->time;
 
@@ -2049,7 +2552,7 @@ void CTestHull :: BuildNodeGraph( void )
 
 // save the node graph for this level	
 	WorldGraph.FSaveGraph( (char *)STRING( gpGlobals->mapname ) );
-	ALERT( at_console, "Done.\n");
+	ALERT( at_console, "Done (%.2f seconds).\n", g_engfuncs.pfnTime() - flStartTime );
 }
 
 
@@ -2591,6 +3094,8 @@ int CGraph :: FSetGraphPointers ( void )
 		}
 	}
 
+	BuildNodeGrid();
+
 	// the pointers are now set.
 	m_fGraphPointersSet = TRUE;
 	return TRUE;
@@ -3024,98 +3529,283 @@ void CGraph::BuildRegionTables(void)
 	// Initialize the cache.
 	//
 	memset(m_Cache, 0, sizeof(m_Cache));
+
+	BuildNodeGrid();
 }
 
-void CGraph :: ComputeStaticRoutingTables( void )
-{
-	int nRoutes = m_cNodes*m_cNodes;
 #define FROM_TO(x,y) ((x)*m_cNodes+(y))
-	short *Routes = new short[nRoutes];
-
-	int *pMyPath = new int[m_cNodes];
-	unsigned short *BestNextNodes = new unsigned short[m_cNodes];
-	char *pRoute = new char[m_cNodes*2];
 
+//=========================================================
+// CGraph - ComputeLinkPassable - asks HandleLinkEnt about
+// every link ent once, so the route searches don't have to
+// touch entities. pPassable is m_cLinks long for each of
+// the two capability masks.
+//=========================================================
+void CGraph :: ComputeLinkPassable( char *pPassable )
+{
+	int		iCap, iCapMask, i;
 
-	if (Routes && pMyPath && BestNextNodes && pRoute)
+	for ( iCap = 0 ; iCap < 2 ; iCap++ )
 	{
-		int nTotalCompressedSize = 0;
-		for (int iHull = 0; iHull < MAX_NODE_HULLS; iHull++)
+		iCapMask = iCap ? ( bits_CAP_OPEN_DOORS | bits_CAP_AUTO_DOORS | bits_CAP_USE ) : 0;
+
+		for ( i = 0 ; i < m_cLinks ; i++ )
 		{
-			for (int iCap = 0; iCap < 2; iCap++)
+			if ( m_pLinkPool[ i ].m_pLinkEnt == NULL )
 			{
-				int iCapMask;
-				switch (iCap)
-				{
-				case 0:
-					iCapMask = 0;
-					break;
+				pPassable[ iCap * m_cLinks + i ] = TRUE;
+			}
+			else
+			{
+				pPassable[ iCap * m_cLinks + i ] = HandleLinkEnt ( m_pLinkPool[ i ].m_iSrcNode, m_pLinkPool[ i ].m_pLinkEnt, iCapMask, NODEGRAPH_STATIC ) ? TRUE : FALSE;
+			}
+		}
+	}
+}
 
-				case 1:
-					iCapMask = bits_CAP_OPEN_DOORS | bits_CAP_AUTO_DOORS | bits_CAP_USE;
-					break;
-				}
+//=========================================================
+// CGraph - FindStaticPath - the search FindShortestPath
+// does while the routing tables aren't complete, with the
+// search state in the caller's arrays (m_cNodes long) and
+// link ents looked up in pPassable, so that it can run on
+// a job thread. Must find exactly the same paths.
+//=========================================================
+int CGraph :: FindStaticPath ( int *piPath, int iStart, int iDest, int iHull, const char *pPassable, float *pflClosest, int *piPrevious )
+{
+	int		iVisitNode;
+	int		iCurrentNode;
+	int		iNumPathNodes;
+	int		iHullMask;
+	int		iLink;
+	int		i;
+	float	flCurrentDistance;
+	float	flOurDistance;
+	CQueuePriority	queue;
+
+	if ( !m_fGraphPresent || !m_fGraphPointersSet )
+	{
+		return FALSE;
+	}
 
+	if ( iStart < 0 || iStart > m_cNodes )
+	{
+		return FALSE;
+	}
 
-				// Initialize Routing table to uncalculated.
-				//
-				for (int iFrom = 0; iFrom < m_cNodes; iFrom++)
+	if (iStart == iDest)
+	{
+		piPath[0] = iStart;
+		piPath[1] = iDest;
+		return 2;
+	}
+
+	switch( iHull )
+	{
+	case NODE_SMALL_HULL:
+		iHullMask = bits_LINK_SMALL_HULL;
+		break;
+	case NODE_HUMAN_HULL:
+		iHullMask = bits_LINK_HUMAN_HULL;
+		break;
+	case NODE_LARGE_HULL:
+		iHullMask = bits_LINK_LARGE_HULL;
+		break;
+	case NODE_FLY_HULL:
+		iHullMask = bits_LINK_FLY_HULL;
+		break;
+	}
+
+	// Mark all the nodes as unvisited.
+	//
+	for ( i = 0; i < m_cNodes; i++)
+	{
+		pflClosest[ i ] = -1.0;
+	}
+
+	pflClosest[ iStart ] = 0.0;
+	piPrevious[ iStart ] = iStart;// tag this as the origin node
+	queue.Insert( iStart, 0.0 );// insert start node 
+	
+	while ( !queue.Empty() )
+	{
+		// now pull a node out of the queue
+		iCurrentNode = queue.Remove(flCurrentDistance);
+
+		if (iCurrentNode == iDest) break;
+
+		for ( i = 0 ; i < m_pNodes[ iCurrentNode ].m_cNumLinks ; i++ )
+		{// run through all of this node's neighbors
+			iLink = m_pNodes[ iCurrentNode ].m_iFirstLink + i;
+			iVisitNode = m_pLinkPool[ iLink ].m_iDestNode;
+
+			if ( ( m_pLinkPool[ iLink ].m_afLinkInfo & iHullMask ) != iHullMask )
+			{// monster is too large to walk this connection
+				continue;
+			}
+
+			if ( !pPassable[ iLink ] )
+			{// brush ent in the way that the monster can't negotiate
+				continue;
+			}
+
+			flOurDistance = flCurrentDistance + m_pLinkPool[ iLink ].m_flWeight;
+			if (  pflClosest[ iVisitNode ] < -0.5
+			   || flOurDistance < pflClosest[ iVisitNode ] - 0.001 )
+			{
+				pflClosest[ iVisitNode ] = flOurDistance;
+				piPrevious[ iVisitNode ] = iCurrentNode;
+
+				queue.Insert ( iVisitNode, flOurDistance );
+			}
+		}
+	}
+
+	if ( pflClosest[ iDest ] < -0.5 )
+	{// Destination is unreachable, no path found.
+		return 0;
+	}
+
+	// now we must walk backwards through the previous nodes, and count how many connections there are in the path
+	iCurrentNode = iDest;
+	iNumPathNodes = 1;// count the dest
+	
+	while ( iCurrentNode != iStart )
+	{
+		iNumPathNodes++;
+		iCurrentNode = piPrevious[ iCurrentNode ];
+	}
+
+	iCurrentNode = iDest;
+	for ( i = iNumPathNodes - 1 ; i >= 0 ; i-- )
+	{
+		piPath[ i ] = iCurrentNode;
+		iCurrentNode = piPrevious[ iCurrentNode ];
+	}
+
+	return iNumPathNodes;
+}
+
+//=========================================================
+// CGraph - BuildRouteTable - fills the uncompressed
+// m_cNodes * m_cNodes table of best next nodes for one hull
+// and capability mask. Each table only depends on the graph,
+// so ComputeStaticRoutingTables builds them in parallel.
+//=========================================================
+void CGraph :: BuildRouteTable( short *Routes, int iHull, const char *pPassable, int *pMyPath, float *pflClosest, int *piPrevious )
+{
+	int		iFrom, iTo, iNode, iNode1;
+	int		cPathSize;
+
+	// Initialize Routing table to uncalculated.
+	//
+	for (iFrom = 0; iFrom < m_cNodes; iFrom++)
+	{
+		for (iTo = 0; iTo < m_cNodes; iTo++)
+		{
+			Routes[FROM_TO(iFrom, iTo)] = -1;
+		}
+	}
+
+	for (iFrom = 0; iFrom < m_cNodes; iFrom++)
+	{
+		for (iTo = m_cNodes-1; iTo >= 0; iTo--)
+		{
+			if (Routes[FROM_TO(iFrom, iTo)] != -1) continue;
+
+			cPathSize = FindStaticPath(pMyPath, iFrom, iTo, iHull, pPassable, pflClosest, piPrevious);
+
+			// Use the computed path to update the routing table.
+			//
+			if (cPathSize > 1)
+			{
+				for (iNode = 0; iNode < cPathSize-1; iNode++)
 				{
-					for (int iTo = 0; iTo < m_cNodes; iTo++)
+					int iStart = pMyPath[iNode];
+					int iNext  = pMyPath[iNode+1];
+					for (iNode1 = iNode+1; iNode1 < cPathSize; iNode1++)
 					{
-						Routes[FROM_TO(iFrom, iTo)] = -1;
+						int iEnd = pMyPath[iNode1];
+						Routes[FROM_TO(iStart, iEnd)] = iNext;
 					}
 				}
+			}
+			else
+			{
+				Routes[FROM_TO(iFrom, iTo)] = iFrom;
+				Routes[FROM_TO(iTo, iFrom)] = iTo;
+			}
+		}
+	}
+}
 
-				for (iFrom = 0; iFrom < m_cNodes; iFrom++)
-				{
-					for (int iTo = m_cNodes-1; iTo >= 0; iTo--)
-					{
-						if (Routes[FROM_TO(iFrom, iTo)] != -1) continue;
+typedef struct
+{
+	CGraph	*m_pGraph;
+	short	*m_pRoutes;		// one table per slot
+	int		*m_pMyPath;		// search state, m_cNodes per slot
+	float	*m_pflClosest;
+	int		*m_piPrevious;
+	char	*m_pPassable;	// ComputeLinkPassable
+	int		m_iFirstTable;	// iHull * 2 + iCap of slot 0
+} ROUTE_JOB;
+
+static void RouteTableJob( void *data, int index, int thread )
+{
+	ROUTE_JOB	*pJob = (ROUTE_JOB *)data;
+	CGraph		*pGraph = pJob->m_pGraph;
+	int			iTable = pJob->m_iFirstTable + index;
+	int			iOffset = index * pGraph->m_cNodes;
 
-						int cPathSize = FindShortestPath(pMyPath, iFrom, iTo, iHull, iCapMask);
+	pGraph->BuildRouteTable( pJob->m_pRoutes + iOffset * pGraph->m_cNodes, iTable / 2, pJob->m_pPassable + ( iTable % 2 ) * pGraph->m_cLinks,
+		pJob->m_pMyPath + iOffset, pJob->m_pflClosest + iOffset, pJob->m_piPrevious + iOffset );
+}
 
-						// Use the computed path to update the routing table.
-						//
-						if (cPathSize > 1)
-						{
-							for (int iNode = 0; iNode < cPathSize-1; iNode++)
-							{
-								int iStart = pMyPath[iNode];
-								int iNext  = pMyPath[iNode+1];
-								for (int iNode1 = iNode+1; iNode1 < cPathSize; iNode1++)
-								{
-									int iEnd = pMyPath[iNode1];
-									Routes[FROM_TO(iStart, iEnd)] = iNext;
-								}
-							}
-#if 0
-							// Well, at first glance, this should work, but actually it's safer
-							// to be told explictly that you can take a series of node in a
-							// particular direction. Some links don't appear to have links in
-							// the opposite direction.
-							//
-							for (iNode = cPathSize-1; iNode >= 1; iNode--)
-							{
-								int iStart = pMyPath[iNode];
-								int iNext  = pMyPath[iNode-1];
-								for (int iNode1 = iNode-1; iNode1 >= 0; iNode1--)
-								{
-									int iEnd = pMyPath[iNode1];
-									Routes[FROM_TO(iStart, iEnd)] = iNext;
-								}
-							}
-#endif
-						}
-						else
-						{
-							Routes[FROM_TO(iFrom, iTo)] = iFrom;
-							Routes[FROM_TO(iTo, iFrom)] = iTo;
-						}
-					}
-				}
+void CGraph :: ComputeStaticRoutingTables( void )
+{
+	int nRoutes = m_cNodes*m_cNodes;
+	int cSlots = min( MAX_NODE_HULLS * 2, GraphJobThreads() );
+	short *RouteTables = new short[nRoutes * cSlots];
+
+	int *pMyPath = new int[m_cNodes * cSlots];
+	float *pflClosest = new float[m_cNodes * cSlots];
+	int *piPrevious = new int[m_cNodes * cSlots];
+	char *pPassable = new char[m_cLinks * 2 + 1];
+	unsigned short *BestNextNodes = new unsigned short[m_cNodes];
+	char *pRoute = new char[m_cNodes*2];
+	ROUTE_JOB job;
+
+
+	if (RouteTables && pMyPath && pflClosest && piPrevious && pPassable && BestNextNodes && pRoute)
+	{
+		int nTotalCompressedSize = 0;
+
+		ComputeLinkPassable( pPassable );
+
+		job.m_pGraph = this;
+		job.m_pRoutes = RouteTables;
+		job.m_pMyPath = pMyPath;
+		job.m_pflClosest = pflClosest;
+		job.m_piPrevious = piPrevious;
+		job.m_pPassable = pPassable;
+
+		// The table for each hull and capability only depends on the graph.
+		// Build as many as there are job threads at once, then compress them
+		// in the same order as they were built one by one.
+		//
+		for (int iFirstTable = 0; iFirstTable < MAX_NODE_HULLS * 2; iFirstTable += cSlots)
+		{
+			int cTables = min( cSlots, MAX_NODE_HULLS * 2 - iFirstTable );
+
+			job.m_iFirstTable = iFirstTable;
+			GraphParallelFor( RouteTableJob, &job, cTables );
+
+			for (int iTable = 0; iTable < cTables; iTable++)
+			{
+				int iHull = ( iFirstTable + iTable ) / 2;
+				int iCap = ( iFirstTable + iTable ) % 2;
+				short *Routes = RouteTables + iTable * nRoutes;
 
-				for (iFrom = 0; iFrom < m_cNodes; iFrom++)
+				for (int iFrom = 0; iFrom < m_cNodes; iFrom++)
 				{
 					for (int iTo = 0; iTo < m_cNodes; iTo++)
 					{
@@ -3311,14 +4001,20 @@ void CGraph :: ComputeStaticRoutingTables( void )
 		}		
 		ALERT( at_aiconsole, "Size of Routes = %d\n", nTotalCompressedSize);
 	}
-	if (Routes) delete Routes;
-	if (BestNextNodes) delete BestNextNodes;
-	if (pRoute) delete pRoute;
-	if (pMyPath) delete pMyPath;
-	Routes = 0;
+	if (RouteTables) delete [] RouteTables;
+	if (BestNextNodes) delete [] BestNextNodes;
+	if (pRoute) delete [] pRoute;
+	if (pMyPath) delete [] pMyPath;
+	if (pflClosest) delete [] pflClosest;
+	if (piPrevious) delete [] piPrevious;
+	if (pPassable) delete [] pPassable;
+	RouteTables = 0;
 	BestNextNodes = 0;
 	pRoute = 0;
 	pMyPath = 0;
+	pflClosest = 0;
+	piPrevious = 0;
+	pPassable = 0;
 
 #if 0
 	TestRoutingTables();
@@ -3326,6 +4022,331 @@ void CGraph :: ComputeStaticRoutingTables( void )
 	m_fRoutingComplete = TRUE;
 }
 
+//=========================================================
+// GraphBenchmark - "graph_benchmark" server command. Runs
+// the link traces and the routing table searches for the
+// loaded graph on the main thread and on the job threads,
+// times both and checks that they agree. The graph itself
+// isn't changed, so this can be run on a dedicated server.
+//=========================================================
+void GraphBenchmark( void )
+{
+	CGraph		*pGraph = &WorldGraph;
+	LINK_JOB	job;
+	ROUTE_JOB	routeJob;
+	int			i, j, k, cBatch, cSlots, cTables, cRetrace;
+	int			nRoutes;
+	int			iCandidateSize;
+	int			cSerial[ NODE_LINK_BATCH ];
+	LINK_CANDIDATE	*pSerial;
+	short		*pSerialRoutes;
+	float		flStart, flLinkSerial, flLinkParallel, flRouteSerial, flRouteParallel;
+	BOOL		fMatch;
+
+	if ( !pGraph->m_fGraphPresent || !pGraph->m_fGraphPointersSet || pGraph->m_cNodes <= 0 )
+	{
+		SERVER_PRINT( "graph_benchmark: no node graph loaded\n" );
+		return;
+	}
+
+	fMatch = TRUE;
+	cRetrace = 0;
+	flLinkSerial = flLinkParallel = 0;
+	iCandidateSize = NODE_LINK_BATCH * pGraph->m_cNodes;
+
+	job.m_pGraph = pGraph;
+	job.m_pCandidates = (LINK_CANDIDATE *)calloc ( sizeof ( LINK_CANDIDATE ), iCandidateSize * 2 );
+
+	if ( !job.m_pCandidates )
+	{
+		SERVER_PRINT( "graph_benchmark: out of memory\n" );
+		return;
+	}
+
+	pSerial = job.m_pCandidates + iCandidateSize;
+
+	// the land nodes are NODE_HEIGHT lower than when the graph was built,
+	// so the traces won't match the graph's links, only each other.
+	for ( i = 0 ; i < pGraph->m_cNodes ; i += NODE_LINK_BATCH )
+	{
+		cBatch = min( NODE_LINK_BATCH, pGraph->m_cNodes - i );
+
+		flStart = g_engfuncs.pfnTime();
+		for ( j = 0 ; j < cBatch ; j++ )
+		{
+			cSerial[ j ] = pGraph->FindVisibleLinks( i + j, &pSerial[ j * pGraph->m_cNodes ] );
+		}
+		flLinkSerial += g_engfuncs.pfnTime() - flStart;
+
+		job.m_iFirstNode = i;
+		flStart = g_engfuncs.pfnTime();
+		GraphParallelFor( LinkVisibleJob, &job, cBatch );
+		flLinkParallel += g_engfuncs.pfnTime() - flStart;
+
+		for ( j = 0 ; j < cBatch ; j++ )
+		{
+			if ( cSerial[ j ] != job.m_cCandidates[ j ] || memcmp( &pSerial[ j * pGraph->m_cNodes ], &job.m_pCandidates[ j * pGraph->m_cNodes ], sizeof( LINK_CANDIDATE ) * cSerial[ j ] ) )
+				fMatch = FALSE;
+
+			for ( k = 0 ; k < cSerial[ j ] ; k++ )
+			{
+				if ( pSerial[ j * pGraph->m_cNodes + k ].m_iDestNode < 0 )
+					cRetrace++;
+			}
+		}
+	}
+
+	free ( job.m_pCandidates );
+
+	nRoutes = pGraph->m_cNodes * pGraph->m_cNodes;
+	cSlots = min( MAX_NODE_HULLS * 2, GraphJobThreads() );
+	flRouteSerial = flRouteParallel = 0;
+
+	routeJob.m_pGraph = pGraph;
+	routeJob.m_pRoutes = new short[nRoutes * cSlots];
+	routeJob.m_pMyPath = new int[pGraph->m_cNodes * cSlots];
+	routeJob.m_pflClosest = new float[pGraph->m_cNodes * cSlots];
+	routeJob.m_piPrevious = new int[pGraph->m_cNodes * cSlots];
+	routeJob.m_pPassable = new char[pGraph->m_cLinks * 2 + 1];
+	pSerialRoutes = new short[nRoutes];
+
+	if ( routeJob.m_pRoutes && routeJob.m_pMyPath && routeJob.m_pflClosest && routeJob.m_piPrevious && routeJob.m_pPassable && pSerialRoutes )
+	{
+		pGraph->ComputeLinkPassable( routeJob.m_pPassable );
+
+		for ( i = 0 ; i < MAX_NODE_HULLS * 2 ; i += cSlots )
+		{
+			cTables = min( cSlots, MAX_NODE_HULLS * 2 - i );
+
+			routeJob.m_iFirstTable = i;
+			flStart = g_engfuncs.pfnTime();
+			GraphParallelFor( RouteTableJob, &routeJob, cTables );
+			flRouteParallel += g_engfuncs.pfnTime() - flStart;
+
+			for ( j = 0 ; j < cTables ; j++ )
+			{
+				flStart = g_engfuncs.pfnTime();
+				pGraph->BuildRouteTable( pSerialRoutes, ( i + j ) / 2, routeJob.m_pPassable + ( ( i + j ) % 2 ) * pGraph->m_cLinks,
+					routeJob.m_pMyPath, routeJob.m_pflClosest, routeJob.m_piPrevious );
+				flRouteSerial += g_engfuncs.pfnTime() - flStart;
+
+				if ( memcmp( pSerialRoutes, routeJob.m_pRoutes + j * nRoutes, sizeof( short ) * nRoutes ) )
+					fMatch = FALSE;
+			}
+		}
+	}
+	else
+	{
+		SERVER_PRINT( "graph_benchmark: out of memory for the routing tables\n" );
+	}
+
+	if ( routeJob.m_pRoutes ) delete [] routeJob.m_pRoutes;
+	if ( routeJob.m_pMyPath ) delete [] routeJob.m_pMyPath;
+	if ( routeJob.m_pflClosest ) delete [] routeJob.m_pflClosest;
+	if ( routeJob.m_piPrevious ) delete [] routeJob.m_piPrevious;
+	if ( routeJob.m_pPassable ) delete [] routeJob.m_pPassable;
+	if ( pSerialRoutes ) delete [] pSerialRoutes;
+
+	SERVER_PRINT( UTIL_VarArgs( "%d nodes, %d links, %d job threads\n", pGraph->m_cNodes, pGraph->m_cLinks, GraphJobThreads() ) );
+	SERVER_PRINT( UTIL_VarArgs( "link traces:    %.3f sec serial, %.3f sec parallel, %d traced again on the main thread\n", flLinkSerial, flLinkParallel, cRetrace ) );
+	SERVER_PRINT( UTIL_VarArgs( "routing tables: %.3f sec serial, %.3f sec parallel\n", flRouteSerial, flRouteParallel ) );
+	SERVER_PRINT( fMatch ? "serial and parallel results match\n" : "serial and parallel results DIFFER!\n" );
+}
+
+//=========================================================
+// GraphNearestRecord - "graph_nearest_record" server command.
+// Starts keeping the FindNearestNode queries, used again it
+// stops and writes them to maps/graphs/<map>.nnq where
+// graph_nearest_benchmark picks them up.
+//=========================================================
+void GraphNearestRecord( void )
+{
+	char	szFilename[MAX_PATH];
+	FILE	*file;
+
+	if ( !gfNearestRecording )
+	{
+		if ( !gpNearestRecord )
+			gpNearestRecord = (NEAREST_QUERY *)calloc ( sizeof ( NEAREST_QUERY ), MAX_NEAREST_RECORD );
+
+		if ( !gpNearestRecord )
+		{
+			SERVER_PRINT( "graph_nearest_record: out of memory\n" );
+			return;
+		}
+
+		gcNearestRecord = 0;
+		gfNearestRecording = TRUE;
+		SERVER_PRINT( UTIL_VarArgs( "recording up to %d nearest node queries, graph_nearest_record again to stop\n", MAX_NEAREST_RECORD ) );
+		return;
+	}
+
+	gfNearestRecording = FALSE;
+
+	// make sure directories have been made
+	GET_GAME_DIR( szFilename );
+	strcat( szFilename, "/maps" );
+	CreateDirectory( szFilename, NULL );
+	strcat( szFilename, "/graphs" );
+	CreateDirectory( szFilename, NULL );
+
+	strcat( szFilename, "/" );
+	strcat( szFilename, STRING( gpGlobals->mapname ) );
+	strcat( szFilename, ".nnq" );
+
+	file = fopen ( szFilename, "wb" );
+
+	if ( !file )
+	{
+		SERVER_PRINT( UTIL_VarArgs( "graph_nearest_record: couldn't create %s\n", szFilename ) );
+		return;
+	}
+
+	fwrite ( &gcNearestRecord, sizeof ( int ), 1, file );
+	fwrite ( gpNearestRecord, sizeof ( NEAREST_QUERY ), gcNearestRecord, file );
+	fclose ( file );
+
+	SERVER_PRINT( UTIL_VarArgs( "%d queries written to %s\n", gcNearestRecord, szFilename ) );
+}
+
+//=========================================================
+// GraphNearestBenchmark - "graph_nearest_benchmark" server
+// command. Replays the queries recorded for this map, or a
+// few around every node if there are none, through the range
+// tables, the grid and the cached grid, and reports queries
+// per second and where the range tables and the grid differ.
+//=========================================================
+void GraphNearestBenchmark( void )
+{
+	static float	rgflOffsets[4][3] = { { 0, 0, 0 }, { 48, 16, 0 }, { -96, 64, 8 }, { 24, -160, 32 } };
+	CGraph		*pGraph = &WorldGraph;
+	char		szFilename[MAX_PATH];
+	NEAREST_QUERY	*pQueries;
+	byte		*pMemFile;
+	int			*pRanges, *pGrid;
+	int			length, cQueries, cDiffer, cHits, i;
+	float		flStart, flRanges, flGrid, flCached;
+	BOOL		fRecording;
+
+	if ( !pGraph->m_fGraphPresent || !pGraph->m_fGraphPointersSet || pGraph->m_cNodes <= 0 )
+	{
+		SERVER_PRINT( "graph_nearest_benchmark: no node graph loaded\n" );
+		return;
+	}
+
+	strcpy ( szFilename, "maps/graphs/" );
+	strcat ( szFilename, STRING( gpGlobals->mapname ) );
+	strcat ( szFilename, ".nnq" );
+
+	pMemFile = LOAD_FILE_FOR_ME( szFilename, &length );
+
+	if ( pMemFile && length >= (int)sizeof ( int ) )
+	{
+		memcpy ( &cQueries, pMemFile, sizeof ( int ) );
+		cQueries = max( 0, min( cQueries, (int)( ( length - sizeof ( int ) ) / sizeof ( NEAREST_QUERY ) ) ) );
+		pQueries = (NEAREST_QUERY *)calloc ( sizeof ( NEAREST_QUERY ), cQueries + 1 );
+
+		if ( pQueries )
+			memcpy ( pQueries, pMemFile + sizeof ( int ), sizeof ( NEAREST_QUERY ) * cQueries );
+
+		SERVER_PRINT( UTIL_VarArgs( "%d queries from %s\n", cQueries, szFilename ) );
+	}
+	else
+	{// nothing recorded, ask from around every node
+		cQueries = pGraph->m_cNodes * 4;
+		pQueries = (NEAREST_QUERY *)calloc ( sizeof ( NEAREST_QUERY ), cQueries );
+
+		if ( pQueries )
+		{
+			for ( i = 0 ; i < cQueries ; i++ )
+			{
+				pQueries[ i ].org[0] = pGraph->m_pNodes[ i / 4 ].m_vecOriginPeek.x + rgflOffsets[ i % 4 ][0];
+				pQueries[ i ].org[1] = pGraph->m_pNodes[ i / 4 ].m_vecOriginPeek.y + rgflOffsets[ i % 4 ][1];
+				pQueries[ i ].org[2] = pGraph->m_pNodes[ i / 4 ].m_vecOriginPeek.z + rgflOffsets[ i % 4 ][2];
+				pQueries[ i ].types = pGraph->m_pNodes[ i / 4 ].m_afNodeInfo & bits_NODE_GROUP_REALM;
+			}
+		}
+
+		SERVER_PRINT( UTIL_VarArgs( "no %s, %d queries around the nodes\n", szFilename, cQueries ) );
+	}
+
+	if ( pMemFile )
+		FREE_FILE( pMemFile );
+
+	pRanges = (int *)calloc ( sizeof ( int ), cQueries + 1 );
+	pGrid = (int *)calloc ( sizeof ( int ), cQueries + 1 );
+
+	if ( !pQueries || !pRanges || !pGrid )
+	{
+		SERVER_PRINT( "graph_nearest_benchmark: out of memory\n" );
+	}
+	else
+	{
+		// don't record our own queries
+		fRecording = gfNearestRecording;
+		gfNearestRecording = FALSE;
+
+		flStart = g_engfuncs.pfnTime();
+		for ( i = 0 ; i < cQueries ; i++ )
+		{
+			pRanges[ i ] = pGraph->FindNearestNodeInRanges( Vector( pQueries[ i ].org ), pQueries[ i ].types );
+		}
+		flRanges = g_engfuncs.pfnTime() - flStart;
+
+		flStart = g_engfuncs.pfnTime();
+		for ( i = 0 ; i < cQueries ; i++ )
+		{
+			pGrid[ i ] = pGraph->FindNearestNodeInGrid( Vector( pQueries[ i ].org ), pQueries[ i ].types );
+		}
+		flGrid = g_engfuncs.pfnTime() - flStart;
+
+		// start from an empty cache
+		memset ( gNodeGrid.m_Cache, 0, sizeof ( gNodeGrid.m_Cache ) );
+		gNodeGrid.m_iCacheAge = 0;
+		gNodeGrid.m_cCacheHits = 0;
+
+		flStart = g_engfuncs.pfnTime();
+		for ( i = 0 ; i < cQueries ; i++ )
+		{
+			pGraph->FindNearestNode( Vector( pQueries[ i ].org ), pQueries[ i ].types );
+		}
+		flCached = g_engfuncs.pfnTime() - flStart;
+		cHits = gNodeGrid.m_cCacheHits;
+
+		gfNearestRecording = fRecording;
+
+		cDiffer = 0;
+		for ( i = 0 ; i < cQueries ; i++ )
+		{
+			if ( pRanges[ i ] == pGrid[ i ] )
+				continue;
+
+			// equally near nodes may be picked in a different order
+			if ( cDiffer < 8 )
+			{
+				Vector vecQuery( pQueries[ i ].org );
+
+				SERVER_PRINT( UTIL_VarArgs( "  (%.0f %.0f %.0f) types %d: ranges %d (%.1f), grid %d (%.1f)\n",
+					vecQuery.x, vecQuery.y, vecQuery.z, pQueries[ i ].types,
+					pRanges[ i ], pRanges[ i ] < 0 ? 0.0 : ( vecQuery - pGraph->m_pNodes[ pRanges[ i ] ].m_vecOriginPeek ).Length(),
+					pGrid[ i ], pGrid[ i ] < 0 ? 0.0 : ( vecQuery - pGraph->m_pNodes[ pGrid[ i ] ].m_vecOriginPeek ).Length() ) );
+			}
+			cDiffer++;
+		}
+
+		SERVER_PRINT( UTIL_VarArgs( "%d nodes in %d x %d x %d cells of %d units\n", pGraph->m_cNodes,
+			gNodeGrid.m_Size[0], gNodeGrid.m_Size[1], gNodeGrid.m_Size[2], (int)gNodeGrid.m_flCellSize ) );
+		SERVER_PRINT( UTIL_VarArgs( "range tables: %.3f sec, %.0f queries/sec\n", flRanges, cQueries / max( flRanges, 0.0001f ) ) );
+		SERVER_PRINT( UTIL_VarArgs( "grid:         %.3f sec, %.0f queries/sec\n", flGrid, cQueries / max( flGrid, 0.0001f ) ) );
+		SERVER_PRINT( UTIL_VarArgs( "cached grid:  %.3f sec, %.0f queries/sec, %d%% hits\n", flCached, cQueries / max( flCached, 0.0001f ), cQueries ? cHits * 100 / cQueries : 0 ) );
+		SERVER_PRINT( UTIL_VarArgs( "%d of %d results differ\n", cDiffer, cQueries ) );
+	}
+
+	if ( pQueries ) free ( pQueries );
+	if ( pRanges ) free ( pRanges );
+	if ( pGrid ) free ( pGrid );
+}
+
 // Test those routing tables. Doesn't really work, yet.
 //
 void CGraph :: TestRoutingTables( void )
@@ -3445,8 +4466,8 @@ void CGraph :: TestRoutingTables( void )
 
 EnoughSaid:
 
-	if (pMyPath) delete pMyPath;
-	if (pMyPath2) delete pMyPath2;
+	if (pMyPath) delete [] pMyPath;
+	if (pMyPath2) delete [] pMyPath2;
 	pMyPath = 0;
 	pMyPath2 = 0;
 }
@@ -101,6 +101,12 @@ typedef struct
 	short n;		// Nearest node or -1 if no node found.
 } CACHE_ENTRY;
 
+typedef struct
+{
+	int		m_iDestNode;	// node that can be seen, or -1 - node if the main thread has to trace it again
+	edict_t	*m_pLinkEnt;	// brush ent in the way, if any
+} LINK_CANDIDATE;
+
 //=========================================================
 // CGraph 
 //=========================================================
@@ -142,7 +148,7 @@ public:
 	int m_minBoxX, m_minBoxY, m_minBoxZ, m_maxBoxX, m_maxBoxY, m_maxBoxZ;
 	int m_CheckedCounter;
 	float m_RegionMin[3], m_RegionMax[3]; // The range of nodes.
-	CACHE_ENTRY m_Cache[CACHE_SIZE];
+	CACHE_ENTRY m_Cache[CACHE_SIZE];	// no longer used, FindNearestNode keeps its own cache. Still part of the .nod file.
 
 
 	int m_HashPrimes[16];
@@ -160,10 +166,13 @@ public:
 
 	// functions to create the graph
 	int		LinkVisibleNodes ( CLink *pLinkPool, FILE *file, int *piBadNode );
+	int		FindVisibleLinks ( int iNode, LINK_CANDIDATE *pCandidates );
 	int		RejectInlineLinks ( CLink *pLinkPool, FILE *file );
 	int		FindShortestPath ( int *piPath, int iStart, int iDest, int iHull, int afCapMask);
 	int		FindNearestNode ( const Vector &vecOrigin, CBaseEntity *pEntity );
 	int		FindNearestNode ( const Vector &vecOrigin, int afNodeTypes );
+	int		FindNearestNodeInRanges ( const Vector &vecOrigin, int afNodeTypes );
+	int		FindNearestNodeInGrid ( const Vector &vecOrigin, int afNodeTypes );
 	//int		FindNearestLink ( const Vector &vecTestPoint, int *piNearestLink, BOOL *pfAlongLine );
 	float	PathLength( int iStart, int iDest, int iHull, int afCapMask );
 	int		NextNodeInRoute( int iCurrentNode, int iDest, int iHull, int iCap );
@@ -184,7 +193,12 @@ public:
 	void	CheckNode(Vector vecOrigin, int iNode);
 
 	void    BuildRegionTables(void);
+	void	BuildNodeGrid(void);
+	void	FreeNodeGrid(void);
 	void    ComputeStaticRoutingTables(void);
+	void	ComputeLinkPassable(char *pPassable);
+	int		FindStaticPath(int *piPath, int iStart, int iDest, int iHull, const char *pPassable, float *pflClosest, int *piPrevious);
+	void	BuildRouteTable(short *Routes, int iHull, const char *pPassable, int *pMyPath, float *pflClosest, int *piPrevious);
 	void    TestRoutingTables(void);
 
 	void	HashInsert(int iSrcNode, int iDestNode, int iKey);
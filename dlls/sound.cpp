@@ -23,6 +23,7 @@
 #include "player.h"
 #include "talkmonster.h"
 #include "gamerules.h"
+#include "physcallback.h"
 
 
 static char *memfgets( byte *pMemFile, int fileSize, int &filePos, char *pBuffer, int bufferSize );
@@ -1656,7 +1657,13 @@ float TEXTURETYPE_PlaySound(TraceResult *ptr,  Vector vecSrc, Vector vecEnd, int
 		vecEnd.CopyToArray(rgfl2);
 
 		// get texture from entity or world (world is ent(0))
-		if (pEntity)
+		if ( g_physfuncs.pfnTraceMaterial )
+		{
+			// engine already knows the material of the texture
+			chTextureType = g_physfuncs.pfnTraceMaterial( pEntity ? ENT(pEntity->pev) : ENT(0), rgfl1, rgfl2 );
+			pTextureName = NULL;
+		}
+		else if (pEntity)
 			pTextureName = TRACE_TEXTURE( ENT(pEntity->pev), rgfl1, rgfl2 );
 		else
 			pTextureName = TRACE_TEXTURE( ENT(0), rgfl1, rgfl2 );
@@ -25,11 +25,13 @@
 #include "cbase.h"
 #include "saverestore.h"
 #include <time.h>
+#include <ctype.h>
 #include "shake.h"
 #include "decals.h"
 #include "player.h"
 #include "weapons.h"
 #include "gamerules.h"
+#include "physcallback.h"
 
 float UTIL_WeaponTimeBase( void )
 {
@@ -401,7 +403,10 @@ void UTIL_MoveToOrigin( edict_t *pent, const Vector &vecGoal, float flDist, int
 }
 
 
-int UTIL_EntitiesInBox( CBaseEntity **pList, int listMax, const Vector &mins, const Vector &maxs, int flagMask )
+#define MAX_QUERY_EDICTS	512	// edicts asked from the engine's area tree at once
+
+// scans every edict, for engines without pfnEntitiesInBox and for lists that don't fit
+static int UTIL_EntitiesInBoxScan( CBaseEntity **pList, int listMax, const Vector &mins, const Vector &maxs, int flagMask )
 {
 	edict_t		*pEdict = g_engfuncs.pfnPEntityOfEntIndex( 1 );
 	CBaseEntity *pEntity;
@@ -443,12 +448,64 @@ int UTIL_EntitiesInBox( CBaseEntity **pList, int listMax, const Vector &mins, co
 }
 
 
-int UTIL_MonstersInSphere( CBaseEntity **pList, int listMax, const Vector &center, float radius )
+// the engine only returns edicts with private data, so Instance() can't fail
+int UTIL_EntitiesInBox( CBaseEntity **pList, int listMax, const Vector &mins, const Vector &maxs, int flagMask )
+{
+	edict_t		*pEdicts[ MAX_QUERY_EDICTS ];
+	int			count, i;
+
+	if ( !g_physfuncs.pfnEntitiesInBox || listMax > MAX_QUERY_EDICTS )
+		return UTIL_EntitiesInBoxScan( pList, listMax, mins, maxs, flagMask );
+
+	count = g_physfuncs.pfnEntitiesInBox( flagMask, mins, maxs, pEdicts, max( listMax, 0 ) );
+	count = min( count, listMax );
+
+	for ( i = 0; i < count; i++ )
+		pList[ i ] = CBaseEntity::Instance( pEdicts[ i ] );
+
+	return count;
+}
+
+
+static BOOL UTIL_InSphere( edict_t *pEdict, const Vector &center, float radiusSquared )
+{
+	float		distance, delta;
+
+	// Use origin for X & Y since they are centered for all monsters
+	// Now X
+	delta = center.x - pEdict->v.origin.x;//(pEdict->v.absmin.x + pEdict->v.absmax.x)*0.5;
+	delta *= delta;
+
+	if ( delta > radiusSquared )
+		return FALSE;
+	distance = delta;
+	
+	// Now Y
+	delta = center.y - pEdict->v.origin.y;//(pEdict->v.absmin.y + pEdict->v.absmax.y)*0.5;
+	delta *= delta;
+
+	distance += delta;
+	if ( distance > radiusSquared )
+		return FALSE;
+
+	// Now Z
+	delta = center.z - (pEdict->v.absmin.z + pEdict->v.absmax.z)*0.5;
+	delta *= delta;
+
+	distance += delta;
+	if ( distance > radiusSquared )
+		return FALSE;
+
+	return TRUE;
+}
+
+
+// scans every edict, for engines without pfnEntitiesInBox and for crowds that don't fit
+static int UTIL_MonstersInSphereScan( CBaseEntity **pList, int listMax, const Vector &center, float radius )
 {
 	edict_t		*pEdict = g_engfuncs.pfnPEntityOfEntIndex( 1 );
 	CBaseEntity *pEntity;
 	int			count;
-	float		distance, delta;
 
 	count = 0;
 	float radiusSquared = radius * radius;
@@ -464,29 +521,7 @@ int UTIL_MonstersInSphere( CBaseEntity **pList, int listMax, const Vector &cente
 		if ( !(pEdict->v.flags & (FL_CLIENT|FL_MONSTER)) )	// Not a client/monster ?
 			continue;
 
-		// Use origin for X & Y since they are centered for all monsters
-		// Now X
-		delta = center.x - pEdict->v.origin.x;//(pEdict->v.absmin.x + pEdict->v.absmax.x)*0.5;
-		delta *= delta;
-
-		if ( delta > radiusSquared )
-			continue;
-		distance = delta;
-		
-		// Now Y
-		delta = center.y - pEdict->v.origin.y;//(pEdict->v.absmin.y + pEdict->v.absmax.y)*0.5;
-		delta *= delta;
-
-		distance += delta;
-		if ( distance > radiusSquared )
-			continue;
-
-		// Now Z
-		delta = center.z - (pEdict->v.absmin.z + pEdict->v.absmax.z)*0.5;
-		delta *= delta;
-
-		distance += delta;
-		if ( distance > radiusSquared )
+		if ( !UTIL_InSphere( pEdict, center, radiusSquared ) )
 			continue;
 
 		pEntity = CBaseEntity::Instance(pEdict);
@@ -505,6 +540,41 @@ int UTIL_MonstersInSphere( CBaseEntity **pList, int listMax, const Vector &cente
 }
 
 
+// clients and monsters have their origin inside their absbox, so the box
+// around the sphere holds everything the sphere test can accept
+int UTIL_MonstersInSphere( CBaseEntity **pList, int listMax, const Vector &center, float radius )
+{
+	edict_t		*pEdicts[ MAX_QUERY_EDICTS ];
+	Vector		vecRadius( radius, radius, radius );
+	int			count, total, i;
+	float		radiusSquared = radius * radius;
+
+	if ( !g_physfuncs.pfnEntitiesInBox || listMax <= 0 )
+		return UTIL_MonstersInSphereScan( pList, listMax, center, radius );
+
+	total = g_physfuncs.pfnEntitiesInBox( FL_CLIENT|FL_MONSTER, center - vecRadius, center + vecRadius, pEdicts, MAX_QUERY_EDICTS );
+
+	if ( total > MAX_QUERY_EDICTS )
+		return UTIL_MonstersInSphereScan( pList, listMax, center, radius );
+
+	count = 0;
+
+	for ( i = 0; i < total; i++ )
+	{
+		if ( !UTIL_InSphere( pEdicts[ i ], center, radiusSquared ) )
+			continue;
+
+		pList[ count ] = CBaseEntity::Instance( pEdicts[ i ] );
+		count++;
+
+		if ( count >= listMax )
+			return count;
+	}
+
+	return count;
+}
+
+
 CBaseEntity *UTIL_FindEntityInSphere( CBaseEntity *pStartEntity, const Vector &vecCenter, float flRadius )
 {
 	edict_t	*pentEntity;
@@ -1711,6 +1781,11 @@ int	CSaveRestoreBuffer :: EntityIndex( edict_t *pentLookup )
 	int i;
 	ENTITYTABLE *pTable;
 
+	// the engine builds the table in edict order, try the edict's own slot first
+	i = ENTINDEX( pentLookup );
+	if ( i >= 0 && i < m_pdata->tableCount && m_pdata->pTable[ i ].pent == pentLookup )
+		return i;
+
 	for ( i = 0; i < m_pdata->tableCount; i++ )
 	{
 		pTable = m_pdata->pTable + i;
@@ -1729,6 +1804,10 @@ edict_t *CSaveRestoreBuffer :: EntityFromIndex( int entityIndex )
 	int i;
 	ENTITYTABLE *pTable;
 
+	// ids are the table slots, unless the table was built some other way
+	if ( entityIndex < m_pdata->tableCount && m_pdata->pTable[ entityIndex ].id == entityIndex )
+		return m_pdata->pTable[ entityIndex ].pent;
+
 	for ( i = 0; i < m_pdata->tableCount; i++ )
 	{
 		pTable = m_pdata->pTable + i;
@@ -1977,52 +2056,218 @@ void CSave :: WriteFunction( const char *pname, const int *data, int count )
 }
 
 
-void EntvarsKeyvalue( entvars_t *pev, KeyValueData *pkvd )
+// --------------------------------------------------------------
+//
+// Field indices - restore and keyvalues find fields by name, each
+// TYPEDESCRIPTION table gets a hash of its field names the first
+// time it's searched.
+//
+// --------------------------------------------------------------
+#define MAX_FIELD_INDICES		1024	// tables that can be indexed, must be a power of two
+
+typedef struct
 {
-	int i;
-	TYPEDESCRIPTION		*pField;
+	TYPEDESCRIPTION	*pFields;
+	int				fieldCount;
+	int				hashMask;		// hash size - 1, -1 when the table can't be indexed
+	short			*pHash;			// field number + 1, 0 for an empty slot
+} FIELDINDEX;
+
+static FIELDINDEX	gFieldIndices[ MAX_FIELD_INDICES ];
+static BOOL			gfFieldIndexOff;	// saverestore_benchmark times the old search with this
+
+static unsigned int FieldNameHash( const char *pName )
+{
+	unsigned int hash = 0;
+
+	// case doesn't matter, the names were always compared with stricmp
+	while ( *pName )
+		hash = hash * 31 + tolower( (unsigned char)*pName++ );
+
+	return hash;
+}
+
+static FIELDINDEX *FieldIndexBuild( FIELDINDEX *pIndex, TYPEDESCRIPTION *pFields, int fieldCount )
+{
+	int		i, slot, hashSize;
+
+	pIndex->pFields = pFields;
+	pIndex->fieldCount = fieldCount;
+	pIndex->hashMask = -1;
+	pIndex->pHash = NULL;
+
+	if ( fieldCount <= 0 || fieldCount >= 0x7FFF )
+		return pIndex;
 
-	for ( i = 0; i < ENTVARS_COUNT; i++ )
+	for ( hashSize = 8; hashSize < fieldCount * 2; hashSize <<= 1 )
+		;
+
+	pIndex->pHash = (short *)calloc( hashSize, sizeof(short) );
+	if ( !pIndex->pHash )
+		return pIndex;
+
+	for ( i = 0; i < fieldCount; i++ )
 	{
-		pField = &gEntvarsDescription[i];
+		slot = FieldNameHash( pFields[i].fieldName ) & (hashSize - 1);
 
-		if ( !stricmp( pField->fieldName, pkvd->szKeyName ) )
+		while ( pIndex->pHash[slot] )
 		{
-			switch( pField->fieldType )
+			// the search from a start field finds the duplicate after it first, leave such tables alone
+			if ( !stricmp( pFields[ pIndex->pHash[slot] - 1 ].fieldName, pFields[i].fieldName ) )
 			{
-			case FIELD_MODELNAME:
-			case FIELD_SOUNDNAME:
-			case FIELD_STRING:
-				(*(int *)((char *)pev + pField->fieldOffset)) = ALLOC_STRING( pkvd->szValue );
-				break;
+				free( pIndex->pHash );
+				pIndex->pHash = NULL;
+				return pIndex;
+			}
+			slot = (slot + 1) & (hashSize - 1);
+		}
 
-			case FIELD_TIME:
-			case FIELD_FLOAT:
-				(*(float *)((char *)pev + pField->fieldOffset)) = atof( pkvd->szValue );
-				break;
+		pIndex->pHash[slot] = i + 1;
+	}
 
-			case FIELD_INTEGER:
-				(*(int *)((char *)pev + pField->fieldOffset)) = atoi( pkvd->szValue );
-				break;
+	pIndex->hashMask = hashSize - 1;
+	return pIndex;
+}
 
-			case FIELD_POSITION_VECTOR:
-			case FIELD_VECTOR:
-				UTIL_StringToVector( (float *)((char *)pev + pField->fieldOffset), pkvd->szValue );
-				break;
+static FIELDINDEX *FieldIndexForTable( TYPEDESCRIPTION *pFields, int fieldCount )
+{
+	FIELDINDEX	*pIndex;
+	int			i, slot;
 
-			default:
-			case FIELD_EVARS:
-			case FIELD_CLASSPTR:
-			case FIELD_EDICT:
-			case FIELD_ENTITY:
-			case FIELD_POINTER:
-				ALERT( at_error, "Bad field in entity!!\n" );
-				break;
-			}
-			pkvd->fHandled = TRUE;
-			return;
+	slot = (int)(((unsigned long)pFields >> 3) & (MAX_FIELD_INDICES - 1));
+
+	for ( i = 0; i < MAX_FIELD_INDICES; i++ )
+	{
+		pIndex = &gFieldIndices[ slot ];
+
+		if ( pIndex->pFields == pFields )
+			return ( pIndex->fieldCount == fieldCount ) ? pIndex : NULL;
+
+		if ( !pIndex->pFields )
+			return FieldIndexBuild( pIndex, pFields, fieldCount );
+
+		slot = (slot + 1) & (MAX_FIELD_INDICES - 1);
+	}
+
+	return NULL;	// no room, search the table
+}
+
+//=========================================================
+// FindField - number of the field called pName, the
+// first one at or after startField when a table has the
+// name twice. -1 if there's no such field.
+//=========================================================
+static int FindField( TYPEDESCRIPTION *pFields, int fieldCount, int startField, const char *pName )
+{
+	FIELDINDEX	*pIndex;
+	int			i, slot, fieldNumber;
+
+	if ( !pFields || fieldCount <= 0 )
+		return -1;
+
+	pIndex = gfFieldIndexOff ? NULL : FieldIndexForTable( pFields, fieldCount );
+
+	if ( pIndex && pIndex->hashMask >= 0 )
+	{
+		slot = FieldNameHash( pName ) & pIndex->hashMask;
+
+		while ( pIndex->pHash[slot] )
+		{
+			fieldNumber = pIndex->pHash[slot] - 1;
+			if ( !stricmp( pFields[ fieldNumber ].fieldName, pName ) )
+				return fieldNumber;
+			slot = (slot + 1) & pIndex->hashMask;
 		}
+		return -1;
 	}
+
+	for ( i = 0; i < fieldCount; i++ )
+	{
+		fieldNumber = (i+startField)%fieldCount;
+		if ( !stricmp( pFields[ fieldNumber ].fieldName, pName ) )
+			return fieldNumber;
+	}
+
+	return -1;
+}
+
+
+// saverestore_benchmark notes where each field block was written
+#define SAVEBENCH_BUFFER		0x400000	// same as the engine's save heap
+#define SAVEBENCH_TOKENS		0xFFF
+#define SAVEBENCH_PASSES		4
+
+typedef struct
+{
+	int				entity;			// table slot of the entity that wrote it
+	int				location;		// where the block starts in the save data
+	const char		*pname;
+	TYPEDESCRIPTION	*pFields;
+	int				fieldCount;
+} SAVEBENCH_BLOCK;
+
+static SAVEBENCH_BLOCK	*gpSaveBenchBlocks;		// set while saverestore_benchmark saves
+static int				gcSaveBenchBlocks;
+static int				gcSaveBenchMax;
+
+static void SaveBenchRecord( SAVERESTOREDATA *pData, const char *pname, TYPEDESCRIPTION *pFields, int fieldCount )
+{
+	SAVEBENCH_BLOCK *pBlock;
+
+	if ( gcSaveBenchBlocks >= gcSaveBenchMax )
+		return;
+
+	pBlock = &gpSaveBenchBlocks[ gcSaveBenchBlocks++ ];
+	pBlock->entity = pData->currentIndex;
+	pBlock->location = pData->size;
+	pBlock->pname = pname;
+	pBlock->pFields = pFields;
+	pBlock->fieldCount = fieldCount;
+}
+
+void EntvarsKeyvalue( entvars_t *pev, KeyValueData *pkvd )
+{
+	int i;
+	TYPEDESCRIPTION		*pField;
+
+	i = FindField( gEntvarsDescription, ENTVARS_COUNT, 0, pkvd->szKeyName );
+	if ( i < 0 )
+		return;
+
+	pField = &gEntvarsDescription[i];
+
+	switch( pField->fieldType )
+	{
+	case FIELD_MODELNAME:
+	case FIELD_SOUNDNAME:
+	case FIELD_STRING:
+		(*(int *)((char *)pev + pField->fieldOffset)) = ALLOC_STRING( pkvd->szValue );
+		break;
+
+	case FIELD_TIME:
+	case FIELD_FLOAT:
+		(*(float *)((char *)pev + pField->fieldOffset)) = atof( pkvd->szValue );
+		break;
+
+	case FIELD_INTEGER:
+		(*(int *)((char *)pev + pField->fieldOffset)) = atoi( pkvd->szValue );
+		break;
+
+	case FIELD_POSITION_VECTOR:
+	case FIELD_VECTOR:
+		UTIL_StringToVector( (float *)((char *)pev + pField->fieldOffset), pkvd->szValue );
+		break;
+
+	default:
+	case FIELD_EVARS:
+	case FIELD_CLASSPTR:
+	case FIELD_EDICT:
+	case FIELD_ENTITY:
+	case FIELD_POINTER:
+		ALERT( at_error, "Bad field in entity!!\n" );
+		break;
+	}
+	pkvd->fHandled = TRUE;
 }
 
 
@@ -2052,6 +2297,10 @@ int CSave :: WriteFields( const char *pname, void *pBaseData, TYPEDESCRIPTION *p
 
 	// Empty fields will not be written, write out the actual number of fields to be written
 	actualCount = fieldCount - emptyCount;
+
+	if ( gpSaveBenchBlocks )
+		SaveBenchRecord( m_pdata, pname, pFields, fieldCount );
+
 	WriteInt( pname, &actualCount, 1 );
 
 	for ( i = 0; i < fieldCount; i++ )
@@ -2208,7 +2457,7 @@ void CSave :: BufferData( const char *pdata, int size )
 
 int CRestore::ReadField( void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCount, int startField, int size, char *pName, void *pData )
 {
-	int i, j, stringCount, fieldNumber, entityIndex;
+	int j, stringCount, fieldNumber, entityIndex;
 	TYPEDESCRIPTION *pTest;
 	float	time, timeData;
 	Vector	position;
@@ -2225,150 +2474,146 @@ int CRestore::ReadField( void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCou
 			position = m_pdata->vecLandmarkOffset;
 	}
 
-	for ( i = 0; i < fieldCount; i++ )
+	fieldNumber = FindField( pFields, fieldCount, startField, pName );
+	if ( fieldNumber < 0 )
+		return -1;
+
+	pTest = &pFields[ fieldNumber ];
+
+	if ( !m_global || !(pTest->flags & FTYPEDESC_GLOBAL) )
 	{
-		fieldNumber = (i+startField)%fieldCount;
-		pTest = &pFields[ fieldNumber ];
-		if ( !stricmp( pTest->fieldName, pName ) )
+		for ( j = 0; j < pTest->fieldSize; j++ )
 		{
-			if ( !m_global || !(pTest->flags & FTYPEDESC_GLOBAL) )
+			void *pOutputData = ((char *)pBaseData + pTest->fieldOffset + (j*gSizes[pTest->fieldType]) );
+			void *pInputData = (char *)pData + j * gSizes[pTest->fieldType];
+
+			switch( pTest->fieldType )
 			{
-				for ( j = 0; j < pTest->fieldSize; j++ )
+			case FIELD_TIME:
+				timeData = *(float *)pInputData;
+				// Re-base time variables
+				timeData += time;
+				*((float *)pOutputData) = timeData;
+			break;
+			case FIELD_FLOAT:
+				*((float *)pOutputData) = *(float *)pInputData;
+			break;
+			case FIELD_MODELNAME:
+			case FIELD_SOUNDNAME:
+			case FIELD_STRING:
+				// Skip over j strings
+				pString = (char *)pData;
+				for ( stringCount = 0; stringCount < j; stringCount++ )
+				{
+					while (*pString)
+						pString++;
+					pString++;
+				}
+				pInputData = pString;
+				if ( strlen( (char *)pInputData ) == 0 )
+					*((int *)pOutputData) = 0;
+				else
 				{
-					void *pOutputData = ((char *)pBaseData + pTest->fieldOffset + (j*gSizes[pTest->fieldType]) );
-					void *pInputData = (char *)pData + j * gSizes[pTest->fieldType];
+					int string;
 
-					switch( pTest->fieldType )
+					string = ALLOC_STRING( (char *)pInputData );
+					
+					*((int *)pOutputData) = string;
+
+					if ( !FStringNull( string ) && m_precache )
 					{
-					case FIELD_TIME:
-						timeData = *(float *)pInputData;
-						// Re-base time variables
-						timeData += time;
-						*((float *)pOutputData) = timeData;
-					break;
-					case FIELD_FLOAT:
-						*((float *)pOutputData) = *(float *)pInputData;
-					break;
-					case FIELD_MODELNAME:
-					case FIELD_SOUNDNAME:
-					case FIELD_STRING:
-						// Skip over j strings
-						pString = (char *)pData;
-						for ( stringCount = 0; stringCount < j; stringCount++ )
-						{
-							while (*pString)
-								pString++;
-							pString++;
-						}
-						pInputData = pString;
-						if ( strlen( (char *)pInputData ) == 0 )
-							*((int *)pOutputData) = 0;
-						else
-						{
-							int string;
-
-							string = ALLOC_STRING( (char *)pInputData );
-							
-							*((int *)pOutputData) = string;
-
-							if ( !FStringNull( string ) && m_precache )
-							{
-								if ( pTest->fieldType == FIELD_MODELNAME )
-									PRECACHE_MODEL( (char *)STRING( string ) );
-								else if ( pTest->fieldType == FIELD_SOUNDNAME )
-									PRECACHE_SOUND( (char *)STRING( string ) );
-							}
-						}
-					break;
-					case FIELD_EVARS:
-						entityIndex = *( int *)pInputData;
-						pent = EntityFromIndex( entityIndex );
-						if ( pent )
-							*((entvars_t **)pOutputData) = VARS(pent);
-						else
-							*((entvars_t **)pOutputData) = NULL;
-					break;
-					case FIELD_CLASSPTR:
-						entityIndex = *( int *)pInputData;
-						pent = EntityFromIndex( entityIndex );
-						if ( pent )
-							*((CBaseEntity **)pOutputData) = CBaseEntity::Instance(pent);
-						else
-							*((CBaseEntity **)pOutputData) = NULL;
-					break;
-					case FIELD_EDICT:
-						entityIndex = *( int *)pInputData;
-						pent = EntityFromIndex( entityIndex );
-						*((edict_t **)pOutputData) = pent;
-					break;
-					case FIELD_EHANDLE:
-						// Input and Output sizes are different!
-						pOutputData = (char *)pOutputData + j*(sizeof(EHANDLE) - gSizes[pTest->fieldType]);
-						entityIndex = *( int *)pInputData;
-						pent = EntityFromIndex( entityIndex );
-						if ( pent )
-							*((EHANDLE *)pOutputData) = CBaseEntity::Instance(pent);
-						else
-							*((EHANDLE *)pOutputData) = NULL;
-					break;
-					case FIELD_ENTITY:
-						entityIndex = *( int *)pInputData;
-						pent = EntityFromIndex( entityIndex );
-						if ( pent )
-							*((EOFFSET *)pOutputData) = OFFSET(pent);
-						else
-							*((EOFFSET *)pOutputData) = 0;
-					break;
-					case FIELD_VECTOR:
-						((float *)pOutputData)[0] = ((float *)pInputData)[0];
-						((float *)pOutputData)[1] = ((float *)pInputData)[1];
-						((float *)pOutputData)[2] = ((float *)pInputData)[2];
-					break;
-					case FIELD_POSITION_VECTOR:
-						((float *)pOutputData)[0] = ((float *)pInputData)[0] + position.x;
-						((float *)pOutputData)[1] = ((float *)pInputData)[1] + position.y;
-						((float *)pOutputData)[2] = ((float *)pInputData)[2] + position.z;
-					break;
+						if ( pTest->fieldType == FIELD_MODELNAME )
+							PRECACHE_MODEL( (char *)STRING( string ) );
+						else if ( pTest->fieldType == FIELD_SOUNDNAME )
+							PRECACHE_SOUND( (char *)STRING( string ) );
+					}
+				}
+			break;
+			case FIELD_EVARS:
+				entityIndex = *( int *)pInputData;
+				pent = EntityFromIndex( entityIndex );
+				if ( pent )
+					*((entvars_t **)pOutputData) = VARS(pent);
+				else
+					*((entvars_t **)pOutputData) = NULL;
+			break;
+			case FIELD_CLASSPTR:
+				entityIndex = *( int *)pInputData;
+				pent = EntityFromIndex( entityIndex );
+				if ( pent )
+					*((CBaseEntity **)pOutputData) = CBaseEntity::Instance(pent);
+				else
+					*((CBaseEntity **)pOutputData) = NULL;
+			break;
+			case FIELD_EDICT:
+				entityIndex = *( int *)pInputData;
+				pent = EntityFromIndex( entityIndex );
+				*((edict_t **)pOutputData) = pent;
+			break;
+			case FIELD_EHANDLE:
+				// Input and Output sizes are different!
+				pOutputData = (char *)pOutputData + j*(sizeof(EHANDLE) - gSizes[pTest->fieldType]);
+				entityIndex = *( int *)pInputData;
+				pent = EntityFromIndex( entityIndex );
+				if ( pent )
+					*((EHANDLE *)pOutputData) = CBaseEntity::Instance(pent);
+				else
+					*((EHANDLE *)pOutputData) = NULL;
+			break;
+			case FIELD_ENTITY:
+				entityIndex = *( int *)pInputData;
+				pent = EntityFromIndex( entityIndex );
+				if ( pent )
+					*((EOFFSET *)pOutputData) = OFFSET(pent);
+				else
+					*((EOFFSET *)pOutputData) = 0;
+			break;
+			case FIELD_VECTOR:
+				((float *)pOutputData)[0] = ((float *)pInputData)[0];
+				((float *)pOutputData)[1] = ((float *)pInputData)[1];
+				((float *)pOutputData)[2] = ((float *)pInputData)[2];
+			break;
+			case FIELD_POSITION_VECTOR:
+				((float *)pOutputData)[0] = ((float *)pInputData)[0] + position.x;
+				((float *)pOutputData)[1] = ((float *)pInputData)[1] + position.y;
+				((float *)pOutputData)[2] = ((float *)pInputData)[2] + position.z;
+			break;
 
-					case FIELD_BOOLEAN:
-					case FIELD_INTEGER:
-						*((int *)pOutputData) = *( int *)pInputData;
-					break;
+			case FIELD_BOOLEAN:
+			case FIELD_INTEGER:
+				*((int *)pOutputData) = *( int *)pInputData;
+			break;
 
-					case FIELD_SHORT:
-						*((short *)pOutputData) = *( short *)pInputData;
-					break;
+			case FIELD_SHORT:
+				*((short *)pOutputData) = *( short *)pInputData;
+			break;
 
-					case FIELD_CHARACTER:
-						*((char *)pOutputData) = *( char *)pInputData;
-					break;
+			case FIELD_CHARACTER:
+				*((char *)pOutputData) = *( char *)pInputData;
+			break;
 
-					case FIELD_POINTER:
-						*((int *)pOutputData) = *( int *)pInputData;
-					break;
-					case FIELD_FUNCTION:
-						if ( strlen( (char *)pInputData ) == 0 )
-							*((int *)pOutputData) = 0;
-						else
-							*((int *)pOutputData) = FUNCTION_FROM_NAME( (char *)pInputData );
-					break;
+			case FIELD_POINTER:
+				*((int *)pOutputData) = *( int *)pInputData;
+			break;
+			case FIELD_FUNCTION:
+				if ( strlen( (char *)pInputData ) == 0 )
+					*((int *)pOutputData) = 0;
+				else
+					*((int *)pOutputData) = FUNCTION_FROM_NAME( (char *)pInputData );
+			break;
 
-					default:
-						ALERT( at_error, "Bad field type\n" );
-					}
-				}
-			}
-#if 0
-			else
-			{
-				ALERT( at_console, "Skipping global field %s\n", pName );
+			default:
+				ALERT( at_error, "Bad field type\n" );
 			}
-#endif
-			return fieldNumber;
 		}
 	}
-
-	return -1;
+#if 0
+	else
+	{
+		ALERT( at_console, "Skipping global field %s\n", pName );
+	}
+#endif
+	return fieldNumber;
 }
 
 
@@ -2541,3 +2786,146 @@ int	CRestore::BufferCheckZString( const char *string )
 	return 0;
 }
 
+
+//=========================================================
+// SaveRestoreBenchmark - "saverestore_benchmark" server
+// command. Saves every entity of the level into a private
+// buffer, then reads every field block back into scratch
+// memory with the field indices and with the old linear
+// search, and prints the times. The entities aren't touched,
+// strings read back stay allocated until the level changes.
+//=========================================================
+void SaveRestoreBenchmark( void )
+{
+	SAVERESTOREDATA	data;
+	SAVEBENCH_BLOCK	*pBlock;
+	CBaseEntity		*pEntity;
+	char			*pScratch;
+	int				i, j, iPass, iMode, cEntities, cSkipped, scratchSize, fieldEnd;
+	float			flStart, flSave, flRestore[2];
+
+	memset( &data, 0, sizeof( data ) );
+
+	data.tableCount = gpGlobals->maxEntities;
+	data.pTable = (ENTITYTABLE *)calloc( data.tableCount, sizeof( ENTITYTABLE ) );
+	data.tokenCount = SAVEBENCH_TOKENS;
+	data.pTokens = (char **)calloc( data.tokenCount, sizeof( char * ) );
+	data.bufferSize = SAVEBENCH_BUFFER;
+	data.pBaseData = (char *)calloc( data.bufferSize, 1 );
+	data.time = gpGlobals->time;
+
+	gcSaveBenchMax = 65536;
+	gcSaveBenchBlocks = 0;
+	gpSaveBenchBlocks = (SAVEBENCH_BLOCK *)calloc( gcSaveBenchMax, sizeof( SAVEBENCH_BLOCK ) );
+
+	if ( !data.pTable || !data.pTokens || !data.pBaseData || !gpSaveBenchBlocks )
+	{
+		SERVER_PRINT( "saverestore_benchmark: out of memory\n" );
+		goto done;
+	}
+
+	// the same entity table the engine builds for a save
+	for ( i = 0; i < data.tableCount; i++ )
+	{
+		data.pTable[i].pent = INDEXENT( i );
+		data.pTable[i].id = i;
+	}
+
+	flSave = 0;
+	cEntities = 0;
+
+	for ( iPass = 0; iPass < SAVEBENCH_PASSES; iPass++ )
+	{
+		data.pCurrentData = data.pBaseData;
+		data.size = 0;
+		gcSaveBenchBlocks = 0;
+		cEntities = 0;
+
+		flStart = g_engfuncs.pfnTime();
+		for ( i = 1; i < data.tableCount; i++ )
+		{
+			if ( !data.pTable[i].pent || data.pTable[i].pent->free )
+				continue;
+
+			pEntity = (CBaseEntity *)GET_PRIVATE( data.pTable[i].pent );
+			if ( !pEntity || ( pEntity->ObjectCaps() & FCAP_DONT_SAVE ) )
+				continue;
+
+			data.currentIndex = i;
+			data.pTable[i].location = data.size;
+
+			CSave saveHelper( &data );
+			pEntity->Save( saveHelper );
+
+			data.pTable[i].size = data.size - data.pTable[i].location;
+			cEntities++;
+		}
+		flSave += g_engfuncs.pfnTime() - flStart;
+	}
+
+	// scratch memory big enough for the largest table
+	scratchSize = 16;
+	for ( i = 0; i < gcSaveBenchBlocks; i++ )
+	{
+		pBlock = &gpSaveBenchBlocks[i];
+		for ( j = 0; j < pBlock->fieldCount; j++ )
+		{
+			fieldEnd = pBlock->pFields[j].fieldOffset + pBlock->pFields[j].fieldSize *
+				( pBlock->pFields[j].fieldType == FIELD_EHANDLE ? sizeof( EHANDLE ) : gSizes[ pBlock->pFields[j].fieldType ] );
+			scratchSize = max( scratchSize, fieldEnd );
+		}
+	}
+
+	pScratch = (char *)calloc( scratchSize, 1 );
+	if ( !pScratch )
+	{
+		SERVER_PRINT( "saverestore_benchmark: out of memory\n" );
+		goto done;
+	}
+
+	cSkipped = 0;
+
+	for ( iMode = 0; iMode < 2; iMode++ )
+	{
+		gfFieldIndexOff = ( iMode == 1 );
+		flRestore[iMode] = 0;
+
+		for ( iPass = 0; iPass < SAVEBENCH_PASSES; iPass++ )
+		{
+			flStart = g_engfuncs.pfnTime();
+			for ( i = 0; i < gcSaveBenchBlocks; i++ )
+			{
+				pBlock = &gpSaveBenchBlocks[i];
+
+				data.pCurrentData = data.pBaseData + pBlock->location;
+				data.size = pBlock->location;
+				data.currentIndex = pBlock->entity;
+
+				CRestore restoreHelper( &data );
+				restoreHelper.PrecacheMode( FALSE );
+
+				if ( !restoreHelper.ReadFields( pBlock->pname, pScratch, pBlock->pFields, pBlock->fieldCount ) && !iMode && !iPass )
+					cSkipped++;
+			}
+			flRestore[iMode] += g_engfuncs.pfnTime() - flStart;
+		}
+	}
+
+	gfFieldIndexOff = FALSE;
+	free( pScratch );
+
+	SERVER_PRINT( UTIL_VarArgs( "%d entities, %d field blocks, %d bytes, %d passes\n", cEntities, gcSaveBenchBlocks, data.size, SAVEBENCH_PASSES ) );
+	SERVER_PRINT( UTIL_VarArgs( "save:                  %.4f sec\n", flSave ) );
+	SERVER_PRINT( UTIL_VarArgs( "restore, field index:  %.4f sec\n", flRestore[0] ) );
+	SERVER_PRINT( UTIL_VarArgs( "restore, name search:  %.4f sec\n", flRestore[1] ) );
+	if ( cSkipped )
+		SERVER_PRINT( UTIL_VarArgs( "%d blocks weren't where they were written\n", cSkipped ) );
+
+done:
+	if ( data.pTable ) free( data.pTable );
+	if ( data.pTokens ) free( data.pTokens );
+	if ( data.pBaseData ) free( data.pBaseData );
+	if ( gpSaveBenchBlocks ) free( gpSaveBenchBlocks );
+	gpSaveBenchBlocks = NULL;
+	gcSaveBenchBlocks = gcSaveBenchMax = 0;
+}
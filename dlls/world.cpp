@@ -853,6 +853,10 @@ int Server_GetPhysicsInterface( int iVersion, server_physics_api_t *pfuncsFromEn
 	// copy new physics interface
 	memcpy(&g_physfuncs, pfuncsFromEngine, sizeof(server_physics_api_t));
 
+	// let the engine build entity states once for all the clients
+	gPhysicsInterface.SV_CheckFullPack = CheckFullPack;
+	gPhysicsInterface.SV_EntityState = EntityState;
+
 	// fill engine callbacks
 	memcpy( pFunctionTable, &gPhysicsInterface, sizeof( physics_interface_t ) );
 
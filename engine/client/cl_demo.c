@@ -1109,6 +1109,19 @@ void CL_FinishTimeDemo( void )
 	if( !time ) time = 1.0;
 
 	Con_Printf( "%i frames %5.3f seconds %5.3f fps\n", frames, time, frames / time );
+
+	if( cls.td_parsetime > 0.0 )
+	{
+		Con_Printf( "%i entities %5.3f seconds in packet entities, %.0f entities/sec (%.0f overall)\n",
+		cls.td_entities, cls.td_parsetime, cls.td_entities / cls.td_parsetime, cls.td_entities / time );
+	}
+
+	if( cls.td_parseonly )
+	{
+		// video and sound were left behind
+		cls.td_parseonly = false;
+		S_StopAllSounds( true );
+	}
 }
 
 /*
@@ -1550,6 +1563,29 @@ void CL_TimeDemo_f( void )
 	cls.td_starttime = host.realtime;
 	cls.td_startframe = host.framecount;
 	cls.td_lastframe = -1;		// get a new message this frame
+	cls.td_parsetime = 0.0;
+	cls.td_entities = 0;
+}
+
+/*
+====================
+CL_ParseDemo_f
+
+parsedemo <demoname>
+====================
+*/
+void CL_ParseDemo_f( void )
+{
+	if( Cmd_Argc() != 2 )
+	{
+		Con_Printf( S_USAGE "parsedemo <demoname>\n" );
+		return;
+	}
+
+	CL_TimeDemo_f ();
+
+	// only read the messages, as fast as possible
+	if( cls.timedemo ) cls.td_parseonly = true;
 }
 
 /*
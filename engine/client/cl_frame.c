@@ -25,8 +25,31 @@ GNU General Public License for more details.
 #include "sound.h"
 #include "input.h"
 
+#ifdef XASH_SSE2
+#include <emmintrin.h>
+#endif
+
 #define STUDIO_INTERPOLATION_FIX
 
+// packet entities interpolated in one pass, one array per axis
+typedef struct
+{
+	float		time;				// interpolation target time
+	int		numslots;				// packet entities covered by slot[]
+	int		count;				// entities in batch
+	short		slot[MAX_VISIBLE_PACKET];		// batch index for packet entity or -1
+	cl_entity_t	*ents[MAX_VISIBLE_PACKET];
+	position_history_t	*ph0[MAX_VISIBLE_PACKET];		// lerp end
+	position_history_t	*ph1[MAX_VISIBLE_PACKET];		// lerp start
+	float		t1[MAX_VISIBLE_PACKET];		// start time
+	float		dt[MAX_VISIBLE_PACKET];		// time between updates, never zero
+	float		start[3][MAX_VISIBLE_PACKET];
+	float		end[3][MAX_VISIBLE_PACKET];
+	float		origin[3][MAX_VISIBLE_PACKET];	// result
+} entlerp_t;
+
+static entlerp_t	cl_entlerp;
+
 /*
 ==================
 CL_IsPlayerIndex
@@ -398,6 +421,73 @@ void CL_PureOrigin( cl_entity_t *ent, float t, vec3_t outorigin, vec3_t outangle
 	}
 }
 
+/*
+==================
+CL_LerpHistory
+
+lerp entity between two history entries,
+origin can be already computed by batched pass
+==================
+*/
+static int CL_LerpHistory( cl_entity_t *e, float t, position_history_t *ph0, position_history_t *ph1, const vec3_t lerped )
+{
+	vec3_t	delta;
+	float	t1, t2, frac;
+	vec4_t	q, q1, q2;
+
+	t1 = ph1->animtime;
+	t2 = ph0->animtime;
+
+	if( t - t1 < 0.0f )
+		return 0;
+
+	if( t1 == 0.0f )
+	{
+		VectorCopy( ph0->origin, e->origin );
+		VectorCopy( ph0->angles, e->angles );
+		return 0;
+	}
+
+	if( t2 == t1 )
+	{
+		VectorCopy( ph0->origin, e->origin );
+		VectorCopy( ph0->angles, e->angles );
+		return 1;
+	}
+
+	frac = (t - t1) / (t2 - t1);
+
+	if( frac < 0.0f )
+		return 0;
+
+	if( frac > 1.0f )
+		frac = 1.0f;
+
+	if( lerped != NULL )
+	{
+		VectorCopy( lerped, e->origin );
+	}
+	else
+	{
+		VectorSubtract( ph0->origin, ph1->origin, delta );
+		VectorMA( ph1->origin, frac, delta, e->origin );
+	}
+
+	if( VectorCompare( ph0->angles, ph1->angles ))
+	{
+		// not rotating, no reason to slerp
+		VectorCopy( ph0->angles, e->angles );
+		return 1;
+	}
+
+	AngleQuaternion( ph0->angles, q1, false );
+	AngleQuaternion( ph1->angles, q2, false );
+	QuaternionSlerp( q2, q1, frac, q );
+	QuaternionAngle( q, e->angles );
+
+	return 1;
+}
+
 /*
 ==================
 CL_InterpolateModel
@@ -408,9 +498,8 @@ non-players interpolation
 int CL_InterpolateModel( cl_entity_t *e )
 {
 	position_history_t  *ph0 = NULL, *ph1 = NULL;
-	vec3_t		origin, angles, delta;
-	float		t, t1, t2, frac;
 	vec4_t		q, q1, q2;
+	float		t;
 
 	VectorCopy( e->curstate.origin, e->origin );
 	VectorCopy( e->curstate.angles, e->angles );
@@ -444,46 +533,240 @@ int CL_InterpolateModel( cl_entity_t *e )
 	if( ph0 == NULL || ph1 == NULL )
 		return 0;
 
-	t1 = ph1->animtime;
-	t2 = ph0->animtime;
+	return CL_LerpHistory( e, t, ph0, ph1, NULL );
+}
 
-	if( t - t1 < 0.0f )
-		return 0;
+/*
+==================
+CL_LerpOrigins_Ref
 
-	if( t1 == 0.0f )
+compute lerped origins for whole batch
+==================
+*/
+static void CL_LerpOrigins_Ref( entlerp_t *lerp )
+{
+	float	frac;
+	int	i, j;
+
+	for( i = 0; i < lerp->count; i++ )
 	{
-		VectorCopy( ph0->origin, e->origin );
-		VectorCopy( ph0->angles, e->angles );
-		return 0;
+		frac = ( lerp->time - lerp->t1[i] ) / lerp->dt[i];
+		if( frac > 1.0f ) frac = 1.0f;
+
+		for( j = 0; j < 3; j++ )
+			lerp->origin[j][i] = lerp->start[j][i] + frac * ( lerp->end[j][i] - lerp->start[j][i] );
 	}
+}
 
-	if( t2 == t1 )
+#ifdef XASH_SSE2
+/*
+==================
+CL_LerpOrigins_SSE2
+
+four entities at once, batch is padded to four
+==================
+*/
+static void CL_LerpOrigins_SSE2( entlerp_t *lerp )
+{
+	__m128	t, one, frac, s, e;
+	int	i, j;
+
+	t = _mm_set1_ps( lerp->time );
+	one = _mm_set1_ps( 1.0f );
+
+	for( i = 0; i < lerp->count; i += 4 )
 	{
-		VectorCopy( ph0->origin, e->origin );
-		VectorCopy( ph0->angles, e->angles );
-		return 1;
+		frac = _mm_div_ps( _mm_sub_ps( t, _mm_loadu_ps( &lerp->t1[i] )), _mm_loadu_ps( &lerp->dt[i] ));
+		frac = _mm_min_ps( frac, one );
+
+		for( j = 0; j < 3; j++ )
+		{
+			s = _mm_loadu_ps( &lerp->start[j][i] );
+			e = _mm_loadu_ps( &lerp->end[j][i] );
+			_mm_storeu_ps( &lerp->origin[j][i], _mm_add_ps( s, _mm_mul_ps( frac, _mm_sub_ps( e, s ))));
+		}
 	}
+}
+#endif
 
-	VectorSubtract( ph0->origin, ph1->origin, delta );
-	frac = (t - t1) / (t2 - t1);
+/*
+==================
+CL_BatchInterpolation
 
-	if( frac < 0.0f )
-		return 0;
+collect all the entities that can be interpolated
+by CL_InterpolateModel and lerp their origins at once.
+Skipped entities are still interpolated one by one
+==================
+*/
+static void CL_BatchInterpolation( frame_t *frame )
+{
+	entlerp_t		*lerp = &cl_entlerp;
+	position_history_t	*ph0, *ph1;
+	entity_state_t	*state;
+	cl_entity_t	*ent;
+	int		i, j, n;
 
-	if( frac > 1.0f )
-		frac = 1.0f;
+	lerp->time = cl.time - cl_interp->value;
+	lerp->numslots = Q_min( frame->num_entities, MAX_VISIBLE_PACKET );
+	lerp->count = 0;
 
-	VectorMA( ph1->origin, frac, delta, origin );
+	for( i = 0; i < lerp->numslots; i++ )
+		lerp->slot[i] = -1;
 
-	AngleQuaternion( ph0->angles, q1, false );
-	AngleQuaternion( ph1->angles, q2, false );
-	QuaternionSlerp( q2, q1, frac, q );
-	QuaternionAngle( q, angles );
+	// same as early outs in CL_InterpolateModel
+	if( cls.timedemo || cls.demoplayback == DEMO_QUAKE1 || cl.maxclients <= 1 )
+		return;
+
+	for( i = 0; i < lerp->numslots; i++ )
+	{
+		state = &cls.packet_entities[(frame->first_entity + i) % cls.num_client_entities];
 
-	VectorCopy( origin, e->origin );
-	VectorCopy( angles, e->angles );
+		if( state->number >= 1 && state->number <= cl.maxclients )
+			continue;
 
-	return 1;
+		if( !state->modelindex || FBitSet( state->effects, EF_NODRAW ))
+			continue;
+
+		ent = CL_GetEntityByIndex( state->number );
+		if( !ent || !ent->model ) continue;
+
+		if( ent->model->type == mod_brush )
+		{
+			if( !cl_bmodelinterp->value )
+				continue;
+		}
+		else
+		{
+			// parametric and not moved entities are never interpolated
+			if( ent->curstate.impacttime != 0.0f && ent->curstate.starttime != 0.0f )
+				continue;
+
+			if( !CL_EntityCustomLerp( ent ) && ent->curstate.movetype != MOVETYPE_STEP && !FBitSet( ent->curstate.eflags, EFLAG_SLERP ))
+				continue;
+		}
+
+		if( cl.local.moving && cl.local.onground == ent->index )
+			continue;
+
+		CL_FindInterpolationUpdates( ent, lerp->time, &ph0, &ph1 );
+
+		n = lerp->count++;
+		lerp->slot[i] = n;
+		lerp->ents[n] = ent;
+		lerp->ph0[n] = ph0;
+		lerp->ph1[n] = ph1;
+		lerp->t1[n] = ph1->animtime;
+		lerp->dt[n] = ( ph0->animtime != ph1->animtime ) ? ( ph0->animtime - ph1->animtime ) : 1.0f;
+
+		for( j = 0; j < 3; j++ )
+		{
+			lerp->start[j][n] = ph1->origin[j];
+			lerp->end[j][n] = ph0->origin[j];
+		}
+	}
+
+	if( !lerp->count ) return;
+
+#ifdef XASH_SSE2
+	if( FBitSet( Sys_CPUFeatures(), CPU_SSE2 ))
+	{
+		// pad the batch with harmless entries
+		for( n = lerp->count; n & 3; n++ )
+		{
+			lerp->t1[n] = 0.0f;
+			lerp->dt[n] = 1.0f;
+			for( j = 0; j < 3; j++ )
+				lerp->start[j][n] = lerp->end[j][n] = 0.0f;
+		}
+
+		CL_LerpOrigins_SSE2( lerp );
+		return;
+	}
+#endif
+	CL_LerpOrigins_Ref( lerp );
+}
+
+/*
+==================
+CL_InterpolateBatched
+
+finish interpolation with results of batched pass
+==================
+*/
+static int CL_InterpolateBatched( int n )
+{
+	entlerp_t		*lerp = &cl_entlerp;
+	cl_entity_t	*e = lerp->ents[n];
+	vec3_t		origin;
+
+	VectorCopy( e->curstate.origin, e->origin );
+	VectorCopy( e->curstate.angles, e->angles );
+	VectorSet( origin, lerp->origin[0][n], lerp->origin[1][n], lerp->origin[2][n] );
+
+	return CL_LerpHistory( e, lerp->time, lerp->ph0[n], lerp->ph1[n], origin );
+}
+
+/*
+==================
+CL_InterpolateLinked
+
+interpolate packet entity with specified index in frame
+==================
+*/
+static int CL_InterpolateLinked( cl_entity_t *e, int index )
+{
+	entlerp_t	*lerp = &cl_entlerp;
+
+	if( index >= lerp->numslots || lerp->slot[index] < 0 || lerp->ents[lerp->slot[index]] != e )
+		return CL_InterpolateModel( e );
+
+	return CL_InterpolateBatched( lerp->slot[index] );
+}
+
+/*
+==================
+CL_LerpBench_f
+
+time batched and per entity interpolation
+of current frame
+==================
+*/
+void CL_LerpBench_f( void )
+{
+	entlerp_t	*lerp = &cl_entlerp;
+	double	start, batched, single;
+	frame_t	*frame;
+	int	i, n, passes;
+
+	if( cls.state != ca_active || !cl.frames[cl.parsecountmod].valid )
+	{
+		Con_Printf( "lerpbench: not active\n" );
+		return;
+	}
+
+	passes = ( Cmd_Argc() > 1 ) ? Q_atoi( Cmd_Argv( 1 )) : 1000;
+	passes = bound( 1, passes, 100000 );
+	frame = &cl.frames[cl.parsecountmod];
+
+	start = Sys_DoubleTime();
+	for( i = 0; i < passes; i++ )
+	{
+		CL_BatchInterpolation( frame );
+		for( n = 0; n < lerp->count; n++ )
+			CL_InterpolateBatched( n );
+	}
+	batched = Sys_DoubleTime() - start;
+
+	start = Sys_DoubleTime();
+	for( i = 0; i < passes; i++ )
+	{
+		for( n = 0; n < lerp->count; n++ )
+			CL_InterpolateModel( lerp->ents[n] );
+	}
+	single = Sys_DoubleTime() - start;
+
+	Con_Printf( "%i entities, batched %.2f usec, one by one %.2f usec per frame\n",
+		lerp->count, batched * 1000000.0 / passes, single * 1000000.0 / passes );
 }
 
 /*
@@ -885,6 +1168,7 @@ int CL_ParsePacketEntities( sizebuf_t *msg, qboolean delta )
 	CL_ProcessPacket( newframe );
 
 	// add new entities into physic lists
+	CL_ClearPhysEnts();
 	CL_SetSolidEntities();
 
 	// first update is the final signon stage where we actually receive an entity (i.e., the world at least)
@@ -1079,6 +1363,10 @@ void CL_LinkPacketEntities( frame_t *frame )
 	qboolean		interpolate;
 	int		i;
 
+	if( CVAR_TO_BOOL( cl_lerp_batch ))
+		CL_BatchInterpolation( frame );
+	else cl_entlerp.numslots = 0;
+
 	for( i = 0; i < frame->num_entities; i++ )
 	{
 		state = &cls.packet_entities[(frame->first_entity + i) % cls.num_client_entities];
@@ -1155,7 +1443,7 @@ void CL_LinkPacketEntities( frame_t *frame )
 
 		if( ent->model->type == mod_brush )
 		{
-			CL_InterpolateModel( ent );
+			CL_InterpolateLinked( ent, i );
 		}
 		else
 		{
@@ -1168,12 +1456,12 @@ void CL_LinkPacketEntities( frame_t *frame )
 			}
 			else if( CL_EntityCustomLerp( ent ))
 			{
-				if ( !CL_InterpolateModel( ent ))
+				if ( !CL_InterpolateLinked( ent, i ))
 					continue;
 			}
 			else if( ent->curstate.movetype == MOVETYPE_STEP && !NET_IsLocalAddress( cls.netchan.remote_address ))
 			{
-				if( !CL_InterpolateModel( ent ))
+				if( !CL_InterpolateLinked( ent, i ))
 					continue;
 			}
 			else
@@ -1287,7 +1575,9 @@ void CL_EmitEntities( void )
 	CL_LinkPlayers ( &cl.frames[cl.parsecountmod] );
 
 	// link all the entities that actually have update
+	Prof_Begin( PROF_CL_LINKENTITIES );
 	CL_LinkPacketEntities ( &cl.frames[cl.parsecountmod] );
+	Prof_End( PROF_CL_LINKENTITIES );
 
 	// link custom user temp entities
 	clgame.dllFuncs.pfnCreateEntities();
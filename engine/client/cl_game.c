@@ -2487,6 +2487,23 @@ static const char *pfnTraceTexture( int ground, float *vstart, float *vend )
 	return PM_TraceTexture( pe, vstart, vend );
 }
 
+/*
+=============
+pfnTraceMaterial
+
+=============
+*/
+static char pfnTraceMaterial( int ground, float *vstart, float *vend )
+{
+	physent_t *pe;
+
+	if( ground < 0 || ground >= clgame.pmove->numphysent )
+		return 0; // bad ground
+
+	pe = &clgame.pmove->physents[ground];
+	return PM_TraceMaterial( pe, vstart, vend, clgame.dllFuncs.pfnPlayerMoveTexture, NULL );
+}
+
 /*
 =============
 pfnTraceSurface
@@ -3725,6 +3742,7 @@ static event_api_t gEventApi =
 	CL_TestLine,
 	CL_PushTraceBounds,
 	CL_PopTraceBounds,
+	pfnTraceMaterial,
 };
 
 static demo_api_t gDemoApi =
@@ -42,6 +42,9 @@ convar_t	*rcon_client_password;
 convar_t	*rcon_address;
 convar_t	*cl_timeout;
 convar_t	*cl_nopred;
+convar_t	*cl_predict_cache;
+convar_t	*cl_lerp_batch;
+convar_t	*cl_max_tempents;
 convar_t	*cl_showfps;
 convar_t	*cl_nodelta;
 convar_t	*cl_crosshair;
@@ -673,7 +676,9 @@ void CL_CreateCmd( void )
 	if( !cls.demoplayback ) cl.cmd = &pcmd->cmd;
 
 	// predict all unacknowledged movements
+	Prof_Begin( PROF_CL_PREDICT );
 	CL_PredictMovement( false );
+	Prof_End( PROF_CL_PREDICT );
 }
 
 void CL_WriteUsercmd( sizebuf_t *msg, int from, int to )
@@ -2623,7 +2628,10 @@ void CL_InitLocal( void )
 	cl_draw_beams = Cvar_Get( "r_drawbeams", "1", FCVAR_CHEAT, "render beams" );
 	cl_lightstyle_lerping = Cvar_Get( "cl_lightstyle_lerping", "0", FCVAR_ARCHIVE, "enables animated light lerping (perfomance option)" );
 	cl_showerror = Cvar_Get( "cl_showerror", "0", FCVAR_ARCHIVE, "show prediction error" );
+	cl_predict_cache = Cvar_Get( "cl_predict_cache", "1", FCVAR_ARCHIVE, "don't run prediction again for commands with unchanged input" );
 	cl_bmodelinterp = Cvar_Get( "cl_bmodelinterp", "1", FCVAR_ARCHIVE, "enable bmodel interpolation" );
+	cl_lerp_batch = Cvar_Get( "cl_lerp_batch", "1", FCVAR_ARCHIVE, "interpolate packet entities in one batched pass" );
+	cl_max_tempents = Cvar_Get( "cl_max_tempents", "0", FCVAR_ARCHIVE, "temp entities pool size, applied on next map (0 - use value from gameinfo)" );
 	cl_clockreset = Cvar_Get( "cl_clockreset", "0.1", FCVAR_ARCHIVE, "frametime delta maximum value before reset" );
 	cl_fixtimerate = Cvar_Get( "cl_fixtimerate", "7.5", FCVAR_ARCHIVE, "time in msec to client clock adjusting" );
 	Cvar_Get( "hud_scale", "0", FCVAR_ARCHIVE|FCVAR_LATCH, "scale hud at current resolution" );
@@ -2657,10 +2665,13 @@ void CL_InitLocal( void )
 	Cmd_AddCommand ("setinfo", CL_SetInfo_f, "examine or change the userinfo string (alias of userinfo)" );
 	Cmd_AddCommand ("userinfo", CL_SetInfo_f, "examine or change the userinfo string (alias of setinfo)" );
 	Cmd_AddCommand ("physinfo", CL_Physinfo_f, "print current client physinfo" );
+	Cmd_AddCommand ("predstats", CL_PredictStats_f, "print how many movement predictions was avoided" );
+	Cmd_AddCommand ("lerpbench", CL_LerpBench_f, "time batched entity interpolation on current frame" );
 	Cmd_AddCommand ("disconnect", CL_Disconnect_f, "disconnect from server" );
 	Cmd_AddCommand ("record", CL_Record_f, "record a demo" );
 	Cmd_AddCommand ("playdemo", CL_PlayDemo_f, "play a demo" );
 	Cmd_AddCommand ("timedemo", CL_TimeDemo_f, "demo benchmark" );
+	Cmd_AddCommand ("parsedemo", CL_ParseDemo_f, "demo network parsing benchmark, nothing is drawn" );
 	Cmd_AddCommand ("killdemo", CL_DeleteDemo_f, "delete a specified demo file" );
 	Cmd_AddCommand ("startdemos", CL_StartDemos_f, "start playing back the selected demos sequentially" );
 	Cmd_AddCommand ("demos", CL_Demos_f, "restart looping demos defined by the last startdemos command" );
@@ -2772,17 +2783,22 @@ void Host_ClientFrame( void )
 	CL_SetLastUpdate ();
 
 	// read updates from server
+	Prof_Begin( PROF_CL_READPACKETS );
 	CL_ReadPackets ();
+	Prof_End( PROF_CL_READPACKETS );
 
 	// do prediction again in case we got
 	// a new portion updates from server
+	Prof_Begin( PROF_CL_PREDICT );
 	CL_RedoPrediction ();
+	Prof_End( PROF_CL_PREDICT );
 
 	// TODO: implement
 //	Voice_Idle( host.frametime );
 
 	// emit visible entities
-	CL_EmitEntities ();
+	if( !cls.td_parseonly )
+		CL_EmitEntities ();
 
 	// in case we lost connection
 	CL_CheckForResend ();
@@ -2802,11 +2818,18 @@ void Host_ClientFrame( void )
 	// process VGUI
 	VGui_RunFrame ();
 
-	// update the screen
-	SCR_UpdateScreen ();
+	if( !cls.td_parseonly )
+	{
+		// update the screen
+		Prof_Begin( PROF_CL_UPDATESCREEN );
+		SCR_UpdateScreen ();
+		Prof_End( PROF_CL_UPDATESCREEN );
 
-	// update audio
-	SND_UpdateSound ();
+		// update audio
+		Prof_Begin( PROF_CL_SOUND );
+		SND_UpdateSound ();
+		Prof_End( PROF_CL_SOUND );
+	}
 
 	// play avi-files
 	SCR_RunCinematic ();
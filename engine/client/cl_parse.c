@@ -20,6 +20,7 @@ GNU General Public License for more details.
 #include "gl_local.h"
 #include "cl_tent.h"
 #include "shake.h"
+#include "pm_local.h"
 #include "hltv.h"
 #include "input.h"
 
@@ -1509,6 +1510,9 @@ void CL_RegisterResources( sizebuf_t *msg )
 			// tell rendering system we have a new set of models.
 			R_NewMap ();
 
+			// footsteps and bullet impacts don't need to search materials.txt
+			PM_InitMaterials( cl.worldmodel, clgame.dllFuncs.pfnPlayerMoveTexture );
+
 			CL_SetupOverviewParams();
 
 			if( clgame.drawFuncs.R_NewMap != NULL )
@@ -1978,6 +1982,7 @@ void CL_ParseServerMessage( sizebuf_t *msg, qboolean normal_message )
 	size_t		bufStart, playerbytes;
 	int		cmd, param1, param2;
 	int		old_background;
+	double		parsetime;
 	const char	*s;
 
 	cls.starting_count = MSG_GetNumBytesRead( msg );	// updates each frame
@@ -2186,14 +2191,18 @@ void CL_ParseServerMessage( sizebuf_t *msg, qboolean normal_message )
 			CL_RegisterUserMessage( msg );
 			break;
 		case svc_packetentities:
-			playerbytes = CL_ParsePacketEntities( msg, false );
-			cl.frames[cl.parsecountmod].graphdata.players += playerbytes;
-			cl.frames[cl.parsecountmod].graphdata.entities += MSG_GetNumBytesRead( msg ) - bufStart - playerbytes;
-			break;
 		case svc_deltapacketentities:
-			playerbytes = CL_ParsePacketEntities( msg, true );
+			parsetime = cls.timedemo ? Sys_DoubleTime() : 0.0;
+			playerbytes = CL_ParsePacketEntities( msg, ( cmd == svc_deltapacketentities ));
 			cl.frames[cl.parsecountmod].graphdata.players += playerbytes;
 			cl.frames[cl.parsecountmod].graphdata.entities += MSG_GetNumBytesRead( msg ) - bufStart - playerbytes;
+
+			if( cls.timedemo )
+			{
+				// demo benchmark stats
+				cls.td_parsetime += Sys_DoubleTime() - parsetime;
+				cls.td_entities += cl.frames[cl.parsecountmod].num_entities;
+			}
 			break;
 		case svc_choke:
 			cl.frames[cls.netchan.incoming_sequence & CL_UPDATE_MASK].choked = true;
@@ -38,6 +38,9 @@ void CL_ClearPhysEnts( void )
 	clgame.pmove->numvisent = 0;
 	clgame.pmove->nummoveent = 0;
 	clgame.pmove->numphysent = 0;
+
+	// force to rebuild solid list
+	cl.local.numsolid = 0;
 }
 
 /*
@@ -502,12 +505,22 @@ void CL_AddLinksToPmove( frame_t *frame )
 CL_SetSolidEntities
 
 Builds all the pmove physents for the current frame
+List is reused until a new frame is arrived
 ===============
 */
 void CL_SetSolidEntities( void )
 {
 	physent_t	*pe = clgame.pmove->physents;
 
+	if( cl.local.numsolid > 0 && cl.local.solidframe == cl.parsecount && pe->model == cl.worldmodel )
+	{
+		// entities are not changed, just drop players and other temporary stuff
+		clgame.pmove->numphysent = cl.local.numsolid;
+		clgame.pmove->numvisent = cl.local.numsolidvis;
+		clgame.pmove->nummoveent = cl.local.numsolidmove;
+		return;
+	}
+
 	// setup physents
 	clgame.pmove->numvisent = 1;
 	clgame.pmove->numphysent = 1;
@@ -526,6 +539,11 @@ void CL_SetSolidEntities( void )
 
 	// add all other entities exlucde players
 	CL_AddLinksToPmove( &cl.frames[cl.parsecountmod] );
+
+	cl.local.solidframe = cl.parsecount;
+	cl.local.numsolid = clgame.pmove->numphysent;
+	cl.local.numsolidvis = clgame.pmove->numvisent;
+	cl.local.numsolidmove = clgame.pmove->nummoveent;
 }
 
 /*
@@ -840,6 +858,17 @@ static const char *pfnTraceTexture( int ground, float *vstart, float *vend )
 	return PM_TraceTexture( pe, vstart, vend );
 }			
 
+static char pfnTraceMaterial( int ground, float *vstart, float *vend, char *texname )
+{
+	physent_t *pe;
+
+	if( ground < 0 || ground >= clgame.pmove->numphysent )
+		return 0; // bad ground
+
+	pe = &clgame.pmove->physents[ground];
+	return PM_TraceMaterial( pe, vstart, vend, clgame.dllFuncs.pfnPlayerMoveTexture, texname );
+}
+
 static void pfnPlaySound( int channel, const char *sample, float volume, float attenuation, int fFlags, int pitch )
 {
 	if( !clgame.pmove->runfuncs )
@@ -957,6 +986,7 @@ void CL_InitClientMove( void )
 	clgame.pmove->PM_TestPlayerPositionEx = pfnTestPlayerPositionEx;
 	clgame.pmove->PM_TraceLineEx = pfnTraceLineEx;
 	clgame.pmove->PM_TraceSurface = pfnTraceSurface;
+	clgame.pmove->PM_TraceMaterial = pfnTraceMaterial;
 
 	// initalize pmove
 	clgame.dllFuncs.pfnPlayerMoveInit( clgame.pmove );
@@ -1155,6 +1185,84 @@ void CL_MoveSpectatorCamera( void )
 	VectorCopy( cls.spectator_state.client.view_ofs, cl.viewheight );
 }
 
+/*
+=================
+CL_PredictStateHash
+
+hash of the predicted player state
+=================
+*/
+static dword CL_PredictStateHash( const local_state_t *state )
+{
+	dword	crc;
+
+	CRC32_Init( &crc );
+	CRC32_ProcessBuffer( &crc, state, sizeof( *state ));
+
+	return CRC32_Final( crc );
+}
+
+/*
+=================
+CL_PredictPhysEntsHash
+
+solid list and movevars that used for this prediction
+=================
+*/
+static dword CL_PredictPhysEntsHash( void )
+{
+	int	first = clgame.oldphyscount;
+	dword	crc;
+
+	CRC32_Init( &crc );
+	CRC32_ProcessBuffer( &crc, &cl.local.solidframe, sizeof( cl.local.solidframe ));
+	CRC32_ProcessBuffer( &crc, &clgame.pmove->numphysent, sizeof( clgame.pmove->numphysent ));
+	CRC32_ProcessBuffer( &crc, &clgame.movevars, sizeof( clgame.movevars ));
+
+	// players are added to the solid list every frame
+	if( clgame.pmove->numphysent > first )
+		CRC32_ProcessBuffer( &crc, &clgame.pmove->physents[first], ( clgame.pmove->numphysent - first ) * sizeof( physent_t ));
+
+	return CRC32_Final( crc );
+}
+
+/*
+=================
+CL_PredictInputHash
+
+all the input of single command prediction
+=================
+*/
+static dword CL_PredictInputHash( dword statehash, dword physhash, const usercmd_t *cmd, double time, int command )
+{
+	dword	crc;
+
+	CRC32_Init( &crc );
+	CRC32_ProcessBuffer( &crc, &statehash, sizeof( statehash ));
+	CRC32_ProcessBuffer( &crc, &physhash, sizeof( physhash ));
+	CRC32_ProcessBuffer( &crc, cmd, sizeof( *cmd ));
+	CRC32_ProcessBuffer( &crc, &time, sizeof( time ));
+	CRC32_ProcessBuffer( &crc, &command, sizeof( command ));	// random seed
+
+	return CRC32_Final( crc );
+}
+
+/*
+=================
+CL_PredictStats_f
+
+=================
+*/
+void CL_PredictStats_f( void )
+{
+	int	total = cl.local.predicted + cl.local.predcached;
+
+	Con_Printf( "%i commands predicted, %i pmove runs avoided (%.1f%%)\n", total,
+		cl.local.predcached, total ? ( cl.local.predcached * 100.0f / total ) : 0.0f );
+
+	cl.local.predicted = cl.local.predcached = 0;
+}
+
 /*
 =================
 CL_PredictMovement
@@ -1166,6 +1274,12 @@ void CL_PredictMovement( qboolean repredicting )
 {
 	runcmd_t		*to_cmd, *from_cmd;
 	local_state_t	*from = NULL, *to = NULL;
+	dword		statehash = 0;
+	dword		physhash = 0;
+	dword		inputhash = 0;
+	qboolean		usecache;
+	predcache_t	*cache;
+	double		starttime;
 	int		current_command;
 	int		current_command_mod;
 	frame_t		*frame = NULL;
@@ -1222,6 +1336,16 @@ void CL_PredictMovement( qboolean repredicting )
 	CL_PushPMStates();
 	CL_SetSolidPlayers( cl.playernum );
 
+	// commands which have the same input as last time doesn't need to run again.
+	// between server frames this is all of them except the newest one
+	usecache = ( CVAR_TO_BOOL( cl_predict_cache ) && CL_IsPredicted( ));
+
+	if( usecache )
+	{
+		statehash = CL_PredictStateHash( from );
+		physhash = CL_PredictPhysEntsHash();
+	}
+
 	for( i = 1; i < CL_UPDATE_MASK && cls.netchan.incoming_acknowledged + i < cls.netchan.outgoing_sequence + stoppoint; i++ )
 	{
 		current_command = cls.netchan.incoming_acknowledged + i;
@@ -1230,8 +1354,38 @@ void CL_PredictMovement( qboolean repredicting )
 		to = &cl.predicted_frames[(cl.parsecountmod + i) & CL_UPDATE_MASK];
 		to_cmd = &cl.commands[current_command_mod];
 		runfuncs = ( !repredicting && !to_cmd->processedfuncs );
+		cache = &cl.predcache[current_command_mod];
+
+		if( usecache )
+			inputhash = CL_PredictInputHash( statehash, physhash, &to_cmd->cmd, time, current_command );
+
+		if( usecache && !runfuncs && cache->valid && cache->inputhash == inputhash )
+		{
+			// nothing was changed since last prediction
+			*to = cache->state;
+			cl.local.lastground = cache->lastground;
+			time += cache->frametime;
+			statehash = cache->resulthash;
+			cl.local.predcached++;
+		}
+		else
+		{
+			starttime = time;
+			CL_RunUsercmd( from, to, &to_cmd->cmd, runfuncs, &time, current_command );
+			cl.local.predicted++;
+
+			if( usecache )
+			{
+				statehash = CL_PredictStateHash( to );
+				cache->valid = true;
+				cache->inputhash = inputhash;
+				cache->resulthash = statehash;
+				cache->frametime = time - starttime;
+				cache->lastground = cl.local.lastground;
+				cache->state = *to;
+			}
+		}
 
-		CL_RunUsercmd( from, to, &to_cmd->cmd, runfuncs, &time, current_command );
 		VectorCopy( to->playerstate.origin, cl.local.predicted_origins[current_command_mod] );
 		to_cmd->processedfuncs = true;
 
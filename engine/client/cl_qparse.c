@@ -1126,6 +1126,7 @@ void CL_ParseQuakeMessage( sizebuf_t *msg, qboolean normal_message )
 	CL_ProcessPacket( &cl.frames[cl.parsecountmod] );
 
 	// add new entities into physic lists
+	CL_ClearPhysEnts();
 	CL_SetSolidEntities();
 
 	// check deferred cmds
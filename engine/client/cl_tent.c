@@ -35,10 +35,36 @@ TEMPENTS MANAGEMENT
 #define FLASHLIGHT_DISTANCE		2000	// in units
 #define SHARD_VOLUME		12.0f	// on shard ever n^3 units
 #define MAX_MUZZLEFLASH		3
+#define TENT_GROUPS			256	// different tent models grouped at once, power of two
+
+// TEMPENTITY layout is shared with client.dll which
+// also moves them between lists, so we keep own links aside
+typedef struct
+{
+	int		prev;
+	int		next;
+	qboolean		linked;
+} tentlink_t;
+
+// last active tent of each model, new ones are linked behind it
+typedef struct
+{
+	model_t		*model;
+	TEMPENTITY	*last;
+	int		update;		// cl_tentupdate when it was set
+} tentgroup_t;
 
 TEMPENTITY	*cl_active_tents;
 TEMPENTITY	*cl_free_tents;
 TEMPENTITY	*cl_tempents = NULL;		// entities pool
+static int	cl_numtents;			// pool size
+static tentlink_t	*cl_tentlinks;			// low priority tents, oldest first
+static int	cl_tentlow_head = -1;
+static int	cl_tentlow_tail = -1;
+static tentgroup_t	cl_tentgroups[TENT_GROUPS];
+static int	cl_tentgroups_update = -1;	// cl_tentupdate the groups were built for
+static int	cl_tentupdate;			// bumped when tents can leave the active list
+static qboolean	cl_tentupdating;			// client.dll is walking the active list
 
 model_t		*cl_sprite_muzzleflash[MAX_MUZZLEFLASH];	// muzzle flashes
 model_t		*cl_sprite_dot = NULL;
@@ -317,6 +343,36 @@ int CL_FxBlend( cl_entity_t *e )
 	return blend;
 }
 
+/*
+================
+CL_TempEntsPoolSize
+
+cl_max_tempents overrides gameinfo value
+================
+*/
+static int CL_TempEntsPoolSize( void )
+{
+	if( cl_max_tempents && cl_max_tempents->value > 0.0f )
+		return bound( 300, (int)cl_max_tempents->value, 2048 );
+	return GI->max_tents;
+}
+
+/*
+================
+CL_AllocTempEnts
+
+================
+*/
+static void CL_AllocTempEnts( int count )
+{
+	if( cl_tempents ) Mem_Free( cl_tempents );
+	if( cl_tentlinks ) Mem_Free( cl_tentlinks );
+
+	cl_tempents = Mem_Calloc( cls.mempool, sizeof( TEMPENTITY ) * count );
+	cl_tentlinks = Mem_Calloc( cls.mempool, sizeof( tentlink_t ) * count );
+	cl_numtents = count;
+}
+
 /*
 ================
 CL_InitTempents
@@ -325,7 +381,7 @@ CL_InitTempents
 */
 void CL_InitTempEnts( void )
 {
-	cl_tempents = Mem_Calloc( cls.mempool, sizeof( TEMPENTITY ) * GI->max_tents );
+	CL_AllocTempEnts( CL_TempEntsPoolSize( ));
 	CL_ClearTempEnts();
 
 	// load tempent sprites (glowshell, muzzleflashes etc)
@@ -344,15 +400,24 @@ void CL_ClearTempEnts( void )
 
 	if( !cl_tempents ) return;
 
-	for( i = 0; i < GI->max_tents - 1; i++ )
+	// pool size was changed, all the tents are dead anyway
+	if( cl_numtents != CL_TempEntsPoolSize( ))
+		CL_AllocTempEnts( CL_TempEntsPoolSize( ));
+
+	for( i = 0; i < cl_numtents - 1; i++ )
 	{
 		cl_tempents[i].next = &cl_tempents[i+1];
 		cl_tempents[i].entity.trivial_accept = INVALID_HANDLE;
 	}
 
-	cl_tempents[GI->max_tents-1].next = NULL;
+	cl_tempents[cl_numtents-1].next = NULL;
+	cl_tempents[cl_numtents-1].entity.trivial_accept = INVALID_HANDLE;
 	cl_free_tents = cl_tempents;
 	cl_active_tents = NULL;
+
+	memset( cl_tentlinks, 0, sizeof( tentlink_t ) * cl_numtents );
+	cl_tentlow_head = cl_tentlow_tail = -1;
+	cl_tentupdate++;
 }
 
 /*
@@ -365,7 +430,55 @@ void CL_FreeTempEnts( void )
 {
 	if( cl_tempents )
 		Mem_Free( cl_tempents );
+	if( cl_tentlinks )
+		Mem_Free( cl_tentlinks );
+
 	cl_tempents = NULL;
+	cl_tentlinks = NULL;
+	cl_numtents = 0;
+}
+
+/*
+==============
+CL_UnlinkLowPriorityTEnt
+
+==============
+*/
+static void CL_UnlinkLowPriorityTEnt( int index )
+{
+	tentlink_t	*link = &cl_tentlinks[index];
+
+	if( !link->linked ) return;
+
+	if( link->prev != -1 ) cl_tentlinks[link->prev].next = link->next;
+	else cl_tentlow_head = link->next;
+
+	if( link->next != -1 ) cl_tentlinks[link->next].prev = link->prev;
+	else cl_tentlow_tail = link->prev;
+
+	link->linked = false;
+}
+
+/*
+==============
+CL_LinkLowPriorityTEnt
+
+newest tents are at the tail
+==============
+*/
+static void CL_LinkLowPriorityTEnt( int index )
+{
+	tentlink_t	*link = &cl_tentlinks[index];
+
+	CL_UnlinkLowPriorityTEnt( index );
+
+	link->prev = cl_tentlow_tail;
+	link->next = -1;
+	link->linked = true;
+
+	if( cl_tentlow_tail != -1 ) cl_tentlinks[cl_tentlow_tail].next = index;
+	else cl_tentlow_head = index;
+	cl_tentlow_tail = index;
 }
 
 /*
@@ -530,6 +643,105 @@ int CL_TempEntAddEntity( cl_entity_t *pEntity )
 	return 0;
 }
 
+/*
+==============
+CL_TempEntGroup
+
+groups left from older updates count as empty.
+returns NULL when all the groups are taken
+==============
+*/
+static tentgroup_t *CL_TempEntGroup( model_t *pmodel )
+{
+	uint		i, hash = (uint)(size_t)pmodel;
+	tentgroup_t	*group;
+
+	hash = ( hash ^ ( hash >> 13 )) * 0x9E3779B1;
+
+	for( i = 0; i < TENT_GROUPS; i++ )
+	{
+		group = &cl_tentgroups[((hash >> 16) + i) & (TENT_GROUPS - 1)];
+		if( group->update != cl_tentupdate || !group->model || group->model == pmodel )
+			return group;
+	}
+
+	return NULL;
+}
+
+/*
+==============
+CL_BuildTempEntGroups
+
+find the last active tent of each model,
+once per update before the first allocation
+==============
+*/
+static void CL_BuildTempEntGroups( void )
+{
+	TEMPENTITY	*pTemp;
+	tentgroup_t	*group;
+	int		count = 0;
+
+	for( pTemp = cl_active_tents; pTemp && count < cl_numtents; pTemp = pTemp->next, count++ )
+	{
+		if( !pTemp->entity.model || !( group = CL_TempEntGroup( pTemp->entity.model )))
+			continue;
+
+		group->model = pTemp->entity.model;
+		group->last = pTemp;
+		group->update = cl_tentupdate;
+	}
+
+	cl_tentgroups_update = cl_tentupdate;
+}
+
+/*
+==============
+CL_LinkActiveTempEnt
+
+put the new tent next to the active ones with the same
+model so client.dll updates them one after another
+==============
+*/
+static void CL_LinkActiveTempEnt( TEMPENTITY *pTemp )
+{
+	model_t		*pmodel = pTemp->entity.model;
+	tentgroup_t	*group = NULL;
+
+	// client.dll frees tents and keeps its own pointers into the list
+	// while it updates them, only the head is safe to link at then
+	if( cl_tentupdating )
+	{
+		pTemp->next = cl_active_tents;
+		cl_active_tents = pTemp;
+		return;
+	}
+
+	if( cl_tentgroups_update != cl_tentupdate )
+		CL_BuildTempEntGroups();
+
+	if( pmodel ) group = CL_TempEntGroup( pmodel );
+
+	// tents set before the last update may be freed already,
+	// reused low priority tents change the model in place
+	if( group && group->update == cl_tentupdate && group->model == pmodel && group->last->entity.model == pmodel )
+	{
+		pTemp->next = group->last->next;
+		group->last->next = pTemp;
+	}
+	else
+	{
+		pTemp->next = cl_active_tents;
+		cl_active_tents = pTemp;
+	}
+
+	if( !group ) return;
+
+	group->model = pmodel;
+	group->last = pTemp;
+	group->update = cl_tentupdate;
+}
+
 /*
 ==============
 CL_AddTempEnts
@@ -543,41 +755,43 @@ void CL_TempEntUpdate( void )
 	double	ft = cl.time - cl.oldtime;
 	float	gravity = clgame.movevars.gravity;
 
+	cl_tentupdate++;
+	cl_tentupdating = true;
 	clgame.dllFuncs.pfnTempEntUpdate( ft, cl.time, gravity, &cl_free_tents, &cl_active_tents, CL_TempEntAddEntity, CL_TempEntPlaySound );
+	cl_tentupdating = false;
 }
 
 /*
 ==============
-CL_TEntAddEntity
+CL_ReuseLowPriorityTempEnt
 
-free the first low priority tempent it finds.
+take the oldest low priority tempent, it stays in active list.
+only called when free list is empty so all the tents are active
 ==============
 */
-qboolean CL_FreeLowPriorityTempEnt( void )
+static TEMPENTITY *CL_ReuseLowPriorityTempEnt( model_t *pmodel )
 {
-	TEMPENTITY	*pActive = cl_active_tents;
-	TEMPENTITY	*pPrev = NULL;
+	TEMPENTITY	*pTemp, *pNext;
+	int		index;
 
-	while( pActive )
+	while( cl_tentlow_head != -1 )
 	{
-		if( pActive->priority == TENTPRIORITY_LOW )
-		{
-			// remove from the active list.
-			if( pPrev ) pPrev->next = pActive->next;
-			else cl_active_tents = pActive->next;
+		index = cl_tentlow_head;
+		pTemp = &cl_tempents[index];
+		CL_UnlinkLowPriorityTEnt( index );
 
-			// add to the free list.
-			pActive->next = cl_free_tents;
-			cl_free_tents = pActive;
+		// client.dll can raise priority after allocation
+		if( pTemp->priority != TENTPRIORITY_LOW )
+			continue;
 
-			return true;
-		}
+		pNext = pTemp->next;
+		CL_PrepareTEnt( pTemp, pmodel );
+		pTemp->next = pNext;
 
-		pPrev = pActive;
-		pActive = pActive->next;
+		return pTemp;
 	}
 
-	return false;
+	return NULL;
 }
 
 /*
@@ -593,7 +807,7 @@ TEMPENTITY *CL_TempEntAlloc( const vec3_t org, model_t *pmodel )
 
 	if( !cl_free_tents )
 	{
-		Con_DPrintf( "Overflow %d temporary ents!\n", GI->max_tents );
+		Con_DPrintf( "Overflow %d temporary ents!\n", cl_numtents );
 		return NULL;
 	}
 
@@ -605,8 +819,8 @@ TEMPENTITY *CL_TempEntAlloc( const vec3_t org, model_t *pmodel )
 	pTemp->priority = TENTPRIORITY_LOW;
 	if( org ) VectorCopy( org, pTemp->entity.origin );
 
-	pTemp->next = cl_active_tents;
-	cl_active_tents = pTemp;
+	CL_LinkActiveTempEnt( pTemp );
+	CL_LinkLowPriorityTEnt( pTemp - cl_tempents );
 
 	return pTemp;
 }
@@ -624,31 +838,31 @@ TEMPENTITY *CL_TempEntAllocHigh( const vec3_t org, model_t *pmodel )
 
 	if( !cl_free_tents )
 	{
-		// no temporary ents free, so find the first active low-priority temp ent 
-		// and overwrite it.
-		CL_FreeLowPriorityTempEnt();
-	}
+		// no temporary ents free, so overwrite the oldest
+		// active low-priority temp ent.
+		pTemp = CL_ReuseLowPriorityTempEnt( pmodel );
 
-	if( !cl_free_tents )
-	{
-		// didn't find anything? The tent list is either full of high-priority tents
-		// or all tents in the list are still due to live for > 10 seconds. 
-		Con_DPrintf( "Couldn't alloc a high priority TENT!\n" );
-		return NULL;
+		if( !pTemp )
+		{
+			// didn't find anything? The tent list is full of high-priority tents
+			Con_DPrintf( "Couldn't alloc a high priority TENT!\n" );
+			return NULL;
+		}
 	}
+	else
+	{
+		// Move out of the free list and into the active list.
+		pTemp = cl_free_tents;
+		cl_free_tents = pTemp->next;
 
-	// Move out of the free list and into the active list.
-	pTemp = cl_free_tents;
-	cl_free_tents = pTemp->next;
-
-	CL_PrepareTEnt( pTemp, pmodel );
+		CL_PrepareTEnt( pTemp, pmodel );
+		CL_LinkActiveTempEnt( pTemp );
+		CL_UnlinkLowPriorityTEnt( pTemp - cl_tempents );
+	}
 
 	pTemp->priority = TENTPRIORITY_HIGH;
 	if( org ) VectorCopy( org, pTemp->entity.origin );
 
-	pTemp->next = cl_active_tents;
-	cl_active_tents = pTemp;
-
 	return pTemp;
 }
 
@@ -925,7 +1139,7 @@ void R_KillAttachedTents( int client )
 	if( client <= 0 || client > cl.maxclients )
 		return;
 
-	for( i = 0; i < GI->max_tents; i++ )
+	for( i = 0; i < cl_numtents; i++ )
 	{
 		TEMPENTITY *pTemp = &cl_tempents[i];
 
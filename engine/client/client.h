@@ -105,6 +105,16 @@ typedef struct runcmd_s
 	int		sendsize;
 } runcmd_t;
 
+typedef struct
+{
+	qboolean		valid;
+	dword		inputhash;	// start state, usercmd, time and physents
+	dword		resulthash;	// hash of the predicted state
+	double		frametime;	// time consumed by command
+	int		lastground;
+	local_state_t	state;		// predicted state
+} predcache_t;
+
 // add angles
 typedef struct
 {
@@ -164,6 +174,16 @@ typedef struct
 	// weapon predict stuff
 	int		weaponsequence;
 	float		weaponstarttime;
+
+	// solid entities list
+	int		solidframe;	// parsecount the list was built for
+	int		numsolid;		// 0 if list must be rebuilt
+	int		numsolidvis;
+	int		numsolidmove;
+
+	// prediction stats
+	int		predicted;	// real pmove runs
+	int		predcached;	// commands taken from predcache
 } cl_local_data_t;
 
 typedef struct
@@ -228,6 +248,7 @@ typedef struct
 	frame_t		frames[MULTIPLAYER_BACKUP];		// alloced on svc_serverdata
 	runcmd_t		commands[MULTIPLAYER_BACKUP];		// each mesage will send several old cmds
 	local_state_t	predicted_frames[MULTIPLAYER_BACKUP];	// local client state
+	predcache_t	predcache[MULTIPLAYER_BACKUP];	// last prediction result for each command
 
 	double		time;			// this is the time value that the client
 						// is rendering at.  always <= cls.realtime
@@ -609,6 +630,9 @@ typedef struct
 	int		td_lastframe;		// to meter out one message a frame
 	int		td_startframe;		// host_framecount at start
 	double		td_starttime;		// realtime at second frame of timedemo
+	double		td_parsetime;		// spent in CL_ParsePacketEntities
+	int		td_entities;		// entity states decoded
+	qboolean		td_parseonly;		// parsedemo: don't draw or mix anything
 	int		forcetrack;		// -1 = use normal cd track
 
 	// game images
@@ -682,6 +706,9 @@ extern convar_t	cl_allow_download;
 extern convar_t	cl_allow_upload;
 extern convar_t	cl_download_ingame;
 extern convar_t	*cl_nopred;
+extern convar_t	*cl_predict_cache;
+extern convar_t	*cl_lerp_batch;
+extern convar_t	*cl_max_tempents;
 extern convar_t	*cl_showfps;
 extern convar_t	*cl_envshot_size;
 extern convar_t	*cl_timeout;
@@ -792,6 +819,7 @@ void CL_StopPlayback( void );
 void CL_StopRecord( void );
 void CL_PlayDemo_f( void );
 void CL_TimeDemo_f( void );
+void CL_ParseDemo_f( void );
 void CL_StartDemos_f( void );
 void CL_Demos_f( void );
 void CL_DeleteDemo_f( void );
@@ -925,6 +953,7 @@ void CL_PopTraceBounds( void );
 void CL_MoveSpectatorCamera( void );
 void CL_SetLastUpdate( void );
 void CL_RedoPrediction( void );
+void CL_PredictStats_f( void );
 void CL_ClearPhysEnts( void );
 void CL_PushPMStates( void );
 void CL_PopPMStates( void );
@@ -954,6 +983,7 @@ void CL_ProcessPacket( frame_t *frame );
 void CL_MoveThirdpersonCamera( void );
 qboolean CL_IsPlayerIndex( int idx );
 void CL_SetIdealPitch( void );
+void CL_LerpBench_f( void );
 void CL_EmitEntities( void );
 
 //
@@ -986,6 +1016,7 @@ void CL_InitParticles( void );
 void CL_ClearParticles( void );
 void CL_FreeParticles( void );
 void CL_DrawParticles( double frametime );
+void CL_ParticleProfiling_f( void );
 void CL_DrawTracers( double frametime );
 void CL_InitTempEnts( void );
 void CL_ClearTempEnts( void );
@@ -21,6 +21,7 @@ GNU General Public License for more details.
 #define DECAL_OVERLAP_DISTANCE	2
 #define DECAL_DISTANCE		4	// too big values produce more clipped polygons
 #define MAX_DECALCLIPVERT		32	// produced vertexes of fragmented decal
+#define MAX_DECALPOOLVERT		8	// bigger decals are allocated from zone
 #define DECAL_CACHEENTRY		256	// MUST BE POWER OF 2 or code below needs to change!
 #define DECAL_TRANSPARENT_THRESHOLD	230	// transparent decals draw with GL_MODULATE
 
@@ -54,8 +55,27 @@ typedef struct
 static float	g_DecalClipVerts[MAX_DECALCLIPVERT][VERTEXSIZE];
 static float	g_DecalClipVerts2[MAX_DECALCLIPVERT][VERTEXSIZE];
 
+// decal mesh that fits into pool, verts continues poly->verts
+typedef struct
+{
+	glpoly_t		poly;
+	float		verts[MAX_DECALPOOLVERT-4][VERTEXSIZE];
+} decalpoly_t;
+
+// per-decal data that never changes while decal is alive
+typedef struct
+{
+	vec3_t		basis[2];		// scaled texture space basis for R_DecalIntersect
+	int		lightmap;		// lightmap the verts was lit for
+	int		light_s;
+	int		light_t;
+} decalcache_t;
+
 static decal_t	gDecalPool[MAX_RENDER_DECALS];
+static decalpoly_t	gDecalPolys[MAX_RENDER_DECALS];
+static decalcache_t	gDecalCache[MAX_RENDER_DECALS];
 static int	gDecalCount;
+static byte	*gDecalTrack;	// R_DecalProfiling_f marks the pool entries it has used
 
 void R_ClearDecals( void )
 {
@@ -63,6 +83,11 @@ void R_ClearDecals( void )
 	gDecalCount = 0;
 }
 
+static qboolean R_DecalPolyInPool( decal_t *pdecal )
+{
+	return ( pdecal->polys == &gDecalPolys[pdecal - gDecalPool].poly );
+}
+
 // unlink pdecal from any surface it's attached to
 static void R_DecalUnlink( decal_t *pdecal )
 {
@@ -91,7 +116,7 @@ static void R_DecalUnlink( decal_t *pdecal )
 		}
 	}
 
-	if( pdecal->polys )
+	if( pdecal->polys && !R_DecalPolyInPool( pdecal ))
 		Mem_Free( pdecal->polys );
 
 	pdecal->psurface = NULL;
@@ -129,6 +154,9 @@ static decal_t *R_DecalAlloc( decal_t *pdecal )
 	// if decal is already linked to a surface, unlink it.
 	R_DecalUnlink( pdecal );
 
+	if( gDecalTrack )
+		gDecalTrack[pdecal - gDecalPool] = true;
+
 	return pdecal;	
 }
 
@@ -445,20 +473,15 @@ static decal_t *R_DecalIntersect( decalinfo_t *decalinfo, msurface_t *surf, int
 
 	while( pDecal ) 
 	{
-		texture = pDecal->texture;
-
 		// Don't steal bigger decals and replace them with smaller decals
 		// Don't steal permanent decals
 		if( !FBitSet( pDecal->flags, FDECAL_PERMANENT ))
 		{
-			vec3_t	testBasis[3];
+			vec3_t	*testBasis = gDecalCache[pDecal - gDecalPool].basis;
 			vec3_t	testPosition[2];
-			float	testWorldScale[2];
 			vec2_t	vDecalMin, vDecalMax;
 			vec2_t	vUnionMin, vUnionMax;
 
-			R_SetupDecalTextureSpaceBasis( pDecal, surf, texture, testBasis, testWorldScale );
-
 			VectorSubtract( decalinfo->m_Position, decalExtents[0], testPosition[0] );
 			VectorSubtract( decalinfo->m_Position, decalExtents[1], testPosition[1] );
 
@@ -507,24 +530,32 @@ static decal_t *R_DecalIntersect( decalinfo_t *decalinfo, msurface_t *surf, int
 ====================
 R_DecalCreatePoly
 
-creates mesh for decal on first rendering
+store clipped and lit decal verts
 ====================
 */
-glpoly_t *R_DecalCreatePoly( decalinfo_t *decalinfo, decal_t *pdecal, msurface_t *surf )
+glpoly_t *R_DecalCreatePoly( decal_t *pdecal, msurface_t *surf, const float *v, int lnumverts )
 {
-	int		lnumverts;
+	decalcache_t	*cache = &gDecalCache[pdecal - gDecalPool];
 	glpoly_t		*poly;
-	float		*v;
 	int		i;
 
 	if( pdecal->polys )	// already created?
 		return pdecal->polys;
 
-	v = R_DecalSetupVerts( pdecal, surf, pdecal->texture, &lnumverts );
 	if( !lnumverts ) return NULL;	// probably this never happens
 
 	// allocate glpoly
-	poly = Mem_Calloc( com_studiocache, sizeof( glpoly_t ) + ( lnumverts - 4 ) * VERTEXSIZE * sizeof( float ));
+	if( lnumverts <= MAX_DECALPOOLVERT )
+	{
+		poly = &gDecalPolys[pdecal - gDecalPool].poly;
+		memset( poly, 0, sizeof( *poly ));
+	}
+	else poly = Mem_Calloc( com_studiocache, sizeof( glpoly_t ) + ( lnumverts - 4 ) * VERTEXSIZE * sizeof( float ));
+
+	cache->lightmap = surf->lightmaptexturenum;
+	cache->light_s = surf->light_s;
+	cache->light_t = surf->light_t;
+
 	poly->next = pdecal->polys;
 	poly->flags = surf->flags;
 	pdecal->polys = poly;
@@ -543,7 +574,7 @@ glpoly_t *R_DecalCreatePoly( decalinfo_t *decalinfo, decal_t *pdecal, msurface_t
 }
 
 // Add the decal to the surface's list of decals.
-static void R_AddDecalToSurface( decal_t *pdecal, msurface_t *surf, decalinfo_t *decalinfo )
+static void R_AddDecalToSurface( decal_t *pdecal, msurface_t *surf, const float *verts, int vertCount )
 {
 	decal_t	*pold;
 
@@ -569,13 +600,17 @@ static void R_AddDecalToSurface( decal_t *pdecal, msurface_t *surf, decalinfo_t
 	// together with surface
 
 	// alloc clipped poly for decal
-	R_DecalCreatePoly( decalinfo, pdecal, surf );
+	R_DecalCreatePoly( pdecal, surf, verts, vertCount );
 }
 
 static void R_DecalCreate( decalinfo_t *decalinfo, msurface_t *surf, float x, float y )
 {
 	decal_t	*pdecal, *pold;
 	int	count, vertCount;
+	vec3_t	textureSpaceBasis[3];
+	float	decalWorldScale[2];
+	decalcache_t	*cache;
+	float	*verts;
 
 	if( !surf ) return;	// ???
 	
@@ -598,8 +633,10 @@ static void R_DecalCreate( decalinfo_t *decalinfo, msurface_t *surf, float x, fl
 	pdecal->texture = decalinfo->m_iTexture;
 
 	// check to see if the decal actually intersects the surface
-	// if not, then remove the decal
-	R_DecalVertsClip( pdecal, surf, decalinfo->m_iTexture, &vertCount );
+	// if not, then remove the decal. This is the only place where decal is clipped
+	R_SetupDecalClip( pdecal, surf, decalinfo->m_iTexture, textureSpaceBasis, decalWorldScale );
+	R_SetupDecalVertsForMSurface( pdecal, surf, textureSpaceBasis, g_DecalClipVerts[0] );
+	verts = R_DoDecalSHClip( g_DecalClipVerts[0], pdecal, surf->polys->numverts, &vertCount );
 	
 	if( !vertCount )
 	{
@@ -607,8 +644,15 @@ static void R_DecalCreate( decalinfo_t *decalinfo, msurface_t *surf, float x, fl
 		return;
 	}
 
+	R_DecalVertsLight( verts, surf, vertCount );
+
+	// keep basis for decals overlapping
+	cache = &gDecalCache[pdecal - gDecalPool];
+	VectorCopy( textureSpaceBasis[0], cache->basis[0] );
+	VectorCopy( textureSpaceBasis[1], cache->basis[1] );
+
 	// add to the surface's list
-	R_AddDecalToSurface( pdecal, surf, decalinfo );
+	R_AddDecalToSurface( pdecal, surf, verts, vertCount );
 }
 
 void R_DecalSurface( msurface_t *surf, decalinfo_t *decalinfo )
@@ -850,6 +894,17 @@ float *R_DecalSetupVerts( decal_t *pDecal, msurface_t *surf, int texture, int *o
 
 	if( p )
 	{
+		decalcache_t	*cache = &gDecalCache[pDecal - gDecalPool];
+
+		// lightmaps was rebuilt since decal creation
+		if( cache->lightmap != surf->lightmaptexturenum || cache->light_s != surf->light_s || cache->light_t != surf->light_t )
+		{
+			R_DecalVertsLight( p->verts[0], surf, p->numverts );
+			cache->lightmap = surf->lightmaptexturenum;
+			cache->light_s = surf->light_s;
+			cache->light_t = surf->light_t;
+		}
+
 		v = g_DecalClipVerts[0];
 		count = p->numverts;
 		v2 = p->verts[0];
@@ -879,12 +934,31 @@ float *R_DecalSetupVerts( decal_t *pDecal, msurface_t *surf, int texture, int *o
 	return v;
 }
 
+/*
+===============
+R_DecalMeshVerts
+
+vertices that renderer draws for the decal
+===============
+*/
+static float *R_DecalMeshVerts( decal_t *pDecal, msurface_t *fa, int *outCount )
+{
+	if( pDecal->polys )
+	{
+		// draw right from the mesh, lightmap coords are not used here
+		*outCount = pDecal->polys->numverts;
+		return pDecal->polys->verts[0];
+	}
+
+	return R_DecalSetupVerts( pDecal, fa, pDecal->texture, outCount );
+}
+
 void DrawSingleDecal( decal_t *pDecal, msurface_t *fa )
 {
 	float	*v;
 	int	i, numVerts;
 
-	v = R_DecalSetupVerts( pDecal, fa, pDecal->texture, &numVerts );
+	v = R_DecalMeshVerts( pDecal, fa, &numVerts );
 	if( !numVerts ) return;
 
 	GL_Bind( GL_TEXTURE0, pDecal->texture );
@@ -1258,6 +1332,87 @@ void R_EntityRemoveDecals( model_t *mod )
 	}
 }
 
+/*
+===============
+R_DecalProfiling_f
+
+shoot decals to random world surfaces,
+first argument is decals count
+===============
+*/
+void R_DecalProfiling_f( void )
+{
+	int		i, texture, shots = 0;
+	int		numverts, drawn = 0;
+	int		count = 1000;
+	model_t		*world = cl.worldmodel;
+	msurface_t	*surf;
+	double		t1, t2;
+	vec3_t		pos, dir;
+	decal_t		*pdecal;
+	byte		created[MAX_RENDER_DECALS];
+
+	if( !world || !world->numsurfaces || !cl.video_prepped )
+	{
+		Con_Printf( "no map loaded\n" );
+		return;
+	}
+
+	if( !host.draw_decals[1][0] )
+	{
+		Con_Printf( "no decals in decals.wad\n" );
+		return;
+	}
+
+	if( Cmd_Argc() > 1 )
+		count = bound( 1, Q_atoi( Cmd_Argv( 1 )), 100000 );
+
+	texture = CL_DecalIndex( 1 );
+	memset( created, 0, sizeof( created ));
+	gDecalTrack = created;
+	t1 = Sys_DoubleTime();
+
+	for( i = 0; i < count; i++ )
+	{
+		surf = world->surfaces + COM_RandomLong( 0, world->numsurfaces - 1 );
+
+		if( !surf->polys || FBitSet( surf->flags, SURF_DRAWTURB|SURF_DRAWSKY|SURF_CONVEYOR ))
+			continue;
+
+		// random point between first vertex and some other
+		VectorSubtract( surf->polys->verts[COM_RandomLong( 0, surf->polys->numverts - 1 )], surf->polys->verts[0], dir );
+		VectorMA( surf->polys->verts[0], COM_RandomFloat( 0.0f, 1.0f ), dir, pos );
+
+		R_DecalShoot( texture, 0, 0, pos, 0, 1.0f );
+		shots++;
+	}
+
+	t1 = Sys_DoubleTime() - t1;
+	gDecalTrack = NULL;
+	t2 = Sys_DoubleTime();
+
+	// fetch all the meshes like DrawSingleDecal does
+	for( i = 0; i < MAX_RENDER_DECALS; i++ )
+	{
+		pdecal = &gDecalPool[i];
+		if( !pdecal->psurface ) continue;
+
+		R_DecalMeshVerts( pdecal, pdecal->psurface, &numverts );
+		drawn += numverts;
+	}
+
+	t2 = Sys_DoubleTime() - t2;
+
+	Con_Printf( "%i decals shot in %.2f msec (%.2f usec per decal), %i verts fetched in %.2f usec\n",
+		shots, t1 * 1000.0, shots ? ( t1 * 1000000.0 / shots ) : 0.0, drawn, t2 * 1000000.0 );
+
+	// remove test decals, decals that was replaced by them are lost anyway
+	for( i = 0; i < MAX_RENDER_DECALS; i++ )
+	{
+		if( created[i] ) R_DecalUnlink( &gDecalPool[i] );
+	}
+}
+
 /*
 ===============
 R_ClearAllDecals
@@ -613,6 +613,10 @@ typedef float GLmatrix[16];
 #define GL_WRITE_ONLY_ARB			0x88B9
 #define GL_READ_WRITE_ARB			0x88BA
 #define GL_BUFFER_SIZE_ARB			0x8764
+
+//GL_ARB_pixel_buffer_object
+#define GL_PIXEL_PACK_BUFFER_ARB		0x88EB
+#define GL_PIXEL_UNPACK_BUFFER_ARB		0x88EC
 #define GL_BUFFER_USAGE_ARB			0x8765
 #define GL_BUFFER_ACCESS_ARB			0x88BB
 #define GL_BUFFER_MAPPED_ARB			0x88BC
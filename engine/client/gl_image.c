@@ -18,10 +18,61 @@ GNU General Public License for more details.
 #include "gl_local.h"
 
 #define TEXTURES_HASH_SIZE	(MAX_TEXTURES >> 2)
+#define IDTEXCACHEHEADER	(('C'<<24)+('T'<<16)+('X'<<8)+'X')	// little-endian "XXTC"
+#define TEXCACHE_VERSION	1
+#define TEXCACHE_PBOS	4		// pixel buffers in flight
+#define TEXCACHE_PATH	"cache/textures/"
+
+// processed mip chain as it was uploaded
+typedef struct
+{
+	int		ident;
+	int		version;
+	dword		crc;			// source pixels and processing params
+	int		texflags;			// texture flags after processing
+	int		picflags;
+	int		type;
+	int		encode;
+	int		srcWidth;
+	int		srcHeight;
+	int		width;			// size of first level
+	int		height;
+	int		numMips;
+	int		size;			// mip chain size
+	rgba_t		fogParams;
+} texcache_t;
+
+typedef struct
+{
+	GLuint		pbo[TEXCACHE_PBOS];
+	int		pbonum;
+
+	// mip chain recording
+	qboolean		recording;
+	byte		*levels;			// texcache_t + levels
+	size_t		levelsize;
+	size_t		maxlevelsize;
+	int		numlevels;
+
+	// stats
+	int		hits;
+	int		misses;
+	int		writes;
+	double		loadtime;
+} gltexcache_t;
+
+// cached file, for pruning
+typedef struct
+{
+	const char	*name;
+	long		size;
+	long		time;
+} texcachefile_t;
 
 static gl_texture_t		gl_textures[MAX_TEXTURES];
 static gl_texture_t*	gl_texturesHashTable[TEXTURES_HASH_SIZE];
 static uint		gl_numTextures;
+static gltexcache_t		gl_texcache;
 
 #define IsLightMap( tex )	( FBitSet(( tex )->flags, TF_ATLAS_PAGE ))
 /*
@@ -977,23 +1028,8 @@ static void GL_BuildMipMap( byte *in, int srcWidth, int srcHeight, int srcDepth,
 			for( y = 0; y < mipHeight; y++, in += instride * 2, out += outpadding )
 			{
 				byte *next = ((( y << 1 ) + 1 ) < srcHeight ) ? ( in + instride ) : in;
-				for( x = 0, row = 0; x < mipWidth; x++, row += 8, out += 4 )
-				{
-					if((( x << 1 ) + 1 ) < srcWidth )
-					{
-						out[0] = (in[row+0] + in[row+4] + next[row+0] + next[row+4]) >> 2;
-						out[1] = (in[row+1] + in[row+5] + next[row+1] + next[row+5]) >> 2;
-						out[2] = (in[row+2] + in[row+6] + next[row+2] + next[row+6]) >> 2;
-						out[3] = (in[row+3] + in[row+7] + next[row+3] + next[row+7]) >> 2;
-					}
-					else
-					{
-						out[0] = (in[row+0] + next[row+0]) >> 1;
-						out[1] = (in[row+1] + next[row+1]) >> 1;
-						out[2] = (in[row+2] + next[row+2]) >> 1;
-						out[3] = (in[row+3] + next[row+3]) >> 1;
-					}
-				}
+				Image_BuildMipRow( out, in, next, srcWidth );
+				out += mipWidth * 4;
 			}
 		}
 	}
@@ -1085,6 +1121,28 @@ static void GL_CheckTexImageError( gl_texture_t *tex )
 		Con_Printf( S_OPENGL_ERROR "%s while uploading %s [%s]\n", GL_ErrorString( err ), tex->name, GL_TargetToString( tex->target ));
 }
 
+/*
+===============
+GL_CacheTextureLevel
+
+store uploaded level for texture cache
+===============
+*/
+static void GL_CacheTextureLevel( const byte *data, size_t size )
+{
+	if( !data ) return;
+
+	if( gl_texcache.levelsize + size > gl_texcache.maxlevelsize )
+	{
+		gl_texcache.maxlevelsize = ( gl_texcache.levelsize + size ) * 2;
+		gl_texcache.levels = Mem_Realloc( r_temppool, gl_texcache.levels, gl_texcache.maxlevelsize );
+	}
+
+	memcpy( gl_texcache.levels + gl_texcache.levelsize, data, size );
+	gl_texcache.levelsize += size;
+	gl_texcache.numlevels++;
+}
+
 /*
 ===============
 GL_UploadTexture
@@ -1202,6 +1260,8 @@ static qboolean GL_UploadTexture( gl_texture_t *tex, rgbdata_t *pic )
 				texsize = GL_CalcTextureSize( tex->format, width, height, tex->depth );
 				size = GL_CalcImageSize( pic->type, width, height, tex->depth );
 				GL_TextureImageRAW( tex, i, j, width, height, tex->depth, pic->type, data );
+				if( gl_texcache.recording )
+					GL_CacheTextureLevel( data, size );
 				if( mipCount > 1 )
 					GL_BuildMipMap( data, width, height, tex->depth, tex->flags );
 				tex->size += texsize;
@@ -1449,6 +1509,268 @@ void GL_UpdateTexSize( int texnum, int width, int height, int depth )
 	}
 }
 
+/*
+================
+GL_TextureCacheKey
+
+returns 0 if texture can't be cached
+================
+*/
+static dword GL_TextureCacheKey( gl_texture_t *tex, rgbdata_t *pic )
+{
+	int	params[10];
+	float	emboss_scale = 0.0f;
+	int	palSize = 0;
+	dword	crc;
+
+	if( !CVAR_TO_BOOL( gl_texture_cache ) || !glw_state.initialized || !pic->buffer )
+		return 0;
+
+	// only single 2D images that will be expanded and mipmapped here
+	if( ImageDXT( pic->type ) || pic->numMips > 1 || pic->depth > 1 || pic->height <= 1 )
+		return 0;
+
+	if( FBitSet( pic->flags, IMAGE_CUBEMAP|IMAGE_MULTILAYER ))
+		return 0;
+
+	if( FBitSet( tex->flags, TF_KEEP_SOURCE|TF_DEPTHMAP|TF_ARB_FLOAT|TF_ARB_16BIT|TF_RECTANGLE ))
+		return 0;
+
+	if( FBitSet( tex->flags, TF_ALLOW_EMBOSS ) && gl_emboss_scale != NULL )
+		emboss_scale = gl_emboss_scale->value;
+
+	if( pic->palette && pic->type == PF_INDEXED_24 )
+		palSize = 768;
+	else if( pic->palette && pic->type == PF_INDEXED_32 )
+		palSize = 1024;
+
+	// everything that changes the result of processing
+	params[0] = pic->width;
+	params[1] = pic->height;
+	params[2] = pic->type;
+	params[3] = pic->flags;
+	params[4] = tex->flags;
+	params[5] = (int)gl_round_down->value;
+	params[6] = GL_Support( GL_ARB_TEXTURE_NPOT_EXT ) ? glConfig.max_2d_texture_size : -glConfig.max_2d_texture_size;
+	params[7] = (int)( emboss_scale * 1000.0f );
+	params[8] = CL_IsQuakeCompatible();	// GL_ApplyFilter
+	params[9] = glConfig.max_multisamples;
+
+	CRC32_Init( &crc );
+	CRC32_ProcessBuffer( &crc, params, sizeof( params ));
+	CRC32_ProcessBuffer( &crc, pic->buffer, pic->size );
+	if( palSize ) CRC32_ProcessBuffer( &crc, pic->palette, palSize );
+	crc = CRC32_Final( crc );
+
+	return crc ? crc : 1;
+}
+
+/*
+================
+GL_TextureCachePath
+================
+*/
+static const char *GL_TextureCachePath( const char *name, dword crc )
+{
+	dword	namecrc;
+
+	CRC32_Init( &namecrc );
+	CRC32_ProcessBuffer( &namecrc, name, Q_strlen( name ));
+	namecrc = CRC32_Final( namecrc );
+
+	return va( TEXCACHE_PATH "%08x%08x.tex", namecrc, crc );
+}
+
+/*
+================
+GL_LoadCachedTexture
+
+upload mip chain from texture cache
+================
+*/
+static qboolean GL_LoadCachedTexture( gl_texture_t *tex, const char *path, dword crc )
+{
+	texcache_t	*hdr;
+	rgbdata_t		pic;
+	int		srcWidth, srcHeight;
+	qboolean		result;
+	long		filesize;
+	GLuint		pbo = 0;
+	byte		*buf;
+	void		*dst;
+
+	if( !FS_FileExists( path, true ))
+		return false;
+
+	buf = FS_MapFile( path, &filesize, true );
+	if( !buf ) return false;
+
+	hdr = (texcache_t *)buf;
+
+	if( filesize <= 0 || (size_t)filesize < sizeof( texcache_t ) || hdr->ident != IDTEXCACHEHEADER || hdr->version != TEXCACHE_VERSION
+	|| hdr->crc != crc || hdr->size < 0 || (size_t)hdr->size != (size_t)filesize - sizeof( texcache_t ) || hdr->numMips <= 0 )
+	{
+		FS_UnmapFile( buf );
+		return false;
+	}
+
+	memset( &pic, 0, sizeof( pic ));
+	pic.width = hdr->width;
+	pic.height = hdr->height;
+	pic.depth = 1;
+	pic.type = hdr->type;
+	pic.flags = hdr->picflags;
+	pic.encode = hdr->encode;
+	pic.numMips = hdr->numMips;
+	pic.buffer = buf + sizeof( texcache_t );
+	pic.size = hdr->size;
+	memcpy( pic.fogParams, hdr->fogParams, sizeof( rgba_t ));
+
+	tex->flags = hdr->texflags;
+	tex->encode = hdr->encode;
+	srcWidth = hdr->srcWidth;
+	srcHeight = hdr->srcHeight;
+
+	if( GL_Support( GL_ARB_PIXEL_BUFFER_OBJECT ))
+	{
+		if( !gl_texcache.pbo[0] )
+			pglGenBuffersARB( TEXCACHE_PBOS, gl_texcache.pbo );
+
+		// stream levels through the pixel buffer, so driver can
+		// transfer them while we are loading the next texture
+		pbo = gl_texcache.pbo[gl_texcache.pbonum++ % TEXCACHE_PBOS];
+		pglBindBufferARB( GL_PIXEL_UNPACK_BUFFER_ARB, pbo );
+		pglBufferDataARB( GL_PIXEL_UNPACK_BUFFER_ARB, pic.size, NULL, GL_STREAM_DRAW_ARB );
+
+		if(( dst = pglMapBufferARB( GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY_ARB )) != NULL )
+		{
+			memcpy( dst, pic.buffer, pic.size );
+			pglUnmapBufferARB( GL_PIXEL_UNPACK_BUFFER_ARB );
+			pic.buffer = NULL; // levels are offsets in the bound buffer now
+		}
+		else
+		{
+			pglBindBufferARB( GL_PIXEL_UNPACK_BUFFER_ARB, 0 );
+			pbo = 0;
+		}
+	}
+
+	result = GL_UploadTexture( tex, &pic );
+
+	if( pbo ) pglBindBufferARB( GL_PIXEL_UNPACK_BUFFER_ARB, 0 );
+	FS_UnmapFile( buf );
+
+	// keep unscaled sizes of original image
+	tex->srcWidth = srcWidth;
+	tex->srcHeight = srcHeight;
+
+	return result;
+}
+
+/*
+================
+GL_StoreCachedTexture
+
+write recorded mip chain into texture cache
+================
+*/
+static void GL_StoreCachedTexture( gl_texture_t *tex, rgbdata_t *pic, const char *path, dword crc )
+{
+	texcache_t	*hdr;
+
+	if( gl_texcache.numlevels != tex->numMips || gl_texcache.numlevels <= 0 )
+		return; // texture was not uploaded as single image
+
+	hdr = (texcache_t *)gl_texcache.levels;
+	hdr->ident = IDTEXCACHEHEADER;
+	hdr->version = TEXCACHE_VERSION;
+	hdr->crc = crc;
+	hdr->texflags = ( tex->flags & ~TF_IMG_UPLOADED );
+	hdr->picflags = ( pic->flags & ~IMAGE_ONEBIT_ALPHA ); // already filtered
+	hdr->type = pic->type;
+	hdr->encode = tex->encode;
+	hdr->srcWidth = tex->srcWidth;
+	hdr->srcHeight = tex->srcHeight;
+	hdr->width = tex->width;
+	hdr->height = tex->height;
+	hdr->numMips = gl_texcache.numlevels;
+	hdr->size = gl_texcache.levelsize - sizeof( texcache_t );
+	memcpy( hdr->fogParams, pic->fogParams, sizeof( rgba_t ));
+
+	if( FS_WriteFile( path, gl_texcache.levels, gl_texcache.levelsize ))
+		gl_texcache.writes++;
+}
+
+/*
+================
+GL_CompareCacheFiles
+
+oldest first
+================
+*/
+static int GL_CompareCacheFiles( const void *a, const void *b )
+{
+	const texcachefile_t	*f1 = (const texcachefile_t *)a;
+	const texcachefile_t	*f2 = (const texcachefile_t *)b;
+
+	if( f1->time != f2->time )
+		return ( f1->time < f2->time ) ? -1 : 1;
+	return 0;
+}
+
+/*
+================
+GL_PruneTextureCache
+
+delete the oldest written textures until
+the cache fits into gl_texture_cache_size
+================
+*/
+static void GL_PruneTextureCache( void )
+{
+	texcachefile_t	*files;
+	double		total = 0.0, limit;
+	int		i, numfiles;
+	search_t		*t;
+
+	limit = gl_texture_cache_size->value * 1024.0 * 1024.0;
+	if( limit <= 0.0 ) return; // unlimited
+
+	t = FS_Search( TEXCACHE_PATH "*.tex", true, true );
+	if( !t ) return;
+
+	files = Mem_Calloc( r_temppool, sizeof( texcachefile_t ) * t->numfilenames );
+
+	for( i = numfiles = 0; i < t->numfilenames; i++ )
+	{
+		files[numfiles].name = t->filenames[i];
+		files[numfiles].size = FS_FileSize( t->filenames[i], true );
+		files[numfiles].time = FS_FileTime( t->filenames[i], true );
+
+		if( files[numfiles].size <= 0 )
+			continue;
+
+		total += files[numfiles].size;
+		numfiles++;
+	}
+
+	if( total > limit )
+	{
+		qsort( files, numfiles, sizeof( texcachefile_t ), GL_CompareCacheFiles );
+
+		for( i = 0; i < numfiles && total > limit; i++ )
+		{
+			if( FS_Delete( files[i].name ))
+				total -= files[i].size;
+		}
+
+		Con_Reportf( "texture cache: %i old textures deleted\n", i );
+	}
+
+	Mem_Free( files );
+	Mem_Free( t );
+}
+
 /*
 ================
 GL_LoadTexture
@@ -1456,9 +1778,12 @@ GL_LoadTexture
 */
 int GL_LoadTexture( const char *name, const byte *buf, size_t size, int flags )
 {
+	double		start = Sys_DoubleTime();
+	const char	*path = NULL;
 	gl_texture_t	*tex;
 	rgbdata_t		*pic;
 	uint		picFlags = 0;
+	dword		crc;
 
 	if( !GL_CheckTexName( name ))
 		return 0;
@@ -1481,17 +1806,56 @@ int GL_LoadTexture( const char *name, const byte *buf, size_t size, int flags )
 
 	// allocate the new one
 	tex = GL_AllocTexture( name, flags );
+
+	if(( crc = GL_TextureCacheKey( tex, pic )) != 0 )
+	{
+		path = GL_TextureCachePath( name, crc );
+
+		if( GL_LoadCachedTexture( tex, path, crc ))
+		{
+			GL_ApplyTextureParams( tex );
+			FS_FreeImage( pic );
+			gl_texcache.loadtime += Sys_DoubleTime() - start;
+			gl_texcache.hits++;
+			return tex - gl_textures;
+		}
+
+		// cached copy is stale or missing, start from scratch
+		tex->flags = flags;
+		tex->size = 0;
+		path = copystring( path );
+		gl_texcache.misses++;
+	}
+
 	GL_ProcessImage( tex, pic );
 
+	if( path )
+	{
+		// GL_UploadTexture will append the levels after header
+		gl_texcache.levelsize = sizeof( texcache_t );
+		gl_texcache.numlevels = 0;
+		gl_texcache.recording = true;
+	}
+
 	if( !GL_UploadTexture( tex, pic ))
 	{
+		gl_texcache.recording = false;
+		if( path ) Mem_Free( (char *)path );
 		memset( tex, 0, sizeof( gl_texture_t ));
 		FS_FreeImage( pic ); // release source texture
 		return 0;
 	}
 
+	if( path )
+	{
+		gl_texcache.recording = false;
+		GL_StoreCachedTexture( tex, pic, path, crc );
+		Mem_Free( (char *)path );
+	}
+
 	GL_ApplyTextureParams( tex ); // update texture filter, wrap etc
 	FS_FreeImage( pic ); // release source texture
+	gl_texcache.loadtime += Sys_DoubleTime() - start;
 
 	// NOTE: always return texnum as index in array or engine will stop work !!!
 	return tex - gl_textures;
@@ -2222,6 +2586,21 @@ void R_TextureList_f( void )
 	Con_Printf( "\n" );
 }
 
+/*
+===============
+R_TextureCache_f
+===============
+*/
+void R_TextureCache_f( void )
+{
+	Con_Printf( "\n" );
+	Con_Printf( "texture cache is %s\n", CVAR_TO_BOOL( gl_texture_cache ) ? "enabled" : "disabled" );
+	Con_Printf( "pixel buffers %s\n", GL_Support( GL_ARB_PIXEL_BUFFER_OBJECT ) ? "used" : "not supported" );
+	Con_Printf( "%i hits, %i misses, %i written\n", gl_texcache.hits, gl_texcache.misses, gl_texcache.writes );
+	Con_Printf( "%.3f secs spent in texture loading\n", gl_texcache.loadtime );
+	Con_Printf( "\n" );
+}
+
 /*
 ===============
 R_InitImages
@@ -2231,6 +2610,7 @@ void R_InitImages( void )
 {
 	memset( gl_textures, 0, sizeof( gl_textures ));
 	memset( gl_texturesHashTable, 0, sizeof( gl_texturesHashTable ));
+	memset( &gl_texcache, 0, sizeof( gl_texcache ));
 	gl_numTextures = 0;
 
 	// create unused 0-entry
@@ -2245,6 +2625,7 @@ void R_InitImages( void )
 	GL_CreateInternalTextures();
 
 	Cmd_AddCommand( "texturelist", R_TextureList_f, "display loaded textures list" );
+	Cmd_AddCommand( "texturecache", R_TextureCache_f, "display texture cache statistics since last vid_restart" );
 }
 
 /*
@@ -2258,8 +2639,19 @@ void R_ShutdownImages( void )
 	int		i;
 
 	Cmd_RemoveCommand( "texturelist" );
+	Cmd_RemoveCommand( "texturecache" );
 	GL_CleanupAllTextureUnits();
 
+	// new textures were cached in this session
+	if( gl_texcache.writes > 0 )
+		GL_PruneTextureCache();
+
+	if( gl_texcache.pbo[0] )
+		pglDeleteBuffersARB( TEXCACHE_PBOS, gl_texcache.pbo );
+	if( gl_texcache.levels )
+		Mem_Free( gl_texcache.levels );
+	memset( &gl_texcache, 0, sizeof( gl_texcache ));
+
 	for( i = 0, tex = gl_textures; i < gl_numTextures; i++, tex++ )
 		GL_DeleteTexture( tex );
 
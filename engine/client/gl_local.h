@@ -236,6 +236,38 @@ typedef struct
 	double		t_world_draw;
 } ref_speeds_t;
 
+// lightmap building kernels (see gl_rsimd.c)
+typedef struct
+{
+	const char	*name;
+	void		(*AddLightStyles)( uint *blocklights, const color24 *lm, const uint **tables, int numstyles, int size );
+	void		(*PackLights)( byte *dest, int stride, const uint *bl, int smax, int tmax );
+} lmkernels_t;
+
+extern lmkernels_t		lmkernels;
+extern const lmkernels_t	lmkernels_ref;
+
+// built-in particles are moved in batches (see gl_rpart.c)
+typedef struct
+{
+	struct particle_s	**parts;		// source particles
+	float		*org[3];		// one array per axis
+	float		*vel[3];
+	float		*damp[2];		// velocity scale for xy and z
+	float		*accel;		// gravity scale
+	int		count;
+	int		maxcount;
+} partbatch_t;
+
+typedef struct
+{
+	const char	*name;
+	void		(*MoveParticles)( partbatch_t *b, float frametime, float grav );
+} partkernels_t;
+
+extern partkernels_t	partkernels;
+extern const partkernels_t	partkernels_ref;
+
 extern ref_speeds_t		r_stats;
 extern ref_instance_t	RI;
 extern ref_globals_t	tr;
@@ -292,6 +324,7 @@ void DrawSingleDecal( decal_t *pDecal, msurface_t *fa );
 void R_EntityRemoveDecals( model_t *mod );
 void DrawDecalsBatch( void );
 void R_ClearDecals( void );
+void R_DecalProfiling_f( void );
 
 //
 // gl_draw.c
@@ -328,6 +361,7 @@ void GL_FreeImage( const char *name );
 const char *GL_Target( GLenum target );
 void R_InitDlightTexture( void );
 void R_TextureList_f( void );
+void R_TextureCache_f( void );
 void R_InitImages( void );
 void R_ShutdownImages( void );
 int GL_TexMemory( void );
@@ -395,6 +429,11 @@ void Matrix4x4_CreateModelview( matrix4x4 out );
 //
 void R_ClearStaticEntities( void );
 
+//
+// gl_rsimd.c
+//
+void R_InitRenderKernels( void );
+
 //
 // gl_rsurf.c
 //
@@ -411,6 +450,8 @@ void R_DrawAlphaTextureChains( void );
 void GL_RebuildLightmaps( void );
 void GL_InitRandomTable( void );
 void GL_BuildLightmaps( void );
+void GL_FreeLightmapBuffers( void );
+void R_LightmapProfiling_f( void );
 void GL_ResetFogColor( void );
 
 //
@@ -425,6 +466,8 @@ void R_DrawSpriteModel( cl_entity_t *e );
 // gl_studio.c
 //
 void R_StudioInit( void );
+void R_StudioClearPoseCache( void );
+void R_PrepareStudioBones( void );
 void Mod_LoadStudioModel( model_t *mod, const void *buffer, qboolean *loaded );
 void R_StudioLerpMovement( cl_entity_t *e, double time, vec3_t origin, vec3_t angles );
 float CL_GetSequenceDuration( cl_entity_t *ent, int sequence );
@@ -540,6 +583,7 @@ enum
 	GL_EXT_GPU_SHADER4,		// shaders only
 	GL_DEPTH_TEXTURE,
 	GL_DEBUG_OUTPUT,
+	GL_ARB_PIXEL_BUFFER_OBJECT,
 	GL_EXTCOUNT,		// must be last
 };
 
@@ -651,6 +695,8 @@ extern convar_t	*gl_lightmap_nearest;
 extern convar_t	*gl_keeptjunctions;
 extern convar_t	*gl_emboss_scale;
 extern convar_t	*gl_round_down;
+extern convar_t	*gl_texture_cache;
+extern convar_t	*gl_texture_cache_size;
 extern convar_t	*gl_detailscale;
 extern convar_t	*gl_wireframe;
 extern convar_t	*gl_polyoffset;
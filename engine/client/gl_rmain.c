@@ -804,6 +804,9 @@ void R_DrawEntitiesOnList( void )
 	tr.blend = 1.0f;
 	GL_CheckForErrors();
 
+	if( !RI.onlyClientDraw )
+		R_PrepareStudioBones();
+
 	// first draw solid entities
 	for( i = 0; i < tr.draw_list->num_solid_entities && !RI.onlyClientDraw; i++ )
 	{
@@ -1531,6 +1534,9 @@ static render_api_t gRenderAPI =
 	Cvar_Set,
 	S_FadeMusicVolume,
 	COM_SetRandomSeed,
+	Prof_Zone,
+	Prof_Begin,
+	Prof_End,
 };
 
 /*
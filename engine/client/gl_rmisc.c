@@ -133,6 +133,7 @@ void R_NewMap( void )
 	int	i;
 
 	R_ClearDecals(); // clear all level decals
+	R_StudioClearPoseCache();
 
 	// upload detailtextures
 	if( CVAR_TO_BOOL( r_detailtextures ))
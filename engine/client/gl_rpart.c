@@ -25,6 +25,15 @@ GNU General Public License for more details.
 #include "studio.h"
 
 #define PART_SIZE	Q_max( 0.5f, cl_draw_particles->value )
+#define PART_BATCH	1024		// quads per draw call
+#define PT_SPARK	pt_clientcustom	// blobs that are not exploding (custom particles are never batched)
+
+// velocity change of built-in particle types
+typedef struct
+{
+	float		damp[2];		// velocity scale for xy and z
+	float		accel;		// gravity scale
+} partmove_t;
 
 /*
 ==============================================================
@@ -70,6 +79,10 @@ particle_t	*cl_free_particles;
 particle_t	*cl_particles = NULL;	// particle pool
 static vec3_t	cl_avelocities[NUMVERTEXNORMALS];
 static float	cl_lasttimewarn = 0.0f;
+static partbatch_t	cl_partbatch;
+static vec3_t	cl_partverts[PART_BATCH*4];
+static vec2_t	cl_partcoords[PART_BATCH*4];
+static rgba_t	cl_partcolors[PART_BATCH*4];
 
 /*
 ================
@@ -118,6 +131,38 @@ void R_GetPackedColor( short *packed, short color )
 	if( packed ) *packed = 0;
 }
 
+/*
+================
+CL_AllocParticleBatch
+
+arrays for count particles in one block
+================
+*/
+static void CL_AllocParticleBatch( partbatch_t *b, int count )
+{
+	float	*data;
+	int	i;
+
+	data = Mem_Calloc( cls.mempool, ( sizeof( float ) * 9 + sizeof( particle_t* )) * count );
+
+	for( i = 0; i < 3; i++, data += count )
+		b->org[i] = data;
+	for( i = 0; i < 3; i++, data += count )
+		b->vel[i] = data;
+	for( i = 0; i < 2; i++, data += count )
+		b->damp[i] = data;
+	b->accel = data;
+	b->parts = (particle_t **)( data + count );
+	b->maxcount = count;
+	b->count = 0;
+}
+
+static void CL_FreeParticleBatch( partbatch_t *b )
+{
+	if( b->org[0] ) Mem_Free( b->org[0] );
+	memset( b, 0, sizeof( *b ));
+}
+
 /*
 ================
 CL_InitParticles
@@ -129,8 +174,18 @@ void CL_InitParticles( void )
 	int	i;
 
 	cl_particles = Mem_Calloc( cls.mempool, sizeof( particle_t ) * GI->max_particles );
+	CL_AllocParticleBatch( &cl_partbatch, GI->max_particles );
 	CL_ClearParticles ();
 
+	// texcoords are the same for all the quads
+	for( i = 0; i < PART_BATCH * 4; i += 4 )
+	{
+		Vector2Set( cl_partcoords[i+0], 0.0f, 1.0f );
+		Vector2Set( cl_partcoords[i+1], 0.0f, 0.0f );
+		Vector2Set( cl_partcoords[i+2], 1.0f, 0.0f );
+		Vector2Set( cl_partcoords[i+3], 1.0f, 1.0f );
+	}
+
 	// this is used for EF_BRIGHTFIELD
 	for( i = 0; i < NUMVERTEXNORMALS; i++ )
 	{
@@ -146,6 +201,8 @@ void CL_InitParticles( void )
 	tracerspeed = Cvar_Get( "tracerspeed", "6000", 0, "tracer speed" );
 	tracerlength = Cvar_Get( "tracerlength", "0.8", 0, "tracer length factor" );
 	traceroffset = Cvar_Get( "traceroffset", "30", 0, "tracer starting offset" );
+
+	Cmd_AddCommand( "particle_profile", CL_ParticleProfiling_f, "particle kernels stress-test, first argument is particles count" );
 }
 
 /*
@@ -181,6 +238,9 @@ void CL_FreeParticles( void )
 	if( cl_particles )
 		Mem_Free( cl_particles );
 	cl_particles = NULL;
+
+	CL_FreeParticleBatch( &cl_partbatch );
+	Cmd_RemoveCommand( "particle_profile" );
 }
 
 /*
@@ -350,22 +410,217 @@ void R_FreeDeadParticles( particle_t **ppparticles )
 
 /*
 ================
-CL_DrawParticles
+CL_SetupParticleMoves
 
-update particle color, position, free expired and draw it
+velocity changes for this frame,
+same as the old per-particle switch
 ================
 */
-void CL_DrawParticles( double frametime )
+static void CL_SetupParticleMoves( partmove_t *moves, float frametime )
+{
+	float	dvel = 4.0f * frametime;
+	int	i;
+
+	memset( moves, 0, sizeof( partmove_t ) * ( PT_SPARK + 1 ));
+
+	for( i = pt_fire; i <= pt_blob2; i++ )
+		moves[i].accel = 1.0f;
+
+	moves[pt_fire].accel = -1.0f;
+	moves[pt_explode].damp[0] = moves[pt_explode].damp[1] = dvel;
+	moves[pt_explode2].damp[0] = moves[pt_explode2].damp[1] = -frametime;
+	moves[pt_blob].damp[0] = moves[pt_blob].damp[1] = dvel;
+	moves[pt_blob2].damp[0] = -dvel;
+	moves[pt_grav].accel = 20.0f;
+	moves[pt_slowgrav].accel = 1.0f;
+	moves[pt_vox_grav].accel = 8.0f;
+	moves[pt_vox_slowgrav].accel = 4.0f;
+	moves[PT_SPARK].damp[0] = moves[PT_SPARK].damp[1] = -frametime * 0.5f;
+	moves[PT_SPARK].accel = 5.0f;
+}
+
+/*
+================
+CL_BatchParticle
+
+copy built-in particle into the batch
+================
+*/
+static void CL_BatchParticle( partbatch_t *b, particle_t *p, const partmove_t *moves )
+{
+	const partmove_t	*move;
+	int		i = b->count++;
+
+	if(( p->type == pt_blob || p->type == pt_blob2 ) && p->packedColor != 255 )
+		move = &moves[PT_SPARK];
+	else if( (uint)p->type >= PT_SPARK )
+		move = &moves[pt_static];
+	else move = &moves[p->type];
+
+	b->parts[i] = p;
+	b->org[0][i] = p->org[0];
+	b->org[1][i] = p->org[1];
+	b->org[2][i] = p->org[2];
+	b->vel[0][i] = p->vel[0];
+	b->vel[1][i] = p->vel[1];
+	b->vel[2][i] = p->vel[2];
+	b->damp[0][i] = move->damp[0];
+	b->damp[1][i] = move->damp[1];
+	b->accel[i] = move->accel;
+}
+
+/*
+================
+CL_FinishParticles
+
+write moved particles back and
+update color ramps of the built-in types
+================
+*/
+static void CL_FinishParticles( partbatch_t *b, float frametime )
 {
-	particle_t	*p;
 	float		time3 = 15.0f * frametime;
 	float		time2 = 10.0f * frametime;
 	float		time1 = 5.0f * frametime;
-	float		dvel = 4.0f * frametime;
+	particle_t	*p;
+	int		i;
+
+	for( i = 0; i < b->count; i++ )
+	{
+		p = b->parts[i];
+
+		p->org[0] = b->org[0][i];
+		p->org[1] = b->org[1][i];
+		p->org[2] = b->org[2][i];
+		p->vel[0] = b->vel[0][i];
+		p->vel[1] = b->vel[1][i];
+		p->vel[2] = b->vel[2][i];
+
+		switch( p->type )
+		{
+		case pt_fire:
+			p->ramp += time1;
+			if( p->ramp >= 6.0f ) p->die = -1.0f;
+			else p->color = ramp3[(int)p->ramp];
+			break;
+		case pt_explode:
+			p->ramp += time2;
+			if( p->ramp >= 8.0f ) p->die = -1.0f;
+			else p->color = ramp1[(int)p->ramp];
+			break;
+		case pt_explode2:
+			p->ramp += time3;
+			if( p->ramp >= 8.0f ) p->die = -1.0f;
+			else p->color = ramp2[(int)p->ramp];
+			break;
+		case pt_blob:
+		case pt_blob2:
+			if( p->packedColor == 255 )
+				break; // normal blob explosion
+			p->ramp += time2;
+			if( p->ramp >= 9.0f ) p->ramp = 0.0f;
+			p->color = gSparkRamp[(int)p->ramp];
+			p->type = COM_RandomLong( 0, 3 ) ? pt_blob : pt_blob2;
+			break;
+		}
+	}
+
+	b->count = 0;
+}
+
+/*
+================
+CL_ParticleQuad
+
+put camera facing quad into the vertex arrays
+================
+*/
+static void CL_ParticleQuad( particle_t *p, float partsize, int vertex )
+{
+	float	*v = cl_partverts[vertex];
+	byte	*c = cl_partcolors[vertex];
+	vec3_t	right, up;
+	color24	*pColor;
+	int	alpha;
+	float	size;
+
+	size = partsize; // get initial size of particle
+
+	// scale up to keep particles from disappearing
+	size += (p->org[0] - RI.vieworg[0]) * RI.cull_vforward[0];
+	size += (p->org[1] - RI.vieworg[1]) * RI.cull_vforward[1];
+	size += (p->org[2] - RI.vieworg[2]) * RI.cull_vforward[2];
+
+	if( size < 20.0f ) size = partsize;
+	else size = partsize + size * 0.002f;
+
+	// scale the axes by radius
+	VectorScale( RI.cull_vright, size, right );
+	VectorScale( RI.cull_vup, size, up );
+
+	p->color = bound( 0, p->color, 255 );
+	pColor = &clgame.palette[p->color];
+
+	alpha = 255 * (p->die - cl.time) * 16.0f;
+	if( alpha > 255 || p->type == pt_static )
+		alpha = 255;
+
+	c[0] = LightToTexGamma( pColor->r );
+	c[1] = LightToTexGamma( pColor->g );
+	c[2] = LightToTexGamma( pColor->b );
+	c[3] = alpha;
+	*(int *)(c + 4) = *(int *)(c + 8) = *(int *)(c + 12) = *(int *)c;
+
+	VectorSet( v + 0, p->org[0] - right[0] + up[0], p->org[1] - right[1] + up[1], p->org[2] - right[2] + up[2] );
+	VectorSet( v + 3, p->org[0] + right[0] + up[0], p->org[1] + right[1] + up[1], p->org[2] + right[2] + up[2] );
+	VectorSet( v + 6, p->org[0] + right[0] - up[0], p->org[1] + right[1] - up[1], p->org[2] + right[2] - up[2] );
+	VectorSet( v + 9, p->org[0] - right[0] - up[0], p->org[1] - right[1] - up[1], p->org[2] - right[2] - up[2] );
+}
+
+/*
+================
+CL_FlushParticleQuads
+
+draw the collected quads
+================
+*/
+static void CL_FlushParticleQuads( int numverts )
+{
+	int	i;
+
+	if( !tr.fCustomRendering )
+	{
+		pglDrawArrays( GL_QUADS, 0, numverts );
+		return;
+	}
+
+	// custom renderer can keep vertex buffer bound
+	pglBegin( GL_QUADS );
+
+	for( i = 0; i < numverts; i++ )
+	{
+		pglColor4ubv( cl_partcolors[i] );
+		pglTexCoord2fv( cl_partcoords[i] );
+		pglVertex3fv( cl_partverts[i] );
+	}
+
+	pglEnd();
+}
+
+/*
+================
+CL_DrawParticles
+
+update particle color, position, free expired and draw it
+================
+*/
+void CL_DrawParticles( double frametime )
+{
+	partmove_t	moves[PT_SPARK+1];
 	float		grav = frametime * clgame.movevars.gravity * 0.05f;
-	vec3_t		right, up;
-	color24		*pColor;
-	int		alpha;
+	partbatch_t	*b = &cl_partbatch;
+	int		numverts = 0;
+	particle_t	*p;
 	float		size;
 
 	if( !cl_draw_particles->value )
@@ -384,123 +639,143 @@ void CL_DrawParticles( double frametime )
 	pglTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
 	pglDepthMask( GL_FALSE );
 
-	pglBegin( GL_QUADS );
+	if( !tr.fCustomRendering )
+	{
+		pglEnableClientState( GL_VERTEX_ARRAY );
+		pglEnableClientState( GL_COLOR_ARRAY );
+		GL_SetTexCoordArrayMode( GL_TEXTURE_COORD_ARRAY );
+		pglVertexPointer( 3, GL_FLOAT, 0, cl_partverts );
+		pglColorPointer( 4, GL_UNSIGNED_BYTE, 0, cl_partcolors );
+		pglTexCoordPointer( 2, GL_FLOAT, 0, cl_partcoords );
+	}
+
+	CL_SetupParticleMoves( moves, frametime );
+	size = PART_SIZE;
 
 	for( p = cl_active_particles; p; p = p->next )
 	{
 		if(( p->type != pt_blob ) || ( p->packedColor == 255 ))
 		{
-			size = PART_SIZE; // get initial size of particle
-
-			// scale up to keep particles from disappearing
-			size += (p->org[0] - RI.vieworg[0]) * RI.cull_vforward[0];
-			size += (p->org[1] - RI.vieworg[1]) * RI.cull_vforward[1];
-			size += (p->org[2] - RI.vieworg[2]) * RI.cull_vforward[2];
-
-			if( size < 20.0f ) size = PART_SIZE;
-			else size = PART_SIZE + size * 0.002f;
-
-			// scale the axes by radius
-			VectorScale( RI.cull_vright, size, right );
-			VectorScale( RI.cull_vup, size, up );
-
-			p->color = bound( 0, p->color, 255 );
-			pColor = &clgame.palette[p->color];
-
-			alpha = 255 * (p->die - cl.time) * 16.0f;
-			if( alpha > 255 || p->type == pt_static )
-				alpha = 255;
-
-			pglColor4ub( LightToTexGamma( pColor->r ), LightToTexGamma( pColor->g ), LightToTexGamma( pColor->b ), alpha );
+			if( numverts == PART_BATCH * 4 )
+			{
+				CL_FlushParticleQuads( numverts );
+				numverts = 0;
+			}
 
-			pglTexCoord2f( 0.0f, 1.0f );
-			pglVertex3f( p->org[0] - right[0] + up[0], p->org[1] - right[1] + up[1], p->org[2] - right[2] + up[2] );
-			pglTexCoord2f( 0.0f, 0.0f );
-			pglVertex3f( p->org[0] + right[0] + up[0], p->org[1] + right[1] + up[1], p->org[2] + right[2] + up[2] );
-			pglTexCoord2f( 1.0f, 0.0f );
-			pglVertex3f( p->org[0] + right[0] - up[0], p->org[1] + right[1] - up[1], p->org[2] + right[2] - up[2] );
-			pglTexCoord2f( 1.0f, 1.0f );
-			pglVertex3f( p->org[0] - right[0] - up[0], p->org[1] - right[1] - up[1], p->org[2] - right[2] - up[2] );
+			CL_ParticleQuad( p, size, numverts );
 			r_stats.c_particle_count++;
+			numverts += 4;
 		}
 
-		if( p->type != pt_clientcustom )
+		if( p->type == pt_clientcustom )
 		{
-			// update position.
-			VectorMA( p->org, frametime, p->vel, p->org );
-		}
-
-		switch( p->type )
-		{
-		case pt_static:
-			break;
-		case pt_fire:
-			p->ramp += time1;
-			if( p->ramp >= 6.0f ) p->die = -1.0f;
-			else p->color = ramp3[(int)p->ramp];
-			p->vel[2] += grav;
-			break;
-		case pt_explode:
-			p->ramp += time2;
-			if( p->ramp >= 8.0f ) p->die = -1.0f;
-			else p->color = ramp1[(int)p->ramp];
-			VectorMA( p->vel, dvel, p->vel, p->vel );
-			p->vel[2] -= grav;
-			break;
-		case pt_explode2:
-			p->ramp += time3;
-			if( p->ramp >= 8.0f ) p->die = -1.0f;
-			else p->color = ramp2[(int)p->ramp];
-			VectorMA( p->vel,-frametime, p->vel, p->vel );
-			p->vel[2] -= grav;
-			break;
-		case pt_blob:
-			if( p->packedColor == 255 )
-			{
-				// normal blob explosion
-				VectorMA( p->vel, dvel, p->vel, p->vel );
-				p->vel[2] -= grav;
-				break;
-			}
-		case pt_blob2:
-			if( p->packedColor == 255 )
-			{
-				// normal blob explosion
-				p->vel[0] -= p->vel[0] * dvel;
-				p->vel[1] -= p->vel[1] * dvel;
-				p->vel[2] -= grav;
-			}
-			else
-			{
-				p->ramp += time2;
-				if( p->ramp >= 9.0f ) p->ramp = 0.0f;
-				p->color = gSparkRamp[(int)p->ramp];
-				VectorMA( p->vel, -frametime * 0.5f, p->vel, p->vel );
-				p->type = COM_RandomLong( 0, 3 ) ? pt_blob : pt_blob2;
-				p->vel[2] -= grav * 5.0f;
-			}
-			break;
-		case pt_grav:
-			p->vel[2] -= grav * 20.0f;
-			break;
-		case pt_slowgrav:
-			p->vel[2] -= grav;
-			break;
-		case pt_vox_grav:
-			p->vel[2] -= grav * 8.0f;
-			break;
-		case pt_vox_slowgrav:
-			p->vel[2] -= grav * 4.0f;
-			break;
-		case pt_clientcustom:
 			if( p->callback )
 				p->callback( p, frametime );
-			break;
+		}
+		else if( b->count < b->maxcount )
+		{
+			CL_BatchParticle( b, p, moves );
 		}
 	}
 
-	pglEnd();
+	if( numverts ) CL_FlushParticleQuads( numverts );
+
+	if( !tr.fCustomRendering )
+	{
+		pglDisableClientState( GL_VERTEX_ARRAY );
+		pglDisableClientState( GL_COLOR_ARRAY );
+		GL_SetTexCoordArrayMode( GL_NONE );
+	}
+
 	pglDepthMask( GL_TRUE );
+
+	// move all the built-in particles at once
+	partkernels.MoveParticles( b, frametime, grav );
+	CL_FinishParticles( b, frametime );
+}
+
+/*
+================
+CL_ProfileParticles
+
+simulate the particles without drawing
+================
+*/
+static double CL_ProfileParticles( const partkernels_t *k, particle_t *list, partbatch_t *b, int passes )
+{
+	partmove_t	moves[PT_SPARK+1];
+	float		frametime = 0.001f;
+	float		grav = frametime * 800.0f * 0.05f;
+	particle_t	*p;
+	double		start;
+	int		i;
+
+	CL_SetupParticleMoves( moves, frametime );
+	start = Sys_DoubleTime();
+
+	for( i = 0; i < passes; i++ )
+	{
+		for( p = list; p; p = p->next )
+			CL_BatchParticle( b, p, moves );
+
+		k->MoveParticles( b, frametime, grav );
+		CL_FinishParticles( b, frametime );
+	}
+
+	return Sys_DoubleTime() - start;
+}
+
+/*
+================
+CL_ParticleProfiling_f
+
+compare particle kernels on the random set
+================
+*/
+void CL_ParticleProfiling_f( void )
+{
+	int		i, count = 32768, passes = 100;
+	particle_t	*source, *parts;
+	partbatch_t	batch;
+	double		t1, t2;
+
+	if( Cmd_Argc() > 1 )
+		count = bound( 1, Q_atoi( Cmd_Argv( 1 )), 1048576 );
+
+	source = Mem_Calloc( cls.mempool, sizeof( particle_t ) * count );
+	parts = Mem_Calloc( cls.mempool, sizeof( particle_t ) * count );
+	CL_AllocParticleBatch( &batch, count );
+
+	// all the built-in types, custom ones are never batched
+	for( i = 0; i < count; i++ )
+	{
+		source[i].type = COM_RandomLong( pt_static, pt_vox_grav );
+		source[i].packedColor = COM_RandomLong( 0, 1 ) ? 255 : 0;
+		source[i].org[0] = COM_RandomFloat( -4096.0f, 4096.0f );
+		source[i].org[1] = COM_RandomFloat( -4096.0f, 4096.0f );
+		source[i].org[2] = COM_RandomFloat( -4096.0f, 4096.0f );
+		source[i].vel[0] = COM_RandomFloat( -256.0f, 256.0f );
+		source[i].vel[1] = COM_RandomFloat( -256.0f, 256.0f );
+		source[i].vel[2] = COM_RandomFloat( -256.0f, 256.0f );
+		source[i].ramp = COM_RandomFloat( 0.0f, 4.0f );
+		source[i].die = cl.time + 1000.0f;
+		source[i].next = ( i < count - 1 ) ? &parts[i+1] : NULL;
+	}
+
+	Con_Printf( "Profiling %i passes of %i particles to %s kernels\n", passes, count, partkernels.name );
+
+	memcpy( parts, source, sizeof( particle_t ) * count );
+	t1 = CL_ProfileParticles( &partkernels_ref, parts, &batch, passes );
+	memcpy( parts, source, sizeof( particle_t ) * count );
+	t2 = CL_ProfileParticles( &partkernels, parts, &batch, passes );
+
+	Con_Printf( "reference %.2f, %s %.2f million particles per second\n",
+		(double)count * passes / Q_max( t1, 0.000001 ) / 1000000.0,
+		partkernels.name, (double)count * passes / Q_max( t2, 0.000001 ) / 1000000.0 );
+
+	CL_FreeParticleBatch( &batch );
+	Mem_Free( source );
+	Mem_Free( parts );
 }
 
 /*
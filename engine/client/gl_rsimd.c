@@ -0,0 +1,240 @@
+/*
+gl_rsimd.c - renderer kernels
+Copyright (C) 2018 Uncle Mike
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "client.h"
+#include "gl_local.h"
+
+#ifdef XASH_SSE2
+#include <emmintrin.h>
+#endif
+
+lmkernels_t	lmkernels;
+partkernels_t	partkernels;
+
+/*
+=============================================================================
+
+	REFERENCE KERNELS
+
+	all other kernels must produce exactly the same output.
+	blocklights have four lanes per texel, the last one is unused
+=============================================================================
+*/
+static void R_AddLightStyles_Ref( uint *blocklights, const color24 *lm, const uint **tables, int numstyles, int size )
+{
+	const uint	*table;
+	int		i, map;
+	uint		*bl;
+
+	memset( blocklights, 0, sizeof( uint ) * size * 4 );
+
+	for( map = 0; map < numstyles; map++ )
+	{
+		table = tables[map];
+
+		for( i = 0, bl = blocklights; i < size; i++, bl += 4, lm++ )
+		{
+			bl[0] += table[lm->r];
+			bl[1] += table[lm->g];
+			bl[2] += table[lm->b];
+		}
+	}
+}
+
+static void R_PackLights_Ref( byte *dest, int stride, const uint *bl, int smax, int tmax )
+{
+	int	s, t;
+
+	stride -= (smax << 2);
+
+	for( t = 0; t < tmax; t++, dest += stride )
+	{
+		for( s = 0; s < smax; s++ )
+		{
+			dest[0] = Q_min((bl[0] >> 7), 255 );
+			dest[1] = Q_min((bl[1] >> 7), 255 );
+			dest[2] = Q_min((bl[2] >> 7), 255 );
+			dest[3] = 255;
+
+			bl += 4;
+			dest += 4;
+		}
+	}
+}
+
+static void R_MoveParticlesRange( partbatch_t *b, int start, float frametime, float grav )
+{
+	int	i;
+
+	for( i = start; i < b->count; i++ )
+	{
+		b->org[0][i] += frametime * b->vel[0][i];
+		b->org[1][i] += frametime * b->vel[1][i];
+		b->org[2][i] += frametime * b->vel[2][i];
+
+		b->vel[0][i] += b->damp[0][i] * b->vel[0][i];
+		b->vel[1][i] += b->damp[0][i] * b->vel[1][i];
+		b->vel[2][i] += b->damp[1][i] * b->vel[2][i];
+		b->vel[2][i] -= b->accel[i] * grav;
+	}
+}
+
+static void R_MoveParticles_Ref( partbatch_t *b, float frametime, float grav )
+{
+	R_MoveParticlesRange( b, 0, frametime, grav );
+}
+
+const lmkernels_t lmkernels_ref =
+{
+	"reference",
+	R_AddLightStyles_Ref,
+	R_PackLights_Ref,
+};
+
+const partkernels_t partkernels_ref =
+{
+	"reference",
+	R_MoveParticles_Ref,
+};
+
+#ifdef XASH_SSE2
+/*
+=============================================================================
+
+	SSE2 KERNELS
+
+	styles are summed in one pass over the block so every texel is
+	stored once. Packing shifts four texels at once, the saturating
+	packs do the clamp to 255 and alpha is or'ed in.
+	Particles are moved four at once, one array per axis
+=============================================================================
+*/
+static void R_AddLightStyles_SSE2( uint *blocklights, const color24 *lm, const uint **tables, int numstyles, int size )
+{
+	const color24	*in;
+	const uint	*table;
+	__m128i		acc;
+	int		i, map;
+
+	if( numstyles <= 0 )
+	{
+		memset( blocklights, 0, sizeof( uint ) * size * 4 );
+		return;
+	}
+
+	for( i = 0; i < size; i++, lm++, blocklights += 4 )
+	{
+		table = tables[0];
+		acc = _mm_setr_epi32( table[lm->r], table[lm->g], table[lm->b], 0 );
+
+		for( map = 1; map < numstyles; map++ )
+		{
+			in = lm + map * size;
+			table = tables[map];
+			acc = _mm_add_epi32( acc, _mm_setr_epi32( table[in->r], table[in->g], table[in->b], 0 ));
+		}
+
+		_mm_storeu_si128( (__m128i *)blocklights, acc );
+	}
+}
+
+static void R_PackLights_SSE2( byte *dest, int stride, const uint *bl, int smax, int tmax )
+{
+	__m128i	alpha = _mm_set1_epi32( (int)0xFF000000 );
+	__m128i	a, b, c, d;
+	int	s, t;
+
+	for( t = 0; t < tmax; t++, dest += stride, bl += smax * 4 )
+	{
+		for( s = 0; s + 4 <= smax; s += 4 )
+		{
+			a = _mm_srli_epi32( _mm_loadu_si128( (const __m128i *)( bl + s * 4 ) + 0 ), 7 );
+			b = _mm_srli_epi32( _mm_loadu_si128( (const __m128i *)( bl + s * 4 ) + 1 ), 7 );
+			c = _mm_srli_epi32( _mm_loadu_si128( (const __m128i *)( bl + s * 4 ) + 2 ), 7 );
+			d = _mm_srli_epi32( _mm_loadu_si128( (const __m128i *)( bl + s * 4 ) + 3 ), 7 );
+			a = _mm_packus_epi16( _mm_packs_epi32( a, b ), _mm_packs_epi32( c, d ));
+			_mm_storeu_si128( (__m128i *)( dest + s * 4 ), _mm_or_si128( a, alpha ));
+		}
+
+		R_PackLights_Ref( dest + s * 4, stride, bl + s * 4, smax - s, 1 );
+	}
+}
+
+static void R_MoveParticles_SSE2( partbatch_t *b, float frametime, float grav )
+{
+	__m128	ft = _mm_set1_ps( frametime );
+	__m128	g = _mm_set1_ps( grav );
+	__m128	vx, vy, vz, damp;
+	int	i;
+
+	for( i = 0; i + 4 <= b->count; i += 4 )
+	{
+		vx = _mm_loadu_ps( b->vel[0] + i );
+		vy = _mm_loadu_ps( b->vel[1] + i );
+		vz = _mm_loadu_ps( b->vel[2] + i );
+
+		_mm_storeu_ps( b->org[0] + i, _mm_add_ps( _mm_loadu_ps( b->org[0] + i ), _mm_mul_ps( ft, vx )));
+		_mm_storeu_ps( b->org[1] + i, _mm_add_ps( _mm_loadu_ps( b->org[1] + i ), _mm_mul_ps( ft, vy )));
+		_mm_storeu_ps( b->org[2] + i, _mm_add_ps( _mm_loadu_ps( b->org[2] + i ), _mm_mul_ps( ft, vz )));
+
+		damp = _mm_loadu_ps( b->damp[0] + i );
+		vx = _mm_add_ps( vx, _mm_mul_ps( damp, vx ));
+		vy = _mm_add_ps( vy, _mm_mul_ps( damp, vy ));
+		vz = _mm_add_ps( vz, _mm_mul_ps( _mm_loadu_ps( b->damp[1] + i ), vz ));
+		vz = _mm_sub_ps( vz, _mm_mul_ps( _mm_loadu_ps( b->accel + i ), g ));
+
+		_mm_storeu_ps( b->vel[0] + i, vx );
+		_mm_storeu_ps( b->vel[1] + i, vy );
+		_mm_storeu_ps( b->vel[2] + i, vz );
+	}
+
+	R_MoveParticlesRange( b, i, frametime, grav );
+}
+
+static const lmkernels_t lmkernels_sse2 =
+{
+	"SSE2",
+	R_AddLightStyles_SSE2,
+	R_PackLights_SSE2,
+};
+
+static const partkernels_t partkernels_sse2 =
+{
+	"SSE2",
+	R_MoveParticles_SSE2,
+};
+#endif
+
+/*
+================
+R_InitRenderKernels
+
+pick the fastest kernels for this cpu
+================
+*/
+void R_InitRenderKernels( void )
+{
+	lmkernels = lmkernels_ref;
+	partkernels = partkernels_ref;
+#ifdef XASH_SSE2
+	if( FBitSet( Sys_CPUFeatures(), CPU_SSE2 ))
+	{
+		lmkernels = lmkernels_sse2;
+		partkernels = partkernels_sse2;
+	}
+#endif
+	Con_Reportf( "Render: using %s lightmap and %s particle kernels\n", lmkernels.name, partkernels.name );
+}
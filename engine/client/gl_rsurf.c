@@ -18,6 +18,16 @@ GNU General Public License for more details.
 #include "gl_local.h"
 #include "mod_local.h"
 #include "mathlib.h"
+
+#define LM_JOBS_GROW	256
+
+typedef struct
+{
+	msurface_t	*surf;
+	byte		*dest;
+	int		stride;
+	qboolean		dynamic;
+} lmjob_t;
 			
 typedef struct
 {
@@ -26,12 +36,29 @@ typedef struct
 	msurface_t	*dynamic_surfaces;
 	msurface_t	*lightmap_surfaces[MAX_LIGHTMAPS];
 	byte		lightmap_buffer[BLOCK_SIZE_MAX*BLOCK_SIZE_MAX*4];
+
+	// builds are queued and running on the job threads before upload
+	lmjob_t		*jobs;
+	int		numjobs;
+	int		maxjobs;
+	uint		*blocklights[MAX_JOB_THREADS];	// per-thread, four lanes per texel
+	int		blocklightsize;		// texels in each blocklights buffer
+
+	// static lightmaps with changed lightstyles
+	msurface_t	**styled_surfaces;
+	int		numstyled;
+	int		maxstyled;
+	byte		*styled_buffer;
+	size_t		styled_size;
+
+	// LightToTexGamma( x ) * lightstyle value for each style
+	uint		styletables[MAX_LIGHTSTYLES][256];
+	int		stylevalue[MAX_LIGHTSTYLES];	// lightstylevalue the table is built for
 } gllightmapstate_t;
 
 static int		nColinElim; // stats
 static vec2_t		world_orthocenter;
 static vec2_t		world_orthohalf;
-static uint		r_blocklights[BLOCK_SIZE_MAX*BLOCK_SIZE_MAX*3];
 static mextrasurf_t		*fullbright_surfaces[MAX_TEXTURES];
 static mextrasurf_t		*detail_surfaces[MAX_TEXTURES];
 static int		rtable[MOD_FRAMES][MOD_FRAMES];
@@ -42,6 +69,7 @@ static msurface_t		*skychain = NULL;
 static gllightmapstate_t	gl_lms;
 
 static void LM_UploadBlock( int lightmapnum );
+static void R_FlushLightmapJobs( void );
 
 byte *Mod_GetCurrentVis( void )
 {
@@ -449,7 +477,7 @@ texture_t *R_TextureAnimation( msurface_t *s )
 R_AddDynamicLights
 ===============
 */
-void R_AddDynamicLights( msurface_t *surf )
+void R_AddDynamicLights( msurface_t *surf, uint *blocklights )
 {
 	float		dist, rad, minlight;
 	int		lnum, s, t, sd, td, smax, tmax;
@@ -511,14 +539,14 @@ void R_AddDynamicLights( msurface_t *surf )
 
 		sl = DotProduct( impact, info->lmvecs[0] ) + info->lmvecs[0][3] - info->lightmapmins[0];
 		tl = DotProduct( impact, info->lmvecs[1] ) + info->lmvecs[1][3] - info->lightmapmins[1];
-		bl = r_blocklights;
+		bl = blocklights;
 
 		for( t = 0, tacc = 0; t < tmax; t++, tacc += sample_size )
 		{
 			td = (tl - tacc) * sample_frac;
 			if( td < 0 ) td = -td;
 
-			for( s = 0, sacc = 0; s < smax; s++, sacc += sample_size, bl += 3 )
+			for( s = 0, sacc = 0; s < smax; s++, sacc += sample_size, bl += 4 )
 			{
 				sd = (sl - sacc) * sample_frac;
 				if( sd < 0 ) sd = -sd;
@@ -604,6 +632,9 @@ static void LM_UploadBlock( qboolean dynamic )
 {
 	int	i;
 
+	// finish all the pending builds into lightmap_buffer
+	R_FlushLightmapJobs();
+
 	if( dynamic )
 	{
 		int	height = 0;
@@ -645,62 +676,235 @@ static void LM_UploadBlock( qboolean dynamic )
 =================
 R_BuildLightmap
 
-Combine and scale multiple lightmaps into the floating
-format in r_blocklights
+Combine and scale multiple lightmaps into the
+blocklights and put them into texture format.
+Can be running on any job thread
 =================
 */
-static void R_BuildLightMap( msurface_t *surf, byte *dest, int stride, qboolean dynamic )
+static void R_BuildLightMap( msurface_t *surf, byte *dest, int stride, qboolean dynamic, uint *blocklights, const lmkernels_t *k )
 {
-	int		smax, tmax;
-	uint		*bl, scale;
-	int		i, map, size, s, t;
+	const uint	*tables[MAXLIGHTMAPS];
+	int		smax, tmax, map;
 	int		sample_size;
 	mextrasurf_t	*info = surf->info;
-	color24		*lm;
 
 	sample_size = Mod_SampleSizeForFace( surf );
 	smax = ( info->lightextents[0] / sample_size ) + 1;
 	tmax = ( info->lightextents[1] / sample_size ) + 1;
-	size = smax * tmax;
-
-	lm = surf->samples;
 
-	memset( r_blocklights, 0, sizeof( uint ) * size * 3 );
+	// scale tables are updated by R_AddLightmapJob
+	for( map = 0; map < MAXLIGHTMAPS && surf->styles[map] != 255 && surf->samples; map++ )
+		tables[map] = gl_lms.styletables[surf->styles[map]];
 
 	// add all the lightmaps
-	for( map = 0; map < MAXLIGHTMAPS && surf->styles[map] != 255 && lm; map++ )
-	{
-		scale = tr.lightstylevalue[surf->styles[map]];
-
-		for( i = 0, bl = r_blocklights; i < size; i++, bl += 3, lm++ )
-		{
-			bl[0] += LightToTexGamma( lm->r ) * scale;
-			bl[1] += LightToTexGamma( lm->g ) * scale;
-			bl[2] += LightToTexGamma( lm->b ) * scale;
-		}
-	}
+	k->AddLightStyles( blocklights, surf->samples, tables, map, smax * tmax );
 
 	// add all the dynamic lights
 	if( surf->dlightframe == tr.framecount && dynamic )
-		R_AddDynamicLights( surf );
+		R_AddDynamicLights( surf, blocklights );
 
 	// Put into texture format
-	stride -= (smax << 2);
-	bl = r_blocklights;
+	k->PackLights( dest, stride, blocklights, smax, tmax );
+}
+
+/*
+=================
+R_UpdateStyleTable
+
+rebuild scale table when lightstyle value is changed
+=================
+*/
+static void R_UpdateStyleTable( int style )
+{
+	int	i, value = tr.lightstylevalue[style];
+	uint	*table;
+
+	if( gl_lms.stylevalue[style] == value )
+		return;
+
+	table = gl_lms.styletables[style];
+	gl_lms.stylevalue[style] = value;
+
+	for( i = 0; i < 256; i++ )
+		table[i] = LightToTexGamma( i ) * value;
+}
+
+/*
+=================
+R_AddLightmapJob
 
-	for( t = 0; t < tmax; t++, dest += stride )
+queue surface to build, dest must stay valid
+until R_FlushLightmapJobs is called
+=================
+*/
+static void R_AddLightmapJob( msurface_t *surf, byte *dest, int stride, qboolean dynamic )
+{
+	int		i, map, size;
+	int		sample_size;
+	mextrasurf_t	*info = surf->info;
+	lmjob_t		*job;
+
+	sample_size = Mod_SampleSizeForFace( surf );
+	size = (( info->lightextents[0] / sample_size ) + 1 ) * (( info->lightextents[1] / sample_size ) + 1 );
+
+	// job threads can't allocate, so grow the buffers here
+	if( size > gl_lms.blocklightsize )
 	{
-		for( s = 0; s < smax; s++ )
-		{
-			dest[0] = Q_min((bl[0] >> 7), 255 );
-			dest[1] = Q_min((bl[1] >> 7), 255 );
-			dest[2] = Q_min((bl[2] >> 7), 255 );
-			dest[3] = 255;
+		for( i = 0; i < Sys_JobThreads(); i++ )
+			gl_lms.blocklights[i] = Mem_Realloc( r_temppool, gl_lms.blocklights[i], sizeof( uint ) * size * 4 );
+		gl_lms.blocklightsize = size;
+	}
 
-			bl += 3;
-			dest += 4;
-		}
+	if( gl_lms.numjobs == gl_lms.maxjobs )
+	{
+		gl_lms.maxjobs += LM_JOBS_GROW;
+		gl_lms.jobs = Mem_Realloc( r_temppool, gl_lms.jobs, sizeof( lmjob_t ) * gl_lms.maxjobs );
 	}
+
+	for( map = 0; map < MAXLIGHTMAPS && surf->styles[map] != 255; map++ )
+		R_UpdateStyleTable( surf->styles[map] );
+
+	job = &gl_lms.jobs[gl_lms.numjobs++];
+	job->surf = surf;
+	job->dest = dest;
+	job->stride = stride;
+	job->dynamic = dynamic;
+}
+
+static void R_LightmapJob( void *data, int index, int thread )
+{
+	lmjob_t	*job = &gl_lms.jobs[index];
+
+	R_BuildLightMap( job->surf, job->dest, job->stride, job->dynamic, gl_lms.blocklights[thread], (const lmkernels_t *)data );
+}
+
+static void R_RunLightmapJobs( const lmkernels_t *k, qboolean threaded )
+{
+	int	i;
+
+	if( threaded )
+	{
+		Sys_ParallelFor( R_LightmapJob, (void *)k, gl_lms.numjobs );
+		return;
+	}
+
+	for( i = 0; i < gl_lms.numjobs; i++ )
+		R_LightmapJob( (void *)k, i, 0 );
+}
+
+/*
+=================
+R_FlushLightmapJobs
+
+build all the queued surfaces
+=================
+*/
+static void R_FlushLightmapJobs( void )
+{
+	R_RunLightmapJobs( &lmkernels, true );
+	gl_lms.numjobs = 0;
+}
+
+/*
+=================
+R_AddStyledSurface
+
+static lightmap of this surface will be
+rebuilt by R_UpdateStyledLightmaps
+=================
+*/
+static void R_AddStyledSurface( msurface_t *surf )
+{
+	if( gl_lms.numstyled == gl_lms.maxstyled )
+	{
+		gl_lms.maxstyled += LM_JOBS_GROW;
+		gl_lms.styled_surfaces = Mem_Realloc( r_temppool, gl_lms.styled_surfaces, sizeof( msurface_t* ) * gl_lms.maxstyled );
+	}
+
+	// prevent to queue it again while it waits for rebuild
+	R_SetCacheState( surf );
+	gl_lms.styled_surfaces[gl_lms.numstyled++] = surf;
+}
+
+/*
+=================
+R_UpdateStyledLightmaps
+
+build the queued surfaces on the job threads
+and update the static lightmaps
+=================
+*/
+static void R_UpdateStyledLightmaps( void )
+{
+	int		i, smax, tmax;
+	int		sample_size;
+	size_t		size = 0;
+	mextrasurf_t	*info;
+	msurface_t	*surf;
+	byte		*base;
+
+	if( !gl_lms.numstyled )
+		return;
+
+	for( i = 0; i < gl_lms.numstyled; i++ )
+	{
+		surf = gl_lms.styled_surfaces[i];
+		sample_size = Mod_SampleSizeForFace( surf );
+		smax = ( surf->info->lightextents[0] / sample_size ) + 1;
+		tmax = ( surf->info->lightextents[1] / sample_size ) + 1;
+		size += smax * tmax * 4;
+	}
+
+	if( size > gl_lms.styled_size )
+	{
+		gl_lms.styled_buffer = Mem_Realloc( r_temppool, gl_lms.styled_buffer, size );
+		gl_lms.styled_size = size;
+	}
+
+	for( i = 0, base = gl_lms.styled_buffer; i < gl_lms.numstyled; i++ )
+	{
+		surf = gl_lms.styled_surfaces[i];
+		sample_size = Mod_SampleSizeForFace( surf );
+		smax = ( surf->info->lightextents[0] / sample_size ) + 1;
+		tmax = ( surf->info->lightextents[1] / sample_size ) + 1;
+
+		R_AddLightmapJob( surf, base, smax * 4, true );
+		base += smax * tmax * 4;
+	}
+
+	R_FlushLightmapJobs();
+
+	for( i = 0, base = gl_lms.styled_buffer; i < gl_lms.numstyled; i++ )
+	{
+		surf = gl_lms.styled_surfaces[i];
+		info = surf->info;
+		sample_size = Mod_SampleSizeForFace( surf );
+		smax = ( info->lightextents[0] / sample_size ) + 1;
+		tmax = ( info->lightextents[1] / sample_size ) + 1;
+
+		GL_Bind( GL_TEXTURE0, tr.lightmapTextures[surf->lightmaptexturenum] );
+
+		pglTexSubImage2D( GL_TEXTURE_2D, 0, surf->light_s, surf->light_t, smax, tmax,
+		GL_RGBA, GL_UNSIGNED_BYTE, base );
+		base += smax * tmax * 4;
+	}
+
+	gl_lms.numstyled = 0;
+}
+
+/*
+=================
+R_ResetLightmapJobs
+
+forget all the queued surfaces
+and scale tables
+=================
+*/
+static void R_ResetLightmapJobs( void )
+{
+	memset( gl_lms.stylevalue, 0xFF, sizeof( gl_lms.stylevalue ));
+	gl_lms.numstyled = 0;
+	gl_lms.numjobs = 0;
 }
 
 /*
@@ -821,6 +1025,9 @@ void R_BlendLightmaps( void )
 	msurface_t	*surf, *newsurf = NULL;
 	int		i;
 
+	// update static lightmaps before they are drawn
+	R_UpdateStyledLightmaps();
+
 	if( CVAR_TO_BOOL( r_fullbright ) || !cl.worldmodel->lightdata )
 		return;
 
@@ -892,13 +1099,13 @@ void R_BlendLightmaps( void )
 				base = gl_lms.lightmap_buffer;
 				base += ( surf->info->dlight_t * BLOCK_SIZE + surf->info->dlight_s ) * 4;
 
-				R_BuildLightMap( surf, base, BLOCK_SIZE * 4, true );
+				R_AddLightmapJob( surf, base, BLOCK_SIZE * 4, true );
 			}
 			else
 			{
 				msurface_t	*drawsurf;
 
-				// upload what we have so far
+				// build and upload what we have so far
 				LM_UploadBlock( true );
 
 				// draw all surfaces that use this lightmap
@@ -924,7 +1131,7 @@ void R_BlendLightmaps( void )
 				base = gl_lms.lightmap_buffer;
 				base += ( surf->info->dlight_t * BLOCK_SIZE + surf->info->dlight_s ) * 4;
 
-				R_BuildLightMap( surf, base, BLOCK_SIZE * 4, true );
+				R_AddLightmapJob( surf, base, BLOCK_SIZE * 4, true );
 			}
 		}
 
@@ -1144,22 +1351,8 @@ dynamic:
 	{
 		if(( fa->styles[maps] >= 32 || fa->styles[maps] == 0 || fa->styles[maps] == 20 ) && ( fa->dlightframe != tr.framecount ))
 		{
-			byte		temp[132*132*4];
-			mextrasurf_t	*info = fa->info;
-			int		sample_size;
-			int		smax, tmax;
-
-			sample_size = Mod_SampleSizeForFace( fa );
-			smax = ( info->lightextents[0] / sample_size ) + 1;
-			tmax = ( info->lightextents[1] / sample_size ) + 1;
-
-			R_BuildLightMap( fa, temp, smax * 4, true );
-			R_SetCacheState( fa );
-                              
-			GL_Bind( GL_TEXTURE0, tr.lightmapTextures[fa->lightmaptexturenum] );
-
-			pglTexSubImage2D( GL_TEXTURE_2D, 0, fa->light_s, fa->light_t, smax, tmax,
-			GL_RGBA, GL_UNSIGNED_BYTE, temp );
+			// will be updated right before R_BlendLightmaps draw it
+			R_AddStyledSurface( fa );
 
 			fa->info->lightmapchain = gl_lms.lightmap_surfaces[fa->lightmaptexturenum];
 			gl_lms.lightmap_surfaces[fa->lightmaptexturenum] = fa;
@@ -2033,7 +2226,7 @@ void GL_CreateSurfaceLightmap( msurface_t *surf )
 	base += ( surf->light_t * BLOCK_SIZE + surf->light_s ) * 4;
 
 	R_SetCacheState( surf );
-	R_BuildLightMap( surf, base, BLOCK_SIZE * 4, false );
+	R_AddLightmapJob( surf, base, BLOCK_SIZE * 4, false );
 }
 
 /*
@@ -2064,6 +2257,7 @@ void GL_RebuildLightmaps( void )
 
 	memset( tr.lightmapTextures, 0, sizeof( tr.lightmapTextures ));
 	gl_lms.current_lightmap_texture = 0;
+	R_ResetLightmapJobs();
 
 	// setup all the lightstyles
 	CL_RunLightStyles();
@@ -2124,6 +2318,7 @@ void GL_BuildLightmaps( void )
 
 	tr.framecount = tr.visframecount = 1;	// no dlight cache
 	gl_lms.current_lightmap_texture = 0;
+	R_ResetLightmapJobs();
 	tr.modelviewIdentity = false;
 	tr.realframecount = 1;
 	nColinElim = 0;
@@ -2179,6 +2374,140 @@ void GL_BuildLightmaps( void )
 	ClearBits( vid_gamma->flags, FCVAR_CHANGED );
 }
 
+/*
+==================
+GL_FreeLightmapBuffers
+
+release job queues before
+the render zone is freed
+==================
+*/
+void GL_FreeLightmapBuffers( void )
+{
+	int	i;
+
+	for( i = 0; i < MAX_JOB_THREADS; i++ )
+	{
+		if( gl_lms.blocklights[i] )
+			Mem_Free( gl_lms.blocklights[i] );
+		gl_lms.blocklights[i] = NULL;
+	}
+
+	if( gl_lms.jobs ) Mem_Free( gl_lms.jobs );
+	if( gl_lms.styled_surfaces ) Mem_Free( gl_lms.styled_surfaces );
+	if( gl_lms.styled_buffer ) Mem_Free( gl_lms.styled_buffer );
+
+	gl_lms.jobs = NULL;
+	gl_lms.styled_surfaces = NULL;
+	gl_lms.styled_buffer = NULL;
+	gl_lms.blocklightsize = 0;
+	gl_lms.maxjobs = gl_lms.maxstyled = 0;
+	gl_lms.styled_size = 0;
+	R_ResetLightmapJobs();
+}
+
+static double R_ProfileLightmapJobs( const lmkernels_t *k, qboolean threaded, int passes )
+{
+	double	start;
+	int	i;
+
+	start = Sys_DoubleTime();
+
+	for( i = 0; i < passes; i++ )
+		R_RunLightmapJobs( k, threaded );
+
+	return Sys_DoubleTime() - start;
+}
+
+/*
+==================
+R_LightmapProfiling_f
+
+rebuild all the world lightmaps with reference
+and current kernels, single and multithreaded
+==================
+*/
+void R_LightmapProfiling_f( void )
+{
+	int		i, smax, tmax, count = 20;
+	int		sample_size, numsurfs = 0;
+	double		t1, t2, t3;
+	size_t		size = 0;
+	byte		*ref, *out;
+	qboolean		match;
+	model_t		*world = cl.worldmodel;
+	msurface_t	*surf;
+
+	if( !world || !world->lightdata || !cl.video_prepped )
+	{
+		Con_Printf( "no map loaded\n" );
+		return;
+	}
+
+	if( Cmd_Argc() > 1 )
+		count = bound( 1, Q_atoi( Cmd_Argv( 1 )), 10000 );
+
+	// layout all the world lightmaps in one buffer
+	for( i = 0; i < world->numsurfaces; i++ )
+	{
+		surf = world->surfaces + i;
+		if( FBitSet( surf->flags, SURF_DRAWTILED ))
+			continue;
+
+		sample_size = Mod_SampleSizeForFace( surf );
+		smax = ( surf->info->lightextents[0] / sample_size ) + 1;
+		tmax = ( surf->info->lightextents[1] / sample_size ) + 1;
+		size += smax * tmax * 4;
+	}
+
+	if( !size ) return;
+
+	R_FlushLightmapJobs();
+
+	ref = Mem_Malloc( r_temppool, size );
+	out = Mem_Malloc( r_temppool, size );
+
+	for( i = 0, size = 0; i < world->numsurfaces; i++ )
+	{
+		surf = world->surfaces + i;
+		if( FBitSet( surf->flags, SURF_DRAWTILED ))
+			continue;
+
+		sample_size = Mod_SampleSizeForFace( surf );
+		smax = ( surf->info->lightextents[0] / sample_size ) + 1;
+		tmax = ( surf->info->lightextents[1] / sample_size ) + 1;
+
+		R_AddLightmapJob( surf, ref + size, smax * 4, false );
+		size += smax * tmax * 4;
+		numsurfs++;
+	}
+
+	Con_Printf( "Profiling %i passes of %i surfaces to %s kernels\n", count, numsurfs, lmkernels.name );
+
+	t1 = R_ProfileLightmapJobs( &lmkernels_ref, false, count );
+
+	// same jobs into the second buffer
+	for( i = 0; i < gl_lms.numjobs; i++ )
+		gl_lms.jobs[i].dest = out + ( gl_lms.jobs[i].dest - ref );
+
+	memset( out, 0, size );
+	t2 = R_ProfileLightmapJobs( &lmkernels, false, count );
+	match = !memcmp( ref, out, size );
+
+	memset( out, 0, size );
+	t3 = R_ProfileLightmapJobs( &lmkernels, true, count );
+	match &= !memcmp( ref, out, size );
+
+	gl_lms.numjobs = 0;
+
+	Con_Printf( "reference %.3f ms, %s %.3f ms, %s on %i threads %.3f ms per pass (%s)\n", t1 * 1000.0 / count,
+		lmkernels.name, t2 * 1000.0 / count, lmkernels.name, Sys_JobThreads(), t3 * 1000.0 / count,
+		match ? "^2match^7" : "^1MISMATCH^7" );
+
+	Mem_Free( ref );
+	Mem_Free( out );
+}
+
 void GL_InitRandomTable( void )
 {
 	int	tu, tv;
@@ -26,9 +26,12 @@ GNU General Public License for more details.
 
 #define EVENT_CLIENT	5000	// less than this value it's a server-side studio events
 #define MAX_LOCALLIGHTS	4
+#define STUDIO_POSES	256	// pose cache slots, must be power of two
 
 CVAR_DEFINE_AUTO( r_glowshellfreq, "2.2", 0, "glowing shell frequency update" );
 CVAR_DEFINE_AUTO( r_shadows, "0", 0, "cast shadows from models" );
+CVAR_DEFINE_AUTO( r_studio_posecache, "1", FCVAR_ARCHIVE, "reuse studio bone poses unchanged since last setup" );
+CVAR_DEFINE_AUTO( r_studio_bonejobs, "1", FCVAR_ARCHIVE, "setup bones of visible studiomodels on job threads before drawing" );
 
 static vec3_t hullcolor[8] = 
 {
@@ -104,6 +107,62 @@ typedef struct
 	float		locallightR2[MAX_LOCALLIGHTS];
 } studio_draw_state_t;
 
+// per-thread bone scratch (was static arrays in R_StudioSetupBones)
+typedef struct
+{
+	vec3_t		pos[MAXSTUDIOBONES];
+	vec4_t		q[MAXSTUDIOBONES];
+	vec3_t		pos2[MAXSTUDIOBONES];
+	vec4_t		q2[MAXSTUDIOBONES];
+	vec3_t		pos3[MAXSTUDIOBONES];
+	vec4_t		q3[MAXSTUDIOBONES];
+	vec3_t		pos4[MAXSTUDIOBONES];
+	vec4_t		q4[MAXSTUDIOBONES];
+	vec3_t		pos1b[MAXSTUDIOBONES];
+	vec4_t		q1b[MAXSTUDIOBONES];
+} studioscratch_t;
+
+// everything the sequence pose depends on, compared with memcmp
+typedef struct
+{
+	cl_entity_t	*ent;
+	studiohdr_t	*phdr;
+	int		sequence;
+	float		frame;
+	float		dadt;
+	byte		controller[4];
+	byte		prevcontroller[4];
+	byte		blending[2];
+	byte		prevblending[2];
+	byte		mouthopen;
+} studioposekey_t;
+
+typedef struct
+{
+	studioposekey_t	key;
+	int		batch;			// prepass that claimed this slot
+	vec3_t		pos[MAXSTUDIOBONES];
+	vec4_t		q[MAXSTUDIOBONES];
+} studiopose_t;
+
+typedef struct
+{
+	cl_entity_t	*ent;
+	studiohdr_t	*phdr;
+	mstudioseqdesc_t	*pseqdesc;
+	mstudioanim_t	*panim;
+	float		frame;
+	studiopose_t	*pose;
+} studioposejob_t;
+
+typedef struct
+{
+	studiopose_t	poses[STUDIO_POSES];
+	studioposejob_t	jobs[STUDIO_POSES];	// every job owns a unique slot
+	int		numjobs;
+	int		batch;
+} studioposecache_t;
+
 // studio-related cvars 
 convar_t			*r_studio_sort_textures;
 convar_t			*r_drawviewmodel;
@@ -112,6 +171,8 @@ convar_t			*cl_himodels;
 
 static r_studio_interface_t	*pStudioDraw;
 static studio_draw_state_t	g_studio;		// global studio state
+static studioscratch_t	g_studioscratch[MAX_JOB_THREADS];
+static studioposecache_t	g_studiopose;
 
 // global variables
 static qboolean		m_fDoRemap;
@@ -138,6 +199,8 @@ void R_StudioInit( void )
 
 	Matrix3x4_LoadIdentity( g_studio.rotationmatrix );
 	Cvar_RegisterVariable( &r_glowshellfreq );
+	Cvar_RegisterVariable( &r_studio_posecache );
+	Cvar_RegisterVariable( &r_studio_bonejobs );
 
 	// g-cont. cvar disabled by Valve
 //	Cvar_RegisterVariable( &r_shadows );
@@ -145,6 +208,21 @@ void R_StudioInit( void )
 	g_studio.interpolate = true;
 	g_studio.framecount = 0;
 	m_fDoRemap = false;
+
+	R_StudioClearPoseCache();
+}
+
+/*
+====================
+R_StudioClearPoseCache
+
+header pointers may be reused
+by the next map
+====================
+*/
+void R_StudioClearPoseCache( void )
+{
+	memset( &g_studiopose, 0, sizeof( g_studiopose ));
 }
 
 /*
@@ -818,7 +896,7 @@ StudioCalcBoneAdj
 
 ====================
 */
-void R_StudioCalcBoneAdj( float dadt, float *adj, const byte *pcontroller1, const byte *pcontroller2, byte mouthopen )
+void R_StudioCalcBoneAdj( studiohdr_t *m_pStudioHeader, float dadt, float *adj, const byte *pcontroller1, const byte *pcontroller2, byte mouthopen )
 {
 	mstudiobonecontroller_t	*pbonecontroller;
 	float			value = 0.0f;	
@@ -1074,7 +1152,7 @@ StudioCalcRotations
 
 ====================
 */
-void R_StudioCalcRotations( cl_entity_t *e, float pos[][3], vec4_t *q, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, float f )
+void R_StudioCalcRotations( cl_entity_t *e, studiohdr_t *m_pStudioHeader, float pos[][3], vec4_t *q, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, float f )
 {
 	int		i, frame;
 	float		adj[MAXSTUDIOCONTROLLERS];
@@ -1102,7 +1180,7 @@ void R_StudioCalcRotations( cl_entity_t *e, float pos[][3], vec4_t *q, mstudiose
 	// add in programtic controllers
 	pbone = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
 
-	R_StudioCalcBoneAdj( dadt, adj, e->curstate.controller, e->latched.prevcontroller, e->mouth.mouthopen );
+	R_StudioCalcBoneAdj( m_pStudioHeader, dadt, adj, e->curstate.controller, e->latched.prevcontroller, e->mouth.mouthopen );
 
 	for( i = 0; i < m_pStudioHeader->numbones; i++, pbone++, panim++ ) 
 	{
@@ -1115,6 +1193,84 @@ void R_StudioCalcRotations( cl_entity_t *e, float pos[][3], vec4_t *q, mstudiose
 	if( pseqdesc->motiontype & STUDIO_Z ) pos[pseqdesc->motionbone][2] = 0.0f;
 }
 
+/*
+====================
+StudioCalcPose
+
+sequence pose with blends, no
+sequence transition and gait
+====================
+*/
+static void R_StudioCalcPose( cl_entity_t *e, studiohdr_t *phdr, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, float f, studioscratch_t *scratch, vec3_t *pos, vec4_t *q )
+{
+	float	s, dadt;
+
+	R_StudioCalcRotations( e, phdr, pos, q, pseqdesc, panim, f );
+
+	if( pseqdesc->numblends <= 1 )
+		return;
+
+	panim += phdr->numbones;
+	R_StudioCalcRotations( e, phdr, scratch->pos2, scratch->q2, pseqdesc, panim, f );
+
+	dadt = R_StudioEstimateInterpolant( e );
+	s = (e->curstate.blending[0] * dadt + e->latched.prevblending[0] * (1.0f - dadt)) / 255.0f;
+
+	R_StudioSlerpBones( phdr->numbones, q, pos, scratch->q2, scratch->pos2, s );
+
+	if( pseqdesc->numblends == 4 )
+	{
+		panim += phdr->numbones;
+		R_StudioCalcRotations( e, phdr, scratch->pos3, scratch->q3, pseqdesc, panim, f );
+
+		panim += phdr->numbones;
+		R_StudioCalcRotations( e, phdr, scratch->pos4, scratch->q4, pseqdesc, panim, f );
+
+		s = (e->curstate.blending[0] * dadt + e->latched.prevblending[0] * (1.0f - dadt)) / 255.0f;
+		R_StudioSlerpBones( phdr->numbones, scratch->q3, scratch->pos3, scratch->q4, scratch->pos4, s );
+
+		s = (e->curstate.blending[1] * dadt + e->latched.prevblending[1] * (1.0f - dadt)) / 255.0f;
+		R_StudioSlerpBones( phdr->numbones, q, pos, scratch->q3, scratch->pos3, s );
+	}
+}
+
+/*
+====================
+StudioPoseKey
+
+====================
+*/
+static void R_StudioPoseKey( studioposekey_t *key, cl_entity_t *e, studiohdr_t *phdr, float f )
+{
+	memset( key, 0, sizeof( *key )); // clear padding for memcmp
+
+	key->ent = e;
+	key->phdr = phdr;
+	key->sequence = e->curstate.sequence;
+	key->frame = f;
+	key->dadt = R_StudioEstimateInterpolant( e );
+	memcpy( key->controller, e->curstate.controller, sizeof( key->controller ));
+	memcpy( key->prevcontroller, e->latched.prevcontroller, sizeof( key->prevcontroller ));
+	memcpy( key->blending, e->curstate.blending, sizeof( key->blending ));
+	memcpy( key->prevblending, e->latched.prevblending, sizeof( key->prevblending ));
+	key->mouthopen = e->mouth.mouthopen;
+}
+
+/*
+====================
+StudioPoseSlot
+
+====================
+*/
+static studiopose_t *R_StudioPoseSlot( cl_entity_t *e )
+{
+	uint	hash = (uint)(size_t)e;
+
+	hash = ( hash ^ ( hash >> 13 )) * 0x9E3779B1;
+
+	return &g_studiopose.poses[(hash >> 16) & (STUDIO_POSES - 1)];
+}
+
 /*
 ====================
 StudioMergeBones
@@ -1128,8 +1284,9 @@ void R_StudioMergeBones( cl_entity_t *e, model_t *m_pSubModel )
 	mstudioseqdesc_t	*pseqdesc;
 	mstudioanim_t	*panim;
 	matrix3x4		bonematrix;
-	static vec4_t	q[MAXSTUDIOBONES];
-	static float	pos[MAXSTUDIOBONES][3];
+	studioscratch_t	*scratch = &g_studioscratch[Sys_JobSlot()];
+	vec4_t		*q = scratch->q;
+	vec3_t		*pos = scratch->pos;
 	double		f;
 
 	if( e->curstate.sequence >=  m_pStudioHeader->numseq )
@@ -1140,7 +1297,7 @@ void R_StudioMergeBones( cl_entity_t *e, model_t *m_pSubModel )
 	f = R_StudioEstimateFrame( e, pseqdesc );
 
 	panim = R_StudioGetAnim( m_pStudioHeader, m_pSubModel, pseqdesc );
-	R_StudioCalcRotations( e, pos, q, pseqdesc, panim, f );
+	R_StudioCalcRotations( e, m_pStudioHeader, pos, q, pseqdesc, panim, f );
 	pbones = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
 
 	for( i = 0; i < m_pStudioHeader->numbones; i++ ) 
@@ -1188,14 +1345,11 @@ void R_StudioSetupBones( cl_entity_t *e )
 	mstudioseqdesc_t	*pseqdesc;
 	mstudioanim_t	*panim;
 	matrix3x4		bonematrix;
-	static vec3_t	pos[MAXSTUDIOBONES];
-	static vec4_t	q[MAXSTUDIOBONES];
-	static vec3_t	pos2[MAXSTUDIOBONES];
-	static vec4_t	q2[MAXSTUDIOBONES];
-	static vec3_t	pos3[MAXSTUDIOBONES];
-	static vec4_t	q3[MAXSTUDIOBONES];
-	static vec3_t	pos4[MAXSTUDIOBONES];
-	static vec4_t	q4[MAXSTUDIOBONES];
+	studioscratch_t	*scratch = &g_studioscratch[Sys_JobSlot()];
+	vec3_t		*pos = scratch->pos;
+	vec4_t		*q = scratch->q;
+	studiopose_t	*pose = NULL;
+	studioposekey_t	key;
 	int		i;
 
 	if( e->curstate.sequence >= m_pStudioHeader->numseq )
@@ -1205,55 +1359,54 @@ void R_StudioSetupBones( cl_entity_t *e )
 
 	f = R_StudioEstimateFrame( e, pseqdesc );
 
-	panim = R_StudioGetAnim( m_pStudioHeader, RI.currentmodel, pseqdesc );
-	R_StudioCalcRotations( e, pos, q, pseqdesc, panim, f );
-
-	if( pseqdesc->numblends > 1 )
+	if( r_studio_posecache.value )
 	{
-		float	s;
-		float	dadt;
-
-		panim += m_pStudioHeader->numbones;
-		R_StudioCalcRotations( e, pos2, q2, pseqdesc, panim, f );
-
-		dadt = R_StudioEstimateInterpolant( e );
-		s = (e->curstate.blending[0] * dadt + e->latched.prevblending[0] * (1.0f - dadt)) / 255.0f;
+		R_StudioPoseKey( &key, e, m_pStudioHeader, f );
+		pose = R_StudioPoseSlot( e );
+	}
 
-		R_StudioSlerpBones( m_pStudioHeader->numbones, q, pos, q2, pos2, s );
+	if( pose && !memcmp( &pose->key, &key, sizeof( key )))
+	{
+		// same pose as the last setup or the job prepass
+		memcpy( pos, pose->pos, sizeof( vec3_t ) * m_pStudioHeader->numbones );
+		memcpy( q, pose->q, sizeof( vec4_t ) * m_pStudioHeader->numbones );
+	}
+	else
+	{
+		panim = R_StudioGetAnim( m_pStudioHeader, RI.currentmodel, pseqdesc );
+		R_StudioCalcPose( e, m_pStudioHeader, pseqdesc, panim, f, scratch, pos, q );
 
-		if( pseqdesc->numblends == 4 )
+		if( pose )
 		{
-			panim += m_pStudioHeader->numbones;
-			R_StudioCalcRotations( e, pos3, q3, pseqdesc, panim, f );
-
-			panim += m_pStudioHeader->numbones;
-			R_StudioCalcRotations( e, pos4, q4, pseqdesc, panim, f );
-
-			s = (e->curstate.blending[0] * dadt + e->latched.prevblending[0] * (1.0f - dadt)) / 255.0f;
-			R_StudioSlerpBones( m_pStudioHeader->numbones, q3, pos3, q4, pos4, s );
-
-			s = (e->curstate.blending[1] * dadt + e->latched.prevblending[1] * (1.0f - dadt)) / 255.0f;
-			R_StudioSlerpBones( m_pStudioHeader->numbones, q, pos, q3, pos3, s );
+			memcpy( pose->pos, pos, sizeof( vec3_t ) * m_pStudioHeader->numbones );
+			memcpy( pose->q, q, sizeof( vec4_t ) * m_pStudioHeader->numbones );
+			pose->key = key;
 		}
 	}
 
 	if( g_studio.interpolate && e->latched.sequencetime && ( e->latched.sequencetime + 0.2f > g_studio.time ) && ( e->latched.prevsequence < m_pStudioHeader->numseq ))
 	{
 		// blend from last sequence
-		static vec3_t	pos1b[MAXSTUDIOBONES];
-		static vec4_t	q1b[MAXSTUDIOBONES];
-		float		s;
+		vec3_t	*pos1b = scratch->pos1b;
+		vec4_t	*q1b = scratch->q1b;
+		vec3_t	*pos2 = scratch->pos2;
+		vec4_t	*q2 = scratch->q2;
+		vec3_t	*pos3 = scratch->pos3;
+		vec4_t	*q3 = scratch->q3;
+		vec3_t	*pos4 = scratch->pos4;
+		vec4_t	*q4 = scratch->q4;
+		float	s;
 
 		pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + e->latched.prevsequence;
 		panim = R_StudioGetAnim( m_pStudioHeader, RI.currentmodel, pseqdesc );
 
 		// clip prevframe
-		R_StudioCalcRotations( e, pos1b, q1b, pseqdesc, panim, e->latched.prevframe );
+		R_StudioCalcRotations( e, m_pStudioHeader, pos1b, q1b, pseqdesc, panim, e->latched.prevframe );
 
 		if( pseqdesc->numblends > 1 )
 		{
 			panim += m_pStudioHeader->numbones;
-			R_StudioCalcRotations( e, pos2, q2, pseqdesc, panim, e->latched.prevframe );
+			R_StudioCalcRotations( e, m_pStudioHeader, pos2, q2, pseqdesc, panim, e->latched.prevframe );
 
 			s = (e->latched.prevseqblending[0]) / 255.0f;
 			R_StudioSlerpBones( m_pStudioHeader->numbones, q1b, pos1b, q2, pos2, s );
@@ -1261,10 +1414,10 @@ void R_StudioSetupBones( cl_entity_t *e )
 			if( pseqdesc->numblends == 4 )
 			{
 				panim += m_pStudioHeader->numbones;
-				R_StudioCalcRotations( e, pos3, q3, pseqdesc, panim, e->latched.prevframe );
+				R_StudioCalcRotations( e, m_pStudioHeader, pos3, q3, pseqdesc, panim, e->latched.prevframe );
 
 				panim += m_pStudioHeader->numbones;
-				R_StudioCalcRotations( e, pos4, q4, pseqdesc, panim, e->latched.prevframe );
+				R_StudioCalcRotations( e, m_pStudioHeader, pos4, q4, pseqdesc, panim, e->latched.prevframe );
 
 				s = (e->latched.prevseqblending[0]) / 255.0f;
 				R_StudioSlerpBones( m_pStudioHeader->numbones, q3, pos3, q4, pos4, s );
@@ -1296,7 +1449,7 @@ void R_StudioSetupBones( cl_entity_t *e )
 		pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pPlayerInfo->gaitsequence;
 
 		panim = R_StudioGetAnim( m_pStudioHeader, RI.currentmodel, pseqdesc );
-		R_StudioCalcRotations( e, pos2, q2, pseqdesc, panim, m_pPlayerInfo->gaitframe );
+		R_StudioCalcRotations( e, m_pStudioHeader, scratch->pos2, scratch->q2, pseqdesc, panim, m_pPlayerInfo->gaitframe );
 
 		for( i = 0; i < m_pStudioHeader->numbones; i++ )
 		{
@@ -1307,8 +1460,8 @@ void R_StudioSetupBones( cl_entity_t *e )
 
 			if( !copy_bones ) continue;
 
-			VectorCopy( pos2[i], pos[i] );
-			Vector4Copy( q2[i], q[i] );
+			VectorCopy( scratch->pos2[i], pos[i] );
+			Vector4Copy( scratch->q2[i], q[i] );
 		}
 	}
 
@@ -3609,6 +3762,109 @@ void R_DrawStudioModel( cl_entity_t *e )
 	}
 }
 
+/*
+=================
+R_StudioPoseJob
+=================
+*/
+static void R_StudioPoseJob( void *data, int index, int thread )
+{
+	studioposejob_t	*job = (studioposejob_t *)data + index;
+
+	R_StudioCalcPose( job->ent, job->phdr, job->pseqdesc, job->panim, job->frame, &g_studioscratch[thread], job->pose->pos, job->pose->q );
+}
+
+/*
+=================
+R_StudioAddPoseJob
+
+everything that may touch the filesystem
+or the zone is done here on the main thread
+=================
+*/
+static void R_StudioAddPoseJob( cl_entity_t *e )
+{
+	mstudioseqdesc_t	*pseqdesc;
+	studioposejob_t	*job;
+	studiopose_t	*pose;
+	studioposekey_t	key;
+	studiohdr_t	*phdr;
+	float		f;
+
+	if( !e || !e->model || e->model->type != mod_studio )
+		return;
+
+	// players, corpses and attached models are set up by other paths
+	if( e->player || e->curstate.renderfx == kRenderFxDeadPlayer || e->curstate.movetype == MOVETYPE_FOLLOW )
+		return;
+
+	phdr = (studiohdr_t *)Mod_StudioExtradata( e->model );
+	if( !phdr || phdr->numbones <= 0 || phdr->numbodyparts == 0 )
+		return;
+
+	if( e->curstate.sequence >= phdr->numseq )
+		e->curstate.sequence = 0;
+
+	pseqdesc = (mstudioseqdesc_t *)((byte *)phdr + phdr->seqindex) + e->curstate.sequence;
+	f = R_StudioEstimateFrame( e, pseqdesc );
+
+	R_StudioPoseKey( &key, e, phdr, f );
+	pose = R_StudioPoseSlot( e );
+
+	// already valid or claimed by another entity in this pass
+	if( pose->batch == g_studiopose.batch || !memcmp( &pose->key, &key, sizeof( key )))
+		return;
+
+	job = &g_studiopose.jobs[g_studiopose.numjobs++];
+	job->ent = e;
+	job->phdr = phdr;
+	job->pseqdesc = pseqdesc;
+	job->panim = R_StudioGetAnim( phdr, e->model, pseqdesc );
+	job->frame = f;
+	job->pose = pose;
+
+	pose->batch = g_studiopose.batch;
+	pose->key = key;
+}
+
+/*
+=================
+R_PrepareStudioBones
+
+compute sequence poses of all visible
+studiomodels on the job threads, the draw
+pass will pick them up from the pose cache
+=================
+*/
+void R_PrepareStudioBones( void )
+{
+	int	i;
+
+	if( !r_studio_posecache.value || !r_studio_bonejobs.value )
+		return;
+
+	if( Sys_JobThreads() <= 1 || FBitSet( RI.params, RP_ENVVIEW ))
+		return;
+
+	// client.dll have its own bone setup
+	if( RI.drawWorld && pStudioDraw->StudioDrawModel != R_StudioDrawModel )
+		return;
+
+	R_StudioSetupTimings();
+
+	g_studiopose.numjobs = 0;
+	g_studiopose.batch++;
+
+	for( i = 0; i < tr.draw_list->num_solid_entities; i++ )
+		R_StudioAddPoseJob( tr.draw_list->solid_entities[i] );
+
+	for( i = 0; i < tr.draw_list->num_trans_entities; i++ )
+		R_StudioAddPoseJob( tr.draw_list->trans_entities[i] );
+
+	if( g_studiopose.numjobs > 0 )
+		Sys_ParallelFor( R_StudioPoseJob, g_studiopose.jobs, g_studiopose.numjobs );
+}
+
 /*
 =================
 R_RunViewmodelEvents
@@ -40,6 +40,8 @@ convar_t	*gl_showtextures;
 convar_t	*gl_detailscale;
 convar_t	*gl_check_errors;
 convar_t	*gl_round_down;
+convar_t	*gl_texture_cache;
+convar_t	*gl_texture_cache_size;
 convar_t	*gl_polyoffset;
 convar_t	*gl_wireframe;
 convar_t	*gl_finish;
@@ -292,6 +294,17 @@ static dllfunc_t texture3dextfuncs[] =
 { NULL					, NULL }
 };
 
+static dllfunc_t pixelbufferfuncs[] =
+{
+{ "glBindBufferARB"				, (void **)&pglBindBufferARB },
+{ "glDeleteBuffersARB"			, (void **)&pglDeleteBuffersARB },
+{ "glGenBuffersARB"				, (void **)&pglGenBuffersARB },
+{ "glMapBufferARB"				, (void **)&pglMapBufferARB },
+{ "glUnmapBufferARB"			, (void **)&pglUnmapBufferARB },
+{ "glBufferDataARB"				, (void **)&pglBufferDataARB },
+{ NULL					, NULL }
+};
+
 static dllfunc_t texturecompressionfuncs[] =
 {
 { "glCompressedTexImage3DARB"			, (void **)&pglCompressedTexImage3DARB },
@@ -1619,6 +1632,8 @@ void GL_InitCommands( void )
 	gl_test = Cvar_Get( "gl_test", "0", 0, "engine developer cvar for quick testing new features" );
 	gl_wireframe = Cvar_Get( "gl_wireframe", "0", FCVAR_ARCHIVE|FCVAR_SPONLY, "show wireframe overlay" );
 	gl_round_down = Cvar_Get( "gl_round_down", "2", FCVAR_RENDERINFO, "round texture sizes to nearest POT value" );
+	gl_texture_cache = Cvar_Get( "gl_texture_cache", "1", FCVAR_ARCHIVE, "keep processed textures with mipmaps on disk to speed up loading" );
+	gl_texture_cache_size = Cvar_Get( "gl_texture_cache_size", "512", FCVAR_ARCHIVE, "texture cache size limit in megabytes, oldest textures are deleted on exit, 0 is unlimited" );
 	gl_msaa = Cvar_Get( "gl_msaa", "1", FCVAR_ARCHIVE, "enable multi sample anti-aliasing" );
 
 	// these cvar not used by engine but some mods requires this
@@ -1634,6 +1649,8 @@ void GL_InitCommands( void )
 	vid_displayfrequency = Cvar_Get ( "vid_displayfrequency", "0", FCVAR_RENDERINFO|FCVAR_VIDRESTART, "fullscreen refresh rate" );
 
 	Cmd_AddCommand( "r_info", R_RenderInfo_f, "display renderer info" );
+	Cmd_AddCommand( "lightmap_profile", R_LightmapProfiling_f, "lightmap kernels stress-test, first argument is passes count" );
+	Cmd_AddCommand( "decal_profile", R_DecalProfiling_f, "decal placement stress-test, first argument is decals count" );
 
 	// give initial OpenGL configuration
 	host.apply_opengl_config = true;
@@ -1654,6 +1671,7 @@ GL_RemoveCommands
 void GL_RemoveCommands( void )
 {
 	Cmd_RemoveCommand( "r_info");
+	Cmd_RemoveCommand( "lightmap_profile" );
 }
 
 /*
@@ -1769,6 +1787,7 @@ void GL_InitExtensions( void )
 		pglGetFloatv( GL_MAX_TEXTURE_LOD_BIAS_EXT, &glConfig.max_texture_lod_bias );
 
 	GL_CheckExtension( "GL_ARB_texture_border_clamp", NULL, NULL, GL_CLAMP_TEXBORDER_EXT );
+	GL_CheckExtension( "GL_ARB_pixel_buffer_object", pixelbufferfuncs, "gl_pixel_buffer_object", GL_ARB_PIXEL_BUFFER_OBJECT );
 
 	GL_CheckExtension( "GL_ARB_depth_texture", NULL, NULL, GL_DEPTH_TEXTURE );
 	GL_CheckExtension( "GL_ARB_texture_float", NULL, "gl_texture_float", GL_ARB_TEXTURE_FLOAT_EXT );
@@ -1867,6 +1886,7 @@ qboolean R_Init( void )
 	R_SpriteInit();
 	R_StudioInit();
 	R_AliasInit();
+	R_InitRenderKernels();
 	R_ClearDecals();
 	R_ClearScene();
 
@@ -1899,6 +1919,7 @@ void R_Shutdown( void )
 
 	GL_RemoveCommands();
 	R_ShutdownImages();
+	GL_FreeLightmapBuffers();
 
 	Mem_FreePool( &r_temppool );
 
@@ -32,6 +32,8 @@ dll_info_t dsound_dll = { "dsound.dll", dsound_funcs, false };
 #define SAMPLE_16BIT_SHIFT		1
 #define SECONDARY_BUFFER_SIZE		0x10000
 
+#define SND_DUMPFILE		"snddump.wav"
+
 typedef enum
 {
 	SIS_SUCCESS,
@@ -39,10 +41,25 @@ typedef enum
 	SIS_NOTAVAIL
 } si_state_t;
 
+typedef enum
+{
+	SND_DEVICE_DSOUND = 0,
+	SND_DEVICE_NULL,		// no output, clocked by the system timer
+	SND_DEVICE_FILE,		// same as null but mixed samples are written into the wav
+} snd_device_t;
+
 static qboolean		snd_firsttime = true;
 static qboolean		primary_format_set;
 static HWND		snd_hwnd;
 
+// memory devices (null and file)
+static snd_device_t		snd_device;
+static short		snd_membuffer[SECONDARY_BUFFER_SIZE / 2];
+static double		snd_memstarttime;
+static file_t		*snd_dumpfile;
+static int		snd_dumptime;	// paintedtime that was written into the file
+static int		snd_dumpsize;	// bytes of sound data
+
 /* 
 =======================================================================
 Global variables. Must be visible to window-procedure function 
@@ -293,6 +310,122 @@ si_state_t SNDDMA_InitDirect( void *hInst )
 	return SIS_SUCCESS;
 }
 
+/*
+==================
+SNDDMA_WriteDumpHeader
+
+16-bit stereo pcm wave header
+==================
+*/
+static void SNDDMA_WriteDumpHeader( void )
+{
+	int	rate = SOUND_DMA_SPEED;
+	int	byterate = SOUND_DMA_SPEED * 4;
+	int	riffsize = snd_dumpsize + 36;
+	int	fmtsize = 16;
+	short	format = 1, numchannels = 2;
+	short	blockalign = 4, bits = 16;
+
+	FS_Seek( snd_dumpfile, 0, SEEK_SET );
+	FS_Write( snd_dumpfile, "RIFF", 4 );
+	FS_Write( snd_dumpfile, &riffsize, 4 );
+	FS_Write( snd_dumpfile, "WAVEfmt ", 8 );
+	FS_Write( snd_dumpfile, &fmtsize, 4 );
+	FS_Write( snd_dumpfile, &format, 2 );
+	FS_Write( snd_dumpfile, &numchannels, 2 );
+	FS_Write( snd_dumpfile, &rate, 4 );
+	FS_Write( snd_dumpfile, &byterate, 4 );
+	FS_Write( snd_dumpfile, &blockalign, 2 );
+	FS_Write( snd_dumpfile, &bits, 2 );
+	FS_Write( snd_dumpfile, "data", 4 );
+	FS_Write( snd_dumpfile, &snd_dumpsize, 4 );
+	FS_Seek( snd_dumpfile, 0, SEEK_END );
+}
+
+/*
+==================
+SNDDMA_WriteDump
+
+append all samples painted since last call
+==================
+*/
+static void SNDDMA_WriteDump( void )
+{
+	int	fullsamples = dma.samples >> 1;
+	int	pos, count;
+
+	// paintedtime was chopped
+	if( paintedtime < snd_dumptime )
+		snd_dumptime = paintedtime;
+
+	// mixer was outrun the buffer, older samples are lost
+	if( paintedtime - snd_dumptime > fullsamples )
+		snd_dumptime = paintedtime - fullsamples;
+
+	while( snd_dumptime < paintedtime )
+	{
+		pos = snd_dumptime & ( fullsamples - 1 );
+		count = Q_min( paintedtime - snd_dumptime, fullsamples - pos );
+
+		FS_Write( snd_dumpfile, snd_membuffer + ( pos << 1 ), count << 2 );
+		snd_dumpsize += count << 2;
+		snd_dumptime += count;
+	}
+}
+
+/*
+==================
+SNDDMA_FlushDump
+
+game thread: mixer thread never touches the disk,
+so the samples it has painted are written from here.
+caller must hold the raw channels lock
+==================
+*/
+void SNDDMA_FlushDump( void )
+{
+	if( snd_device == SND_DEVICE_DSOUND || !snd_dumpfile )
+		return;
+
+	SNDDMA_WriteDump();
+}
+
+/*
+==================
+SNDDMA_InitMemory
+
+output device without hardware, for dedicated
+boxes and mixer benchmarks
+==================
+*/
+static qboolean SNDDMA_InitMemory( snd_device_t device )
+{
+	snd_device = device;
+	memset( snd_membuffer, 0, sizeof( snd_membuffer ));
+	snd_memstarttime = Sys_DoubleTime();
+	dma.samples = SECONDARY_BUFFER_SIZE / 2;
+	dma.buffer = (byte *)snd_membuffer;
+
+	if( device == SND_DEVICE_FILE )
+	{
+		snd_dumpfile = FS_Open( SND_DUMPFILE, "wb", false );
+
+		if( !snd_dumpfile )
+		{
+			Con_Printf( S_ERROR "Audio: couldn't write %s\n", SND_DUMPFILE );
+			snd_device = SND_DEVICE_DSOUND;
+			return false;
+		}
+
+		snd_dumptime = 0;
+		snd_dumpsize = 0;
+		SNDDMA_WriteDumpHeader();
+		Con_Printf( "Audio: writing mixer output into %s\n", SND_DUMPFILE );
+	}
+
+	return true;
+}
+
 /*
 ==================
 SNDDMA_Init
@@ -303,14 +436,31 @@ Returns false if nothing is found.
 */
 int SNDDMA_Init( void *hInst )
 {
+	char	device[32];
+
 	// already initialized
 	if( dma.initialized ) return true;
 
 	memset( &dma, 0, sizeof( dma ));
 
-	// init DirectSound
-	if( SNDDMA_InitDirect( hInst ) != SIS_SUCCESS )
+	if( !Sys_GetParmFromCmdLine( "-snddevice", device ))
+		device[0] = '\0';
+
+	if( !Q_stricmp( device, "null" ))
+	{
+		if( !SNDDMA_InitMemory( SND_DEVICE_NULL ))
+			return false;
+	}
+	else if( !Q_stricmp( device, "file" ))
+	{
+		if( !SNDDMA_InitMemory( SND_DEVICE_FILE ))
+			return false;
+	}
+	else if( SNDDMA_InitDirect( hInst ) != SIS_SUCCESS )
+	{
+		// init DirectSound
 		return false;
+	}
 	dma.initialized = true;
 	snd_firsttime = false;
 
@@ -334,6 +484,13 @@ int SNDDMA_GetDMAPos( void )
 
 	if( !dma.initialized )
 		return 0;
+
+	if( snd_device != SND_DEVICE_DSOUND )
+	{
+		// stereo samples played since init
+		s = (int)fmod(( Sys_DoubleTime() - snd_memstarttime ) * SOUND_DMA_SPEED, dma.samples >> 1 );
+		return s << 1;
+	}
 	
 	mmtime.wType = TIME_SAMPLES;
 	pDSBuf->lpVtbl->GetCurrentPosition( pDSBuf, &mmtime.u.sample, &dwWrite );
@@ -373,7 +530,10 @@ int SNDDMA_GetSoundtime( void )
 			// time to chop things off to avoid 32 bit limits
 			buffers = 0;
 			paintedtime = fullsamples;
-			S_StopAllSounds( true );
+
+			if( S_OnMixerThread( ))
+				S_MixerTimeWrapped();
+			else S_StopAllSounds( true );
 		}
 	}
 
@@ -397,10 +557,14 @@ void SNDDMA_BeginPainting( void )
 	HRESULT	hr;
 	DWORD	dwStatus;
 
+	// memory buffer is always valid
+	if( snd_device != SND_DEVICE_DSOUND )
+		return;
+
 	if( !pDSBuf ) return;
 
 	// if the buffer was lost or stopped, restore it and/or restart it
-	if( pDSBuf->lpVtbl->GetStatus( pDSBuf, &dwStatus ) != DS_OK )
+	if( pDSBuf->lpVtbl->GetStatus( pDSBuf, &dwStatus ) != DS_OK && !S_OnMixerThread( ))
 		Con_DPrintf( S_ERROR "BeginPainting: couldn't get sound buffer status\n" );
 	
 	if( dwStatus & DSBSTATUS_BUFFERLOST )
@@ -417,6 +581,13 @@ void SNDDMA_BeginPainting( void )
 	{
 		if( hr != DSERR_BUFFERLOST )
 		{
+			// mixer thread just skips the pass, game thread will shutdown sound
+			if( S_OnMixerThread( ))
+			{
+				S_MixerDeviceLost();
+				return;
+			}
+
 			Con_DPrintf( S_ERROR "BeginPainting: %s\n", DSoundError( hr ));
 			S_Shutdown ();
 			return;
@@ -439,6 +610,15 @@ Also unlocks the dsound buffer
 void SNDDMA_Submit( void )
 {
 	if( !dma.buffer ) return;
+
+	if( snd_device != SND_DEVICE_DSOUND )
+	{
+		// mixer thread leaves it for SNDDMA_FlushDump
+		if( snd_dumpfile && !S_OnMixerThread( ))
+			SNDDMA_WriteDump();
+		return;
+	}
+
 	// unlock the dsound buffer
 	if( pDSBuf ) pDSBuf->lpVtbl->Unlock( pDSBuf, dma.buffer, locksize, NULL, 0 );
 }
@@ -454,9 +634,44 @@ void SNDDMA_Shutdown( void )
 {
 	if( !dma.initialized ) return;
 	dma.initialized = false;
+
+	if( snd_dumpfile )
+	{
+		// mixer thread is already stopped, write the rest
+		SNDDMA_WriteDump();
+		SNDDMA_WriteDumpHeader();
+		FS_Close( snd_dumpfile );
+		snd_dumpfile = NULL;
+	}
+
+	if( snd_device != SND_DEVICE_DSOUND )
+	{
+		snd_device = SND_DEVICE_DSOUND;
+		dma.buffer = NULL;
+		return;
+	}
+
 	SNDDMA_FreeSound();
 }
 
+/*
+==============
+SNDDMA_DeviceName
+==============
+*/
+const char *SNDDMA_DeviceName( void )
+{
+	switch( snd_device )
+	{
+	case SND_DEVICE_NULL:
+		return "null device";
+	case SND_DEVICE_FILE:
+		return "file device (" SND_DUMPFILE ")";
+	default:
+		return "DirectSound";
+	}
+}
+
 /*
 ===========
 S_Activate
@@ -474,7 +689,12 @@ void S_Activate( qboolean active, void *hInst )
 	if( !pDS || !snd_hwnd )
 		return;
 
+	// mixer must not hold the buffer lock
+	S_MixerPause();
+
 	if( active )
 		DS_CreateBuffers( snd_hwnd );
 	else DS_DestroyBuffers();
+
+	S_MixerResume();
 }
\ No newline at end of file
@@ -777,7 +777,7 @@ void DSP_Process( int idsp, portable_samplepair_t *pbfront, int sampleCount )
 		return;
 
 	// don't process DSP while in menu
-	if( cls.key_dest == key_menu || !sampleCount )
+	if( s_mixstate.menu || !sampleCount )
 		return;
 
 	// preset is already installed by CheckNewDspPresets
@@ -811,6 +811,8 @@ CheckNewDspPresets
 */
 void CheckNewDspPresets( void )
 {
+	qboolean	reallocate;
+
 	if( dsp_off->value != 0.0f )
 		return;
 
@@ -850,9 +852,15 @@ void CheckNewDspPresets( void )
 
 	room_typeprev = idsp_room;
 
+	// delay lines will be reallocated, keep the mixer thread away
+	reallocate = FBitSet( sxrvb_size->flags|sxdly_delay->flags|sxste_delay->flags, FCVAR_CHANGED ) ? true : false;
+	if( reallocate ) S_MixerPause();
+
 	RVB_CheckNewReverbVal( );
 	DLY_CheckNewDelayVal( );
 	DLY_CheckNewStereoDelayVal();
+
+	if( reallocate ) S_MixerResume();
 }
 
 /*
@@ -880,6 +888,9 @@ void SX_Profiling_f( void )
 		testbuffer[i].right = COM_RandomLong( 0, 3000 );
 	}
 
+	// dsp state is shared with the mixer
+	S_MixerPause();
+
 	if( Cmd_Argc() > 1 )
 	{
 		Cvar_SetValue( "room_type", Q_atof( Cmd_Argv( 1 )));
@@ -904,4 +915,6 @@ void SX_Profiling_f( void )
 		SX_ReloadRoomFX();
 		CheckNewDspPresets();
 	}
+
+	S_MixerResume();
 }
\ No newline at end of file
@@ -137,6 +137,10 @@ wavdata_t *S_LoadSound( sfx_t *sfx )
 	if( !COM_CheckString( sfx->name ))
 		return NULL;
 
+	// mixer thread never loads anything
+	if( S_OnMixerThread( ))
+		return NULL;
+
 	// load it from disk
 	if( Q_stricmp( sfx->name, "*default" ))
 	{
@@ -299,7 +303,9 @@ void S_EndRegistration( void )
 
 	if( !s_registering || !dma.initialized )
 		return;
-	
+
+	S_MixerPause();
+
 	// free any sounds not from this registration sequence
 	for( i = 0, sfx = s_knownSfx; i < s_numSfx; i++, sfx++ )
 	{
@@ -310,6 +316,8 @@ void S_EndRegistration( void )
 			S_FreeSound( sfx ); // don't need this sound
 	}
 
+	S_MixerResume();
+
 	// load everything in
 	for( i = 0, sfx = s_knownSfx; i < s_numSfx; i++, sfx++ )
 	{
@@ -396,6 +404,8 @@ void S_FreeSounds( void )
 	if( !dma.initialized )
 		return;
 
+	S_MixerPause();
+
 	// stop all sounds
 	S_StopAllSounds( true );
 
@@ -407,4 +417,6 @@ void S_FreeSounds( void )
 	memset( s_sfxHashList, 0, sizeof( s_sfxHashList ));
 
 	s_numSfx = 0;
+
+	S_MixerResume();
 }
\ No newline at end of file
@@ -142,6 +142,7 @@ void S_FreeChannel( channel_t *ch )
 	ch->name[0] = '\0';
 	ch->use_loop = false;
 	ch->isSentence = false;
+	ch->serial = 0;
 
 	// clear mixer
 	memset( &ch->pMixer, 0, sizeof( ch->pMixer ));
@@ -1441,6 +1442,8 @@ rawchan_t *S_FindRawChannel( int entnum, qboolean create )
 	best_time = 0x7fffffff;
 	best = free = -1;
 
+	S_LockRawChannels();
+
 	for( i = 0; i < MAX_RAW_CHANNELS; i++ )
 	{
 		ch = raw_channels[i];
@@ -1455,7 +1458,10 @@ rawchan_t *S_FindRawChannel( int entnum, qboolean create )
 
 			// exact match
 			if( ch->entnum == entnum )
+			{
+				S_UnlockRawChannels();
 				return ch;
+			}
 
 			time = ch->s_rawend - paintedtime;
 			if( time < best_time )
@@ -1466,11 +1472,16 @@ rawchan_t *S_FindRawChannel( int entnum, qboolean create )
 		}
 	}
 
+	S_UnlockRawChannels();
+
 	if( !create ) return NULL;
 
 	if( free >= 0 ) best = free;
 	if( best < 0 ) return NULL; // no free slots
 
+	// mixer thread must not see half-initialized channel
+	S_MixerPause();
+
 	if( !raw_channels[best] )
 	{
 		raw_samples = MAX_RAW_SAMPLES;
@@ -1482,6 +1493,8 @@ rawchan_t *S_FindRawChannel( int entnum, qboolean create )
 	ch->entnum = entnum;
 	ch->s_rawend = 0;
 
+	S_MixerResume();
+
 	return ch;
 }
 
@@ -1568,8 +1581,11 @@ static void S_RawEntSamples( int entnum, uint samples, uint rate, word width, wo
 
 	ch->master_vol = snd_vol;
 	ch->dist_mult = (ATTN_NONE / SND_CLIP_DISTANCE);
+
+	S_LockRawChannels();
 	ch->s_rawend = S_RawSamplesStereo( ch->rawsamples, ch->s_rawend, ch->max_samples, samples, rate, width, channels, data );
 	ch->leftvol = ch->rightvol = snd_vol;
+	S_UnlockRawChannels();
 }
 
 /*
@@ -1600,6 +1616,7 @@ void S_StreamAviSamples( void *Avi, int entnum, float fvol, float attn, float sy
 	float	duration = 0.0f;
 	int	r, fileBytes;
 	rawchan_t	*ch = NULL;
+	int	time;
 
 	if( !dma.initialized || s_listener.paused || !CL_IsInGame( ))
 		return;
@@ -1620,19 +1637,22 @@ void S_StreamAviSamples( void *Avi, int entnum, float fvol, float attn, float sy
 	ch->dist_mult = (attn / SND_CLIP_DISTANCE);
 
 	// see how many samples should be copied into the raw buffer
-	if( ch->s_rawend < soundtime )
-		ch->s_rawend = soundtime;
+	S_LockRawChannels();
+	time = soundtime;
+	if( ch->s_rawend < time )
+		ch->s_rawend = time;
+	S_UnlockRawChannels();
 
 	// position is changed, synchronization is lost etc
 	if( fabs( ch->oldtime - synctime ) > s_mixahead->value )
 		ch->sound_info.loopStart = AVI_TimeToSoundPosition( Avi, synctime * 1000 );
 	ch->oldtime = synctime; // keep actual time
 
-	while( ch->s_rawend < soundtime + ch->max_samples )
+	while( ch->s_rawend < time + ch->max_samples )
 	{
 		wavdata_t	*info = &ch->sound_info;
 
-		bufferSamples = ch->max_samples - (ch->s_rawend - soundtime);
+		bufferSamples = ch->max_samples - (ch->s_rawend - time);
 
 		// decide how much data needs to be read from the file
 		fileSamples = bufferSamples * ((float)info->rate / SOUND_DMA_SPEED );
@@ -1660,8 +1680,10 @@ void S_StreamAviSamples( void *Avi, int entnum, float fvol, float attn, float sy
 		if( r > 0 )
 		{
 			// add to raw buffer
+			S_LockRawChannels();
 			ch->s_rawend = S_RawSamplesStereo( ch->rawsamples, ch->s_rawend, ch->max_samples,
 			fileSamples, info->rate, info->width, info->channels, raw );
+			S_UnlockRawChannels();
 		}
 		else break; // no more samples for this frame
 	}
@@ -1675,11 +1697,16 @@ S_GetRawSamplesLength
 uint S_GetRawSamplesLength( int entnum ) 
 {
 	rawchan_t	*ch;
+	uint	length;
 
 	if( !( ch = S_FindRawChannel( entnum, false )))
 		return 0;
 
-	return ch->s_rawend <= paintedtime ? 0 : (float)(ch->s_rawend - paintedtime) * DMA_MSEC_PER_SAMPLE;
+	S_LockRawChannels();
+	length = ch->s_rawend <= paintedtime ? 0 : (float)(ch->s_rawend - paintedtime) * DMA_MSEC_PER_SAMPLE;
+	S_UnlockRawChannels();
+
+	return length;
 }
 
 /*
@@ -1694,7 +1721,9 @@ void S_ClearRawChannel( int entnum )
 	if( !( ch = S_FindRawChannel( entnum, false )))
 		return;
 
+	S_LockRawChannels();
 	ch->s_rawend = 0;
+	S_UnlockRawChannels();
 }
 
 /*
@@ -1706,7 +1735,7 @@ Free raw channel that have been idling for too long.
 */
 static void S_FreeIdleRawChannels( void )
 {
-	int	i;
+	int	i, idle;
 
 	for( i = 0; i < MAX_RAW_CHANNELS; i++ )
 	{
@@ -1714,12 +1743,17 @@ static void S_FreeIdleRawChannels( void )
 
 		if( !ch ) continue;
 
-		if( ch->s_rawend >= paintedtime )
-			continue;
+		// the lock must be released before pausing the mixer
+		S_LockRawChannels();
+		idle = ( ch->s_rawend < paintedtime && ( paintedtime - ch->s_rawend ) / SOUND_DMA_SPEED >= S_RAW_SOUND_IDLE_SEC );
+		S_UnlockRawChannels();
 
-		if(( paintedtime - ch->s_rawend ) / SOUND_DMA_SPEED >= S_RAW_SOUND_IDLE_SEC )
+		if( idle )
 		{
+			// wait for the mixer to leave the channel
+			S_MixerPause();
 			raw_channels[i] = NULL;
+			S_MixerResume();
 			Mem_Free( ch );
 		}
 	}
@@ -1751,7 +1785,11 @@ S_SpatializeRawChannels
 */
 static void S_SpatializeRawChannels( void )
 {
-	int	i;
+	int	i, time;
+
+	S_LockRawChannels();
+	time = paintedtime;
+	S_UnlockRawChannels();
 	
 	for( i = 0; i < MAX_RAW_CHANNELS; i++ )
 	{
@@ -1761,7 +1799,7 @@ static void S_SpatializeRawChannels( void )
 
 		if( !ch ) continue;
 
-		if( ch->s_rawend < paintedtime )
+		if( ch->s_rawend < time )
 		{
 			ch->leftvol = ch->rightvol = 0;
 			continue;
@@ -1875,6 +1913,11 @@ void S_StopAllSounds( qboolean ambient )
 	int	i;
 
 	if( !dma.initialized ) return;
+
+	// mixer thread must drop its own copies too
+	S_MixerPause();
+	S_MixerResetChannels();
+
 	total_channels = MAX_DYNAMIC_CHANNELS;	// no statics
 
 	for( i = 0; i < MAX_CHANNELS; i++ ) 
@@ -1895,6 +1938,8 @@ void S_StopAllSounds( qboolean ambient )
 
 	// clear any remaining soundfade
 	memset( &soundfade, 0, sizeof( soundfade ));
+
+	S_MixerResume();
 }
 
 //=============================================================================
@@ -1908,7 +1953,9 @@ void S_UpdateChannels( void )
 	if( !dma.buffer ) return;
 
 	// updates DMA time
+	S_LockRawChannels();
 	soundtime = SNDDMA_GetSoundtime();
+	S_UnlockRawChannels();
 
 	// soundtime - total samples that have been played out to hardware at dmaspeed
 	// paintedtime - total samples that have been mixed at speed
@@ -1940,7 +1987,9 @@ Don't let sound skip if going slow
 */
 void S_ExtraUpdate( void )
 {
-	if( !dma.initialized ) return;
+	// mixer thread doesn't care about slow frames
+	if( !dma.initialized || S_MixerThreaded( ))
+		return;
 	S_UpdateChannels ();
 }
 
@@ -1976,6 +2025,12 @@ void SND_UpdateSound( void )
 
 	if( !dma.initialized ) return;
 
+	// grab playback positions from the mixer thread
+	S_MixerSync();
+
+	// mixer thread has lost the device
+	if( !dma.initialized ) return;
+
 	// if the loading plaque is up, clear everything
 	// out to make sure we aren't looping a dirty
 	// dma buffer while loading
@@ -2086,8 +2141,16 @@ void SND_UpdateSound( void )
 	S_StreamBackgroundTrack ();
 	S_StreamSoundTrack ();
 
+	// room presets may reallocate the delay lines,
+	// so never do it from the mixer thread
+	CheckNewDspPresets ();
+
+	// send this frame changes to the mixer
+	S_MixerPublish ();
+
 	// mix some sound
-	S_UpdateChannels ();
+	if( !S_MixerThreaded( ))
+		S_UpdateChannels ();
 }
 
 /*
@@ -2249,13 +2312,14 @@ S_SoundInfo_f
 */
 void S_SoundInfo_f( void )
 {
-	Con_Printf( "Audio: DirectSound\n" );
+	Con_Printf( "Audio: %s\n", SNDDMA_DeviceName( ));
 	Con_Printf( "%5d channel(s)\n", 2 );
 	Con_Printf( "%5d samples\n", dma.samples );
 	Con_Printf( "%5d bits/sample\n", 16 );
 	Con_Printf( "%5d bytes/sec\n", SOUND_DMA_SPEED );
 	Con_Printf( "%5d total_channels\n", total_channels );
 
+	S_MixerInfo ();
 	S_PrintBackgroundTrackState ();
 }
 
@@ -2302,6 +2366,7 @@ qboolean S_Init( void )
 	Cmd_AddCommand( "-voicerecord", Cmd_Null_f, "stop voice recording (non-implemented)" );
 	Cmd_AddCommand( "spk", S_SayReliable_f, "reliable play a specified sententce" );
 	Cmd_AddCommand( "speak", S_Say_f, "playing a specified sententce" );
+	Cmd_AddCommand( "mix_profile", S_MixProfiling_f, "mixer kernels stress-test, first argument is passes count" );
 
 	if( !SNDDMA_Init( host.hWnd ))
 	{
@@ -2319,9 +2384,11 @@ qboolean S_Init( void )
 	MIX_InitAllPaintbuffers ();
 	SX_Init ();
 	S_InitScaletable ();
+	S_InitMixKernels ();
 	S_StopAllSounds ( true );
 	S_InitSounds ();
 	VOX_Init ();
+	S_InitMixerThread ();
 
 	return true;
 }
@@ -2344,7 +2411,9 @@ void S_Shutdown( void )
 	Cmd_RemoveCommand( "-voicerecord" );
 	Cmd_RemoveCommand( "speak" );
 	Cmd_RemoveCommand( "spk" );
+	Cmd_RemoveCommand( "mix_profile" );
 
+	S_ShutdownMixerThread ();
 	S_StopAllSounds (false);
 	S_FreeRawChannels ();
 	S_FreeSounds ();
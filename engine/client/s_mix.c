@@ -25,12 +25,6 @@ GNU General Public License for more details.
 #define FILTERTYPE_LINEAR	1
 #define FILTERTYPE_CUBIC	2
 
-#define CCHANVOLUMES	2
-
-#define SND_SCALE_BITS	7
-#define SND_SCALE_SHIFT	(8 - SND_SCALE_BITS)
-#define SND_SCALE_LEVELS	(1 << SND_SCALE_BITS)
-
 portable_samplepair_t	*g_curpaintbuffer;
 portable_samplepair_t	streambuffer[(PAINTBUFFER_SIZE+1)];
 portable_samplepair_t	paintbuffer[(PAINTBUFFER_SIZE+1)];
@@ -62,7 +56,7 @@ void S_TransferPaintBuffer( int endtime )
 {
 	int	*snd_p, snd_linear_count;
 	int	lpos, lpaintedtime;
-	int	i, val, sampleMask;
+	int	sampleMask;
 	short	*snd_out;
 	dword	*pbuf;
 
@@ -85,21 +79,7 @@ void S_TransferPaintBuffer( int endtime )
 		snd_linear_count <<= 1;
 
 		// write a linear blast of samples
-		for( i = 0; i < snd_linear_count; i += 2 )
-		{
-			val = (snd_p[i+0] * 256) >> 8;
-
-			if( val > 0x7fff ) snd_out[i+0] = 0x7fff;
-			else if( val < (short)0x8000 )
-				snd_out[i+0] = (short)0x8000;
-			else snd_out[i+0] = val;
-
-			val = (snd_p[i+1] * 256) >> 8;
-			if( val > 0x7fff ) snd_out[i+1] = 0x7fff;
-			else if( val < (short)0x8000 )
-				snd_out[i+1] = (short)0x8000;
-			else snd_out[i+1] = val;
-		}
+		mixkernels.TransferStereo16( snd_out, snd_p, snd_linear_count );
 
 		snd_p += snd_linear_count;
 		lpaintedtime += (snd_linear_count >> 1);
@@ -214,184 +194,10 @@ CHANNEL MIXING
 
 ===============================================================================
 */
-void S_PaintMonoFrom8( portable_samplepair_t *pbuf, int *volume, byte *pData, int outCount )
-{
-	int	*lscale, *rscale;
-	int 	i, data;
-		
-	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
-	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
-
-	for( i = 0; i < outCount; i++ )
-	{
-		data = pData[i];
-		pbuf[i].left += lscale[data];
-		pbuf[i].right += rscale[data];
-	}
-}
-
-void S_PaintStereoFrom8( portable_samplepair_t *pbuf, int *volume, byte *pData, int outCount )
-{
-	int	*lscale, *rscale;
-	uint	left, right;
-	word	*data;
-	int	i;
-
-	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
-	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
-	data = (word *)pData;
-
-	for( i = 0; i < outCount; i++, data++ )
-	{
-		left = (byte)((*data & 0x00FF));
-		right = (byte)((*data & 0xFF00) >> 8);
-		pbuf[i].left += lscale[left];
-		pbuf[i].right += rscale[right];
-	}
-}
-
-void S_PaintMonoFrom16( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount )
-{
-	int	left, right;
-	int	i, data;
-
-	for( i = 0; i < outCount; i++ )
-	{
-		data = pData[i];
-		left = ( data * volume[0]) >> 8;
-		right = (data * volume[1]) >> 8;
-		pbuf[i].left += left;
-		pbuf[i].right += right;
-	}
-}
-
-void S_PaintStereoFrom16( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount )
-{
-	uint	*data;
-	int	left, right;
-	int	i;
-
-	data = (uint *)pData;
-		
-	for( i = 0; i < outCount; i++, data++ )
-	{
-		left = (signed short)((*data & 0x0000FFFF));
-		right = (signed short)((*data & 0xFFFF0000) >> 16);
-
-		left =  (left * volume[0]) >> 8;
-		right = (right * volume[1]) >> 8;
-
-		pbuf[i].left += left;
-		pbuf[i].right += right;
-	}
-}
-
 void S_Mix8MonoTimeCompress( portable_samplepair_t *pbuf, int *volume, byte *pData, int inputOffset, uint rateScale, int outCount, int timecompress )
 {
 }
 
-void S_Mix8Mono( portable_samplepair_t *pbuf, int *volume, byte *pData, int inputOffset, uint rateScale, int outCount, int timecompress )
-{
-	int	i, sampleIndex = 0;
-	uint	sampleFrac = inputOffset;
-	int	*lscale, *rscale;
-
-	if( timecompress != 0 )
-	{
-		S_Mix8MonoTimeCompress( pbuf, volume, pData, inputOffset, rateScale, outCount, timecompress );
-//		return;
-	}
-
-	// Not using pitch shift?
-	if( rateScale == FIX( 1 ))
-	{
-		S_PaintMonoFrom8( pbuf, volume, pData, outCount );
-		return;
-	}
-
-	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
-	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
-
-	for( i = 0; i < outCount; i++ )
-	{
-		pbuf[i].left += lscale[pData[sampleIndex]];
-		pbuf[i].right += rscale[pData[sampleIndex]];
-		sampleFrac += rateScale;
-		sampleIndex += FIX_INTPART( sampleFrac );
-		sampleFrac = FIX_FRACPART( sampleFrac );
-	}
-}
-
-void S_Mix8Stereo( portable_samplepair_t *pbuf, int *volume, byte *pData, int inputOffset, uint rateScale, int outCount )
-{
-	int	i, sampleIndex = 0;
-	uint	sampleFrac = inputOffset;
-	int	*lscale, *rscale;
-
-	// Not using pitch shift?
-	if( rateScale == FIX( 1 ))
-	{
-		S_PaintStereoFrom8( pbuf, volume, pData, outCount );
-		return;
-	}
-
-	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
-	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
-
-	for( i = 0; i < outCount; i++ )
-	{
-		pbuf[i].left += lscale[pData[sampleIndex+0]];
-		pbuf[i].right += rscale[pData[sampleIndex+1]];
-		sampleFrac += rateScale;
-		sampleIndex += FIX_INTPART( sampleFrac )<<1;
-		sampleFrac = FIX_FRACPART( sampleFrac );
-	}
-}
-
-void S_Mix16Mono( portable_samplepair_t *pbuf, int *volume, short *pData, int inputOffset, uint rateScale, int outCount )
-{
-	int	i, sampleIndex = 0;
-	uint	sampleFrac = inputOffset;
-
-	// Not using pitch shift?
-	if( rateScale == FIX( 1 ))
-	{
-		S_PaintMonoFrom16( pbuf, volume, pData, outCount );
-		return;
-	}
-
-	for( i = 0; i < outCount; i++ )
-	{
-		pbuf[i].left += (volume[0] * (int)( pData[sampleIndex] ))>>8;
-		pbuf[i].right += (volume[1] * (int)( pData[sampleIndex] ))>>8;
-		sampleFrac += rateScale;
-		sampleIndex += FIX_INTPART( sampleFrac );
-		sampleFrac = FIX_FRACPART( sampleFrac );
-	}
-}
-
-void S_Mix16Stereo( portable_samplepair_t *pbuf, int *volume, short *pData, int inputOffset, uint rateScale, int outCount )
-{
-	int	i, sampleIndex = 0;
-	uint	sampleFrac = inputOffset;
-
-	// Not using pitch shift?
-	if( rateScale == FIX( 1 ))
-	{
-		S_PaintStereoFrom16( pbuf, volume, pData, outCount );
-		return;
-	}
-
-	for( i = 0; i < outCount; i++ )
-	{
-		pbuf[i].left += (volume[0] * (int)( pData[sampleIndex+0] ))>>8;
-		pbuf[i].right += (volume[1] * (int)( pData[sampleIndex+1] ))>>8;
-		sampleFrac += rateScale;
-		sampleIndex += FIX_INTPART(sampleFrac)<<1;
-		sampleFrac = FIX_FRACPART(sampleFrac);
-	}
-}
-
 void S_MixChannel( channel_t *pChannel, void *pData, int outputOffset, int inputOffset, uint fracRate, int outCount, int timecompress )
 {
 	int			pvol[CCHANVOLUMES];
@@ -408,14 +214,18 @@ void S_MixChannel( channel_t *pChannel, void *pData, int outputOffset, int input
 	if( pSource->channels == 1 )
 	{
 		if( pSource->width == 1 )
-			S_Mix8Mono( pbuf, pvol, (char *)pData, inputOffset, fracRate, outCount, timecompress );
-		else S_Mix16Mono( pbuf, pvol, (short *)pData, inputOffset, fracRate, outCount );
+		{
+			if( timecompress != 0 )
+				S_Mix8MonoTimeCompress( pbuf, pvol, (byte *)pData, inputOffset, fracRate, outCount, timecompress );
+			mixkernels.MixMono8( pbuf, pvol, (byte *)pData, inputOffset, fracRate, outCount );
+		}
+		else mixkernels.MixMono16( pbuf, pvol, (short *)pData, inputOffset, fracRate, outCount );
 	}
 	else
 	{
 		if( pSource->width == 1 )
-			S_Mix8Stereo( pbuf, pvol, (char *)pData, inputOffset, fracRate, outCount );
-		else S_Mix16Stereo( pbuf, pvol, (short *)pData, inputOffset, fracRate, outCount );
+			mixkernels.MixStereo8( pbuf, pvol, (byte *)pData, inputOffset, fracRate, outCount );
+		else mixkernels.MixStereo16( pbuf, pvol, (short *)pData, inputOffset, fracRate, outCount );
 	}
 }
 
@@ -535,10 +345,11 @@ void MIX_MixChannelsToPaintbuffer( int endtime, int rate, int outputRate )
 	channel_t *ch;
 	wavdata_t	*pSource;
 	int	i, sampleCount;
+	int	numChannels;
 	qboolean	bZeroVolume;
 
 	// mix each channel into paintbuffer
-	ch = channels;
+	numChannels = S_MixerChannels( &ch );
 	
 	// validate parameters
 	Assert( outputRate <= SOUND_DMA_SPEED );
@@ -551,29 +362,29 @@ void MIX_MixChannelsToPaintbuffer( int endtime, int rate, int outputRate )
 	
 	if( sampleCount <= 0 ) return;
 
-	for( i = 0; i < total_channels; i++, ch++ )
+	for( i = 0; i < numChannels; i++, ch++ )
 	{
 		if( !ch->sfx ) continue;
 
 		// NOTE: background map is allow both type sounds: menu and game
-		if( !cl.background )
+		if( !s_mixstate.background )
 		{
-			if( cls.key_dest == key_console && ch->localsound )
+			if( s_mixstate.console && ch->localsound )
 			{
 				// play, playvol
 			}
-			else if(( s_listener.inmenu || s_listener.paused ) && !ch->localsound )
+			else if(( s_mixstate.inmenu || s_mixstate.paused ) && !ch->localsound )
 			{
 				// play only local sounds, keep pause for other
 				continue;
 			}
-			else if( !s_listener.inmenu && !s_listener.active && !ch->staticsound )
+			else if( !s_mixstate.inmenu && !s_mixstate.active && !ch->staticsound )
 			{
 				// play only ambient sounds, keep pause for other
 				continue;
 			}
 		}
-		else if( cls.key_dest == key_console )
+		else if( s_mixstate.console )
 			continue;	// silent mode in console
 
 		pSource = S_LoadSound( ch->sfx );
@@ -639,140 +450,6 @@ void MIX_MixChannelsToPaintbuffer( int endtime, int rate, int outputRate )
 	}
 }
 
-// pass in index -1...count+2, return pointer to source sample in either paintbuffer or delay buffer
-_inline portable_samplepair_t *S_GetNextpFilter( int i, portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem )
-{
-	// The delay buffer is assumed to precede the paintbuffer by 6 duplicated samples
-	if( i == -1 ) return (&(pfiltermem[0]));
-	if( i == 0 ) return (&(pfiltermem[1]));
-	if( i == 1 ) return (&(pfiltermem[2]));
-
-	// return from paintbuffer, where samples are doubled.  
-	// even samples are to be replaced with interpolated value.
-	return (&(pbuffer[(i-2) * 2 + 1]));
-}
-
-// pass forward over passed in buffer and cubic interpolate all odd samples
-// pbuffer: buffer to filter (in place)
-// prevfilter:  filter memory. NOTE: this must match the filtertype ie: filtercubic[] for FILTERTYPE_CUBIC
-// if NULL then perform no filtering.
-// count: how many samples to upsample. will become count*2 samples in buffer, in place.
-
-void S_Interpolate2xCubic( portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem, int cfltmem, int count )
-{
-
-// implement cubic interpolation on 2x upsampled buffer.   Effectively delays buffer contents by 2 samples.
-// pbuffer: contains samples at 0, 2, 4, 6...
-// temppaintbuffer is temp buffer, same size as paintbuffer, used to store processed values
-// count: number of samples to process in buffer ie: how many samples at 0, 2, 4, 6...
-
-// finpos is the fractional, inpos the integer part.
-//		finpos = 0.5 for upsampling by 2x
-//		inpos is the position of the sample
-
-//		xm1 = x [inpos - 1];
-//		x0 = x [inpos + 0];
-//		x1 = x [inpos + 1];
-//		x2 = x [inpos + 2];
-//		a = (3 * (x0-x1) - xm1 + x2) / 2;
-//		b = 2*x1 + xm1 - (5*x0 + x2) / 2;
-//		c = (x1 - xm1) / 2;
-//		y [outpos] = (((a * finpos) + b) * finpos + c) * finpos + x0;
-
-	int i, upCount = count << 1;
-	int a, b, c;
-	int xm1, x0, x1, x2;
-	portable_samplepair_t *psamp0;
-	portable_samplepair_t *psamp1;
-	portable_samplepair_t *psamp2;
-	portable_samplepair_t *psamp3;
-	int outpos = 0;
-
-	Assert( upCount <= PAINTBUFFER_SIZE );
-
-	// pfiltermem holds 6 samples from previous buffer pass
-	// process 'count' samples
-	for( i = 0; i < count; i++)
-	{
-		// get source sample pointer
-		psamp0 = S_GetNextpFilter( i-1, pbuffer, pfiltermem );
-		psamp1 = S_GetNextpFilter( i+0, pbuffer, pfiltermem );
-		psamp2 = S_GetNextpFilter( i+1, pbuffer, pfiltermem );
-		psamp3 = S_GetNextpFilter( i+2, pbuffer, pfiltermem );
-
-		// write out original sample to interpolation buffer
-		temppaintbuffer[outpos++] = *psamp1;
-
-		// get all left samples for interpolation window
-		xm1 = psamp0->left;
-		x0 = psamp1->left;
-		x1 = psamp2->left;
-		x2 = psamp3->left;
-		
-		// interpolate
-		a = (3 * (x0-x1) - xm1 + x2) / 2;
-		b = 2*x1 + xm1 - (5*x0 + x2) / 2;
-		c = (x1 - xm1) / 2;
-		
-		// write out interpolated sample
-		temppaintbuffer[outpos].left = a/8 + b/4 + c/2 + x0;
-		
-		// get all right samples for window
-		xm1 = psamp0->right;
-		x0 = psamp1->right;
-		x1 = psamp2->right;
-		x2 = psamp3->right;
-		
-		// interpolate
-		a = (3 * (x0-x1) - xm1 + x2) / 2;
-		b = 2*x1 + xm1 - (5*x0 + x2) / 2;
-		c = (x1 - xm1) / 2;
-		
-		// write out interpolated sample, increment output counter
-		temppaintbuffer[outpos++].right = a/8 + b/4 + c/2 + x0;
-		
-		Assert( outpos <= ( sizeof( temppaintbuffer ) / sizeof( temppaintbuffer[0] )));
-	}
-	
-	Assert( cfltmem >= 3 );
-
-	// save last 3 samples from paintbuffer
-	pfiltermem[0] = pbuffer[upCount - 5];
-	pfiltermem[1] = pbuffer[upCount - 3];
-	pfiltermem[2] = pbuffer[upCount - 1];
-
-	// copy temppaintbuffer back into paintbuffer
-	for( i = 0; i < upCount; i++ )
-		pbuffer[i] = temppaintbuffer[i];
-}
-
-// pass forward over passed in buffer and linearly interpolate all odd samples
-// pbuffer: buffer to filter (in place)
-// prevfilter:  filter memory. NOTE: this must match the filtertype ie: filterlinear[] for FILTERTYPE_LINEAR
-// if NULL then perform no filtering.
-// count: how many samples to upsample. will become count*2 samples in buffer, in place.
-void S_Interpolate2xLinear( portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem, int cfltmem, int count )
-{
-	int	i, upCount = count<<1;
-
-	Assert( upCount <= PAINTBUFFER_SIZE );
-	Assert( cfltmem >= 1 );
-
-	// use interpolation value from previous mix
-	pbuffer[0].left = (pfiltermem->left + pbuffer[0].left) >> 1;
-	pbuffer[0].right = (pfiltermem->right + pbuffer[0].right) >> 1;
-
-	for( i = 2; i < upCount; i += 2 )
-	{
-		// use linear interpolation for upsampling
-		pbuffer[i].left = (pbuffer[i].left + pbuffer[i-1].left) >> 1;
-		pbuffer[i].right = (pbuffer[i].right + pbuffer[i-1].right) >> 1;
-	}
-
-	// save last value to be played out in buffer
-	*pfiltermem = pbuffer[upCount - 1]; 
-}
-
 // upsample by 2x, optionally using interpolation
 // count: how many samples to upsample. will become count*2 samples in buffer, in place.
 // pbuffer: buffer to upsample into (in place)
@@ -782,15 +459,10 @@ void S_Interpolate2xLinear( portable_samplepair_t *pbuffer, portable_samplepair_
 // filtertype: FILTERTYPE_NONE, _LINEAR, _CUBIC etc.  Must match prevfilter.
 void S_MixBufferUpsample2x( int count, portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem, int cfltmem, int filtertype )
 {
-	int	upCount = count<<1;
-	int	i, j;	
+	Assert(( count << 1 ) <= PAINTBUFFER_SIZE );
 
 	// reverse through buffer, duplicating contents for 'count' samples
-	for( i = upCount - 1, j = count - 1; j >= 0; i-=2, j-- )
-	{	
-		pbuffer[i] = pbuffer[j];
-		pbuffer[i-1] = pbuffer[j];
-	}
+	mixkernels.Upsample2x( pbuffer, count );
 
 	if( !s_lerping->value ) return;
 	
@@ -798,10 +470,12 @@ void S_MixBufferUpsample2x( int count, portable_samplepair_t *pbuffer, portable_
 	switch( filtertype )
 	{
 	case FILTERTYPE_LINEAR:
-		S_Interpolate2xLinear( pbuffer, pfiltermem, cfltmem, count );
+		Assert( cfltmem >= 1 );
+		mixkernels.Interpolate2xLinear( pbuffer, pfiltermem, count );
 		break;
 	case FILTERTYPE_CUBIC:
-		S_Interpolate2xCubic( pbuffer, pfiltermem, cfltmem, count );
+		Assert( cfltmem >= 3 );
+		mixkernels.Interpolate2xCubic( pbuffer, pfiltermem, count );
 		break;
 	default:	// no filter
 		break;
@@ -838,7 +512,7 @@ void MIX_ClearAllPaintBuffers( int SampleCount, qboolean clearFilters )
 void MIX_MixPaintbuffers( int ibuf1, int ibuf2, int ibuf3, int count, float fgain )
 {
 	portable_samplepair_t	*pbuf1, *pbuf2, *pbuf3;
-	int			i, gain;
+	int			gain;
 
 	gain = 256 * fgain;
 	
@@ -859,29 +533,15 @@ void MIX_MixPaintbuffers( int ibuf1, int ibuf2, int ibuf3, int count, float fgai
 	// pb1 (4ch->2ch) + pb2 (4ch->2ch)	-> pb3 2ch
 
 	// mix front channels
-	for( i = 0; i < count; i++ )
-	{
-		pbuf3[i].left = pbuf1[i].left;
-		pbuf3[i].right = pbuf1[i].right;
-		pbuf3[i].left += (pbuf2[i].left * gain) >> 8;
-		pbuf3[i].right += (pbuf2[i].right * gain) >> 8;
-	}
+	mixkernels.MixPaintbuffers( pbuf3, pbuf1, pbuf2, count, gain );
 }
 
 void MIX_CompressPaintbuffer( int ipaint, int count )
 {
-	portable_samplepair_t	*pbuf;
 	paintbuffer_t		*ppaint;
-	int			i;
 
 	ppaint = MIX_GetPPaintFromIPaint( ipaint );
-	pbuf = ppaint->pbuf;
-	
-	for( i = 0; i < count; i++, pbuf++ )
-	{
-		pbuf->left = CLIP( pbuf->left );
-		pbuf->right = CLIP( pbuf->right );
-	}
+	mixkernels.ClipPaintbuffer( ppaint->pbuf, count );
 }
 
 void S_MixUpsample( int sampleCount, int filtertype )
@@ -903,10 +563,12 @@ void MIX_MixStreamBuffer( int end )
 	rawchan_t			*ch;
 
 	pbuf = MIX_GetPFrontFromIPaint( ISTREAMBUFFER );
+
+	S_LockRawChannels();
 	ch = S_FindRawChannel( S_RAW_SOUND_BACKGROUNDTRACK, false );
 
 	// clear the paint buffer
-	if( s_listener.paused || !ch || ch->s_rawend < paintedtime )
+	if( s_mixstate.paused || !ch || ch->s_rawend < paintedtime )
 	{
 		memset( pbuf, 0, (end - paintedtime) * sizeof( portable_samplepair_t ));
 	}
@@ -926,6 +588,7 @@ void MIX_MixStreamBuffer( int end )
 		for( ; i < end; i++ )
 			pbuf[i-paintedtime].left = pbuf[i-paintedtime].right = 0;
 	}
+	S_UnlockRawChannels();
 }
 
 void MIX_MixRawSamplesBuffer( int end )
@@ -935,7 +598,9 @@ void MIX_MixRawSamplesBuffer( int end )
 
 	pbuf = MIX_GetCurrentPaintbufferPtr()->pbuf;
 
-	if( s_listener.paused ) return;
+	if( s_mixstate.paused ) return;
+
+	S_LockRawChannels();
 
 	// paint in the raw channels
 	for( i = 0; i < MAX_RAW_CHANNELS; i++ )
@@ -959,6 +624,8 @@ void MIX_MixRawSamplesBuffer( int end )
 			pbuf[j-paintedtime].right += ( ch->rawsamples[j & ( ch->max_samples - 1 )].right * ch->rightvol ) >> 8;
 		}
 	}
+
+	S_UnlockRawChannels();
 }
 
 // upsample and mix sounds into final 44khz versions of:
@@ -1019,8 +686,6 @@ void MIX_PaintChannels( int endtime )
 	int	end, count;
 	float	dsp_room_gain;
 
-	CheckNewDspPresets();
-
 	// get dsp preset gain values, update gain crossfaders,
 	// used when mixing dsp processed buffers into paintbuffer
 	dsp_room_gain = DSP_GetGain( idsp_room );	// update crossfader - gain only used in MIX_ScaleChannelVolume
@@ -1056,7 +721,10 @@ void MIX_PaintChannels( int endtime )
 		MIX_SetCurrentPaintbuffer( IPAINTBUFFER );
 
 		// transfer out according to DMA format
+		// game thread reads paintedtime and the file device buffer
+		S_LockRawChannels();
 		S_TransferPaintBuffer( end );
 		paintedtime = end;
+		S_UnlockRawChannels();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,891 @@
+/*
+s_simd.c - sound mixing kernels
+Copyright (C) 2018 Uncle Mike
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "sound.h"
+#include "client.h"
+
+#ifdef XASH_SSE2
+#include <emmintrin.h>
+#endif
+
+mixkernels_t	mixkernels;
+
+/*
+=============================================================================
+
+	REFERENCE KERNELS
+
+	all other kernels must produce exactly the same output
+=============================================================================
+*/
+static void S_MixMono8_Ref( portable_samplepair_t *pbuf, const int *volume, const byte *pData, int inputOffset, uint rateScale, int outCount )
+{
+	int	i, sampleIndex = 0;
+	uint	sampleFrac = inputOffset;
+	int	*lscale, *rscale;
+
+	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
+	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
+
+	// Not using pitch shift?
+	if( rateScale == FIX( 1 ))
+	{
+		for( i = 0; i < outCount; i++ )
+		{
+			pbuf[i].left += lscale[pData[i]];
+			pbuf[i].right += rscale[pData[i]];
+		}
+		return;
+	}
+
+	for( i = 0; i < outCount; i++ )
+	{
+		pbuf[i].left += lscale[pData[sampleIndex]];
+		pbuf[i].right += rscale[pData[sampleIndex]];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac );
+		sampleFrac = FIX_FRACPART( sampleFrac );
+	}
+}
+
+static void S_MixStereo8_Ref( portable_samplepair_t *pbuf, const int *volume, const byte *pData, int inputOffset, uint rateScale, int outCount )
+{
+	int	i, sampleIndex = 0;
+	uint	sampleFrac = inputOffset;
+	int	*lscale, *rscale;
+
+	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
+	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
+
+	// Not using pitch shift?
+	if( rateScale == FIX( 1 ))
+	{
+		for( i = 0; i < outCount; i++, pData += 2 )
+		{
+			pbuf[i].left += lscale[pData[0]];
+			pbuf[i].right += rscale[pData[1]];
+		}
+		return;
+	}
+
+	for( i = 0; i < outCount; i++ )
+	{
+		pbuf[i].left += lscale[pData[sampleIndex+0]];
+		pbuf[i].right += rscale[pData[sampleIndex+1]];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac )<<1;
+		sampleFrac = FIX_FRACPART( sampleFrac );
+	}
+}
+
+static void S_MixMono16_Ref( portable_samplepair_t *pbuf, const int *volume, const short *pData, int inputOffset, uint rateScale, int outCount )
+{
+	int	i, sampleIndex = 0;
+	uint	sampleFrac = inputOffset;
+
+	// Not using pitch shift?
+	if( rateScale == FIX( 1 ))
+	{
+		for( i = 0; i < outCount; i++ )
+		{
+			pbuf[i].left += ( pData[i] * volume[0] ) >> 8;
+			pbuf[i].right += ( pData[i] * volume[1] ) >> 8;
+		}
+		return;
+	}
+
+	for( i = 0; i < outCount; i++ )
+	{
+		pbuf[i].left += (volume[0] * (int)( pData[sampleIndex] ))>>8;
+		pbuf[i].right += (volume[1] * (int)( pData[sampleIndex] ))>>8;
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac );
+		sampleFrac = FIX_FRACPART( sampleFrac );
+	}
+}
+
+static void S_MixStereo16_Ref( portable_samplepair_t *pbuf, const int *volume, const short *pData, int inputOffset, uint rateScale, int outCount )
+{
+	int	i, sampleIndex = 0;
+	uint	sampleFrac = inputOffset;
+
+	// Not using pitch shift?
+	if( rateScale == FIX( 1 ))
+	{
+		for( i = 0; i < outCount; i++, pData += 2 )
+		{
+			pbuf[i].left += ( pData[0] * volume[0] ) >> 8;
+			pbuf[i].right += ( pData[1] * volume[1] ) >> 8;
+		}
+		return;
+	}
+
+	for( i = 0; i < outCount; i++ )
+	{
+		pbuf[i].left += (volume[0] * (int)( pData[sampleIndex+0] ))>>8;
+		pbuf[i].right += (volume[1] * (int)( pData[sampleIndex+1] ))>>8;
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART(sampleFrac)<<1;
+		sampleFrac = FIX_FRACPART(sampleFrac);
+	}
+}
+
+static void S_MixPaintbuffers_Ref( portable_samplepair_t *pbuf3, const portable_samplepair_t *pbuf1, const portable_samplepair_t *pbuf2, int count, int gain )
+{
+	int	i;
+
+	for( i = 0; i < count; i++ )
+	{
+		pbuf3[i].left = pbuf1[i].left + ((pbuf2[i].left * gain) >> 8);
+		pbuf3[i].right = pbuf1[i].right + ((pbuf2[i].right * gain) >> 8);
+	}
+}
+
+static void S_ClipPaintbuffer_Ref( portable_samplepair_t *pbuf, int count )
+{
+	int	i;
+
+	for( i = 0; i < count; i++, pbuf++ )
+	{
+		pbuf->left = CLIP( pbuf->left );
+		pbuf->right = CLIP( pbuf->right );
+	}
+}
+
+static void S_TransferStereo16_Ref( short *snd_out, const int *snd_p, int count )
+{
+	int	i, val;
+
+	for( i = 0; i < count; i++ )
+	{
+		val = (snd_p[i] * 256) >> 8;
+
+		if( val > 0x7fff ) snd_out[i] = 0x7fff;
+		else if( val < (short)0x8000 )
+			snd_out[i] = (short)0x8000;
+		else snd_out[i] = val;
+	}
+}
+
+static void S_Upsample2x_Ref( portable_samplepair_t *pbuffer, int count )
+{
+	int	i, j;
+
+	// reverse through buffer, duplicating contents for 'count' samples
+	for( i = (count << 1) - 1, j = count - 1; j >= 0; i -= 2, j-- )
+	{
+		pbuffer[i] = pbuffer[j];
+		pbuffer[i-1] = pbuffer[j];
+	}
+}
+
+static void S_Interpolate2xLinear_Ref( portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem, int count )
+{
+	int	i, upCount = count<<1;
+
+	// use interpolation value from previous mix
+	pbuffer[0].left = (pfiltermem->left + pbuffer[0].left) >> 1;
+	pbuffer[0].right = (pfiltermem->right + pbuffer[0].right) >> 1;
+
+	for( i = 2; i < upCount; i += 2 )
+	{
+		// use linear interpolation for upsampling
+		pbuffer[i].left = (pbuffer[i].left + pbuffer[i-1].left) >> 1;
+		pbuffer[i].right = (pbuffer[i].right + pbuffer[i-1].right) >> 1;
+	}
+
+	// save last value to be played out in buffer
+	*pfiltermem = pbuffer[upCount - 1];
+}
+
+// pass in index -1...count+2, return pointer to source sample in either paintbuffer or delay buffer
+_inline portable_samplepair_t *S_GetNextpFilter( int i, portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem )
+{
+	// The delay buffer is assumed to precede the paintbuffer by 6 duplicated samples
+	if( i == -1 ) return (&(pfiltermem[0]));
+	if( i == 0 ) return (&(pfiltermem[1]));
+	if( i == 1 ) return (&(pfiltermem[2]));
+
+	// return from paintbuffer, where samples are doubled.
+	// even samples are to be replaced with interpolated value.
+	return (&(pbuffer[(i-2) * 2 + 1]));
+}
+
+// implement cubic interpolation on 2x upsampled buffer.   Effectively delays buffer contents by 2 samples.
+// out: receives original sample 'i' and the interpolated one
+//
+// finpos is the fractional, inpos the integer part.
+//		finpos = 0.5 for upsampling by 2x
+//		inpos is the position of the sample
+//
+//		xm1 = x [inpos - 1];
+//		x0 = x [inpos + 0];
+//		x1 = x [inpos + 1];
+//		x2 = x [inpos + 2];
+//		a = (3 * (x0-x1) - xm1 + x2) / 2;
+//		b = 2*x1 + xm1 - (5*x0 + x2) / 2;
+//		c = (x1 - xm1) / 2;
+//		y [outpos] = (((a * finpos) + b) * finpos + c) * finpos + x0;
+static void S_Interpolate2xCubicSample( portable_samplepair_t *out, portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem, int i )
+{
+	portable_samplepair_t	*psamp0;
+	portable_samplepair_t	*psamp1;
+	portable_samplepair_t	*psamp2;
+	portable_samplepair_t	*psamp3;
+	int			xm1, x0, x1, x2;
+	int			a, b, c;
+
+	// get source sample pointer
+	psamp0 = S_GetNextpFilter( i-1, pbuffer, pfiltermem );
+	psamp1 = S_GetNextpFilter( i+0, pbuffer, pfiltermem );
+	psamp2 = S_GetNextpFilter( i+1, pbuffer, pfiltermem );
+	psamp3 = S_GetNextpFilter( i+2, pbuffer, pfiltermem );
+
+	// write out original sample to interpolation buffer
+	out[0] = *psamp1;
+
+	// get all left samples for interpolation window
+	xm1 = psamp0->left;
+	x0 = psamp1->left;
+	x1 = psamp2->left;
+	x2 = psamp3->left;
+
+	// interpolate
+	a = (3 * (x0-x1) - xm1 + x2) / 2;
+	b = 2*x1 + xm1 - (5*x0 + x2) / 2;
+	c = (x1 - xm1) / 2;
+
+	// write out interpolated sample
+	out[1].left = a/8 + b/4 + c/2 + x0;
+
+	// get all right samples for window
+	xm1 = psamp0->right;
+	x0 = psamp1->right;
+	x1 = psamp2->right;
+	x2 = psamp3->right;
+
+	// interpolate
+	a = (3 * (x0-x1) - xm1 + x2) / 2;
+	b = 2*x1 + xm1 - (5*x0 + x2) / 2;
+	c = (x1 - xm1) / 2;
+
+	// write out interpolated sample
+	out[1].right = a/8 + b/4 + c/2 + x0;
+}
+
+static void S_Interpolate2xCubic_Ref( portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem, int count )
+{
+	int	i, upCount = count << 1;
+
+	// pfiltermem holds 3 samples from previous buffer pass
+	for( i = 0; i < count; i++ )
+		S_Interpolate2xCubicSample( &temppaintbuffer[i<<1], pbuffer, pfiltermem, i );
+
+	// save last 3 samples from paintbuffer
+	pfiltermem[0] = pbuffer[upCount - 5];
+	pfiltermem[1] = pbuffer[upCount - 3];
+	pfiltermem[2] = pbuffer[upCount - 1];
+
+	// copy temppaintbuffer back into paintbuffer
+	for( i = 0; i < upCount; i++ )
+		pbuffer[i] = temppaintbuffer[i];
+}
+
+static const mixkernels_t mix_kernels_ref =
+{
+	"reference",
+	S_MixMono8_Ref,
+	S_MixStereo8_Ref,
+	S_MixMono16_Ref,
+	S_MixStereo16_Ref,
+	S_MixPaintbuffers_Ref,
+	S_ClipPaintbuffer_Ref,
+	S_TransferStereo16_Ref,
+	S_Upsample2x_Ref,
+	S_Interpolate2xLinear_Ref,
+	S_Interpolate2xCubic_Ref,
+};
+
+#ifdef XASH_SSE2
+/*
+=============================================================================
+
+	SSE2 KERNELS
+
+	channel mixers work on four frames at once. Samples are widened
+	to 16-bit words in the low half of each dword, so _mm_madd_epi16
+	gives the exact sample * volume product. 8-bit scaletable is
+	(signed char)sample * (volume & ~1) so it's computed inplace.
+	Pitch shifted channels gather the samples with scalar stepping
+=============================================================================
+*/
+// signed division by power of two that rounds toward zero like C does
+#define DIV_POW2_SSE2( x, k )	_mm_srai_epi32( _mm_add_epi32( x, _mm_srli_epi32( _mm_srai_epi32( x, 31 ), 32 - (k) )), k )
+
+// add four frames of widened samples into the paintbuffer
+_inline void S_MixFrames_SSE2( portable_samplepair_t *pbuf, __m128i samples, __m128i vol, __m128i shift )
+{
+	__m128i	zero = _mm_setzero_si128();
+	__m128i	lo, hi;
+
+	lo = _mm_sra_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( samples, zero ), vol ), shift );
+	hi = _mm_sra_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( samples, zero ), vol ), shift );
+	_mm_storeu_si128( (__m128i *)pbuf + 0, _mm_add_epi32( _mm_loadu_si128( (__m128i *)pbuf + 0 ), lo ));
+	_mm_storeu_si128( (__m128i *)pbuf + 1, _mm_add_epi32( _mm_loadu_si128( (__m128i *)pbuf + 1 ), hi ));
+}
+
+static void S_MixMono8_SSE2( portable_samplepair_t *pbuf, const int *volume, const byte *pData, int inputOffset, uint rateScale, int outCount )
+{
+	int	i, s0, s1, s2, s3, sampleIndex = 0;
+	uint	sampleFrac = inputOffset;
+	__m128i	vol, shift, s;
+
+	vol = _mm_setr_epi32( volume[0] & ~1, volume[1] & ~1, volume[0] & ~1, volume[1] & ~1 );
+	shift = _mm_setzero_si128();
+
+	if( rateScale == FIX( 1 ))
+	{
+		for( i = 0; i + 4 <= outCount; i += 4 )
+		{
+			s = _mm_cvtsi32_si128( *(const int *)( pData + i ));
+			s = _mm_srai_epi16( _mm_unpacklo_epi8( s, s ), 8 );
+			S_MixFrames_SSE2( pbuf + i, _mm_unpacklo_epi16( s, s ), vol, shift );
+		}
+		S_MixMono8_Ref( pbuf + i, volume, pData + i, 0, rateScale, outCount - i );
+		return;
+	}
+
+	for( i = 0; i + 4 <= outCount; i += 4 )
+	{
+		s0 = (signed char)pData[sampleIndex];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac );
+		sampleFrac = FIX_FRACPART( sampleFrac );
+		s1 = (signed char)pData[sampleIndex];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac );
+		sampleFrac = FIX_FRACPART( sampleFrac );
+		s2 = (signed char)pData[sampleIndex];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac );
+		sampleFrac = FIX_FRACPART( sampleFrac );
+		s3 = (signed char)pData[sampleIndex];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac );
+		sampleFrac = FIX_FRACPART( sampleFrac );
+
+		s = _mm_setr_epi16( s0, s0, s1, s1, s2, s2, s3, s3 );
+		S_MixFrames_SSE2( pbuf + i, s, vol, shift );
+	}
+
+	S_MixMono8_Ref( pbuf + i, volume, pData + sampleIndex, sampleFrac, rateScale, outCount - i );
+}
+
+static void S_MixStereo8_SSE2( portable_samplepair_t *pbuf, const int *volume, const byte *pData, int inputOffset, uint rateScale, int outCount )
+{
+	int	i, l0, r0, l1, r1, l2, r2, l3, r3, sampleIndex = 0;
+	uint	sampleFrac = inputOffset;
+	__m128i	vol, shift, s;
+
+	vol = _mm_setr_epi32( volume[0] & ~1, volume[1] & ~1, volume[0] & ~1, volume[1] & ~1 );
+	shift = _mm_setzero_si128();
+
+	if( rateScale == FIX( 1 ))
+	{
+		for( i = 0; i + 4 <= outCount; i += 4 )
+		{
+			s = _mm_loadl_epi64( (const __m128i *)( pData + ( i << 1 )));
+			S_MixFrames_SSE2( pbuf + i, _mm_srai_epi16( _mm_unpacklo_epi8( s, s ), 8 ), vol, shift );
+		}
+		S_MixStereo8_Ref( pbuf + i, volume, pData + ( i << 1 ), 0, rateScale, outCount - i );
+		return;
+	}
+
+	for( i = 0; i + 4 <= outCount; i += 4 )
+	{
+		l0 = (signed char)pData[sampleIndex+0];
+		r0 = (signed char)pData[sampleIndex+1];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac )<<1;
+		sampleFrac = FIX_FRACPART( sampleFrac );
+		l1 = (signed char)pData[sampleIndex+0];
+		r1 = (signed char)pData[sampleIndex+1];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac )<<1;
+		sampleFrac = FIX_FRACPART( sampleFrac );
+		l2 = (signed char)pData[sampleIndex+0];
+		r2 = (signed char)pData[sampleIndex+1];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac )<<1;
+		sampleFrac = FIX_FRACPART( sampleFrac );
+		l3 = (signed char)pData[sampleIndex+0];
+		r3 = (signed char)pData[sampleIndex+1];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac )<<1;
+		sampleFrac = FIX_FRACPART( sampleFrac );
+
+		s = _mm_setr_epi16( l0, r0, l1, r1, l2, r2, l3, r3 );
+		S_MixFrames_SSE2( pbuf + i, s, vol, shift );
+	}
+
+	S_MixStereo8_Ref( pbuf + i, volume, pData + sampleIndex, sampleFrac, rateScale, outCount - i );
+}
+
+static void S_MixMono16_SSE2( portable_samplepair_t *pbuf, const int *volume, const short *pData, int inputOffset, uint rateScale, int outCount )
+{
+	int	i, s0, s1, s2, s3, sampleIndex = 0;
+	uint	sampleFrac = inputOffset;
+	__m128i	vol, shift, s;
+
+	vol = _mm_setr_epi32( volume[0], volume[1], volume[0], volume[1] );
+	shift = _mm_cvtsi32_si128( 8 );
+
+	if( rateScale == FIX( 1 ))
+	{
+		for( i = 0; i + 4 <= outCount; i += 4 )
+		{
+			s = _mm_loadl_epi64( (const __m128i *)( pData + i ));
+			S_MixFrames_SSE2( pbuf + i, _mm_unpacklo_epi16( s, s ), vol, shift );
+		}
+		S_MixMono16_Ref( pbuf + i, volume, pData + i, 0, rateScale, outCount - i );
+		return;
+	}
+
+	for( i = 0; i + 4 <= outCount; i += 4 )
+	{
+		s0 = pData[sampleIndex];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac );
+		sampleFrac = FIX_FRACPART( sampleFrac );
+		s1 = pData[sampleIndex];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac );
+		sampleFrac = FIX_FRACPART( sampleFrac );
+		s2 = pData[sampleIndex];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac );
+		sampleFrac = FIX_FRACPART( sampleFrac );
+		s3 = pData[sampleIndex];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac );
+		sampleFrac = FIX_FRACPART( sampleFrac );
+
+		s = _mm_setr_epi16( s0, s0, s1, s1, s2, s2, s3, s3 );
+		S_MixFrames_SSE2( pbuf + i, s, vol, shift );
+	}
+
+	S_MixMono16_Ref( pbuf + i, volume, pData + sampleIndex, sampleFrac, rateScale, outCount - i );
+}
+
+static void S_MixStereo16_SSE2( portable_samplepair_t *pbuf, const int *volume, const short *pData, int inputOffset, uint rateScale, int outCount )
+{
+	int	i, l0, r0, l1, r1, l2, r2, l3, r3, sampleIndex = 0;
+	uint	sampleFrac = inputOffset;
+	__m128i	vol, shift, s;
+
+	vol = _mm_setr_epi32( volume[0], volume[1], volume[0], volume[1] );
+	shift = _mm_cvtsi32_si128( 8 );
+
+	if( rateScale == FIX( 1 ))
+	{
+		for( i = 0; i + 4 <= outCount; i += 4 )
+		{
+			s = _mm_loadu_si128( (const __m128i *)( pData + ( i << 1 )));
+			S_MixFrames_SSE2( pbuf + i, s, vol, shift );
+		}
+		S_MixStereo16_Ref( pbuf + i, volume, pData + ( i << 1 ), 0, rateScale, outCount - i );
+		return;
+	}
+
+	for( i = 0; i + 4 <= outCount; i += 4 )
+	{
+		l0 = pData[sampleIndex+0];
+		r0 = pData[sampleIndex+1];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac )<<1;
+		sampleFrac = FIX_FRACPART( sampleFrac );
+		l1 = pData[sampleIndex+0];
+		r1 = pData[sampleIndex+1];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac )<<1;
+		sampleFrac = FIX_FRACPART( sampleFrac );
+		l2 = pData[sampleIndex+0];
+		r2 = pData[sampleIndex+1];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac )<<1;
+		sampleFrac = FIX_FRACPART( sampleFrac );
+		l3 = pData[sampleIndex+0];
+		r3 = pData[sampleIndex+1];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac )<<1;
+		sampleFrac = FIX_FRACPART( sampleFrac );
+
+		s = _mm_setr_epi16( l0, r0, l1, r1, l2, r2, l3, r3 );
+		S_MixFrames_SSE2( pbuf + i, s, vol, shift );
+	}
+
+	S_MixStereo16_Ref( pbuf + i, volume, pData + sampleIndex, sampleFrac, rateScale, outCount - i );
+}
+
+static void S_MixPaintbuffers_SSE2( portable_samplepair_t *pbuf3, const portable_samplepair_t *pbuf1, const portable_samplepair_t *pbuf2, int count, int gain )
+{
+	__m128i	g, a, even, odd;
+	int	i;
+
+	g = _mm_set1_epi32( gain );
+
+	// SSE2 have no 32-bit multiply, assemble it from two pmuludq.
+	// low 32 bits of the product are the same for signed values
+	for( i = 0; i + 2 <= count; i += 2 )
+	{
+		a = _mm_loadu_si128( (const __m128i *)( pbuf2 + i ));
+		even = _mm_mul_epu32( a, g );
+		odd = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), g );
+		a = _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 )), _mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 )));
+		a = _mm_add_epi32( _mm_loadu_si128( (const __m128i *)( pbuf1 + i )), _mm_srai_epi32( a, 8 ));
+		_mm_storeu_si128( (__m128i *)( pbuf3 + i ), a );
+	}
+
+	S_MixPaintbuffers_Ref( pbuf3 + i, pbuf1 + i, pbuf2 + i, count - i, gain );
+}
+
+static void S_ClipPaintbuffer_SSE2( portable_samplepair_t *pbuf, int count )
+{
+	__m128i	minval, maxval, s;
+	int	i;
+
+	minval = _mm_set1_epi16( -32760 );
+	maxval = _mm_set1_epi16( 32760 );
+
+	for( i = 0; i + 4 <= count; i += 4 )
+	{
+		// saturate to 16 bit first, then clip to the CLIP range
+		s = _mm_packs_epi32( _mm_loadu_si128( (__m128i *)( pbuf + i ) + 0 ), _mm_loadu_si128( (__m128i *)( pbuf + i ) + 1 ));
+		s = _mm_min_epi16( _mm_max_epi16( s, minval ), maxval );
+		_mm_storeu_si128( (__m128i *)( pbuf + i ) + 0, _mm_srai_epi32( _mm_unpacklo_epi16( s, s ), 16 ));
+		_mm_storeu_si128( (__m128i *)( pbuf + i ) + 1, _mm_srai_epi32( _mm_unpackhi_epi16( s, s ), 16 ));
+	}
+
+	S_ClipPaintbuffer_Ref( pbuf + i, count - i );
+}
+
+static void S_TransferStereo16_SSE2( short *snd_out, const int *snd_p, int count )
+{
+	__m128i	a, b;
+	int	i;
+
+	for( i = 0; i + 8 <= count; i += 8 )
+	{
+		// (val * 256) >> 8 keeps the low 24 bits
+		a = _mm_srai_epi32( _mm_slli_epi32( _mm_loadu_si128( (const __m128i *)( snd_p + i ) + 0 ), 8 ), 8 );
+		b = _mm_srai_epi32( _mm_slli_epi32( _mm_loadu_si128( (const __m128i *)( snd_p + i ) + 1 ), 8 ), 8 );
+		_mm_storeu_si128( (__m128i *)( snd_out + i ), _mm_packs_epi32( a, b ));
+	}
+
+	S_TransferStereo16_Ref( snd_out + i, snd_p + i, count - i );
+}
+
+static void S_Upsample2x_SSE2( portable_samplepair_t *pbuffer, int count )
+{
+	__m128i	s;
+	int	j;
+
+	// odd count: duplicate the last sample alone
+	if( count & 1 )
+	{
+		pbuffer[(count << 1) - 1] = pbuffer[count - 1];
+		pbuffer[(count << 1) - 2] = pbuffer[count - 1];
+		count--;
+	}
+
+	// reverse through buffer, each pass reads two samples
+	// before writing four, so nothing is overwritten too early
+	for( j = count - 2; j >= 0; j -= 2 )
+	{
+		s = _mm_loadu_si128( (__m128i *)( pbuffer + j ));
+		_mm_storeu_si128( (__m128i *)( pbuffer + ( j << 1 ) + 2 ), _mm_unpackhi_epi64( s, s ));
+		_mm_storeu_si128( (__m128i *)( pbuffer + ( j << 1 ) + 0 ), _mm_unpacklo_epi64( s, s ));
+	}
+}
+
+static void S_Interpolate2xLinear_SSE2( portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem, int count )
+{
+	int	i, upCount = count<<1;
+	__m128i	a, b, s;
+
+	// use interpolation value from previous mix
+	pbuffer[0].left = (pfiltermem->left + pbuffer[0].left) >> 1;
+	pbuffer[0].right = (pfiltermem->right + pbuffer[0].right) >> 1;
+
+	// odd samples are never written, so even ones are independent
+	for( i = 2; i + 2 < upCount; i += 4 )
+	{
+		a = _mm_loadu_si128( (__m128i *)( pbuffer + i - 1 ));
+		b = _mm_loadu_si128( (__m128i *)( pbuffer + i + 1 ));
+		s = _mm_srai_epi32( _mm_add_epi32( _mm_unpackhi_epi64( a, b ), _mm_unpacklo_epi64( a, b )), 1 );
+		_mm_storel_epi64( (__m128i *)( pbuffer + i + 0 ), s );
+		_mm_storel_epi64( (__m128i *)( pbuffer + i + 2 ), _mm_unpackhi_epi64( s, s ));
+	}
+
+	for( ; i < upCount; i += 2 )
+	{
+		pbuffer[i].left = (pbuffer[i].left + pbuffer[i-1].left) >> 1;
+		pbuffer[i].right = (pbuffer[i].right + pbuffer[i-1].right) >> 1;
+	}
+
+	// save last value to be played out in buffer
+	*pfiltermem = pbuffer[upCount - 1];
+}
+
+static void S_Interpolate2xCubic_SSE2( portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem, int count )
+{
+	__m128i	p0, p1, p2, p3, p4;
+	__m128i	xm1, x0, x1, x2;
+	__m128i	a, b, c, y;
+	int	i, upCount = count << 1;
+
+	// first samples are taken from the filter memory
+	for( i = 0; i < count && i < 3; i++ )
+		S_Interpolate2xCubicSample( &temppaintbuffer[i<<1], pbuffer, pfiltermem, i );
+
+	// two output samples per pass, whole window is in the paintbuffer
+	for( ; i + 2 <= count; i += 2 )
+	{
+		p0 = _mm_loadl_epi64( (__m128i *)( pbuffer + ( i - 3 ) * 2 + 1 ));
+		p1 = _mm_loadl_epi64( (__m128i *)( pbuffer + ( i - 2 ) * 2 + 1 ));
+		p2 = _mm_loadl_epi64( (__m128i *)( pbuffer + ( i - 1 ) * 2 + 1 ));
+		p3 = _mm_loadl_epi64( (__m128i *)( pbuffer + ( i + 0 ) * 2 + 1 ));
+		p4 = _mm_loadl_epi64( (__m128i *)( pbuffer + ( i + 1 ) * 2 + 1 ));
+
+		xm1 = _mm_unpacklo_epi64( p0, p1 );
+		x0 = _mm_unpacklo_epi64( p1, p2 );
+		x1 = _mm_unpacklo_epi64( p2, p3 );
+		x2 = _mm_unpacklo_epi64( p3, p4 );
+
+		// a = (3 * (x0-x1) - xm1 + x2) / 2
+		a = _mm_sub_epi32( x0, x1 );
+		a = _mm_add_epi32( a, _mm_slli_epi32( a, 1 ));
+		a = _mm_add_epi32( _mm_sub_epi32( a, xm1 ), x2 );
+		a = DIV_POW2_SSE2( a, 1 );
+
+		// b = 2*x1 + xm1 - (5*x0 + x2) / 2
+		b = _mm_add_epi32( _mm_add_epi32( x0, _mm_slli_epi32( x0, 2 )), x2 );
+		b = _mm_sub_epi32( _mm_add_epi32( _mm_slli_epi32( x1, 1 ), xm1 ), DIV_POW2_SSE2( b, 1 ));
+
+		// c = (x1 - xm1) / 2
+		c = _mm_sub_epi32( x1, xm1 );
+		c = DIV_POW2_SSE2( c, 1 );
+
+		// y = a/8 + b/4 + c/2 + x0
+		y = _mm_add_epi32( DIV_POW2_SSE2( a, 3 ), DIV_POW2_SSE2( b, 2 ));
+		y = _mm_add_epi32( _mm_add_epi32( y, DIV_POW2_SSE2( c, 1 )), x0 );
+
+		_mm_storeu_si128( (__m128i *)( temppaintbuffer + ( i << 1 ) + 0 ), _mm_unpacklo_epi64( x0, y ));
+		_mm_storeu_si128( (__m128i *)( temppaintbuffer + ( i << 1 ) + 2 ), _mm_unpackhi_epi64( x0, y ));
+	}
+
+	for( ; i < count; i++ )
+		S_Interpolate2xCubicSample( &temppaintbuffer[i<<1], pbuffer, pfiltermem, i );
+
+	// save last 3 samples from paintbuffer
+	pfiltermem[0] = pbuffer[upCount - 5];
+	pfiltermem[1] = pbuffer[upCount - 3];
+	pfiltermem[2] = pbuffer[upCount - 1];
+
+	// copy temppaintbuffer back into paintbuffer
+	memcpy( pbuffer, temppaintbuffer, upCount * sizeof( portable_samplepair_t ));
+}
+
+static const mixkernels_t mix_kernels_sse2 =
+{
+	"SSE2",
+	S_MixMono8_SSE2,
+	S_MixStereo8_SSE2,
+	S_MixMono16_SSE2,
+	S_MixStereo16_SSE2,
+	S_MixPaintbuffers_SSE2,
+	S_ClipPaintbuffer_SSE2,
+	S_TransferStereo16_SSE2,
+	S_Upsample2x_SSE2,
+	S_Interpolate2xLinear_SSE2,
+	S_Interpolate2xCubic_SSE2,
+};
+#endif
+
+/*
+=============================================================================
+
+	KERNELS DISPATCH
+
+=============================================================================
+*/
+/*
+================
+S_InitMixKernels
+
+pick the fastest kernels for this cpu
+================
+*/
+void S_InitMixKernels( void )
+{
+	mixkernels = mix_kernels_ref;
+#ifdef XASH_SSE2
+	if( FBitSet( Sys_CPUFeatures(), CPU_SSE2 ))
+		mixkernels = mix_kernels_sse2;
+#endif
+	Con_Reportf( "Audio: using %s mixing kernels\n", mixkernels.name );
+}
+
+#define MIX_PROFILE_CHANNELS	32
+#define MIX_PROFILE_SOURCE	16384
+
+typedef struct
+{
+	int		width;
+	int		channels;
+	int		volume[CCHANVOLUMES];
+	int		inputOffset;
+	uint		rateScale;
+	const byte	*pData;
+} mixscript_t;
+
+/*
+================
+S_MixRenderScript
+
+render a scripted channel set the same way as
+MIX_PaintChannels does, from 22k channels down to DMA samples
+================
+*/
+static double S_MixRenderScript( const mixkernels_t *k, const mixscript_t *script, portable_samplepair_t *buf1, portable_samplepair_t *buf2, short *out, int passes )
+{
+	portable_samplepair_t	fltmem[2][CPAINTFILTERMEM];
+	const mixscript_t		*ch;
+	int			i, j, half = PAINTBUFFER_SIZE >> 1;
+	double			start;
+
+	start = Sys_DoubleTime();
+
+	for( i = 0; i < passes; i++ )
+	{
+		memset( fltmem, 0, sizeof( fltmem ));
+		memset( buf1, 0, ( PAINTBUFFER_SIZE + 1 ) * sizeof( portable_samplepair_t ));
+		memset( buf2, 0, ( PAINTBUFFER_SIZE + 1 ) * sizeof( portable_samplepair_t ));
+
+		for( j = 0; j < MIX_PROFILE_CHANNELS; j++ )
+		{
+			portable_samplepair_t	*pbuf = ( j & 1 ) ? buf2 : buf1;
+
+			ch = &script[j];
+
+			if( ch->channels == 1 )
+			{
+				if( ch->width == 1 )
+					k->MixMono8( pbuf, ch->volume, ch->pData, ch->inputOffset, ch->rateScale, half );
+				else k->MixMono16( pbuf, ch->volume, (short *)ch->pData, ch->inputOffset, ch->rateScale, half );
+			}
+			else
+			{
+				if( ch->width == 1 )
+					k->MixStereo8( pbuf, ch->volume, ch->pData, ch->inputOffset, ch->rateScale, half );
+				else k->MixStereo16( pbuf, ch->volume, (short *)ch->pData, ch->inputOffset, ch->rateScale, half );
+			}
+		}
+
+		k->Upsample2x( buf1, half );
+		k->Interpolate2xLinear( buf1, fltmem[0], half );
+		k->Upsample2x( buf2, half );
+		k->Interpolate2xCubic( buf2, fltmem[1], half );
+
+		k->MixPaintbuffers( buf1, buf1, buf2, PAINTBUFFER_SIZE, 200 );
+		k->ClipPaintbuffer( buf1, PAINTBUFFER_SIZE );
+		k->TransferStereo16( out, (int *)buf1, PAINTBUFFER_SIZE * 2 );
+	}
+
+	return Sys_DoubleTime() - start;
+}
+
+/*
+================
+S_MixProfiling_f
+
+compare kernels against reference and print the timings
+================
+*/
+void S_MixProfiling_f( void )
+{
+	portable_samplepair_t	*ref1, *ref2, *buf1, *buf2;
+	mixscript_t		script[MIX_PROFILE_CHANNELS];
+	short			*refout, *out;
+	byte			*src;
+	int			i, count = 200;
+	double			t1, t2;
+	qboolean			match;
+
+	if( Cmd_Argc() > 1 )
+		count = bound( 1, Q_atoi( Cmd_Argv( 1 )), 100000 );
+
+	src = Mem_Malloc( sndpool, MIX_PROFILE_SOURCE );
+	ref1 = Mem_Malloc( sndpool, ( PAINTBUFFER_SIZE + 1 ) * sizeof( portable_samplepair_t ));
+	ref2 = Mem_Malloc( sndpool, ( PAINTBUFFER_SIZE + 1 ) * sizeof( portable_samplepair_t ));
+	buf1 = Mem_Malloc( sndpool, ( PAINTBUFFER_SIZE + 1 ) * sizeof( portable_samplepair_t ));
+	buf2 = Mem_Malloc( sndpool, ( PAINTBUFFER_SIZE + 1 ) * sizeof( portable_samplepair_t ));
+	refout = Mem_Malloc( sndpool, PAINTBUFFER_SIZE * 2 * sizeof( short ));
+	out = Mem_Malloc( sndpool, PAINTBUFFER_SIZE * 2 * sizeof( short ));
+
+	for( i = 0; i < MIX_PROFILE_SOURCE; i++ )
+		src[i] = COM_RandomLong( 0, 255 );
+
+	// every format, all pitches from 0.25 to 2.0, some channels unpitched.
+	// pitch 2.0 reads 1025 stereo 16-bit frames past the start offset
+	for( i = 0; i < MIX_PROFILE_CHANNELS; i++ )
+	{
+		script[i].width = ( i & 2 ) ? 2 : 1;
+		script[i].channels = ( i & 4 ) ? 2 : 1;
+		script[i].volume[0] = COM_RandomLong( 0, 255 );
+		script[i].volume[1] = COM_RandomLong( 0, 255 );
+		script[i].inputOffset = COM_RandomLong( 0, FIX_MASK );
+		script[i].rateScale = ( i & 8 ) ? FIX( 1 ) : COM_RandomLong( FIX( 1 ) / 4, FIX( 2 ));
+		script[i].pData = src + ( COM_RandomLong( 0, 4095 ) & ~3 );
+	}
+
+	Con_Printf( "Profiling %i passes of %i channels to %s kernels\n", count, MIX_PROFILE_CHANNELS, mixkernels.name );
+
+	// upsamplers share temppaintbuffer with the mixer
+	S_MixerPause();
+
+	S_MixRenderScript( &mix_kernels_ref, script, ref1, ref2, refout, 1 );
+	S_MixRenderScript( &mixkernels, script, buf1, buf2, out, 1 );
+	match = !memcmp( ref1, buf1, PAINTBUFFER_SIZE * sizeof( portable_samplepair_t ));
+	match &= !memcmp( ref2, buf2, PAINTBUFFER_SIZE * sizeof( portable_samplepair_t ));
+	match &= !memcmp( refout, out, PAINTBUFFER_SIZE * 2 * sizeof( short ));
+
+	t1 = S_MixRenderScript( &mix_kernels_ref, script, ref1, ref2, refout, count );
+	t2 = S_MixRenderScript( &mixkernels, script, buf1, buf2, out, count );
+
+	S_MixerResume();
+
+	Con_Printf( "reference %.3f ms, %s %.3f ms per pass (%s)\n", t1 * 1000.0 / count,
+		mixkernels.name, t2 * 1000.0 / count, match ? "^2match^7" : "^1MISMATCH^7" );
+
+	Mem_Free( src );
+	Mem_Free( ref1 );
+	Mem_Free( ref2 );
+	Mem_Free( buf1 );
+	Mem_Free( buf2 );
+	Mem_Free( refout );
+	Mem_Free( out );
+}
@@ -178,6 +178,7 @@ void S_StreamBackgroundTrack( void )
 	byte	raw[MAX_RAW_SAMPLES];
 	int	r, fileBytes;
 	rawchan_t	*ch = NULL;
+	int	time;
 
 	if( !dma.initialized || !s_bgTrack.stream || s_listener.streaming )
 		return;
@@ -200,14 +201,17 @@ void S_StreamBackgroundTrack( void )
 	Assert( ch != NULL );
 
 	// see how many samples should be copied into the raw buffer
-	if( ch->s_rawend < soundtime )
-		ch->s_rawend = soundtime;
+	S_LockRawChannels();
+	time = soundtime;
+	if( ch->s_rawend < time )
+		ch->s_rawend = time;
+	S_UnlockRawChannels();
 
-	while( ch->s_rawend < soundtime + ch->max_samples )
+	while( ch->s_rawend < time + ch->max_samples )
 	{
 		wavdata_t	*info = FS_StreamInfo( s_bgTrack.stream );
 
-		bufferSamples = ch->max_samples - (ch->s_rawend - soundtime);
+		bufferSamples = ch->max_samples - (ch->s_rawend - time);
 
 		// decide how much data needs to be read from the file
 		fileSamples = bufferSamples * ((float)info->rate / SOUND_DMA_SPEED );
@@ -292,6 +296,7 @@ void S_StreamSoundTrack( void )
 	byte	raw[MAX_RAW_SAMPLES];
 	int	r, fileBytes;
 	rawchan_t	*ch = NULL;
+	int	time;
 
 	if( !dma.initialized || !s_listener.streaming || s_listener.paused )
 		return;
@@ -301,16 +306,19 @@ void S_StreamSoundTrack( void )
 	Assert( ch != NULL );
 
 	// see how many samples should be copied into the raw buffer
-	if( ch->s_rawend < soundtime )
-		ch->s_rawend = soundtime;
+	S_LockRawChannels();
+	time = soundtime;
+	if( ch->s_rawend < time )
+		ch->s_rawend = time;
+	S_UnlockRawChannels();
 
-	while( ch->s_rawend < soundtime + ch->max_samples )
+	while( ch->s_rawend < time + ch->max_samples )
 	{
 		wavdata_t	*info = SCR_GetMovieInfo();
 
 		if( !info ) break;	// bad soundtrack?
 
-		bufferSamples = ch->max_samples - (ch->s_rawend - soundtime);
+		bufferSamples = ch->max_samples - (ch->s_rawend - time);
 
 		// decide how much data needs to be read from the file
 		fileSamples = bufferSamples * ((float)info->rate / SOUND_DMA_SPEED );
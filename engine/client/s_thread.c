@@ -0,0 +1,693 @@
+/*
+s_thread.c - dedicated sound mixer thread
+Copyright (C) 2018 Uncle Mike
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "sound.h"
+#include "client.h"
+
+/*
+=============================================================================
+
+	MIXER THREAD
+
+	the mixer owns a private copy of every playing channel and the
+	paintbuffers. game thread never touches them while the mixer runs:
+	once per frame it compares its channels with the state that was
+	sent before and pushes the differences into a single-producer,
+	single-consumer command ring. mixer answers with a snapshot of the
+	playback positions so the game can free finished channels and
+	save the current sample offsets. both snapshots are triple-buffered
+	and exchanged with a single interlocked operation, nobody waits.
+
+	rare structural changes (freeing sounds, raw channels, dsp delay
+	lines, output device) use S_MixerPause to park the mixer between
+	two passes instead.
+=============================================================================
+*/
+#define MIXER_RING_SIZE		128		// must be power of two
+#define MIXER_RING_MASK		(MIXER_RING_SIZE - 1)
+#define MIXER_PASS_MSEC		5		// mixer wakes up at least this often
+#define TRIPLE_NEW			4		// back buffer was published after last read
+
+typedef enum
+{
+	MIXCMD_START = 0,	// copy whole channel, start it from the current position
+	MIXCMD_UPDATE,	// new volumes or pitch after respatialization
+	MIXCMD_STOP,	// release the channel
+} mixcmd_type_t;
+
+typedef struct
+{
+	int		type;
+	int		index;		// channel number
+	int		leftvol;
+	int		rightvol;
+	int		basePitch;
+	qboolean		use_loop;
+	channel_t		chan;		// MIXCMD_START only
+} mixcmd_t;
+
+// what was sent to mixer for each channel, game thread only
+typedef struct
+{
+	int		serial;		// 0 if mixer doesn't play this channel
+	sfx_t		*sfx;
+	int		leftvol;
+	int		rightvol;
+	int		basePitch;
+	qboolean		use_loop;
+} mixsent_t;
+
+// playback position, mixer thread writes it after each pass
+typedef struct
+{
+	int		serial;		// start serial of the channel that mixer plays
+	sfx_t		*sfx;		// NULL when mixer has released the channel
+	mixer_t		pMixer;
+	int		wordIndex;
+	qboolean		hasWord;		// currentWord is valid
+} mixprogress_t;
+
+typedef struct
+{
+	HANDLE		hThread;
+	DWORD		threadId;
+	HANDLE		hWake;		// game -> mixer: new commands or pause request
+	HANDLE		hParked;		// mixer -> game: pause request accepted
+	HANDLE		hResume;		// game -> mixer: leave the pause
+	volatile LONG	quit;
+	volatile LONG	pause;
+	volatile LONG	wrapped;		// paintedtime was chopped, game must restart all sounds
+	volatile LONG	lost;		// mixer couldn't lock the device buffer, game must shutdown sound
+	int		pausecount;	// nested pauses, game thread only
+
+	// command ring, game thread advances head, mixer thread advances tail
+	mixcmd_t		ring[MIXER_RING_SIZE];
+	volatile LONG	head;
+	volatile LONG	tail;
+	int		overflows;	// frames that didn't fit into the ring
+
+	// raw samples, s_rawend, soundtime and paintedtime
+	CRITICAL_SECTION	rawlock;
+
+	// mixer thread copies
+	channel_t		channels[MAX_CHANNELS];
+	int		serials[MAX_CHANNELS];
+
+	// game thread bookkeeping
+	mixsent_t		sent[MAX_CHANNELS];
+	int		serial;
+
+	// game -> mixer
+	mixstate_t	state[3];
+	volatile LONG	stateReady;
+	int		stateBack;
+	int		stateFront;
+
+	// mixer -> game
+	mixprogress_t	progress[3][MAX_CHANNELS];
+	volatile LONG	progressReady;
+	int		progressBack;
+	int		progressFront;
+
+	// statistics
+	volatile LONG	passes;
+	double		passTime;
+	double		passTimeMax;
+} sndthread_t;
+
+static sndthread_t	snd_thread;
+mixstate_t	s_mixstate;
+
+/*
+================
+S_TriplePublish
+
+producer side: hand the filled back buffer over,
+returns the index of the next back buffer
+================
+*/
+static int S_TriplePublish( volatile LONG *ready, int back )
+{
+	return InterlockedExchange( ready, back|TRIPLE_NEW ) & 3;
+}
+
+/*
+================
+S_TripleLatest
+
+consumer side: grab the newest published buffer if any,
+returns the index of the buffer to read
+================
+*/
+static int S_TripleLatest( volatile LONG *ready, int front )
+{
+	if( !FBitSet( *ready, TRIPLE_NEW ))
+		return front;
+	return InterlockedExchange( ready, front ) & 3;
+}
+
+/*
+================
+S_MixerThreaded
+
+returns true if mixing was moved out from the game thread
+================
+*/
+qboolean S_MixerThreaded( void )
+{
+	return ( snd_thread.hThread != NULL );
+}
+
+/*
+================
+S_OnMixerThread
+================
+*/
+qboolean S_OnMixerThread( void )
+{
+	return ( snd_thread.hThread != NULL && GetCurrentThreadId() == snd_thread.threadId );
+}
+
+/*
+================
+S_MixerChannels
+
+channels that mixer is working with
+================
+*/
+int S_MixerChannels( channel_t **list )
+{
+	if( S_MixerThreaded( ))
+	{
+		*list = snd_thread.channels;
+		return MAX_CHANNELS;
+	}
+
+	*list = channels;
+	return total_channels;
+}
+
+/*
+================
+S_MixerExecuteCommands
+
+mixer thread: apply all pending commands
+================
+*/
+static void S_MixerExecuteCommands( void )
+{
+	mixcmd_t	*cmd;
+	channel_t	*ch;
+
+	while( snd_thread.tail != snd_thread.head )
+	{
+		cmd = &snd_thread.ring[snd_thread.tail & MIXER_RING_MASK];
+		ch = &snd_thread.channels[cmd->index];
+
+		switch( cmd->type )
+		{
+		case MIXCMD_START:
+			*ch = cmd->chan;
+			if( ch->currentWord )
+				ch->currentWord = &ch->pMixer;
+			snd_thread.serials[cmd->index] = ch->serial;
+			break;
+		case MIXCMD_UPDATE:
+			ch->leftvol = cmd->leftvol;
+			ch->rightvol = cmd->rightvol;
+			ch->basePitch = cmd->basePitch;
+			ch->use_loop = cmd->use_loop;
+			break;
+		case MIXCMD_STOP:
+			if( ch->sfx ) S_FreeChannel( ch );
+			break;
+		}
+
+		// slot may be reused now
+		InterlockedIncrement( &snd_thread.tail );
+	}
+}
+
+/*
+================
+S_MixerWriteProgress
+
+mixer thread: tell the game where are we
+================
+*/
+static void S_MixerWriteProgress( void )
+{
+	mixprogress_t	*p = snd_thread.progress[snd_thread.progressBack];
+	channel_t		*ch = snd_thread.channels;
+	int		i;
+
+	for( i = 0; i < MAX_CHANNELS; i++, ch++, p++ )
+	{
+		p->serial = snd_thread.serials[i];
+		p->sfx = ch->sfx;
+		if( !ch->sfx ) continue;
+
+		p->pMixer = ch->pMixer;
+		p->wordIndex = ch->wordIndex;
+		p->hasWord = ( ch->currentWord != NULL );
+	}
+
+	snd_thread.progressBack = S_TriplePublish( &snd_thread.progressReady, snd_thread.progressBack );
+}
+
+/*
+================
+S_MixerThread
+================
+*/
+static DWORD WINAPI S_MixerThread( void *unused )
+{
+	double	start, elapsed;
+
+	Prof_ThreadName( "mixer" );
+
+	while( !snd_thread.quit )
+	{
+		S_MixerExecuteCommands();
+
+		// game wants to change something that we are using.
+		if( snd_thread.pause )
+		{
+			SetEvent( snd_thread.hParked );
+			WaitForSingleObject( snd_thread.hResume, INFINITE );
+			continue;
+		}
+
+		snd_thread.stateFront = S_TripleLatest( &snd_thread.stateReady, snd_thread.stateFront );
+		s_mixstate = snd_thread.state[snd_thread.stateFront];
+
+		Prof_Begin( PROF_MIXER );
+		start = Sys_DoubleTime();
+		S_UpdateChannels();
+		elapsed = Sys_DoubleTime() - start;
+		Prof_End( PROF_MIXER );
+
+		S_MixerWriteProgress();
+
+		snd_thread.passTime += elapsed;
+		if( snd_thread.passTimeMax < elapsed )
+			snd_thread.passTimeMax = elapsed;
+		InterlockedIncrement( &snd_thread.passes );
+
+		WaitForSingleObject( snd_thread.hWake, MIXER_PASS_MSEC );
+	}
+
+	return 0;
+}
+
+/*
+================
+S_MixerPause
+
+game thread: wait until mixer finish current pass and park it.
+may be nested
+================
+*/
+void S_MixerPause( void )
+{
+	if( !S_MixerThreaded( ) || S_OnMixerThread( ))
+		return;
+
+	if( snd_thread.pausecount++ )
+		return;
+
+	InterlockedExchange( &snd_thread.pause, 1 );
+	SetEvent( snd_thread.hWake );
+	WaitForSingleObject( snd_thread.hParked, INFINITE );
+}
+
+/*
+================
+S_MixerResume
+================
+*/
+void S_MixerResume( void )
+{
+	if( !S_MixerThreaded( ) || S_OnMixerThread( ))
+		return;
+
+	if( snd_thread.pausecount <= 0 || --snd_thread.pausecount )
+		return;
+
+	InterlockedExchange( &snd_thread.pause, 0 );
+	SetEvent( snd_thread.hResume );
+}
+
+/*
+================
+S_MixerResetChannels
+
+forget all channels, mixer must be paused
+================
+*/
+void S_MixerResetChannels( void )
+{
+	if( !S_MixerThreaded( ))
+		return;
+
+	Assert( snd_thread.pausecount > 0 );
+
+	// commands posted after the last drain would restart stopped sounds
+	InterlockedExchange( &snd_thread.tail, snd_thread.head );
+
+	memset( snd_thread.channels, 0, sizeof( snd_thread.channels ));
+	memset( snd_thread.serials, 0, sizeof( snd_thread.serials ));
+	memset( snd_thread.sent, 0, sizeof( snd_thread.sent ));
+}
+
+/*
+================
+S_MixerTimeWrapped
+
+mixer thread: paintedtime was chopped, all sounds must be restarted
+================
+*/
+void S_MixerTimeWrapped( void )
+{
+	InterlockedExchange( &snd_thread.wrapped, 1 );
+}
+
+/*
+================
+S_MixerDeviceLost
+
+mixer thread: device buffer can't be locked anymore
+================
+*/
+void S_MixerDeviceLost( void )
+{
+	InterlockedExchange( &snd_thread.lost, 1 );
+}
+
+/*
+================
+S_LockRawChannels
+
+raw channels are filled by the game thread and mixed
+by the mixer thread, never pause the mixer while holding it
+================
+*/
+void S_LockRawChannels( void )
+{
+	if( S_MixerThreaded( ))
+		EnterCriticalSection( &snd_thread.rawlock );
+}
+
+/*
+================
+S_UnlockRawChannels
+================
+*/
+void S_UnlockRawChannels( void )
+{
+	if( S_MixerThreaded( ))
+		LeaveCriticalSection( &snd_thread.rawlock );
+}
+
+/*
+================
+S_MixerSync
+
+game thread: fetch playback positions from the mixer
+and release the channels that was finished
+================
+*/
+void S_MixerSync( void )
+{
+	mixprogress_t	*p;
+	mixsent_t		*sent;
+	channel_t		*ch;
+	int		i;
+
+	if( !S_MixerThreaded( ))
+		return;
+
+	if( InterlockedExchange( &snd_thread.lost, 0 ))
+	{
+		Con_DPrintf( S_ERROR "BeginPainting: mixer thread couldn't lock sound buffer\n" );
+		S_Shutdown();
+		return;
+	}
+
+	if( InterlockedExchange( &snd_thread.wrapped, 0 ))
+	{
+		S_StopAllSounds( true );
+		return;
+	}
+
+	// the file device is filled by the mixer, but written on the game thread
+	S_LockRawChannels();
+	SNDDMA_FlushDump();
+	S_UnlockRawChannels();
+
+	snd_thread.progressFront = S_TripleLatest( &snd_thread.progressReady, snd_thread.progressFront );
+	p = snd_thread.progress[snd_thread.progressFront];
+	sent = snd_thread.sent;
+	ch = channels;
+
+	for( i = 0; i < MAX_CHANNELS; i++, ch++, p++, sent++ )
+	{
+		// mixer doesn't reached this start yet or channel was restarted after
+		if( !ch->sfx || !sent->serial || ch->serial != sent->serial || p->serial != sent->serial )
+			continue;
+
+		if( !p->sfx )
+		{
+			// mixer is done with it
+			S_FreeChannel( ch );
+			sent->serial = 0;
+			continue;
+		}
+
+		ch->pMixer = p->pMixer;
+		ch->wordIndex = p->wordIndex;
+		ch->currentWord = p->hasWord ? &ch->pMixer : NULL;
+
+		// sentence advanced to another word
+		if( ch->isSentence )
+			sent->sfx = ch->sfx = p->sfx;
+	}
+}
+
+/*
+================
+S_MixerPreloadSentence
+
+mixer thread never touches the disk, so load all the words now
+================
+*/
+static void S_MixerPreloadSentence( channel_t *ch )
+{
+	int	i;
+
+	for( i = 0; i < CVOXWORDMAX && ch->words[i].sfx != NULL; i++ )
+		S_LoadSound( ch->words[i].sfx );
+}
+
+/*
+================
+S_MixerPublish
+
+game thread: push channel changes since last frame into the ring
+and the current listener state. non-threaded mixer reads state directly
+================
+*/
+void S_MixerPublish( void )
+{
+	mixstate_t	*state;
+	mixsent_t		*sent;
+	mixcmd_t		*cmd;
+	channel_t		*ch;
+	int		i;
+
+	state = S_MixerThreaded() ? &snd_thread.state[snd_thread.stateBack] : &s_mixstate;
+	state->active = s_listener.active;
+	state->inmenu = s_listener.inmenu;
+	state->paused = s_listener.paused;
+	state->console = ( cls.key_dest == key_console );
+	state->menu = ( cls.key_dest == key_menu );
+	state->background = cl.background;
+
+	if( !S_MixerThreaded( ))
+		return;
+
+	snd_thread.stateBack = S_TriplePublish( &snd_thread.stateReady, snd_thread.stateBack );
+
+	for( i = 0, ch = channels, sent = snd_thread.sent; i < MAX_CHANNELS; i++, ch++, sent++ )
+	{
+		if( !ch->sfx && !sent->serial )
+			continue;
+
+		if( snd_thread.head - snd_thread.tail >= MIXER_RING_SIZE )
+		{
+			// ring is full, the rest will be sent with next frame
+			snd_thread.overflows++;
+			break;
+		}
+
+		cmd = &snd_thread.ring[snd_thread.head & MIXER_RING_MASK];
+		cmd->index = i;
+
+		if( !ch->sfx )
+		{
+			cmd->type = MIXCMD_STOP;
+			sent->serial = 0;
+		}
+		else if( !ch->serial || ch->serial != sent->serial || ( !ch->isSentence && ch->sfx != sent->sfx ))
+		{
+			if( ch->isSentence )
+				S_MixerPreloadSentence( ch );
+
+			if( ++snd_thread.serial <= 0 )
+				snd_thread.serial = 1;
+
+			ch->serial = snd_thread.serial;
+			cmd->type = MIXCMD_START;
+			cmd->chan = *ch;
+
+			sent->serial = ch->serial;
+			sent->sfx = ch->sfx;
+			sent->leftvol = ch->leftvol;
+			sent->rightvol = ch->rightvol;
+			sent->basePitch = ch->basePitch;
+			sent->use_loop = ch->use_loop;
+		}
+		else if( ch->leftvol != sent->leftvol || ch->rightvol != sent->rightvol || ch->basePitch != sent->basePitch || ch->use_loop != sent->use_loop )
+		{
+			cmd->type = MIXCMD_UPDATE;
+			cmd->leftvol = sent->leftvol = ch->leftvol;
+			cmd->rightvol = sent->rightvol = ch->rightvol;
+			cmd->basePitch = sent->basePitch = ch->basePitch;
+			cmd->use_loop = sent->use_loop = ch->use_loop;
+		}
+		else continue; // nothing changed
+
+		// full barrier, command is visible before the new head
+		InterlockedIncrement( &snd_thread.head );
+	}
+
+	SetEvent( snd_thread.hWake );
+}
+
+/*
+================
+S_InitMixerThread
+
+start mixing in background, -nomixthread keeps the mixer
+on the game thread as before
+================
+*/
+void S_InitMixerThread( void )
+{
+	if( S_MixerThreaded( ) || Sys_CheckParm( "-nomixthread" ))
+		return;
+
+	memset( &snd_thread, 0, sizeof( snd_thread ));
+	snd_thread.stateBack = 0;
+	snd_thread.stateReady = 1;
+	snd_thread.stateFront = 2;
+	snd_thread.progressBack = 0;
+	snd_thread.progressReady = 1;
+	snd_thread.progressFront = 2;
+
+	// mixer starts with the same state that game has
+	snd_thread.state[0] = snd_thread.state[1] = snd_thread.state[2] = s_mixstate;
+
+	snd_thread.hWake = CreateEvent( NULL, FALSE, FALSE, NULL );
+	snd_thread.hParked = CreateEvent( NULL, FALSE, FALSE, NULL );
+	snd_thread.hResume = CreateEvent( NULL, FALSE, FALSE, NULL );
+	InitializeCriticalSection( &snd_thread.rawlock );
+
+	if( snd_thread.hWake && snd_thread.hParked && snd_thread.hResume )
+		snd_thread.hThread = CreateThread( NULL, 0, S_MixerThread, NULL, CREATE_SUSPENDED, &snd_thread.threadId );
+
+	if( !snd_thread.hThread )
+	{
+		Con_Printf( S_WARN "Audio: couldn't create mixer thread, mixing on the main thread\n" );
+		if( snd_thread.hWake ) CloseHandle( snd_thread.hWake );
+		if( snd_thread.hParked ) CloseHandle( snd_thread.hParked );
+		if( snd_thread.hResume ) CloseHandle( snd_thread.hResume );
+		DeleteCriticalSection( &snd_thread.rawlock );
+		memset( &snd_thread, 0, sizeof( snd_thread ));
+		return;
+	}
+
+	SetThreadPriority( snd_thread.hThread, THREAD_PRIORITY_ABOVE_NORMAL );
+	ResumeThread( snd_thread.hThread );
+
+	Con_Reportf( "Audio: mixing on a separate thread\n" );
+}
+
+/*
+================
+S_ShutdownMixerThread
+
+stop the mixer thread, game thread owns the mixing again
+================
+*/
+void S_ShutdownMixerThread( void )
+{
+	if( !S_MixerThreaded( ) || S_OnMixerThread( ))
+		return;
+
+	InterlockedExchange( &snd_thread.quit, 1 );
+	InterlockedExchange( &snd_thread.pause, 0 );
+	SetEvent( snd_thread.hResume );
+	SetEvent( snd_thread.hWake );
+
+	WaitForSingleObject( snd_thread.hThread, INFINITE );
+
+	CloseHandle( snd_thread.hThread );
+	CloseHandle( snd_thread.hWake );
+	CloseHandle( snd_thread.hParked );
+	CloseHandle( snd_thread.hResume );
+	DeleteCriticalSection( &snd_thread.rawlock );
+
+	// game channels are still playing, mark them as unsent
+	memset( &snd_thread, 0, sizeof( snd_thread ));
+}
+
+/*
+================
+S_MixerInfo
+
+print mixer thread statistics
+================
+*/
+void S_MixerInfo( void )
+{
+	int	passes;
+
+	if( !S_MixerThreaded( ))
+	{
+		Con_Printf( "mixer runs on the main thread\n" );
+		return;
+	}
+
+	passes = snd_thread.passes;
+	Con_Printf( "%5d mixer passes\n", passes );
+	if( passes > 0 )
+	{
+		Con_Printf( "%5.2f ms average pass\n", snd_thread.passTime * 1000.0 / passes );
+		Con_Printf( "%5.2f ms longest pass\n", snd_thread.passTimeMax * 1000.0 );
+	}
+	Con_Printf( "%5d ring overflows\n", snd_thread.overflows );
+}
@@ -383,8 +383,10 @@ void VOX_FreeWord( channel_t *pchan )
 	pchan->currentWord = NULL; // sentence is finished
 	memset( &pchan->pMixer, 0, sizeof( pchan->pMixer ));
 
-	// release unused sounds
-	if( pchan->words[pchan->wordIndex].sfx )
+	// release unused sounds. mixer thread may still play
+	// this word on another channel, so keep it until the
+	// next registration sweep
+	if( pchan->words[pchan->wordIndex].sfx && !S_MixerThreaded( ))
 	{
 		// If this wave wasn't precached by the game code
 		if( !pchan->words[pchan->wordIndex].fKeepCached )
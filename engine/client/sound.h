@@ -113,6 +113,32 @@ extern portable_samplepair_t	temppaintbuffer[];
 extern portable_samplepair_t	*g_curpaintbuffer;
 extern paintbuffer_t	paintbuffers[];
 
+#define CCHANVOLUMES		2
+
+#define SND_SCALE_BITS		7
+#define SND_SCALE_SHIFT		(8 - SND_SCALE_BITS)
+#define SND_SCALE_LEVELS		(1 << SND_SCALE_BITS)
+
+extern int		snd_scaletable[SND_SCALE_LEVELS][256];
+
+// mixing kernels, see s_simd.c
+typedef struct mixkernels_s
+{
+	const char	*name;
+	void		(*MixMono8)( portable_samplepair_t *pbuf, const int *volume, const byte *pData, int inputOffset, uint rateScale, int outCount );
+	void		(*MixStereo8)( portable_samplepair_t *pbuf, const int *volume, const byte *pData, int inputOffset, uint rateScale, int outCount );
+	void		(*MixMono16)( portable_samplepair_t *pbuf, const int *volume, const short *pData, int inputOffset, uint rateScale, int outCount );
+	void		(*MixStereo16)( portable_samplepair_t *pbuf, const int *volume, const short *pData, int inputOffset, uint rateScale, int outCount );
+	void		(*MixPaintbuffers)( portable_samplepair_t *pbuf3, const portable_samplepair_t *pbuf1, const portable_samplepair_t *pbuf2, int count, int gain );
+	void		(*ClipPaintbuffer)( portable_samplepair_t *pbuf, int count );
+	void		(*TransferStereo16)( short *snd_out, const int *snd_p, int count );
+	void		(*Upsample2x)( portable_samplepair_t *pbuffer, int count );
+	void		(*Interpolate2xLinear)( portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem, int count );
+	void		(*Interpolate2xCubic)( portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem, int count );
+} mixkernels_t;
+
+extern mixkernels_t		mixkernels;
+
 // structure used for fading in and out client sound volume.
 typedef struct
 {
@@ -183,6 +209,7 @@ typedef struct channel_s
 	qboolean		use_loop;		// don't loop default and local sounds
 	qboolean		staticsound;	// use origin instead of fetching entnum's origin
 	qboolean		localsound;	// it's a local menu sound (not looped, not paused)
+	int		serial;		// start serial, matches the channel with the mixer thread copy
 	mixer_t		pMixer;
 
 	// sound culling
@@ -221,6 +248,17 @@ typedef struct
 	byte		pasbytes[(MAX_MAP_LEAFS+7)/8];// actual PHS for current frame
 } listener_t;
 
+// everything mixer needs to know about the client state
+typedef struct
+{
+	qboolean		active;		// client is in game
+	qboolean		inmenu;		// listener in-menu ?
+	qboolean		paused;
+	qboolean		console;		// console is active
+	qboolean		menu;		// menu is active
+	qboolean		background;	// background map is running
+} mixstate_t;
+
 typedef struct
 {
 	string		current;		// a currently playing track
@@ -242,8 +280,10 @@ int SNDDMA_GetSoundtime( void );
 void SNDDMA_Shutdown( void );
 void SNDDMA_BeginPainting( void );
 void SNDDMA_Submit( void );
+void SNDDMA_FlushDump( void );
 void SNDDMA_LockSound( void );
 void SNDDMA_UnlockSound( void );
+const char *SNDDMA_DeviceName( void );
 
 //====================================================================
 
@@ -260,6 +300,7 @@ extern int	total_channels;
 extern int	paintedtime;
 extern int	soundtime;
 extern listener_t	s_listener;
+extern mixstate_t	s_mixstate;
 extern int	idsp_room;
 extern dma_t	dma;
 
@@ -280,6 +321,7 @@ float S_GetMusicVolume( void );
 // s_main.c
 //
 void S_FreeChannel( channel_t *ch );
+void S_UpdateChannels( void );
 
 //
 // s_mix.c
@@ -290,6 +332,31 @@ void MIX_InitAllPaintbuffers( void );
 void MIX_FreeAllPaintbuffers( void );
 void MIX_PaintChannels( int endtime );
 
+//
+// s_simd.c
+//
+void S_InitMixKernels( void );
+void S_MixProfiling_f( void );
+
+//
+// s_thread.c
+//
+void S_InitMixerThread( void );
+void S_ShutdownMixerThread( void );
+qboolean S_MixerThreaded( void );
+qboolean S_OnMixerThread( void );
+int S_MixerChannels( channel_t **list );
+void S_MixerPause( void );
+void S_MixerResume( void );
+void S_MixerResetChannels( void );
+void S_MixerTimeWrapped( void );
+void S_MixerDeviceLost( void );
+void S_LockRawChannels( void );
+void S_UnlockRawChannels( void );
+void S_MixerSync( void );
+void S_MixerPublish( void );
+void S_MixerInfo( void );
+
 // s_load.c
 qboolean S_TestSoundChar( const char *pch, char c );
 char *S_SkipSoundChar( const char *pch );
@@ -465,6 +465,8 @@ const char *COM_FileWithoutPath( const char *in );
 byte *W_LoadLump( wfile_t *wad, const char *lumpname, size_t *lumpsizeptr, const char type );
 void W_Close( wfile_t *wad );
 byte *FS_LoadFile( const char *path, long *filesizeptr, qboolean gamedironly );
+byte *FS_MapFile( const char *path, long *filesizeptr, qboolean gamedironly );
+void FS_UnmapFile( const void *buffer );
 qboolean FS_WriteFile( const char *filename, const void *data, long len );
 qboolean COM_ParseVector( char **pfile, float *v, size_t size );
 void COM_NormalizeAngles( vec3_t angles );
@@ -617,6 +619,7 @@ rgbdata_t *FS_CopyImage( rgbdata_t *in );
 void FS_FreeImage( rgbdata_t *pack );
 extern const bpc_desc_t PFDesc[];	// image get pixelformat
 qboolean Image_Process( rgbdata_t **pix, int width, int height, uint flags, float bumpscale );
+void Image_BuildMipRow( byte *out, const byte *in, const byte *next, int srcWidth );
 void Image_PaletteHueReplace( byte *palSrc, int newHue, int start, int end, int pal_size );
 void Image_PaletteTranslate( byte *palSrc, int top, int bottom, int pal_size );
 void Image_SetForceFlags( uint flags );	// set image force flags on loading
@@ -655,6 +658,7 @@ typedef enum
 	// wavdata->flags
 	SOUND_LOOPED	= BIT( 0 ),	// this is looped sound (contain cue markers)
 	SOUND_STREAM	= BIT( 1 ),	// this is a streaminfo, not a real sound
+	SOUND_MAPPED	= BIT( 2 ),	// buffer points into the file view (see FS_MapFile)
 
 	// Sound_Process manipulation flags
 	SOUND_RESAMPLE	= BIT(12),	// resample sound to specified rate
@@ -741,6 +745,7 @@ qboolean CL_Active( void );
 void SV_Init( void );
 void SV_Shutdown( const char *finalmsg );
 void Host_ServerFrame( void );
+qboolean Host_ServerPackets( void );
 qboolean SV_Active( void );
 
 /*
@@ -991,6 +996,7 @@ void S_StopAllSounds( qboolean ambient );
 // gamma routines
 void BuildGammaTable( float gamma, float brightness );
 byte LightToTexGamma( byte b );
+const byte *LightGammaTable( void );
 byte TextureToGamma( byte b );
 
 #ifdef __cplusplus
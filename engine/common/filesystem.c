@@ -109,6 +109,7 @@ char			fs_basedir[MAX_SYSPATH];	// base game directory
 char			fs_gamedir[MAX_SYSPATH];	// game current directory
 char			fs_writedir[MAX_SYSPATH];	// path that game allows to overwrite, delete and rename files (and create new of course)
 qboolean			fs_ext_path = false;	// attempt to read\write from ./ or ../ pathes 
+static qboolean		fs_mapfiles;		// FS_MapFile can map files, -nomapfiles to disable
 
 static void FS_InitMemory( void );
 static searchpath_t *FS_FindFile( const char *name, int *index, qboolean gamedironly );
@@ -122,6 +123,7 @@ static long FS_SysFileTime( const char *filename );
 static char W_TypeFromExt( const char *lumpname );
 static const char *W_ExtFromType( char lumptype );
 static void FS_Purge( file_t* file );
+static void FS_UnmapAll( void );
 
 /*
 =============================================================================
@@ -1379,6 +1381,7 @@ void FS_Init( void )
 	int		i;
 	
 	FS_InitMemory();
+	fs_mapfiles = !Sys_CheckParm( "-nomapfiles" );
 
 	Cmd_AddCommand( "fs_rescan", FS_Rescan_f, "rescan filesystem search pathes" );
 	Cmd_AddCommand( "fs_path", FS_Path_f, "show filesystem search pathes" );
@@ -1463,6 +1466,7 @@ void FS_Shutdown( void )
 	memset( &SI, 0, sizeof( sysinfo_t ));
 
 	FS_ClearSearchPath(); // release all wad files too
+	FS_UnmapAll(); // mapped views are outside of pool
 	Mem_FreePool( &fs_mempool );
 }
 
@@ -2234,6 +2238,184 @@ byte *FS_LoadFile( const char *path, long *filesizeptr, qboolean gamedironly )
 	return buf;
 }
 
+/*
+=============================================================================
+
+FILE MAPPING
+
+=============================================================================
+*/
+typedef struct fsview_s
+{
+	byte		*base;			// view base, NULL if file was loaded into memory
+	byte		*data;			// file contents
+	long		size;			// file size
+	struct fsview_s	*next;
+} fsview_t;
+
+#define FS_VIEW_HASH	64			// must be power of two
+
+static fsview_t		*fs_views[FS_VIEW_HASH];	// active views hashed by data pointer
+
+/*
+============
+FS_ViewHash
+============
+*/
+static int FS_ViewHash( const void *data )
+{
+	size_t	ptr = (size_t)data;
+
+	// views are 64k aligned, loaded files are aligned by allocator
+	return (int)(( ptr >> 4 ) ^ ( ptr >> 16 )) & ( FS_VIEW_HASH - 1 );
+}
+
+/*
+============
+FS_MapView
+
+map a part of file into memory. Pages are copy-on-write
+so the caller is free to modify the contents
+============
+*/
+static byte *FS_MapView( int handle, long offset, long size, byte **base )
+{
+	static DWORD	granularity;
+	HANDLE		hMapping;
+	long		alignedofs;
+	byte		*view;
+
+	if( !granularity )
+	{
+		SYSTEM_INFO	info;
+
+		GetSystemInfo( &info );
+		granularity = info.dwAllocationGranularity;
+	}
+
+	// view offset must be aligned to allocation granularity
+	alignedofs = offset - ( offset % granularity );
+
+	hMapping = CreateFileMapping( (HANDLE)_get_osfhandle( handle ), NULL, PAGE_WRITECOPY, 0, 0, NULL );
+	if( !hMapping ) return NULL;
+
+	view = MapViewOfFile( hMapping, FILE_MAP_COPY, 0, alignedofs, size + ( offset - alignedofs ));
+	CloseHandle( hMapping ); // view keeps the mapping alive
+	if( !view ) return NULL;
+
+	*base = view;
+
+	return view + ( offset - alignedofs );
+}
+
+/*
+============
+FS_MapFile
+
+Like FS_LoadFile but maps the file from disk or pak
+without copying. The buffer is NOT zero-terminated,
+so text files should be loaded with FS_LoadFile.
+Falls back to FS_LoadFile for wad lumps.
+Release with FS_UnmapFile
+============
+*/
+byte *FS_MapFile( const char *path, long *filesizeptr, qboolean gamedironly )
+{
+	fsview_t	*view;
+	byte	*base = NULL;
+	byte	*buf = NULL;
+	long	filesize = 0;
+	file_t	*file;
+	int	hash;
+
+	file = FS_Open( path, "rb", gamedironly );
+
+	if( file )
+	{
+		filesize = file->real_length;
+
+		if( filesize > 0 && fs_mapfiles )
+			buf = FS_MapView( file->handle, file->offset, filesize, &base );
+		FS_Close( file );
+	}
+
+	if( !buf )
+	{
+		// wad lump, empty file or mapping has failed
+		buf = FS_LoadFile( path, &filesize, gamedironly );
+		if( !buf ) return NULL;
+	}
+
+	view = (fsview_t *)Mem_Malloc( fs_mempool, sizeof( fsview_t ));
+	view->base = base;
+	view->data = buf;
+	view->size = filesize;
+
+	hash = FS_ViewHash( buf );
+	view->next = fs_views[hash];
+	fs_views[hash] = view;
+
+	if( filesizeptr )
+		*filesizeptr = filesize;
+
+	return buf;
+}
+
+/*
+============
+FS_UnmapFile
+
+release buffer that was returned by FS_MapFile.
+Pointer must be the same that FS_MapFile has returned
+============
+*/
+void FS_UnmapFile( const void *buffer )
+{
+	fsview_t	*view, **prev;
+
+	if( !buffer ) return;
+
+	for( prev = &fs_views[FS_ViewHash( buffer )]; ( view = *prev ) != NULL; prev = &view->next )
+	{
+		if( view->data != buffer )
+			continue;
+
+		if( view->base ) UnmapViewOfFile( view->base );
+		else Mem_Free( view->data );
+
+		*prev = view->next;
+		Mem_Free( view );
+		return;
+	}
+
+	Con_Printf( S_ERROR "FS_UnmapFile: buffer %p is not mapped\n", buffer );
+}
+
+/*
+============
+FS_UnmapAll
+
+release all views that was left on shutdown
+============
+*/
+static void FS_UnmapAll( void )
+{
+	fsview_t	*view;
+	int	i;
+
+	for( i = 0; i < FS_VIEW_HASH; i++ )
+	{
+		while(( view = fs_views[i] ) != NULL )
+		{
+			if( view->base ) UnmapViewOfFile( view->base );
+			else Mem_Free( view->data );
+
+			fs_views[i] = view->next;
+			Mem_Free( view );
+		}
+	}
+}
+
 /*
 ============
 FS_WriteFile
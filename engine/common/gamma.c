@@ -82,6 +82,11 @@ byte LightToTexGamma( byte b )
 	return lightgammatable[b];
 }
 
+const byte *LightGammaTable( void )
+{
+	return lightgammatable;
+}
+
 byte TextureToGamma( byte b )
 {
 	return texgammatable[b];
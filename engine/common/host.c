@@ -32,6 +32,21 @@ sysinfo_t		SI;
 CVAR_DEFINE( host_developer, "developer", "0", 0, "engine is in development-mode" );
 CVAR_DEFINE_AUTO( sys_ticrate, "100", 0, "framerate in dedicated mode" );
 
+// dedicated server frame schedule
+typedef struct
+{
+	double		nexttick;		// when the next frame is due
+	double		starttime;	// stats are collected since
+	double		idletime;		// time spent waiting for packets or the next frame
+	double		jitter;		// sum of frame delays past the schedule
+	double		maxjitter;
+	int		numticks;
+	int		resyncs;		// frame was late so much the schedule was restarted
+	int		wakeups;		// woken up by the packets
+} hosttick_t;
+
+static hosttick_t	host_tick;
+
 convar_t	*host_serverstate;
 convar_t	*host_gameloaded;
 convar_t	*host_clientloaded;
@@ -122,6 +137,112 @@ void Host_AbortCurrentFrame( void )
 	longjmp( host.abortframe, 1 );
 }
 
+/*
+==================
+Host_WaitForTick
+
+dedicated server sleeps in the socket
+until a packet comes or the next frame is due
+==================
+*/
+static void Host_WaitForTick( void )
+{
+	double	start, remaining;
+
+	if( !host_tick.starttime )
+		host_tick.starttime = Sys_DoubleTime();
+
+	while( 1 )
+	{
+		start = Sys_DoubleTime();
+		remaining = host_tick.nexttick - start;
+		if( remaining <= 0.0 ) break;
+
+		if( !SV_Active( ))
+		{
+			// nothing reads the socket while there is no map
+			Sys_Sleep( Q_max( 1, (int)( remaining * 1000.0 )));
+			host_tick.idletime += Sys_DoubleTime() - start;
+			continue;
+		}
+
+		if( NET_Sleep( remaining ))
+		{
+			host_tick.idletime += Sys_DoubleTime() - start;
+
+			// run usercmds right away, the frame will answer them on time
+			if( !Host_ServerPackets( ))
+				break;
+			host_tick.wakeups++;
+		}
+		else host_tick.idletime += Sys_DoubleTime() - start;
+	}
+}
+
+/*
+==================
+Host_CheckTick
+
+returns false if the next dedicated frame is not due yet
+==================
+*/
+static qboolean Host_CheckTick( double fps )
+{
+	double	now = Sys_DoubleTime();
+	double	late;
+
+	if( now < host_tick.nexttick )
+		return false;
+
+	late = now - host_tick.nexttick;
+
+	if( late > ( 1.0 / fps ))
+	{
+		// we missed a whole frame (level change or hitch),
+		// don't try to catch up, just start a new schedule
+		host_tick.nexttick = now + ( 1.0 / fps );
+		host_tick.resyncs++;
+	}
+	else
+	{
+		// keep the schedule instead of the previous frame time, so
+		// the wakeup delays don't accumulate into the frame spacing
+		host_tick.nexttick += ( 1.0 / fps );
+		host_tick.maxjitter = Q_max( host_tick.maxjitter, late );
+		host_tick.jitter += late;
+		host_tick.numticks++;
+	}
+
+	return true;
+}
+
+/*
+==================
+Host_TickStats_f
+
+print and reset dedicated server frame stats
+==================
+*/
+static void Host_TickStats_f( void )
+{
+	double	total = Sys_DoubleTime() - host_tick.starttime;
+
+	if( !host_tick.starttime || total <= 0.0 )
+	{
+		Con_Printf( "no stats collected yet\n" );
+		return;
+	}
+
+	Con_Printf( "%i frames in %.2f seconds (%.1f fps, sys_ticrate %g)\n", host_tick.numticks, total, host_tick.numticks / total, sys_ticrate.value );
+	if( host_tick.numticks > 0 )
+		Con_Printf( "jitter: %.3f ms avg, %.3f ms max\n", host_tick.jitter * 1000.0 / host_tick.numticks, host_tick.maxjitter * 1000.0 );
+	Con_Printf( "idle: %.1f%%, %i packet wakeups, %i resyncs\n", host_tick.idletime * 100.0 / total, host_tick.wakeups, host_tick.resyncs );
+
+	host_tick.starttime = Sys_DoubleTime();
+	host_tick.idletime = host_tick.jitter = host_tick.maxjitter = 0.0;
+	host_tick.numticks = host_tick.resyncs = host_tick.wakeups = 0;
+}
+
 /*
 ==================
 Host_CheckSleep
@@ -132,7 +253,7 @@ void Host_CheckSleep( void )
 	if( host.type == HOST_DEDICATED )
 	{
 		// let the dedicated server some sleep
-		Sys_Sleep( 1 );
+		Host_WaitForTick();
 	}
 	else
 	{
@@ -455,7 +576,7 @@ qboolean Host_FilterTime( float time )
 
 		if( host.type == HOST_DEDICATED )
 		{
-			if(( host.realtime - oldtime ) < ( 1.0 / ( fps + 1.0 )))
+			if( !Host_CheckTick( fps ))
 				return false;
 		}
 		else
@@ -490,12 +611,16 @@ void Host_Frame( float time )
 	if( !Host_FilterTime( time ))
 		return;
 
+	Prof_FrameBegin ();
+
 	Host_InputFrame ();  // input frame
 	Host_ClientBegin (); // begin client
 	Host_GetCommands (); // dedicated in
 	Host_ServerFrame (); // server frame
 	Host_ClientFrame (); // client frame
 
+	Prof_FrameEnd ();
+
 	host.framecount++;
 }
 
@@ -787,12 +912,16 @@ void Host_InitCommon( const char *hostname, qboolean bChangeGame )
 	}
 	HPAK_Init();
 
+	Prof_Init();
+	Sys_InitJobs();
 	IN_Init();
 	Key_Init();
 }
 
 void Host_FreeCommon( void )
 {
+	Sys_ShutdownJobs();
+	Prof_Shutdown();
 	Image_Shutdown();
 	Sound_Shutdown();
 	Netchan_Shutdown();
@@ -830,6 +959,7 @@ int EXPORT Host_Main( const char *progname, int bChangeGame, pfnChangeGame func
 	con_gamemaps = Cvar_Get( "con_mapfilter", "1", FCVAR_ARCHIVE, "when true show only maps in game folder" );
 	build = Cvar_Get( "buildnum", va( "%i", Q_buildnum()), FCVAR_READ_ONLY, "returns a current build number" );
 	ver = Cvar_Get( "ver", va( "%i/%s (hw build %i)", PROTOCOL_VERSION, XASH_VERSION, Q_buildnum()), FCVAR_READ_ONLY, "shows an engine version" );
+	Cvar_Get( "host_tracematerial", "1", FCVAR_READ_ONLY, "engine has PM_TraceMaterial and EV_TraceMaterial, game dlls check it before using them" );
 
 	Mod_Init();
 	NET_Init();
@@ -855,6 +985,7 @@ int EXPORT Host_Main( const char *progname, int bChangeGame, pfnChangeGame func
 
 		Cmd_AddCommand( "quit", Sys_Quit, "quit the game" );
 		Cmd_AddCommand( "exit", Sys_Quit, "quit the game" );
+		Cmd_AddCommand( "host_tickstats", Host_TickStats_f, "print and reset server frame jitter and idle time" );
 	}
 	else Cmd_AddCommand( "minimize", Host_Minimize_f, "minimize main window to tray" );
 
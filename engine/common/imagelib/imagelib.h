@@ -274,7 +274,19 @@ enum
 	PAL_HALFLIFE
 };
 
+// per-cpu pixel kernels (see img_simd.c)
+typedef struct imgkernels_s
+{
+	const char	*name;
+	void		(*Expand8to32)( const byte *in, uint *out, const uint *pal, int pixels );
+	void		(*ClearLuma)( byte *in, int pixels );
+	void		(*LerpRow)( byte *out, const byte *row1, const byte *row2, int count, int lerp );
+	void		(*LerpLine32)( const byte *in, byte *out, int inwidth, int outwidth );
+	void		(*MipRow32)( byte *out, const byte *in, const byte *next, int srcwidth );
+} imgkernels_t;
+
 extern imglib_t image;
+extern imgkernels_t imgkernels;
 
 byte *Image_ResampleInternal( const void *indata, int in_w, int in_h, int out_w, int out_h, int intype, qboolean *done );
 byte *Image_FlipInternal( const byte *in, word *srcwidth, word *srcheight, int type, int flags );
@@ -317,6 +329,12 @@ qboolean Image_SaveBMP( const char *name, rgbdata_t *pix );
 //
 rgbdata_t *Image_Quantize( rgbdata_t *pic );
 
+//
+// img_simd.c
+//
+void Image_InitKernels( void );
+void Image_Profiling_f( void );
+
 //
 // img_utils.c
 //
@@ -0,0 +1,412 @@
+/*
+img_simd.c - imagelib pixel kernels
+Copyright (C) 2018 Uncle Mike
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "imagelib.h"
+
+#ifdef XASH_SSE2
+#include <emmintrin.h>
+#endif
+
+imgkernels_t	imgkernels;
+
+/*
+=============================================================================
+
+	REFERENCE KERNELS
+
+	all other kernels must produce exactly the same output
+=============================================================================
+*/
+static void Image_Expand8to32_Ref( const byte *in, uint *out, const uint *pal, int pixels )
+{
+	while( pixels >= 8 )
+	{
+		out[0] = pal[in[0]];
+		out[1] = pal[in[1]];
+		out[2] = pal[in[2]];
+		out[3] = pal[in[3]];
+		out[4] = pal[in[4]];
+		out[5] = pal[in[5]];
+		out[6] = pal[in[6]];
+		out[7] = pal[in[7]];
+
+		in += 8;
+		out += 8;
+		pixels -= 8;
+	}
+
+	while( pixels-- > 0 )
+		*out++ = pal[*in++];
+}
+
+static void Image_ClearLuma_Ref( byte *in, int pixels )
+{
+	int	i;
+
+	for( i = 0; i < pixels; i++ )
+		in[i] = in[i] < 224 ? in[i] : 0;
+}
+
+static void Image_LerpRow_Ref( byte *out, const byte *row1, const byte *row2, int count, int lerp )
+{
+	int	i, r;
+
+	for( i = 0; i < count; i++ )
+	{
+		r = row1[i];
+		out[i] = (byte)((((row2[i] - r) * lerp)>>16 ) + r );
+	}
+}
+
+static void Image_LerpLine32_Ref( const byte *in, byte *out, int inwidth, int outwidth )
+{
+	int	j, xi, oldx = 0, f, fstep, endx, lerp;
+
+	fstep = (int)(inwidth * 65536.0f / outwidth);
+	endx = (inwidth-1);
+
+	for( j = 0, f = 0; j < outwidth; j++, f += fstep )
+	{
+		xi = f>>16;
+		if( xi != oldx )
+		{
+			in += (xi - oldx) * 4;
+			oldx = xi;
+		}
+		if( xi < endx )
+		{
+			lerp = f & 0xFFFF;
+			*out++ = (byte)((((in[4] - in[0]) * lerp)>>16) + in[0]);
+			*out++ = (byte)((((in[5] - in[1]) * lerp)>>16) + in[1]);
+			*out++ = (byte)((((in[6] - in[2]) * lerp)>>16) + in[2]);
+			*out++ = (byte)((((in[7] - in[3]) * lerp)>>16) + in[3]);
+		}
+		else // last pixel of the line has no pixel to lerp to
+		{
+			*out++ = in[0];
+			*out++ = in[1];
+			*out++ = in[2];
+			*out++ = in[3];
+		}
+	}
+}
+
+static void Image_MipRow32_Ref( byte *out, const byte *in, const byte *next, int srcwidth )
+{
+	int	x, row, mipwidth = Q_max( 1, srcwidth >> 1 );
+
+	for( x = 0, row = 0; x < mipwidth; x++, row += 8, out += 4 )
+	{
+		if((( x << 1 ) + 1 ) < srcwidth )
+		{
+			out[0] = (in[row+0] + in[row+4] + next[row+0] + next[row+4]) >> 2;
+			out[1] = (in[row+1] + in[row+5] + next[row+1] + next[row+5]) >> 2;
+			out[2] = (in[row+2] + in[row+6] + next[row+2] + next[row+6]) >> 2;
+			out[3] = (in[row+3] + in[row+7] + next[row+3] + next[row+7]) >> 2;
+		}
+		else
+		{
+			out[0] = (in[row+0] + next[row+0]) >> 1;
+			out[1] = (in[row+1] + next[row+1]) >> 1;
+			out[2] = (in[row+2] + next[row+2]) >> 1;
+			out[3] = (in[row+3] + next[row+3]) >> 1;
+		}
+	}
+}
+
+static const imgkernels_t img_kernels_ref =
+{
+	"reference",
+	Image_Expand8to32_Ref,
+	Image_ClearLuma_Ref,
+	Image_LerpRow_Ref,
+	Image_LerpLine32_Ref,
+	Image_MipRow32_Ref,
+};
+
+#ifdef XASH_SSE2
+/*
+=============================================================================
+
+	SSE2 KERNELS
+
+	_mm_mulhi_epi16 treats lerp as signed, so lerp >= 0x8000 is seen
+	as lerp - 0x10000 and the product loses exactly one 'diff'.
+	adding it back gives the same (diff * lerp) >> 16 as reference
+=============================================================================
+*/
+static void Image_Expand8to32_SSE2( const byte *in, uint *out, const uint *pal, int pixels )
+{
+	while( pixels >= 8 )
+	{
+		_mm_storeu_si128((__m128i *)(out + 0), _mm_setr_epi32( pal[in[0]], pal[in[1]], pal[in[2]], pal[in[3]] ));
+		_mm_storeu_si128((__m128i *)(out + 4), _mm_setr_epi32( pal[in[4]], pal[in[5]], pal[in[6]], pal[in[7]] ));
+
+		in += 8;
+		out += 8;
+		pixels -= 8;
+	}
+
+	while( pixels-- > 0 )
+		*out++ = pal[*in++];
+}
+
+static void Image_ClearLuma_SSE2( byte *in, int pixels )
+{
+	__m128i	limit = _mm_set1_epi8( (char)223 );
+	__m128i	pix, mask;
+	int	i;
+
+	for( i = 0; i + 16 <= pixels; i += 16 )
+	{
+		pix = _mm_loadu_si128((const __m128i *)(in + i));
+		mask = _mm_cmpeq_epi8( _mm_min_epu8( pix, limit ), pix );
+		_mm_storeu_si128((__m128i *)(in + i), _mm_and_si128( pix, mask ));
+	}
+
+	for( ; i < pixels; i++ )
+		in[i] = in[i] < 224 ? in[i] : 0;
+}
+
+static void Image_LerpRow_SSE2( byte *out, const byte *row1, const byte *row2, int count, int lerp )
+{
+	__m128i	zero = _mm_setzero_si128();
+	__m128i	vlerp = _mm_set1_epi16( (short)lerp );
+	__m128i	fixup = _mm_set1_epi16( FBitSet( lerp, 0x8000 ) ? -1 : 0 );
+	__m128i	a, b, alo, ahi, dlo, dhi;
+	int	i, r;
+
+	for( i = 0; i + 16 <= count; i += 16 )
+	{
+		a = _mm_loadu_si128((const __m128i *)(row1 + i));
+		b = _mm_loadu_si128((const __m128i *)(row2 + i));
+		alo = _mm_unpacklo_epi8( a, zero );
+		ahi = _mm_unpackhi_epi8( a, zero );
+		dlo = _mm_sub_epi16( _mm_unpacklo_epi8( b, zero ), alo );
+		dhi = _mm_sub_epi16( _mm_unpackhi_epi8( b, zero ), ahi );
+		dlo = _mm_add_epi16( _mm_mulhi_epi16( dlo, vlerp ), _mm_and_si128( dlo, fixup ));
+		dhi = _mm_add_epi16( _mm_mulhi_epi16( dhi, vlerp ), _mm_and_si128( dhi, fixup ));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16( _mm_add_epi16( alo, dlo ), _mm_add_epi16( ahi, dhi )));
+	}
+
+	for( ; i < count; i++ )
+	{
+		r = row1[i];
+		out[i] = (byte)((((row2[i] - r) * lerp)>>16 ) + r );
+	}
+}
+
+static void Image_LerpLine32_SSE2( const byte *in, byte *out, int inwidth, int outwidth )
+{
+	int	j, xi, oldx = 0, f, fstep, endx, lerp;
+	__m128i	zero = _mm_setzero_si128();
+	__m128i	pix, diff, vlerp, fixup;
+
+	fstep = (int)(inwidth * 65536.0f / outwidth);
+	endx = (inwidth-1);
+
+	for( j = 0, f = 0; j < outwidth; j++, f += fstep, out += 4 )
+	{
+		xi = f>>16;
+		if( xi != oldx )
+		{
+			in += (xi - oldx) * 4;
+			oldx = xi;
+		}
+		if( xi < endx )
+		{
+			lerp = f & 0xFFFF;
+			vlerp = _mm_set1_epi16( (short)lerp );
+			fixup = _mm_set1_epi16( FBitSet( lerp, 0x8000 ) ? -1 : 0 );
+
+			// two neighbour pixels in the low and high halves
+			pix = _mm_unpacklo_epi8( _mm_loadl_epi64((const __m128i *)in ), zero );
+			diff = _mm_sub_epi16( _mm_srli_si128( pix, 8 ), pix );
+			diff = _mm_add_epi16( _mm_mulhi_epi16( diff, vlerp ), _mm_and_si128( diff, fixup ));
+			pix = _mm_add_epi16( pix, diff );
+			*(int *)out = _mm_cvtsi128_si32( _mm_packus_epi16( pix, pix ));
+		}
+		else // last pixel of the line has no pixel to lerp to
+		{
+			*(int *)out = *(const int *)in;
+		}
+	}
+}
+
+static void Image_MipRow32_SSE2( byte *out, const byte *in, const byte *next, int srcwidth )
+{
+	int	x, row, mipwidth = Q_max( 1, srcwidth >> 1 );
+	__m128i	zero = _mm_setzero_si128();
+	__m128i	a, b, lo, hi;
+
+	// two output pixels from four source columns per step
+	for( x = 0, row = 0; x + 2 <= mipwidth && ( x << 1 ) + 3 < srcwidth; x += 2, row += 16, out += 8 )
+	{
+		a = _mm_loadu_si128((const __m128i *)(in + row));
+		b = _mm_loadu_si128((const __m128i *)(next + row));
+		lo = _mm_add_epi16( _mm_unpacklo_epi8( a, zero ), _mm_unpacklo_epi8( b, zero ));
+		hi = _mm_add_epi16( _mm_unpackhi_epi8( a, zero ), _mm_unpackhi_epi8( b, zero ));
+		lo = _mm_add_epi16( _mm_unpacklo_epi64( lo, hi ), _mm_unpackhi_epi64( lo, hi ));
+		lo = _mm_srli_epi16( lo, 2 );
+		_mm_storel_epi64((__m128i *)out, _mm_packus_epi16( lo, zero ));
+	}
+
+	if( x < mipwidth )
+		Image_MipRow32_Ref( out, in + row, next + row, srcwidth - ( x << 1 ));
+}
+
+static const imgkernels_t img_kernels_sse2 =
+{
+	"sse2",
+	Image_Expand8to32_SSE2,
+	Image_ClearLuma_SSE2,
+	Image_LerpRow_SSE2,
+	Image_LerpLine32_SSE2,
+	Image_MipRow32_SSE2,
+};
+#endif
+
+/*
+=============================================================================
+
+	KERNELS DISPATCH
+
+=============================================================================
+*/
+/*
+================
+Image_InitKernels
+
+pick the fastest kernels for this cpu
+================
+*/
+void Image_InitKernels( void )
+{
+	imgkernels = img_kernels_ref;
+#ifdef XASH_SSE2
+	if( FBitSet( Sys_CPUFeatures(), CPU_SSE2 ))
+		imgkernels = img_kernels_sse2;
+#endif
+	Con_Reportf( "Image: using %s pixel kernels\n", imgkernels.name );
+}
+
+/*
+================
+Image_BuildMipRow
+
+box filter one row of RGBA mipmap
+================
+*/
+void Image_BuildMipRow( byte *out, const byte *in, const byte *next, int srcWidth )
+{
+	imgkernels.MipRow32( out, in, next, srcWidth );
+}
+
+/*
+================
+Image_ProfileKernel
+
+run the kernel set through the same input
+================
+*/
+static double Image_ProfileKernel( const imgkernels_t *k, int kernel, byte *src, byte *out, const uint *pal, int count )
+{
+	double	start;
+	int	i, y;
+
+	start = Sys_DoubleTime();
+
+	for( i = 0; i < count; i++ )
+	{
+		switch( kernel )
+		{
+		case 0:
+			k->Expand8to32( src, (uint *)out, pal, 256 * 256 );
+			break;
+		case 1:
+			memcpy( out, src, 256 * 256 );
+			k->ClearLuma( out, 256 * 256 );
+			break;
+		case 2:
+			for( y = 0; y < 256; y++ )
+				k->LerpRow( out + y * 1024, src + y * 1024, src + ( y + 1 ) * 1024, 1024, ( y * 251 + i ) & 0xFFFF );
+			break;
+		case 3:
+			for( y = 0; y < 256; y++ )
+				k->LerpLine32( src + y * 744, out + y * 1024, 186, 256 );
+			break;
+		case 4:
+			for( y = 0; y < 128; y++ )
+				k->MipRow32( out + y * 512, src + y * 2048, src + y * 2048 + 1024, 256 );
+			break;
+		}
+	}
+
+	return Sys_DoubleTime() - start;
+}
+
+/*
+================
+Image_Profiling_f
+
+compare kernels against reference and print the throughput
+================
+*/
+void Image_Profiling_f( void )
+{
+	const char	*names[5] = { "palette expand", "luma clear", "lerp row", "lerp line", "mip row" };
+	const int		pixels[5] = { 256 * 256, 256 * 256, 256 * 256, 256 * 256, 128 * 128 };
+	byte		*src, *ref, *out;
+	uint		pal[256];
+	double		t1, t2;
+	int		i, k, count = 500;
+	qboolean		match;
+
+	if( Cmd_Argc() > 1 )
+		count = bound( 1, Q_atoi( Cmd_Argv( 1 )), 100000 );
+
+	src = Mem_Malloc( host.imagepool, 1024 * 258 );
+	ref = Mem_Malloc( host.imagepool, 1024 * 256 );
+	out = Mem_Malloc( host.imagepool, 1024 * 256 );
+
+	for( i = 0; i < 1024 * 258; i++ )
+		src[i] = COM_RandomLong( 0, 255 );
+	for( i = 0; i < 256; i++ )
+		pal[i] = COM_RandomLong( 0, 0x7FFFFFFF );
+
+	Con_Printf( "Profiling %i calls to %s kernels\n", count, imgkernels.name );
+
+	for( k = 0; k < 5; k++ )
+	{
+		memset( ref, 0, 1024 * 256 );
+		memset( out, 0, 1024 * 256 );
+
+		t1 = Image_ProfileKernel( &img_kernels_ref, k, src, ref, pal, 1 );
+		t2 = Image_ProfileKernel( &imgkernels, k, src, out, pal, 1 );
+		match = !memcmp( ref, out, 1024 * 256 );
+
+		t1 = Image_ProfileKernel( &img_kernels_ref, k, src, ref, pal, count );
+		t2 = Image_ProfileKernel( &imgkernels, k, src, out, pal, count );
+
+		Con_Printf( "%-16s reference %8.2f MPix/s, %s %8.2f MPix/s (%s)\n", names[k],
+			(double)pixels[k] * count / ( t1 * 1000000.0 ), imgkernels.name,
+			(double)pixels[k] * count / ( t2 * 1000000.0 ),
+			match ? "^2match^7" : "^1MISMATCH^7" );
+	}
+
+	Mem_Free( src );
+	Mem_Free( ref );
+	Mem_Free( out );
+}
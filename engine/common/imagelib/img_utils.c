@@ -18,7 +18,6 @@ GNU General Public License for more details.
 #include "mod_local.h"
 #include "gl_export.h"
 
-#define LERPBYTE( i )	r = resamplerow1[i]; out[i] = (byte)(((( resamplerow2[i] - r ) * lerp)>>16 ) + r )
 #define FILTER_SIZE		5
 
 uint d_8toQ1table[256];
@@ -164,10 +163,14 @@ void Image_Init( void )
 	}
 
 	image.tempbuffer = NULL;
+
+	Image_InitKernels();
+	Cmd_AddCommand( "image_profile", Image_Profiling_f, "imagelib kernels stress-test, compares them with reference code" );
 }
 
 void Image_Shutdown( void )
 {
+	Cmd_RemoveCommand( "image_profile" );
 	Mem_Check(); // check for leaks
 	Mem_FreePool( &host.imagepool );
 }
@@ -581,8 +584,6 @@ NOTE: must call Image_GetPaletteXXX before used
 */
 qboolean Image_Copy8bitRGBA( const byte *in, byte *out, int pixels )
 {
-	int	*iout = (int *)out;
-	byte	*fin = (byte *)in;
 	byte	*col;
 	int	i;
 
@@ -591,10 +592,7 @@ qboolean Image_Copy8bitRGBA( const byte *in, byte *out, int pixels )
 
 	// this is a base image with luma - clear luma pixels
 	if( image.flags & IMAGE_HAS_LUMA )
-	{
-		for( i = 0; i < image.width * image.height; i++ )
-			fin[i] = fin[i] < 224 ? fin[i] : 0;
-	}
+		imgkernels.ClearLuma( (byte *)in, image.width * image.height );
 
 	// check for color
 	for( i = 0; i < 256; i++ )
@@ -607,80 +605,12 @@ qboolean Image_Copy8bitRGBA( const byte *in, byte *out, int pixels )
 		}
 	}
 
-	while( pixels >= 8 )
-	{
-		iout[0] = image.d_currentpal[in[0]];
-		iout[1] = image.d_currentpal[in[1]];
-		iout[2] = image.d_currentpal[in[2]];
-		iout[3] = image.d_currentpal[in[3]];
-		iout[4] = image.d_currentpal[in[4]];
-		iout[5] = image.d_currentpal[in[5]];
-		iout[6] = image.d_currentpal[in[6]];
-		iout[7] = image.d_currentpal[in[7]];
-
-		in += 8;
-		iout += 8;
-		pixels -= 8;
-	}
-
-	if( pixels & 4 )
-	{
-		iout[0] = image.d_currentpal[in[0]];
-		iout[1] = image.d_currentpal[in[1]];
-		iout[2] = image.d_currentpal[in[2]];
-		iout[3] = image.d_currentpal[in[3]];
-		in += 4;
-		iout += 4;
-	}
-
-	if( pixels & 2 )
-	{
-		iout[0] = image.d_currentpal[in[0]];
-		iout[1] = image.d_currentpal[in[1]];
-		in += 2;
-		iout += 2;
-	}
-
-	if( pixels & 1 ) // last byte
-		iout[0] = image.d_currentpal[in[0]];
+	imgkernels.Expand8to32( in, (uint *)out, image.d_currentpal, pixels );
 	image.type = PF_RGBA_32;	// update image type;
 
 	return true;
 }
 
-static void Image_Resample32LerpLine( const byte *in, byte *out, int inwidth, int outwidth )
-{
-	int	j, xi, oldx = 0, f, fstep, endx, lerp;
-
-	fstep = (int)(inwidth * 65536.0f / outwidth);
-	endx = (inwidth-1);
-
-	for( j = 0, f = 0; j < outwidth; j++, f += fstep )
-	{
-		xi = f>>16;
-		if( xi != oldx )
-		{
-			in += (xi - oldx) * 4;
-			oldx = xi;
-		}
-		if( xi < endx )
-		{
-			lerp = f & 0xFFFF;
-			*out++ = (byte)((((in[4] - in[0]) * lerp)>>16) + in[0]);
-			*out++ = (byte)((((in[5] - in[1]) * lerp)>>16) + in[1]);
-			*out++ = (byte)((((in[6] - in[2]) * lerp)>>16) + in[2]);
-			*out++ = (byte)((((in[7] - in[3]) * lerp)>>16) + in[3]);
-		}
-		else // last pixel of the line has no pixel to lerp to
-		{
-			*out++ = in[0];
-			*out++ = in[1];
-			*out++ = in[2];
-			*out++ = in[3];
-		}
-	}
-}
-
 static void Image_Resample24LerpLine( const byte *in, byte *out, int inwidth, int outwidth )
 {
 	int	j, xi, oldx = 0, f, fstep, endx, lerp;
@@ -717,7 +647,7 @@ static void Image_Resample24LerpLine( const byte *in, byte *out, int inwidth, in
 void Image_Resample32Lerp( const void *indata, int inwidth, int inheight, void *outdata, int outwidth, int outheight )
 {
 	const byte *inrow;
-	int	i, j, r, yi, oldy = 0, f, fstep, lerp, endy = (inheight - 1);
+	int	i, yi, oldy = 0, f, fstep, endy = (inheight - 1);
 	int	inwidth4 = inwidth * 4;
 	int	outwidth4 = outwidth * 4;
 	byte	*out = (byte *)outdata;
@@ -731,79 +661,25 @@ void Image_Resample32Lerp( const void *indata, int inwidth, int inheight, void *
 
 	inrow = (const byte *)indata;
 
-	Image_Resample32LerpLine( inrow, resamplerow1, inwidth, outwidth );
-	Image_Resample32LerpLine( inrow + inwidth4, resamplerow2, inwidth, outwidth );
+	imgkernels.LerpLine32( inrow, resamplerow1, inwidth, outwidth );
+	imgkernels.LerpLine32( inrow + inwidth4, resamplerow2, inwidth, outwidth );
 
-	for( i = 0, f = 0; i < outheight; i++, f += fstep )
+	for( i = 0, f = 0; i < outheight; i++, f += fstep, out += outwidth4 )
 	{
 		yi = f>>16;
 
 		if( yi < endy )
 		{
-			lerp = f & 0xFFFF;
 			if( yi != oldy )
 			{
 				inrow = (byte *)indata + inwidth4 * yi;
 				if( yi == oldy + 1 ) memcpy( resamplerow1, resamplerow2, outwidth4 );
-				else Image_Resample32LerpLine( inrow, resamplerow1, inwidth, outwidth );
-				Image_Resample32LerpLine( inrow + inwidth4, resamplerow2, inwidth, outwidth );
+				else imgkernels.LerpLine32( inrow, resamplerow1, inwidth, outwidth );
+				imgkernels.LerpLine32( inrow + inwidth4, resamplerow2, inwidth, outwidth );
 				oldy = yi;
 			}
 
-			j = outwidth - 4;
-
-			while( j >= 0 )
-			{
-				LERPBYTE( 0);
-				LERPBYTE( 1);
-				LERPBYTE( 2);
-				LERPBYTE( 3);
-				LERPBYTE( 4);
-				LERPBYTE( 5);
-				LERPBYTE( 6);
-				LERPBYTE( 7);
-				LERPBYTE( 8);
-				LERPBYTE( 9);
-				LERPBYTE(10);
-				LERPBYTE(11);
-				LERPBYTE(12);
-				LERPBYTE(13);
-				LERPBYTE(14);
-				LERPBYTE(15);
-				out += 16;
-				resamplerow1 += 16;
-				resamplerow2 += 16;
-				j -= 4;
-			}
-
-			if( j & 2 )
-			{
-				LERPBYTE( 0);
-				LERPBYTE( 1);
-				LERPBYTE( 2);
-				LERPBYTE( 3);
-				LERPBYTE( 4);
-				LERPBYTE( 5);
-				LERPBYTE( 6);
-				LERPBYTE( 7);
-				out += 8;
-				resamplerow1 += 8;
-				resamplerow2 += 8;
-			}
-
-			if( j & 1 )
-			{
-				LERPBYTE( 0);
-				LERPBYTE( 1);
-				LERPBYTE( 2);
-				LERPBYTE( 3);
-				out += 4;
-				resamplerow1 += 4;
-				resamplerow2 += 4;
-			}
-
-			resamplerow1 -= outwidth4;
-			resamplerow2 -= outwidth4;
+			imgkernels.LerpRow( out, resamplerow1, resamplerow2, outwidth4, f & 0xFFFF );
 		}
 		else
 		{
@@ -811,7 +687,7 @@ void Image_Resample32Lerp( const void *indata, int inwidth, int inheight, void *
 			{
 				inrow = (byte *)indata + inwidth4 * yi;
 				if( yi == oldy + 1 ) memcpy( resamplerow1, resamplerow2, outwidth4 );
-				else Image_Resample32LerpLine( inrow, resamplerow1, inwidth, outwidth);
+				else imgkernels.LerpLine32( inrow, resamplerow1, inwidth, outwidth);
 				oldy = yi;
 			}
 
@@ -864,7 +740,7 @@ void Image_Resample32Nolerp( const void *indata, int inwidth, int inheight, void
 void Image_Resample24Lerp( const void *indata, int inwidth, int inheight, void *outdata, int outwidth, int outheight )
 {
 	const byte *inrow;
-	int	i, j, r, yi, oldy, f, fstep, lerp, endy = (inheight - 1);
+	int	i, yi, oldy, f, fstep, endy = (inheight - 1);
 	int	inwidth3 = inwidth * 3;
 	int	outwidth3 = outwidth * 3;
 	byte	*out = (byte *)outdata;
@@ -881,13 +757,12 @@ void Image_Resample24Lerp( const void *indata, int inwidth, int inheight, void *
 	Image_Resample24LerpLine( inrow, resamplerow1, inwidth, outwidth );
 	Image_Resample24LerpLine( inrow + inwidth3, resamplerow2, inwidth, outwidth );
 
-	for( i = 0, f = 0; i < outheight; i++, f += fstep )
+	for( i = 0, f = 0; i < outheight; i++, f += fstep, out += outwidth3 )
 	{
 		yi = f>>16;
 
 		if( yi < endy )
 		{
-			lerp = f & 0xFFFF;
 			if( yi != oldy )
 			{
 				inrow = (byte *)indata + inwidth3 * yi;
@@ -897,53 +772,7 @@ void Image_Resample24Lerp( const void *indata, int inwidth, int inheight, void *
 				oldy = yi;
 			}
 
-			j = outwidth - 4;
-
-			while( j >= 0 )
-			{
-				LERPBYTE( 0);
-				LERPBYTE( 1);
-				LERPBYTE( 2);
-				LERPBYTE( 3);
-				LERPBYTE( 4);
-				LERPBYTE( 5);
-				LERPBYTE( 6);
-				LERPBYTE( 7);
-				LERPBYTE( 8);
-				LERPBYTE( 9);
-				LERPBYTE(10);
-				LERPBYTE(11);
-				out += 12;
-				resamplerow1 += 12;
-				resamplerow2 += 12;
-				j -= 4;
-			}
-
-			if( j & 2 )
-			{
-				LERPBYTE( 0);
-				LERPBYTE( 1);
-				LERPBYTE( 2);
-				LERPBYTE( 3);
-				LERPBYTE( 4);
-				LERPBYTE( 5);
-				out += 6;
-				resamplerow1 += 6;
-				resamplerow2 += 6;
-			}
-
-			if( j & 1 )
-			{
-				LERPBYTE( 0);
-				LERPBYTE( 1);
-				LERPBYTE( 2);
-				out += 3;
-				resamplerow1 += 3;
-				resamplerow2 += 3;
-			}
-
-			resamplerow1 -= outwidth3;
-			resamplerow2 -= outwidth3;
+			imgkernels.LerpRow( out, resamplerow1, resamplerow2, outwidth3, f & 0xFFFF );
 		}
 		else
 		{
@@ -1316,17 +1145,18 @@ rgbdata_t *Image_DecompressInternal( rgbdata_t *pic )
 
 rgbdata_t *Image_LightGamma( rgbdata_t *pic )
 {
-	byte	*in = (byte *)pic->buffer;
-	int	i;
+	const byte	*gamma = LightGammaTable();
+	byte		*in = (byte *)pic->buffer;
+	int		i;
 
 	if( pic->type != PF_RGBA_32 )
 		return pic;
 
 	for( i = 0; i < pic->width * pic->height; i++, in += 4 )
 	{
-		in[0] = LightToTexGamma( in[0] );
-		in[1] = LightToTexGamma( in[1] );
-		in[2] = LightToTexGamma( in[2] );
+		in[0] = gamma[in[0]];
+		in[1] = gamma[in[1]];
+		in[2] = gamma[in[2]];
 	}
 
 	return pic;
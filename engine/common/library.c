@@ -511,9 +511,70 @@ static void FreeNameFuncGlobals( dll_user_t *hInst )
 			Mem_Free( hInst->names[i] );
 	}
 
+	if( hInst->nameHash ) Mem_Free( hInst->nameHash );
+	if( hInst->sortedFuncs ) Mem_Free( hInst->sortedFuncs );
+
 	hInst->num_ordinals = 0;
 	hInst->ordinals = NULL;
 	hInst->funcs = NULL;
+	hInst->nameHash = NULL;
+	hInst->nameHashSize = 0;
+	hInst->sortedFuncs = NULL;
+}
+
+static dll_user_t	*sort_library;	// for LibrarySortFuncs
+
+static int LibrarySortFuncs( const void *a, const void *b )
+{
+	int	i1 = *(const word *)a;
+	int	i2 = *(const word *)b;
+	dword	f1 = sort_library->funcs[sort_library->ordinals[i1]];
+	dword	f2 = sort_library->funcs[sort_library->ordinals[i2]];
+
+	if( f1 != f2 )
+		return ( f1 < f2 ) ? -1 : 1;
+
+	// equal addresses keep the export order, the first name wins
+	return i1 - i2;
+}
+
+/*
+================
+LibraryBuildLookups
+
+name hash and address order of the exports. Equal names and
+equal addresses resolve to the first export, as the scans did
+================
+*/
+static void LibraryBuildLookups( dll_user_t *hInst )
+{
+	int	i, slot;
+
+	if( hInst->num_ordinals <= 0 )
+		return;
+
+	for( hInst->nameHashSize = 64; hInst->nameHashSize < hInst->num_ordinals * 2; hInst->nameHashSize <<= 1 );
+
+	hInst->nameHash = Mem_Calloc( host.mempool, hInst->nameHashSize * sizeof( word ));
+	hInst->sortedFuncs = Mem_Malloc( host.mempool, hInst->num_ordinals * sizeof( word ));
+
+	// linear probing keeps the earlier of two equal names first in the chain
+	for( i = 0; i < hInst->num_ordinals; i++ )
+	{
+		hInst->sortedFuncs[i] = i;
+
+		if( !hInst->names[i] )
+			continue;
+
+		slot = COM_HashKey( hInst->names[i], hInst->nameHashSize );
+		while( hInst->nameHash[slot] )
+			slot = ( slot + 1 ) & ( hInst->nameHashSize - 1 );
+		hInst->nameHash[slot] = i + 1;
+	}
+
+	sort_library = hInst;
+	qsort( hInst->sortedFuncs, hInst->num_ordinals, sizeof( word ), LibrarySortFuncs );
+	sort_library = NULL;
 }
 
 char *GetMSVCName( const char *in_name )
@@ -749,6 +810,8 @@ qboolean LibraryLoadSymbols( dll_user_t *hInst )
 		}
 	}
 
+	LibraryBuildLookups( hInst );
+
 	if( p_Names ) Mem_Free( p_Names );
 	return true;
 table_error:
@@ -848,22 +911,65 @@ void COM_FreeLibrary( void *hInstance )
 	Mem_Free( hInst );	// done
 }
 
+static int LibraryFindName( dll_user_t *hInst, const char *pName )
+{
+	int	i, slot;
+
+	if( !hInst->nameHash || !pName )
+		return -1;
+
+	slot = COM_HashKey( pName, hInst->nameHashSize );
+
+	while(( i = hInst->nameHash[slot] ) != 0 )
+	{
+		if( !Q_strcmp( pName, hInst->names[i - 1] ))
+			return i - 1;
+		slot = ( slot + 1 ) & ( hInst->nameHashSize - 1 );
+	}
+
+	return -1;
+}
+
+static int LibraryFindFunction( dll_user_t *hInst, dword function )
+{
+	int	lo, hi, mid;
+	dword	f;
+
+	if( !hInst->sortedFuncs )
+		return -1;
+
+	function -= hInst->funcBase;
+
+	// first of the exports with this address
+	lo = 0;
+	hi = hInst->num_ordinals;
+
+	while( lo < hi )
+	{
+		mid = ( lo + hi ) >> 1;
+		f = hInst->funcs[hInst->ordinals[hInst->sortedFuncs[mid]]];
+
+		if( f < function )
+			lo = mid + 1;
+		else hi = mid;
+	}
+
+	if( lo < hInst->num_ordinals && hInst->funcs[hInst->ordinals[hInst->sortedFuncs[lo]]] == function )
+		return hInst->sortedFuncs[lo];
+
+	return -1;
+}
+
 dword COM_FunctionFromName( void *hInstance, const char *pName )
 {
 	dll_user_t	*hInst = (dll_user_t *)hInstance;
-	int		i, index;
+	int		i;
 
 	if( !hInst || !hInst->hInstance )
 		return 0;
 
-	for( i = 0; i < hInst->num_ordinals; i++ )
-	{
-		if( !Q_strcmp( pName, hInst->names[i] ))
-		{
-			index = hInst->ordinals[i];
-			return hInst->funcs[index] + hInst->funcBase;
-		}
-	}
+	if(( i = LibraryFindName( hInst, pName )) != -1 )
+		return hInst->funcs[hInst->ordinals[i]] + hInst->funcBase;
 
 	// couldn't find the function name to return address
 	Con_Printf( "Can't find proc: %s\n", pName );
@@ -874,21 +980,113 @@ dword COM_FunctionFromName( void *hInstance, const char *pName )
 const char *COM_NameForFunction( void *hInstance, dword function )
 {
 	dll_user_t	*hInst = (dll_user_t *)hInstance;
-	int		i, index;
+	int		i;
 
 	if( !hInst || !hInst->hInstance )
 		return NULL;
 
-	for( i = 0; i < hInst->num_ordinals; i++ )
-	{
-		index = hInst->ordinals[i];
-
-		if(( function - hInst->funcBase ) == hInst->funcs[index] )
-			return hInst->names[i];
-	}
+	if(( i = LibraryFindFunction( hInst, function )) != -1 )
+		return hInst->names[i];
 
 	// couldn't find the function address to return name
 	Con_Printf( "Can't find address: %08lx\n", function );
 
 	return NULL;
+}
+
+/*
+================
+COM_FunctionLookupBenchmark
+
+looks up every exported name and address as many times as
+count entities with four function pointers each would, with
+the tables and with the old scans, and checks they agree
+================
+*/
+void COM_FunctionLookupBenchmark( void *hInstance, int count )
+{
+	dll_user_t	*hInst = (dll_user_t *)hInstance;
+	double		start, scanNames, scanFuncs, hashNames, sortFuncs;
+	int		i, j, n, lookups, mismatches;
+	dword		function;
+	const char	*name;
+
+	if( !hInst || !hInst->hInstance || !hInst->num_ordinals )
+	{
+		Con_Printf( "no export table\n" );
+		return;
+	}
+
+	lookups = count * 4;
+	mismatches = 0;
+	scanNames = scanFuncs = hashNames = sortFuncs = 0.0;
+
+	for( n = 0; n < lookups; n += hInst->num_ordinals )
+	{
+		start = Sys_DoubleTime();
+		for( i = 0; i < hInst->num_ordinals && n + i < lookups; i++ )
+			LibraryFindName( hInst, hInst->names[i] );
+		hashNames += Sys_DoubleTime() - start;
+
+		start = Sys_DoubleTime();
+		for( i = 0; i < hInst->num_ordinals && n + i < lookups; i++ )
+			LibraryFindFunction( hInst, hInst->funcs[hInst->ordinals[i]] + hInst->funcBase );
+		sortFuncs += Sys_DoubleTime() - start;
+
+		start = Sys_DoubleTime();
+		for( i = 0; i < hInst->num_ordinals && n + i < lookups; i++ )
+		{
+			for( j = 0; j < hInst->num_ordinals; j++ )
+			{
+				if( !Q_strcmp( hInst->names[i], hInst->names[j] ))
+					break;
+			}
+		}
+		scanNames += Sys_DoubleTime() - start;
+
+		start = Sys_DoubleTime();
+		for( i = 0; i < hInst->num_ordinals && n + i < lookups; i++ )
+		{
+			function = hInst->funcs[hInst->ordinals[i]];
+			for( j = 0; j < hInst->num_ordinals; j++ )
+			{
+				if( function == hInst->funcs[hInst->ordinals[j]] )
+					break;
+			}
+		}
+		scanFuncs += Sys_DoubleTime() - start;
+	}
+
+	// both ways must give the same answers
+	for( i = 0; i < hInst->num_ordinals; i++ )
+	{
+		if( !hInst->names[i] )
+			continue;
+
+		for( j = 0; j < hInst->num_ordinals; j++ )
+		{
+			if( !Q_strcmp( hInst->names[i], hInst->names[j] ))
+				break;
+		}
+
+		if( LibraryFindName( hInst, hInst->names[i] ) != j )
+			mismatches++;
+
+		function = hInst->funcs[hInst->ordinals[i]];
+		for( j = 0; j < hInst->num_ordinals; j++ )
+		{
+			if( function == hInst->funcs[hInst->ordinals[j]] )
+				break;
+		}
+
+		n = LibraryFindFunction( hInst, function + hInst->funcBase );
+		name = ( n != -1 ) ? hInst->names[n] : NULL;
+		if( name != hInst->names[j] )
+			mismatches++;
+	}
+
+	Con_Printf( "%s: %i exports, %i lookups each way\n", hInst->dllName, hInst->num_ordinals, lookups );
+	Con_Printf( "name to function: %.4f sec scanning, %.4f sec hashed\n", scanNames, hashNames );
+	Con_Printf( "function to name: %.4f sec scanning, %.4f sec sorted\n", scanFuncs, sortFuncs );
+	if( mismatches ) Con_Printf( "^1%i lookups disagree^7\n", mismatches );
 }
\ No newline at end of file
@@ -152,6 +152,11 @@ typedef struct dll_user_s
 	char	*names[MAX_LIBRARY_EXPORTS];	// max 4096 exports supported
 	int	num_ordinals;		// actual exports count
 	dword	funcBase;			// base offset
+
+	// lookup tables for COM_FunctionFromName and COM_NameForFunction
+	word	*nameHash;		// name index + 1 in each slot, 0 is empty
+	int	nameHashSize;		// power of two
+	word	*sortedFuncs;		// name indices ordered by function address
 } dll_user_t;
 
 dll_user_t *FS_FindLibrary( const char *dllname, qboolean directpath );
@@ -160,5 +165,6 @@ void *COM_GetProcAddress( void *hInstance, const char *name );
 const char *COM_NameForFunction( void *hInstance, dword function );
 dword COM_FunctionFromName( void *hInstance, const char *pName );
 void COM_FreeLibrary( void *hInstance );
+void COM_FunctionLookupBenchmark( void *hInstance, int count );
 
 #endif//LIBRARY_H
\ No newline at end of file
@@ -42,6 +42,46 @@ typedef struct leaflist_s
 	int			topnode;		// for overflows where each leaf can't be stored individually
 } leaflist_t;
 
+// processed world data, see Mod_OpenWorldCache
+#define IDBMCACHEHEADER	(('C'<<24)+('M'<<16)+('B'<<8)+'X') // little-endian "XBMC"
+#define BMCACHE_VERSION	1
+
+typedef struct
+{
+	vec3_t			mins, maxs;	// mextrasurf_t
+	vec3_t			origin;
+	float			lmvecs[2][4];
+	short			lightmapmins[2];
+	short			lightextents[2];
+	short			texturemins[2];	// msurface_t
+	short			extents[2];
+} dsurfcache_t;
+
+typedef struct
+{
+	int			clipnodeofs;	// -1 if hull is missed
+	int			numclipnodes;
+	vec3_t			clip_mins;
+	vec3_t			clip_maxs;
+} dhullcache_t;
+
+typedef struct
+{
+	int			ident;
+	int			version;
+	int			buildnum;
+	dword			checksum;		// bsp lumps and hull sizes
+	int			numsurfaces;
+	int			numbevelplanes;
+	int			numsubmodels;
+	int			numnodes;
+	int			surfofs;		// dsurfcache_t[numsurfaces]
+	int			bevelofs;		// mfacebevel_t[numsurfaces], edges are file offsets
+	int			hull0ofs;		// mclipnode_t[numnodes]
+	int			hullofs;		// dhullcache_t[numsubmodels][MAX_MAP_HULLS]
+	int			filesize;
+} dbmcache_t;
+
 typedef struct
 {
 	// generic lumps
@@ -130,6 +170,11 @@ typedef struct
 	byte			*shadowdata_out;	// occlusion data pointer
 	dclipnode32_t		*clipnodes_out;	// temporary 32-bit array to hold clipnodes
 
+	// world cache
+	dbmcache_t		*cache;		// mapped processed data or NULL
+	dword			cachecrc;
+	hull_t			*cachehulls;	// hulls to write, [numsubmodels][MAX_MAP_HULLS]
+
 	// misc stuff
 	wadlist_t			wadlist;
 	int			lightmap_samples;	// samples per lightmap (1 or 3)
@@ -174,12 +219,66 @@ typedef struct
 	size_t		*count;
 } mlumpinfo_t;
 
+// loaders in the order of Mod_LoadBmodelLumps
+enum
+{
+	LOAD_ENTITIES = 0,
+	LOAD_PLANES,
+	LOAD_SUBMODELS,
+	LOAD_VERTEXES,
+	LOAD_EDGES,
+	LOAD_SURFEDGES,
+	LOAD_TEXTURES,
+	LOAD_VISIBILITY,
+	LOAD_TEXINFO,
+	LOAD_SURFACES,
+	LOAD_LIGHTING,
+	LOAD_MARKSURFACES,
+	LOAD_LEAFS,
+	LOAD_NODES,
+	LOAD_CLIPNODES,
+	LOAD_COUNT
+};
+
+typedef struct
+{
+	const char	*name;
+	void		(*load)( dbspmodel_t *bmod );		// serial, allocates and reports
+	void		(*convert)( dbspmodel_t *bmod, int first, int last, int thread );
+	void		(*finish)( dbspmodel_t *bmod );		// serial, after the convert jobs
+	int		chunksize;			// items per convert job
+	int		depends;				// loaders that must be finished before
+} mloader_t;
+
+typedef struct
+{
+	int		loader;
+	int		first;
+	int		last;
+} mloadchunk_t;
+
+typedef struct
+{
+	mloadchunk_t	*chunks;
+	double		time[LOAD_COUNT];			// serial parts
+	double		jobtime[LOAD_COUNT][MAX_JOB_THREADS];	// convert jobs, summed per thread
+
+	// per-thread results of the convert jobs
+	vec3_t		mins[MAX_JOB_THREADS];		// world bounds from the vertexes
+	vec3_t		maxs[MAX_JOB_THREADS];
+	int		badplanes[MAX_JOB_THREADS];
+} mloadjobs_t;
+
 world_static_t		world;
 static dbspmodel_t		srcmodel;
 static loadstat_t		loadstat;
 static model_t		*worldmodel;
 static byte		g_visdata[(MAX_MAP_LEAFS+7)/8];	// intermediate buffer
 static mlumpstat_t		worldstats[HEADER_LUMPS+EXTRA_LUMPS];
+static mloadjobs_t		loadjobs;
+static qboolean		loadbench;	// stop after the lumps, see Mod_LoadBenchmark_f
+static byte		*worldcache;	// mapped cache file of the world
+static model_t		*worldcachemodel;	// model that uses worldcache
 static mlumpinfo_t		srclumps[HEADER_LUMPS] =
 {
 { LUMP_ENTITIES, 32, MAX_MAP_ENTSTRING, sizeof( byte ), -1, "entities", 0, (void **)&srcmodel.entdata, &srcmodel.entdatasize },
@@ -1042,9 +1141,6 @@ static void Mod_CalcSurfaceExtents( msurface_t *surf )
 	{
 		e = loadmodel->surfedges[surf->firstedge + i];
 
-		if( e >= loadmodel->numedges || e <= -loadmodel->numedges )
-			Host_Error( "Mod_CalcSurfaceExtents: bad edge\n" );
-
 		if( e >= 0 ) v = &loadmodel->vertexes[loadmodel->edges[e].v[0]];
 		else v = &loadmodel->vertexes[loadmodel->edges[-e].v[1]];
 
@@ -1085,9 +1181,6 @@ static void Mod_CalcSurfaceExtents( msurface_t *surf )
 			info->lightmapmins[i] = surf->texturemins[i];
 			info->lightextents[i] = surf->extents[i];
 		}
-
-		if( !FBitSet( tex->flags, TEX_SPECIAL ) && ( surf->extents[i] > 16384 ) && ( tr.block_size == BLOCK_SIZE_DEFAULT ))
-			Con_Reportf( S_ERROR "Bad surface extents %i\n", surf->extents[i] );
 	}
 }
 
@@ -1109,9 +1202,6 @@ static void Mod_CalcSurfaceBounds( msurface_t *surf )
 	{
 		e = loadmodel->surfedges[surf->firstedge + i];
 
-		if( e >= loadmodel->numedges || e <= -loadmodel->numedges )
-			Host_Error( "Mod_CalcSurfaceBounds: bad edge\n" );
-
 		if( e >= 0 ) v = &loadmodel->vertexes[loadmodel->edges[e].v[0]];
 		else v = &loadmodel->vertexes[loadmodel->edges[-e].v[1]];
 		AddPointToBounds( v->position, surf->info->mins, surf->info->maxs );
@@ -1123,31 +1213,23 @@ static void Mod_CalcSurfaceBounds( msurface_t *surf )
 /*
 =================
 Mod_CreateFaceBevels
+
+surf->info->bevel is allocated by Mod_LoadSurfaces
 =================
 */
 static void Mod_CreateFaceBevels( msurface_t *surf )
 {
 	vec3_t		delta, edgevec;
-	byte		*facebevel;
 	vec3_t		faceNormal;
 	mvertex_t		*v0, *v1;
-	int		contents;
-	int		i, size;
+	int		i;
 	vec_t		radius;
-	mfacebevel_t	*fb;
+	mfacebevel_t	*fb = surf->info->bevel;
 
 	if( surf->texinfo && surf->texinfo->texture )
-		contents = Mod_GetFaceContents( surf->texinfo->texture->name );
-	else contents = CONTENTS_SOLID;
-
-	size = sizeof( mfacebevel_t ) + surf->numedges * sizeof( mplane_t );
-	facebevel = (byte *)Mem_Calloc( loadmodel->mempool, size );
-	fb = (mfacebevel_t *)facebevel;
-	facebevel += sizeof( mfacebevel_t );
-	fb->edges = (mplane_t *)facebevel;
+		fb->contents = Mod_GetFaceContents( surf->texinfo->texture->name );
+	else fb->contents = CONTENTS_SOLID;
 	fb->numedges = surf->numedges;
-	fb->contents = contents;
-	surf->info->bevel = fb;
 
 	if( FBitSet( surf->flags, SURF_PLANEBACK ))
 		VectorNegate( surf->plane->normal, faceNormal );
@@ -1269,7 +1351,7 @@ Mod_MakeHull0
 Duplicate the drawing hull structure as a clipping hull
 =================
 */
-static void Mod_MakeHull0( void )
+static void Mod_MakeHull0( dbspmodel_t *bmod )
 {
 	mnode_t		*in, *child;
 	mclipnode_t	*out;
@@ -1277,13 +1359,19 @@ static void Mod_MakeHull0( void )
 	int		i, j;
 	
 	hull = &loadmodel->hulls[0];	
-	hull->clipnodes = out = Mem_Malloc( loadmodel->mempool, loadmodel->numnodes * sizeof( *out ));	
-	in = loadmodel->nodes;
-
 	hull->firstclipnode = 0;
 	hull->lastclipnode = loadmodel->numnodes - 1;
 	hull->planes = loadmodel->planes;
 
+	if( bmod->cache )
+	{
+		hull->clipnodes = (mclipnode_t *)((byte *)bmod->cache + bmod->cache->hull0ofs);
+		return;
+	}
+
+	hull->clipnodes = out = Mem_Malloc( loadmodel->mempool, loadmodel->numnodes * sizeof( *out ));	
+	in = loadmodel->nodes;
+
 	for( i = 0; i < loadmodel->numnodes; i++, out++, in++ )
 	{
 		out->planenum = in->plane - loadmodel->planes;
@@ -1353,6 +1441,34 @@ static void Mod_SetupHull( dbspmodel_t *bmod, model_t *mod, byte *mempool, int h
 	RemapClipNodes_r( bmod->clipnodes_out, hull, headnode );
 }
 
+/*
+=================
+Mod_HullFromCache
+
+same as Mod_SetupHull but the clipnodes are mapped
+=================
+*/
+static void Mod_HullFromCache( dbspmodel_t *bmod, model_t *mod, int submodel, int hullnum )
+{
+	dhullcache_t	*in = (dhullcache_t *)((byte *)bmod->cache + bmod->cache->hullofs) + submodel * MAX_MAP_HULLS + hullnum;
+	hull_t		*hull = &mod->hulls[hullnum];
+
+	VectorCopy( in->clip_mins, hull->clip_mins );
+	VectorCopy( in->clip_maxs, hull->clip_maxs );
+	hull->firstclipnode = 0;
+
+	if( in->clipnodeofs == -1 )
+	{
+		hull->lastclipnode = 0;
+		hull->planes = NULL; // hull is missed
+		return;
+	}
+
+	hull->clipnodes = (mclipnode_t *)((byte *)bmod->cache + in->clipnodeofs);
+	hull->lastclipnode = in->numclipnodes;
+	hull->planes = mod->planes; // share planes
+}
+
 /*
 =================
 Mod_LoadColoredLighting
@@ -1496,8 +1612,20 @@ static void Mod_SetupSubmodels( dbspmodel_t *bmod )
 
 		// but hulls1-3 is build individually for a each given submodel
 		for( j = 1; j < MAX_MAP_HULLS; j++ )
+		{
+			if( bmod->cache )
+			{
+				Mod_HullFromCache( bmod, mod, i, j );
+				continue;
+			}
+
 			Mod_SetupHull( bmod, mod, mempool, bm->headnode[j], j );
 
+			// keep the remapped clipnodes for the cache
+			if( bmod->cachehulls )
+				bmod->cachehulls[i * MAX_MAP_HULLS + j] = mod->hulls[j];
+		}
+
 		mod->firstmodelsurface = bm->firstface;
 		mod->nummodelsurfaces = bm->numfaces;
 
@@ -1745,15 +1873,17 @@ Mod_LoadPlanes
 */
 static void Mod_LoadPlanes( dbspmodel_t *bmod )
 {
-	dplane_t	*in;
-	mplane_t	*out;
-	int	i, j;
-
-	in = bmod->planes;
-	loadmodel->planes = out = Mem_Malloc( loadmodel->mempool, bmod->numplanes * sizeof( *out ));
+	loadmodel->planes = Mem_Malloc( loadmodel->mempool, bmod->numplanes * sizeof( mplane_t ));
 	loadmodel->numplanes = bmod->numplanes;
+}
+
+static void Mod_ConvertPlanes( dbspmodel_t *bmod, int first, int last, int thread )
+{
+	dplane_t	*in = bmod->planes + first;
+	mplane_t	*out = loadmodel->planes + first;
+	int	i, j;
 
-	for( i = 0; i < bmod->numplanes; i++, in++, out++ )
+	for( i = first; i < last; i++, in++, out++ )
 	{
 		out->signbits = 0;
 		for( j = 0; j < 3; j++ )
@@ -1765,13 +1895,29 @@ static void Mod_LoadPlanes( dbspmodel_t *bmod )
 		}
 
 		if( VectorLength( out->normal ) < 0.5f )
-			Con_Printf( S_ERROR "bad normal for plane #%i\n", i );
+			loadjobs.badplanes[thread]++;
 
 		out->dist = in->dist;
 		out->type = in->type;
 	}
 }
 
+static void Mod_FinishPlanes( dbspmodel_t *bmod )
+{
+	int	i, badplanes = 0;
+
+	for( i = 0; i < MAX_JOB_THREADS; i++ )
+		badplanes += loadjobs.badplanes[i];
+
+	if( !badplanes ) return;
+
+	for( i = 0; i < loadmodel->numplanes; i++ )
+	{
+		if( VectorLength( loadmodel->planes[i].normal ) < 0.5f )
+			Con_Printf( S_ERROR "bad normal for plane #%i\n", i );
+	}
+}
+
 /*
 =================
 Mod_LoadVertexes
@@ -1779,25 +1925,46 @@ Mod_LoadVertexes
 */
 static void Mod_LoadVertexes( dbspmodel_t *bmod )
 {
-	dvertex_t	*in;
-	mvertex_t	*out;
 	int	i;
 
-	in = bmod->vertexes;
-	out = loadmodel->vertexes = Mem_Malloc( loadmodel->mempool, bmod->numvertexes * sizeof( mvertex_t ));
+	loadmodel->vertexes = Mem_Malloc( loadmodel->mempool, bmod->numvertexes * sizeof( mvertex_t ));
 	loadmodel->numvertexes = bmod->numvertexes;
 
-	if( bmod->isworld ) ClearBounds( world.mins, world.maxs );
+	// every thread grows its own bounds
+	for( i = 0; i < MAX_JOB_THREADS; i++ )
+		ClearBounds( loadjobs.mins[i], loadjobs.maxs[i] );
+}
+
+static void Mod_ConvertVertexes( dbspmodel_t *bmod, int first, int last, int thread )
+{
+	dvertex_t	*in = bmod->vertexes + first;
+	mvertex_t	*out = loadmodel->vertexes + first;
+	int	i;
 
-	for( i = 0; i < bmod->numvertexes; i++, in++, out++ )
+	for( i = first; i < last; i++, in++, out++ )
 	{
 		if( bmod->isworld )
-			AddPointToBounds( in->point, world.mins, world.maxs );
+			AddPointToBounds( in->point, loadjobs.mins[thread], loadjobs.maxs[thread] );
 		VectorCopy( in->point, out->position );
 	}
+}
+
+static void Mod_FinishVertexes( dbspmodel_t *bmod )
+{
+	int	i;
 
 	if( !bmod->isworld ) return;
 
+	ClearBounds( world.mins, world.maxs );
+
+	for( i = 0; i < MAX_JOB_THREADS; i++ )
+	{
+		if( loadjobs.mins[i][0] > loadjobs.maxs[i][0] )
+			continue; // thread had no vertexes
+		AddPointToBounds( loadjobs.mins[i], world.mins, world.maxs );
+		AddPointToBounds( loadjobs.maxs[i], world.mins, world.maxs );
+	}
+
 	VectorSubtract( world.maxs, world.mins, world.size );
 
 	for( i = 0; i < 3; i++ )
@@ -1815,17 +1982,20 @@ Mod_LoadEdges
 */
 static void Mod_LoadEdges( dbspmodel_t *bmod )
 {
-	medge_t	*out;
-	int	i;
-
-	loadmodel->edges = out = Mem_Malloc( loadmodel->mempool, bmod->numedges * sizeof( medge_t ));
+	loadmodel->edges = Mem_Malloc( loadmodel->mempool, bmod->numedges * sizeof( medge_t ));
 	loadmodel->numedges = bmod->numedges;
+}
+
+static void Mod_ConvertEdges( dbspmodel_t *bmod, int first, int last, int thread )
+{
+	medge_t	*out = loadmodel->edges + first;
+	int	i;
 
 	if( bmod->version == QBSP2_VERSION )
 	{
-		dedge32_t	*in = (dedge32_t *)bmod->edges32;
+		dedge32_t	*in = (dedge32_t *)bmod->edges32 + first;
 
-		for( i = 0; i < bmod->numedges; i++, in++, out++ )
+		for( i = first; i < last; i++, in++, out++ )
 		{
 			out->v[0] = in->v[0];
 			out->v[1] = in->v[1];
@@ -1833,9 +2003,9 @@ static void Mod_LoadEdges( dbspmodel_t *bmod )
 	}
 	else
 	{
-		dedge_t	*in = (dedge_t *)bmod->edges;
+		dedge_t	*in = (dedge_t *)bmod->edges + first;
 
-		for( i = 0; i < bmod->numedges; i++, in++, out++ )
+		for( i = first; i < last; i++, in++, out++ )
 		{
 			out->v[0] = (word)in->v[0];
 			out->v[1] = (word)in->v[1];
@@ -1851,10 +2021,14 @@ Mod_LoadSurfEdges
 static void Mod_LoadSurfEdges( dbspmodel_t *bmod )
 {
 	loadmodel->surfedges = Mem_Malloc( loadmodel->mempool, bmod->numsurfedges * sizeof( dsurfedge_t ));
-	memcpy( loadmodel->surfedges, bmod->surfedges, bmod->numsurfedges * sizeof( dsurfedge_t ));
 	loadmodel->numsurfedges = bmod->numsurfedges;
 }
 
+static void Mod_ConvertSurfEdges( dbspmodel_t *bmod, int first, int last, int thread )
+{
+	memcpy( loadmodel->surfedges + first, bmod->surfedges + first, ( last - first ) * sizeof( dsurfedge_t ));
+}
+
 /*
 =================
 Mod_LoadMarkSurfaces
@@ -2234,12 +2408,11 @@ Mod_LoadSurfaces
 */
 static void Mod_LoadSurfaces( dbspmodel_t *bmod )
 {
-	int		test_lightsize = -1;
-	int		next_lightofs = -1;
-	int		prev_lightofs = -1;
-	int		i, j, lightofs;
+	int		i, j, e;
+	int		numbevels = 0;
 	mextrasurf_t	*info;
 	msurface_t	*out;
+	byte		*bevels;
 
 	loadmodel->surfaces = out = Mem_Calloc( loadmodel->mempool, bmod->numsurfaces * sizeof( msurface_t ));
 	info = Mem_Calloc( loadmodel->mempool, bmod->numsurfaces * sizeof( mextrasurf_t ));
@@ -2272,7 +2445,6 @@ static void Mod_LoadSurfaces( dbspmodel_t *bmod )
 
 			for( j = 0; j < MAXLIGHTMAPS; j++ )
 				out->styles[j] = in->styles[j];
-			lightofs = in->lightofs;
 		}
 		else
 		{
@@ -2292,7 +2464,6 @@ static void Mod_LoadSurfaces( dbspmodel_t *bmod )
 
 			for( j = 0; j < MAXLIGHTMAPS; j++ )
 				out->styles[j] = in->styles[j];
-			lightofs = in->lightofs;
 		}
 
 		tex = out->texinfo->texture;
@@ -2325,9 +2496,106 @@ static void Mod_LoadSurfaces( dbspmodel_t *bmod )
 		if( FBitSet( out->texinfo->flags, TEX_SPECIAL ))
 			SetBits( out->flags, SURF_DRAWTILED );
 
+		// the edges are walked on the job threads, check them here
+		for( j = 0; j < out->numedges; j++ )
+		{
+			e = loadmodel->surfedges[out->firstedge + j];
+
+			if( e >= loadmodel->numedges || e <= -loadmodel->numedges )
+				Host_Error( "Mod_LoadSurfaces: bad edge\n" );
+		}
+
+		numbevels += out->numedges;
+	}
+
+	if( bmod->cache )
+	{
+		mfacebevel_t	*fb = (mfacebevel_t *)((byte *)bmod->cache + bmod->cache->bevelofs);
+
+		// bevels are used from the cache, make the edges pointers
+		for( i = 0, out = loadmodel->surfaces; i < bmod->numsurfaces; i++, out++, fb++ )
+		{
+			if( !out->plane ) continue; // skipped as corrupted
+
+			fb->edges = (mplane_t *)((byte *)bmod->cache + (size_t)fb->edges );
+			out->info->bevel = fb;
+		}
+		return;
+	}
+
+	// one block for the bevels of all the faces
+	bevels = Mem_Calloc( loadmodel->mempool, bmod->numsurfaces * sizeof( mfacebevel_t ) + numbevels * sizeof( mplane_t ));
+
+	for( i = 0, out = loadmodel->surfaces; i < bmod->numsurfaces; i++, out++ )
+	{
+		if( !out->plane ) continue; // skipped as corrupted
+
+		out->info->bevel = (mfacebevel_t *)bevels;
+		bevels += sizeof( mfacebevel_t );
+		out->info->bevel->edges = (mplane_t *)bevels;
+		bevels += out->numedges * sizeof( mplane_t );
+	}
+}
+
+static void Mod_ConvertSurfaces( dbspmodel_t *bmod, int first, int last, int thread )
+{
+	msurface_t	*out = loadmodel->surfaces + first;
+	int		i;
+
+	if( bmod->cache )
+	{
+		dsurfcache_t	*in = (dsurfcache_t *)((byte *)bmod->cache + bmod->cache->surfofs) + first;
+
+		for( i = first; i < last; i++, in++, out++ )
+		{
+			if( !out->plane ) continue; // skipped as corrupted
+
+			VectorCopy( in->mins, out->info->mins );
+			VectorCopy( in->maxs, out->info->maxs );
+			VectorCopy( in->origin, out->info->origin );
+			memcpy( out->info->lmvecs, in->lmvecs, sizeof( in->lmvecs ));
+			memcpy( out->info->lightmapmins, in->lightmapmins, sizeof( in->lightmapmins ));
+			memcpy( out->info->lightextents, in->lightextents, sizeof( in->lightextents ));
+			memcpy( out->texturemins, in->texturemins, sizeof( in->texturemins ));
+			memcpy( out->extents, in->extents, sizeof( in->extents ));
+		}
+		return;
+	}
+
+	for( i = first; i < last; i++, out++ )
+	{
+		if( !out->plane ) continue; // skipped as corrupted
+
 		Mod_CalcSurfaceBounds( out );
 		Mod_CalcSurfaceExtents( out );
 		Mod_CreateFaceBevels( out );
+	}
+}
+
+static void Mod_FinishSurfaces( dbspmodel_t *bmod )
+{
+	int		test_lightsize = -1;
+	int		next_lightofs = -1;
+	int		prev_lightofs = -1;
+	int		i, j, lightofs;
+	mextrasurf_t	*info;
+	msurface_t	*out;
+
+	for( i = 0, out = loadmodel->surfaces; i < loadmodel->numsurfaces; i++, out++ )
+	{
+		if( !out->plane ) continue; // skipped as corrupted
+
+		info = out->info;
+
+		for( j = 0; j < 2; j++ )
+		{
+			if( !FBitSet( out->texinfo->flags, TEX_SPECIAL ) && ( out->extents[j] > 16384 ) && ( tr.block_size == BLOCK_SIZE_DEFAULT ))
+				Con_Reportf( S_ERROR "Bad surface extents %i\n", out->extents[j] );
+		}
+
+		if( bmod->version == QBSP2_VERSION )
+			lightofs = bmod->surfaces32[i].lightofs;
+		else lightofs = bmod->surfaces[i].lightofs;
 
 		// grab the second sample to detect colored lighting
 		if( test_lightsize > 0 && lightofs != -1 )
@@ -2386,13 +2654,16 @@ Mod_LoadNodes
 */
 static void Mod_LoadNodes( dbspmodel_t *bmod )
 {
-	mnode_t	*out;
-	int	i, j, p;
-
-	loadmodel->nodes = out = (mnode_t *)Mem_Calloc( loadmodel->mempool, bmod->numnodes * sizeof( *out ));
+	loadmodel->nodes = (mnode_t *)Mem_Calloc( loadmodel->mempool, bmod->numnodes * sizeof( mnode_t ));
 	loadmodel->numnodes = bmod->numnodes;
+}
+
+static void Mod_ConvertNodes( dbspmodel_t *bmod, int first, int last, int thread )
+{
+	mnode_t	*out = loadmodel->nodes + first;
+	int	i, j, p;
 
-	for( i = 0; i < loadmodel->numnodes; i++, out++ )
+	for( i = first; i < last; i++, out++ )
 	{
 		if( bmod->version == QBSP2_VERSION )
 		{
@@ -2439,7 +2710,10 @@ static void Mod_LoadNodes( dbspmodel_t *bmod )
 			}
 		}
 	}
+}
 
+static void Mod_FinishNodes( dbspmodel_t *bmod )
+{
 	// sets nodes and leafs
 	Mod_SetParent( loadmodel->nodes, NULL );
 }
@@ -2552,16 +2826,22 @@ Mod_LoadClipnodes
 */
 static void Mod_LoadClipnodes( dbspmodel_t *bmod )
 {
-	dclipnode32_t	*out;
-	int		i;
+	bmod->clipnodes_out = (dclipnode32_t *)Mem_Malloc( loadmodel->mempool, bmod->numclipnodes * sizeof( dclipnode32_t ));
+
+	// FIXME: fill loadmodel->clipnodes?
+	loadmodel->numclipnodes = bmod->numclipnodes;
+}
 
-	bmod->clipnodes_out = out = (dclipnode32_t *)Mem_Malloc( loadmodel->mempool, bmod->numclipnodes * sizeof( *out ));	
+static void Mod_ConvertClipnodes( dbspmodel_t *bmod, int first, int last, int thread )
+{
+	dclipnode32_t	*out = bmod->clipnodes_out + first;
+	int		i;
 
 	if(( bmod->version == QBSP2_VERSION ) || ( bmod->version == HLBSP_VERSION && bmod->numclipnodes >= MAX_MAP_CLIPNODES ))
 	{
-		dclipnode32_t	*in = bmod->clipnodes32;
+		dclipnode32_t	*in = bmod->clipnodes32 + first;
 
-		for( i = 0; i < bmod->numclipnodes; i++, out++, in++ )
+		for( i = first; i < last; i++, out++, in++ )
 		{
 			out->planenum = in->planenum;
 			out->children[0] = in->children[0];
@@ -2570,9 +2850,9 @@ static void Mod_LoadClipnodes( dbspmodel_t *bmod )
 	}
 	else
 	{
-		dclipnode_t	*in = bmod->clipnodes;
+		dclipnode_t	*in = bmod->clipnodes + first;
 
-		for( i = 0; i < bmod->numclipnodes; i++, out++, in++ )
+		for( i = first; i < last; i++, out++, in++ )
 		{
 			out->planenum = in->planenum;
 
@@ -2586,9 +2866,6 @@ static void Mod_LoadClipnodes( dbspmodel_t *bmod )
 				out->children[1] -= 65536;
 		}
 	}
-
-	// FIXME: fill loadmodel->clipnodes?
-	loadmodel->numclipnodes = bmod->numclipnodes;
 }
 
 /*
@@ -2648,8 +2925,6 @@ static void Mod_LoadLighting( dbspmodel_t *bmod )
 {
 	int		i, lightofs;
 	msurface_t	*surf;
-	color24		*out;
-	byte		*in;
 
 	if( !bmod->lightdatasize )
 		return;
@@ -2657,15 +2932,9 @@ static void Mod_LoadLighting( dbspmodel_t *bmod )
 	switch( bmod->lightmap_samples )
 	{
 	case 1:
+		// white lighting data is expanded by Mod_ConvertLighting
 		if( !Mod_LoadColoredLighting( bmod ))
-		{
-			loadmodel->lightdata = out = (color24 *)Mem_Malloc( loadmodel->mempool, bmod->lightdatasize * sizeof( color24 ));
-			in = bmod->lightdata;
-
-			// expand the white lighting data
-			for( i = 0; i < bmod->lightdatasize; i++, out++ )
-				out->r = out->g = out->b = *in++;
-		}
+			loadmodel->lightdata = (color24 *)Mem_Malloc( loadmodel->mempool, bmod->lightdatasize * sizeof( color24 ));
 		break;
 	case 3:	// load colored lighting
 		loadmodel->lightdata = Mem_Malloc( loadmodel->mempool, bmod->lightdatasize );
@@ -2715,6 +2984,398 @@ static void Mod_LoadLighting( dbspmodel_t *bmod )
 	}
 }
 
+static void Mod_ConvertLighting( dbspmodel_t *bmod, int first, int last, int thread )
+{
+	color24	*out = loadmodel->lightdata + first;
+	byte	*in = bmod->lightdata + first;
+	int	i;
+
+	// expand the white lighting data
+	for( i = first; i < last; i++, out++ )
+		out->r = out->g = out->b = *in++;
+}
+
+/*
+===============================================================================
+
+			WORLD CACHE
+
+	surface extents and bevels, hull 0 and the remapped clipnodes of
+	the world are written to cache/maps/ after the first load. Later
+	loads of the same map map the file in and use it with only the
+	bevel pointers fixed up
+===============================================================================
+*/
+/*
+=================
+Mod_WorldCacheChecksum
+
+everything the cached data is computed from
+=================
+*/
+static dword Mod_WorldCacheChecksum( const byte *mod_base )
+{
+	dheader_t		*header = (dheader_t *)mod_base;
+	dextrahdr_t	*extrahdr = (dextrahdr_t *)((byte *)mod_base + sizeof( dheader_t ));
+	dword		crc;
+	int		i;
+
+	CRC32_Init( &crc );
+	CRC32_ProcessBuffer( &crc, header, sizeof( dheader_t ));
+
+	for( i = 0; i < HEADER_LUMPS; i++ )
+	{
+		if( header->lumps[i].filelen > 0 )
+			CRC32_ProcessBuffer( &crc, mod_base + header->lumps[i].fileofs, header->lumps[i].filelen );
+	}
+
+	if( extrahdr->id == IDEXTRAHEADER && extrahdr->version == EXTRA_VERSION )
+	{
+		for( i = 0; i < EXTRA_LUMPS; i++ )
+		{
+			if( extrahdr->lumps[i].filelen > 0 )
+				CRC32_ProcessBuffer( &crc, mod_base + extrahdr->lumps[i].fileofs, extrahdr->lumps[i].filelen );
+		}
+	}
+
+	// hull sizes are given by the game dll
+	CRC32_ProcessBuffer( &crc, host.player_mins, sizeof( host.player_mins ));
+	CRC32_ProcessBuffer( &crc, host.player_maxs, sizeof( host.player_maxs ));
+
+	return CRC32_Final( crc );
+}
+
+static const char *Mod_WorldCachePath( void )
+{
+	char	mapname[64];
+
+	COM_FileBase( loadmodel->name, mapname );
+
+	return va( "cache/maps/%s.bmc", mapname );
+}
+
+static qboolean Mod_CacheRange( dbmcache_t *hdr, int ofs, int size )
+{
+	return ( ofs >= (int)sizeof( dbmcache_t ) && size >= 0 && ofs + size <= hdr->filesize );
+}
+
+/*
+=================
+Mod_OpenWorldCache
+
+map the cache file if it matches the bsp,
+otherwise prepare to write a new one
+=================
+*/
+static void Mod_OpenWorldCache( dbspmodel_t *bmod, const byte *mod_base )
+{
+	dbmcache_t	*hdr;
+	mfacebevel_t	*fb;
+	dhullcache_t	*hc;
+	long		filesize;
+	int		i;
+
+	if( !bmod->isworld || !CVAR_TO_BOOL( mod_worldcache ) || worldcache != NULL )
+		return;
+
+	bmod->cachecrc = Mod_WorldCacheChecksum( mod_base );
+	hdr = (dbmcache_t *)FS_MapFile( Mod_WorldCachePath(), &filesize, true );
+
+	if( hdr != NULL )
+	{
+		qboolean	valid;
+
+		valid = ( filesize >= sizeof( dbmcache_t ) && hdr->ident == IDBMCACHEHEADER && hdr->version == BMCACHE_VERSION );
+		valid = valid && ( hdr->buildnum == Q_buildnum() && hdr->checksum == bmod->cachecrc && hdr->filesize == filesize );
+		valid = valid && ( hdr->numsurfaces == bmod->numsurfaces && hdr->numsubmodels == bmod->numsubmodels && hdr->numnodes == bmod->numnodes );
+		valid = valid && Mod_CacheRange( hdr, hdr->surfofs, hdr->numsurfaces * sizeof( dsurfcache_t ));
+		valid = valid && Mod_CacheRange( hdr, hdr->bevelofs, hdr->numsurfaces * sizeof( mfacebevel_t ));
+		valid = valid && Mod_CacheRange( hdr, hdr->hull0ofs, hdr->numnodes * sizeof( mclipnode_t ));
+		valid = valid && Mod_CacheRange( hdr, hdr->hullofs, hdr->numsubmodels * MAX_MAP_HULLS * sizeof( dhullcache_t ));
+
+		fb = (mfacebevel_t *)((byte *)hdr + hdr->bevelofs);
+		for( i = 0; valid && i < hdr->numsurfaces; i++, fb++ )
+		{
+			if( fb->numedges > 0 )
+				valid = Mod_CacheRange( hdr, (size_t)fb->edges, fb->numedges * sizeof( mplane_t ));
+		}
+
+		hc = (dhullcache_t *)((byte *)hdr + hdr->hullofs);
+		for( i = 0; valid && i < hdr->numsubmodels * MAX_MAP_HULLS; i++, hc++ )
+		{
+			if( hc->clipnodeofs != -1 )
+				valid = Mod_CacheRange( hdr, hc->clipnodeofs, hc->numclipnodes * sizeof( mclipnode_t ));
+		}
+
+		if( valid )
+		{
+			Con_Reportf( "loading %s\n", Mod_WorldCachePath( ));
+			worldcache = (byte *)hdr;
+			worldcachemodel = loadmodel;
+			bmod->cache = hdr;
+			return;
+		}
+
+		FS_UnmapFile( hdr ); // stale
+	}
+
+	// collect the hulls while loading
+	bmod->cachehulls = Z_Calloc( bmod->numsubmodels * MAX_MAP_HULLS * sizeof( hull_t ));
+}
+
+/*
+=================
+Mod_WriteWorldCache
+=================
+*/
+static void Mod_WriteWorldCache( dbspmodel_t *bmod, model_t *mod )
+{
+	int		i, numbevelplanes = 0;
+	int		numclipnodes = 0;
+	size_t		planeofs, clipofs;
+	mfacebevel_t	*fb;
+	dsurfcache_t	*out;
+	dhullcache_t	*hc;
+	msurface_t	*in;
+	hull_t		*hull;
+	dbmcache_t	*hdr;
+	byte		*buf;
+
+	for( i = 0, in = mod->surfaces; i < mod->numsurfaces; i++, in++ )
+	{
+		if( in->info->bevel )
+			numbevelplanes += in->info->bevel->numedges;
+	}
+
+	for( i = 0, hull = bmod->cachehulls; i < mod->numsubmodels * MAX_MAP_HULLS; i++, hull++ )
+	{
+		if( hull->planes != NULL )
+			numclipnodes += hull->lastclipnode;
+	}
+
+	hdr = (dbmcache_t *)Z_Calloc( sizeof( dbmcache_t ));
+	hdr->ident = IDBMCACHEHEADER;
+	hdr->version = BMCACHE_VERSION;
+	hdr->buildnum = Q_buildnum();
+	hdr->checksum = bmod->cachecrc;
+	hdr->numsurfaces = mod->numsurfaces;
+	hdr->numbevelplanes = numbevelplanes;
+	hdr->numsubmodels = mod->numsubmodels;
+	hdr->numnodes = mod->numnodes;
+	hdr->surfofs = sizeof( dbmcache_t );
+	hdr->bevelofs = hdr->surfofs + mod->numsurfaces * sizeof( dsurfcache_t );
+	planeofs = hdr->bevelofs + mod->numsurfaces * sizeof( mfacebevel_t );
+	hdr->hull0ofs = planeofs + numbevelplanes * sizeof( mplane_t );
+	hdr->hullofs = hdr->hull0ofs + mod->numnodes * sizeof( mclipnode_t );
+	clipofs = hdr->hullofs + mod->numsubmodels * MAX_MAP_HULLS * sizeof( dhullcache_t );
+	hdr->filesize = clipofs + numclipnodes * sizeof( mclipnode_t );
+
+	buf = Z_Calloc( hdr->filesize );
+	memcpy( buf, hdr, sizeof( dbmcache_t ));
+	Z_Free( hdr );
+	hdr = (dbmcache_t *)buf;
+
+	out = (dsurfcache_t *)(buf + hdr->surfofs);
+	fb = (mfacebevel_t *)(buf + hdr->bevelofs);
+
+	for( i = 0, in = mod->surfaces; i < mod->numsurfaces; i++, in++, out++, fb++ )
+	{
+		VectorCopy( in->info->mins, out->mins );
+		VectorCopy( in->info->maxs, out->maxs );
+		VectorCopy( in->info->origin, out->origin );
+		memcpy( out->lmvecs, in->info->lmvecs, sizeof( out->lmvecs ));
+		memcpy( out->lightmapmins, in->info->lightmapmins, sizeof( out->lightmapmins ));
+		memcpy( out->lightextents, in->info->lightextents, sizeof( out->lightextents ));
+		memcpy( out->texturemins, in->texturemins, sizeof( out->texturemins ));
+		memcpy( out->extents, in->extents, sizeof( out->extents ));
+
+		if( !in->info->bevel ) continue;
+
+		// edges pointer is stored as file offset
+		*fb = *in->info->bevel;
+		fb->edges = (mplane_t *)planeofs;
+		memcpy( buf + planeofs, in->info->bevel->edges, fb->numedges * sizeof( mplane_t ));
+		planeofs += fb->numedges * sizeof( mplane_t );
+	}
+
+	memcpy( buf + hdr->hull0ofs, mod->hulls[0].clipnodes, mod->numnodes * sizeof( mclipnode_t ));
+
+	hc = (dhullcache_t *)(buf + hdr->hullofs);
+
+	for( i = 0, hull = bmod->cachehulls; i < mod->numsubmodels * MAX_MAP_HULLS; i++, hull++, hc++ )
+	{
+		VectorCopy( hull->clip_mins, hc->clip_mins );
+		VectorCopy( hull->clip_maxs, hc->clip_maxs );
+
+		if( !hull->planes )
+		{
+			hc->clipnodeofs = -1;
+			continue;
+		}
+
+		hc->clipnodeofs = clipofs;
+		hc->numclipnodes = hull->lastclipnode;
+		memcpy( buf + clipofs, hull->clipnodes, hull->lastclipnode * sizeof( mclipnode_t ));
+		clipofs += hull->lastclipnode * sizeof( mclipnode_t );
+	}
+
+	if( FS_WriteFile( Mod_WorldCachePath(), buf, hdr->filesize ))
+		Con_Reportf( "write %s\n", Mod_WorldCachePath( ));
+	Z_Free( buf );
+}
+
+/*
+===============================================================================
+
+			LOAD PIPELINE
+
+	a loader is split into a serial part that allocates, links and
+	reports, and a convert part that runs over chunks of items on the
+	job threads. Every loader waits for the loaders it depends on, the
+	ones that are ready together convert side by side. The lumps are
+	read from the mapped file, so the jobs page them in concurrently
+===============================================================================
+*/
+static const mloader_t	bmodloaders[LOAD_COUNT] =
+{
+{ "entities", Mod_LoadEntities, NULL, NULL, 0, 0 },
+{ "planes", Mod_LoadPlanes, Mod_ConvertPlanes, Mod_FinishPlanes, 4096, 0 },
+{ "submodels", Mod_LoadSubmodels, NULL, NULL, 0, 0 },
+{ "vertexes", Mod_LoadVertexes, Mod_ConvertVertexes, Mod_FinishVertexes, 4096, 0 },
+{ "edges", Mod_LoadEdges, Mod_ConvertEdges, NULL, 4096, 0 },
+{ "surfedges", Mod_LoadSurfEdges, Mod_ConvertSurfEdges, NULL, 16384, 0 },
+{ "textures", Mod_LoadTextures, NULL, NULL, 0, BIT( LOAD_ENTITIES ) },
+{ "visibility", Mod_LoadVisibility, NULL, NULL, 0, 0 },
+{ "texinfo", Mod_LoadTexInfo, NULL, NULL, 0, BIT( LOAD_TEXTURES ) },
+{ "surfaces", Mod_LoadSurfaces, Mod_ConvertSurfaces, Mod_FinishSurfaces, 256, BIT( LOAD_PLANES )|BIT( LOAD_VERTEXES )|BIT( LOAD_EDGES )|BIT( LOAD_SURFEDGES )|BIT( LOAD_TEXINFO ) },
+{ "lighting", Mod_LoadLighting, Mod_ConvertLighting, NULL, 65536, BIT( LOAD_SURFACES ) },
+{ "marksurfaces", Mod_LoadMarkSurfaces, NULL, NULL, 0, BIT( LOAD_SURFACES ) },
+{ "leafs", Mod_LoadLeafs, NULL, NULL, 0, BIT( LOAD_SUBMODELS )|BIT( LOAD_VISIBILITY )|BIT( LOAD_MARKSURFACES ) },
+{ "nodes", Mod_LoadNodes, Mod_ConvertNodes, Mod_FinishNodes, 4096, BIT( LOAD_PLANES )|BIT( LOAD_SURFACES )|BIT( LOAD_LEAFS ) },
+{ "clipnodes", Mod_LoadClipnodes, Mod_ConvertClipnodes, NULL, 4096, 0 },
+};
+
+/*
+=================
+Mod_LoaderItems
+
+number of items for the convert jobs
+=================
+*/
+static int Mod_LoaderItems( dbspmodel_t *bmod, int loader )
+{
+	switch( loader )
+	{
+	case LOAD_PLANES:
+		return bmod->numplanes;
+	case LOAD_VERTEXES:
+		return bmod->numvertexes;
+	case LOAD_EDGES:
+		return bmod->numedges;
+	case LOAD_SURFEDGES:
+		return bmod->numsurfedges;
+	case LOAD_SURFACES:
+		return bmod->numsurfaces;
+	case LOAD_LIGHTING:
+		// only the white lighting needs to be expanded
+		if( loadmodel->lightdata && bmod->lightmap_samples == 1 && !FBitSet( loadmodel->flags, MODEL_COLORED_LIGHTING ))
+			return bmod->lightdatasize;
+		return 0;
+	case LOAD_NODES:
+		return bmod->numnodes;
+	case LOAD_CLIPNODES:
+		// the hulls are mapped from the world cache
+		return bmod->cache ? 0 : bmod->numclipnodes;
+	}
+
+	return 0;
+}
+
+static void Mod_LoaderJob( void *data, int index, int thread )
+{
+	mloadchunk_t	*chunk = &loadjobs.chunks[index];
+	double		start = Sys_DoubleTime();
+
+	bmodloaders[chunk->loader].convert( (dbspmodel_t *)data, chunk->first, chunk->last, thread );
+	loadjobs.jobtime[chunk->loader][thread] += Sys_DoubleTime() - start;
+}
+
+/*
+=================
+Mod_RunLoaders
+
+load every lump into the heap, ready loaders
+are started in the order of the table
+=================
+*/
+static void Mod_RunLoaders( dbspmodel_t *bmod )
+{
+	int		i, j, wave, done = 0;
+	int		items[LOAD_COUNT];
+	int		numchunks;
+	const mloader_t	*loader;
+	mloadchunk_t	*chunk;
+	double		start;
+
+	memset( &loadjobs, 0, sizeof( loadjobs ));
+
+	while( done != BIT( LOAD_COUNT ) - 1 )
+	{
+		numchunks = 0;
+		wave = 0;
+
+		for( i = 0, loader = bmodloaders; i < LOAD_COUNT; i++, loader++ )
+		{
+			if( FBitSet( done, BIT( i )) || ( done & loader->depends ) != loader->depends )
+				continue;
+
+			start = Sys_DoubleTime();
+			loader->load( bmod );
+			loadjobs.time[i] += Sys_DoubleTime() - start;
+
+			items[i] = loader->convert ? Mod_LoaderItems( bmod, i ) : 0;
+			if( items[i] > 0 ) numchunks += ( items[i] + loader->chunksize - 1 ) / loader->chunksize;
+			SetBits( wave, BIT( i ));
+		}
+
+		if( !wave ) Host_Error( "Mod_RunLoaders: circular dependency\n" );
+
+		if( numchunks > 0 )
+		{
+			chunk = loadjobs.chunks = Z_Malloc( numchunks * sizeof( mloadchunk_t ));
+
+			for( i = 0, loader = bmodloaders; i < LOAD_COUNT; i++, loader++ )
+			{
+				if( !FBitSet( wave, BIT( i )))
+					continue;
+
+				for( j = 0; j < items[i]; j += loader->chunksize, chunk++ )
+				{
+					chunk->loader = i;
+					chunk->first = j;
+					chunk->last = Q_min( j + loader->chunksize, items[i] );
+				}
+			}
+
+			Sys_ParallelFor( Mod_LoaderJob, bmod, numchunks );
+			Z_Free( loadjobs.chunks );
+			loadjobs.chunks = NULL;
+		}
+
+		for( i = 0, loader = bmodloaders; i < LOAD_COUNT; i++, loader++ )
+		{
+			if( !FBitSet( wave, BIT( i )) || !loader->finish )
+				continue;
+
+			start = Sys_DoubleTime();
+			loader->finish( bmod );
+			loadjobs.time[i] += Sys_DoubleTime() - start;
+		}
+
+		SetBits( done, wave );
+	}
+}
+
 /*
 =================
 Mod_LoadBmodelLumps
@@ -2777,25 +3438,17 @@ qboolean Mod_LoadBmodelLumps( const byte *mod_base, qboolean isworld )
 	else if( !bmod->isworld && loadstat.numwarnings )
 		Con_DPrintf( "Mod_Load%s: %i warning(s)\n", isworld ? "World" : "Brush", loadstat.numwarnings );
 
+	// processed data from the last load
+	Mod_OpenWorldCache( bmod, mod_base );
+
 	// load into heap
-	Mod_LoadEntities( bmod );
-	Mod_LoadPlanes( bmod );
-	Mod_LoadSubmodels( bmod );
-	Mod_LoadVertexes( bmod );
-	Mod_LoadEdges( bmod );
-	Mod_LoadSurfEdges( bmod );
-	Mod_LoadTextures( bmod );
-	Mod_LoadVisibility( bmod );
-	Mod_LoadTexInfo( bmod );
-	Mod_LoadSurfaces( bmod );
-	Mod_LoadLighting( bmod );
-	Mod_LoadMarkSurfaces( bmod );
-	Mod_LoadLeafs( bmod );
-	Mod_LoadNodes( bmod );
-	Mod_LoadClipnodes( bmod );
+	Mod_RunLoaders( bmod );
+
+	// no submodels and hulls for the benchmark, they are registered globally
+	if( loadbench ) return true;
 
 	// preform some post-initalization
-	Mod_MakeHull0 ();
+	Mod_MakeHull0( bmod );
 	Mod_SetupSubmodels( bmod );
 
 	if( isworld )
@@ -2806,6 +3459,13 @@ qboolean Mod_LoadBmodelLumps( const byte *mod_base, qboolean isworld )
 		world.shadowdata = bmod->shadowdata_out;	// occlusion data pointer
 	}
 
+	if( bmod->cachehulls != NULL )
+	{
+		Mod_WriteWorldCache( bmod, mod );
+		Z_Free( bmod->cachehulls );
+		bmod->cachehulls = NULL;
+	}
+
 	for( i = 0; i < bmod->wadlist.count; i++ )
 	{
 		if( !bmod->wadlist.wadusage[i] )
@@ -2907,6 +3567,98 @@ void Mod_LoadBrushModel( model_t *mod, const void *buffer, qboolean *loaded )
 	if( loaded ) *loaded = true;	// all done
 }
 
+/*
+=================
+Mod_LoadBenchmark_f
+
+load the lumps of every map as brush model
+and show the time spent by each loader
+=================
+*/
+void Mod_LoadBenchmark_f( void )
+{
+	double	lumptime[LOAD_COUNT];
+	double	start, total, maptime;
+	int	i, j, numloaded = 0;
+	model_t	bench, *oldmodel;
+	search_t	*t;
+	byte	*buf;
+
+	if( SV_Active() || CL_Active( ))
+	{
+		Con_Printf( "map_loadbench: can't run while a map is loaded\n" );
+		return;
+	}
+
+	t = FS_Search( "maps/*.bsp", true, false );
+
+	if( !t )
+	{
+		Con_Printf( "map_loadbench: no maps found\n" );
+		return;
+	}
+
+	memset( lumptime, 0, sizeof( lumptime ));
+	oldmodel = loadmodel;
+	total = 0.0;
+
+	for( i = 0; i < t->numfilenames; i++ )
+	{
+		if(( buf = FS_MapFile( t->filenames[i], NULL, false )) == NULL )
+			continue;
+
+		if( !Mod_TestBmodelLumps( t->filenames[i], buf, true ))
+		{
+			FS_UnmapFile( buf );
+			continue;
+		}
+
+		memset( &bench, 0, sizeof( bench ));
+		Q_strncpy( bench.name, t->filenames[i], sizeof( bench.name ));
+		bench.mempool = Mem_AllocPool( va( "^2%s^7", bench.name ));
+		bench.type = mod_brush;
+		loadmodel = &bench;
+		loadbench = true;
+
+		start = Sys_DoubleTime();
+		if( Mod_LoadBmodelLumps( buf, false ))
+		{
+			maptime = Sys_DoubleTime() - start;
+			total += maptime;
+			numloaded++;
+
+			for( j = 0; j < LOAD_COUNT; j++ )
+			{
+				int	k;
+
+				lumptime[j] += loadjobs.time[j];
+				for( k = 0; k < MAX_JOB_THREADS; k++ )
+					lumptime[j] += loadjobs.jobtime[j][k];
+			}
+
+			Con_Printf( "%-32s %8.2f ms\n", t->filenames[i], maptime * 1000.0 );
+		}
+
+		loadbench = false;
+		loadmodel = oldmodel;
+		Mod_UnloadBrushModel( &bench );
+		FS_UnmapFile( buf );
+	}
+
+	Mem_Free( t );
+
+	if( !numloaded )
+	{
+		Con_Printf( "map_loadbench: no maps loaded\n" );
+		return;
+	}
+
+	Con_Printf( "\n%i maps, %i job threads, time summed over the threads:\n", numloaded, Sys_JobThreads( ));
+	for( i = 0; i < LOAD_COUNT; i++ )
+		Con_Printf( "%-12s %8.2f ms, %6.2f ms per map\n", bmodloaders[i].name, lumptime[i] * 1000.0, lumptime[i] * 1000.0 / numloaded );
+	Con_Printf( "wall total   %8.2f ms, %6.2f ms per map\n", total * 1000.0, total * 1000.0 / numloaded );
+}
+
 /*
 =================
 Mod_UnloadBrushModel
@@ -2931,6 +3683,13 @@ void Mod_UnloadBrushModel( model_t *mod )
 		world.shadowdata = NULL;
 	}
 
+	if( mod == worldcachemodel )
+	{
+		FS_UnmapFile( worldcache );
+		worldcachemodel = NULL;
+		worldcache = NULL;
+	}
+
 	if( mod->name[0] != '*' )
 	{
 		for( i = 0; i < mod->numtextures; i++ )
@@ -158,6 +158,7 @@ extern byte		*com_studiocache;
 extern model_t		*loadmodel;
 extern convar_t		*mod_studiocache;
 extern convar_t		*r_wadtextures;
+extern convar_t		*mod_worldcache;
 extern convar_t		*r_showhull;
 
 //
@@ -197,6 +198,7 @@ int Mod_SampleSizeForFace( msurface_t *surf );
 byte *Mod_GetPVSForPoint( const vec3_t p );
 void Mod_UnloadBrushModel( model_t *mod );
 void Mod_PrintWorldStats_f( void );
+void Mod_LoadBenchmark_f( void );
 
 //
 // mod_dbghulls.c
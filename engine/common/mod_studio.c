@@ -703,7 +703,7 @@ qboolean Mod_GetStudioBounds( const char *name, vec3_t mins, vec3_t maxs )
 	if( !Q_strstr( name, "models" ) || !Q_strstr( name, ".mdl" ))
 		return false;
 
-	f = FS_LoadFile( name, NULL, false );
+	f = FS_MapFile( name, NULL, false );
 	if( !f ) return false;
 
 	if( *(uint *)f == IDSTUDIOHEADER )
@@ -713,7 +713,7 @@ qboolean Mod_GetStudioBounds( const char *name, vec3_t mins, vec3_t maxs )
 		Mod_StudioComputeBounds( f, mins, maxs, false );
 		result = true;
 	}
-	Mem_Free( f );
+	FS_UnmapFile( f );
 
 	return result;
 }
@@ -811,13 +811,13 @@ void Mod_LoadStudioModel( model_t *mod, const void *buffer, qboolean *loaded )
 		void		*buffer2 = NULL;
 		size_t		size1, size2;
 
-		buffer2 = FS_LoadFile( Mod_StudioTexName( mod->name ), NULL, false );
+		buffer2 = FS_MapFile( Mod_StudioTexName( mod->name ), NULL, false );
 		thdr = R_StudioLoadHeader( mod, buffer2 );
 
 		if( !thdr )
 		{
 			Con_Printf( S_WARN "Mod_LoadStudioModel: %s missing textures file\n", mod->name ); 
-			if( buffer2 ) Mem_Free( buffer2 );
+			FS_UnmapFile( buffer2 );
 		}
                     else
                     {
@@ -839,7 +839,7 @@ void Mod_LoadStudioModel( model_t *mod, const void *buffer, qboolean *loaded )
 			out = (byte *)phdr + phdr->textureindex;
 			memcpy( out, in, size1 + size2 );	// copy textures + skinrefs
 			phdr->length += size1 + size2;
-			Mem_Free( buffer2 ); // release T.mdl
+			FS_UnmapFile( buffer2 ); // release T.mdl
 		}
 	}
 	else
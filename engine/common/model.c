@@ -31,6 +31,7 @@ static int	mod_numknown = 0;
 byte		*com_studiocache;		// cache for submodels
 convar_t		*mod_studiocache;
 convar_t		*r_wadtextures;
+convar_t		*mod_worldcache;
 convar_t		*r_showhull;
 model_t		*loadmodel;
 
@@ -147,10 +148,12 @@ void Mod_Init( void )
 	com_studiocache = Mem_AllocPool( "Studio Cache" );
 	mod_studiocache = Cvar_Get( "r_studiocache", "1", FCVAR_ARCHIVE, "enables studio cache for speedup tracing hitboxes" );
 	r_wadtextures = Cvar_Get( "r_wadtextures", "0", 0, "completely ignore textures in the bsp-file if enabled" );
+	mod_worldcache = Cvar_Get( "mod_worldcache", "1", FCVAR_ARCHIVE, "keep processed world data on disk to speed up map reloads" );
 	r_showhull = Cvar_Get( "r_showhull", "0", 0, "draw collision hulls 1-3" );
 
 	Cmd_AddCommand( "mapstats", Mod_PrintWorldStats_f, "show stats for currently loaded map" );
 	Cmd_AddCommand( "modellist", Mod_Modellist_f, "display loaded models list" );
+	Cmd_AddCommand( "map_loadbench", Mod_LoadBenchmark_f, "load every map and show the time spent per lump" );
 
 	Mod_ResetStudioAPI ();
 	Mod_InitStudioHull ();
@@ -281,7 +284,7 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 	Q_strncpy( tempname, mod->name, sizeof( tempname ));
 	COM_FixSlashes( tempname );
 
-	buf = FS_LoadFile( tempname, &length, false );
+	buf = FS_MapFile( tempname, &length, false );
 
 	if( !buf )
 	{
@@ -316,7 +319,7 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 		Mod_LoadBrushModel( mod, buf, &loaded );
 		break;
 	default:
-		Mem_Free( buf );
+		FS_UnmapFile( buf );
 		if( crash ) Host_Error( "%s has unknown format\n", tempname );
 		else Con_Printf( S_ERROR "%s has unknown format\n", tempname );
 		return NULL;
@@ -325,7 +328,7 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 	if( !loaded )
 	{
 		Mod_FreeModel( mod );
-		Mem_Free( buf );
+		FS_UnmapFile( buf );
 
 		if( crash ) Host_Error( "%s couldn't load\n", tempname );
 		else Con_Printf( S_ERROR "%s couldn't load\n", tempname );
@@ -377,7 +380,7 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 			p->initialCRC = currentCRC;
 		}
 	}
-	Mem_Free( buf );
+	FS_UnmapFile( buf );
 
 	return mod;
 }
@@ -537,11 +540,11 @@ void Mod_LoadCacheFile( const char *filename, cache_user_t *cu )
 	Q_strncpy( modname, filename, sizeof( modname ));
 	COM_FixSlashes( modname );
 
-	buf = FS_LoadFile( modname, &size, false );
+	buf = FS_MapFile( modname, &size, false );
 	if( !buf || !size ) Host_Error( "LoadCacheFile: ^1can't load %s^7\n", filename );
 	cu->data = Mem_Malloc( com_studiocache, size );
 	memcpy( cu->data, buf, size );
-	Mem_Free( buf );
+	FS_UnmapFile( buf );
 }
 
 /*
@@ -1282,6 +1282,8 @@ void Netchan_TransmitBits( netchan_t *chan, int length, byte *data )
 		return;
 	}
 
+	Prof_Begin( PROF_NETCHAN_TRANSMIT );
+
 	// if the remote side dropped the last reliable message, resend it
 	send_reliable = false;
 
@@ -1543,6 +1545,8 @@ void Netchan_TransmitBits( netchan_t *chan, int length, byte *data )
 			, send_reliable ? 1 : 0
 			, (float)host.realtime );
 	}
+
+	Prof_End( PROF_NETCHAN_TRANSMIT );
 }
 
 /*
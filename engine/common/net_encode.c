@@ -304,6 +304,11 @@ static delta_info_t dt_info[] =
 { NULL },
 };
 
+// positions of entity tables in dt_info
+#define DT_ENTITY_STATE		5
+#define DT_ENTITY_STATE_PLAYER	6
+#define DT_CUSTOM_ENTITY_STATE	7
+
 delta_info_t *Delta_FindStruct( const char *name )
 {
 	int	i;
@@ -323,6 +328,22 @@ delta_info_t *Delta_FindStruct( const char *name )
 	return NULL;
 }
 
+/*
+=====================
+Delta_FindEntityStruct
+
+entity tables are required for each entity
+in every packet, so don't search them by name
+=====================
+*/
+static delta_info_t *Delta_FindEntityStruct( int entityType, qboolean player )
+{
+	if( FBitSet( entityType, ENTITY_BEAM ))
+		return &dt_info[DT_CUSTOM_ENTITY_STATE];
+	if( player ) return &dt_info[DT_ENTITY_STATE_PLAYER];
+	return &dt_info[DT_ENTITY_STATE];
+}
+
 int Delta_NumTables( void )
 {
 	return NUM_FIELDS( dt_info );
@@ -772,6 +793,21 @@ void Delta_InitFields( void )
 	Mem_Free( afile );
 }
 
+/*
+=====================
+Delta_CheckEntityTables
+
+entity tables are fetched by position,
+so make sure that nobody has reordered dt_info
+=====================
+*/
+static void Delta_CheckEntityTables( void )
+{
+	ASSERT( !Q_strcmp( dt_info[DT_ENTITY_STATE].pName, "entity_state_t" ));
+	ASSERT( !Q_strcmp( dt_info[DT_ENTITY_STATE_PLAYER].pName, "entity_state_player_t" ));
+	ASSERT( !Q_strcmp( dt_info[DT_CUSTOM_ENTITY_STATE].pName, "custom_entity_state_t" ));
+}
+
 void Delta_Init( void )
 {
 	delta_info_t	*dt;
@@ -779,6 +815,8 @@ void Delta_Init( void )
 	// shutdown it first
 	if( delta_init ) Delta_Shutdown ();
 
+	Delta_CheckEntityTables ();
+
 	Delta_InitFields ();	// initialize fields
 	delta_init = true;
 
@@ -831,6 +869,8 @@ void Delta_InitClient( void )
 	// already initalized
 	if( delta_init ) return;
 
+	Delta_CheckEntityTables ();
+
 	for( i = 0; i < NUM_FIELDS( dt_info ); i++ )
 	{
 		if( dt_info[i].numFields > 0 )
@@ -1040,11 +1080,7 @@ int Delta_TestBaseline( entity_state_t *from, entity_state_t *to, qboolean playe
 		return countBits;
 	}
 
-	if( FBitSet( to->entityType, ENTITY_BEAM ))
-		dt = Delta_FindStruct( "custom_entity_state_t" );
-	else if( player )
-		dt = Delta_FindStruct( "entity_state_player_t" );
-	else dt = Delta_FindStruct( "entity_state_t" );
+	dt = Delta_FindEntityStruct( to->entityType, player );
 
 	Assert( dt && dt->bInitialized );
 
@@ -1697,18 +1733,7 @@ void MSG_WriteDeltaEntity( entity_state_t *from, entity_state_t *to, sizebuf_t *
 	}
 	else MSG_WriteOneBit( msg, 0 );
 
-	if( FBitSet( to->entityType, ENTITY_BEAM ))
-	{
-		dt = Delta_FindStruct( "custom_entity_state_t" );
-	}
-	else if( delta_type == DELTA_PLAYER )
-	{
-		dt = Delta_FindStruct( "entity_state_player_t" );
-	}
-	else
-	{
-		dt = Delta_FindStruct( "entity_state_t" );
-	}
+	dt = Delta_FindEntityStruct( to->entityType, ( delta_type == DELTA_PLAYER ));
 
 	Assert( dt && dt->bInitialized );
 		
@@ -1812,18 +1837,7 @@ qboolean MSG_ReadDeltaEntity( sizebuf_t *msg, entity_state_t *from, entity_state
 		to->entityType = MSG_ReadUBitLong( msg, 2 );
 	to->number = number;
 
-	if( FBitSet( to->entityType, ENTITY_BEAM ))
-	{
-		dt = Delta_FindStruct( "custom_entity_state_t" );
-	}
-	else if( delta_type == DELTA_PLAYER )
-	{
-		dt = Delta_FindStruct( "entity_state_player_t" );
-	}
-	else
-	{
-		dt = Delta_FindStruct( "entity_state_t" );
-	}
+	dt = Delta_FindEntityStruct( to->entityType, ( delta_type == DELTA_PLAYER ));
 
 	Assert( dt && dt->bInitialized );
 
@@ -1393,29 +1393,35 @@ qboolean NET_IsActive( void )
 ====================
 NET_Sleep
 
-sleeps msec or until net socket is ready
+sleeps timeout seconds or until net socket is ready,
+returns true if there is a packet to read
 ====================
 */
-void NET_Sleep( int msec )
+qboolean NET_Sleep( double timeout )
 {
-	struct timeval	timeout;
+	struct timeval	tv;
 	fd_set		fdset;
-	int		i = 0;
+	int		usec;
 
 	if( !net.initialized || host.type == HOST_NORMAL )
-		return; // we're not a dedicated server, just run full speed
+		return false; // we're not a dedicated server, just run full speed
 
-	FD_ZERO( &fdset );
+	usec = (int)( timeout * 1000000.0 );
 
-	if( net.ip_sockets[NS_SERVER] != INVALID_SOCKET )
+	if( net.ip_sockets[NS_SERVER] == INVALID_SOCKET )
 	{
-		FD_SET( net.ip_sockets[NS_SERVER], &fdset ); // network socket
-		i = net.ip_sockets[NS_SERVER];
+		// winsock can't select on empty set
+		Sys_Sleep( Q_max( 1, usec / 1000 ));
+		return false;
 	}
 
-	timeout.tv_sec = msec / 1000;
-	timeout.tv_usec = (msec % 1000) * 1000;
-	pSelect( i+1, &fdset, NULL, NULL, &timeout );
+	FD_ZERO( &fdset );
+	FD_SET( net.ip_sockets[NS_SERVER], &fdset ); // network socket
+
+	tv.tv_sec = usec / 1000000;
+	tv.tv_usec = usec % 1000000;
+
+	return ( pSelect( net.ip_sockets[NS_SERVER] + 1, &fdset, NULL, NULL, &tv ) > 0 );
 }
 
 /*
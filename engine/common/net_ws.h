@@ -44,7 +44,7 @@ extern convar_t	*net_clockwindow;
 
 void NET_Init( void );
 void NET_Shutdown( void );
-void NET_Sleep( int msec );
+qboolean NET_Sleep( double timeout );
 qboolean NET_IsActive( void );
 qboolean NET_IsConfigured( void );
 void NET_Config( qboolean net_enable );
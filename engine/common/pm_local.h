@@ -19,6 +19,9 @@ GNU General Public License for more details.
 #include "pm_defs.h"
 
 typedef int (*pfnIgnore)( physent_t *pe );	// custom trace filter
+typedef char (*findmaterial_t)( char *name );	// materials.txt lookup of the game dll
+
+#define MATERIAL_NAMEMAX	13		// CBTEXTURENAMEMAX in pm_shared
 
 //
 // pm_debug.c
@@ -44,6 +47,9 @@ void PM_ConvertTrace( trace_t *out, pmtrace_t *in, edict_t *ent );
 // pm_surface.c
 //
 const char *PM_TraceTexture( physent_t *pe, vec3_t vstart, vec3_t vend );
+char PM_TextureMaterial( texture_t *tx, findmaterial_t pfnFind );
+char PM_TraceMaterial( physent_t *pe, vec3_t vstart, vec3_t vend, findmaterial_t pfnFind, char *texname );
+void PM_InitMaterials( model_t *mod, findmaterial_t pfnFind );
 msurface_t *PM_RecursiveSurfCheck( model_t *model, mnode_t *node, vec3_t p1, vec3_t p2 );
 msurface_t *PM_TraceSurface( physent_t *pe, vec3_t start, vec3_t end );
 int PM_TestLineExt( playermove_t *pmove, physent_t *ents, int numents, const vec3_t start, const vec3_t end, int flags );
@@ -222,6 +222,92 @@ const char *PM_TraceTexture( physent_t *pe, vec3_t start, vec3_t end )
 	return surf->texinfo->texture->name;
 }
 
+/*
+==================
+PM_MaterialName
+
+strip the texture name like the game does it
+before looking it up in materials.txt
+==================
+*/
+static void PM_MaterialName( const texture_t *tx, char *name )
+{
+	const char	*s = tx->name;
+
+	// strip leading '-0' or '+0~' or '{' or '!'
+	if(( *s == '-' || *s == '+' ) && s[1] )
+		s += 2;
+
+	if( *s == '{' || *s == '!' || *s == '~' || *s == ' ' )
+		s++;
+
+	Q_strncpy( name, s, MATERIAL_NAMEMAX );
+}
+
+/*
+==================
+PM_TextureMaterial
+
+the type is kept on the texture
+==================
+*/
+char PM_TextureMaterial( texture_t *tx, findmaterial_t pfnFind )
+{
+	char	name[MATERIAL_NAMEMAX];
+
+	if( !tx ) return 0;
+
+	if( tx->material || !pfnFind )
+		return tx->material;
+
+	PM_MaterialName( tx, name );
+	tx->material = pfnFind( name );
+
+	return tx->material;
+}
+
+/*
+==================
+PM_TraceMaterial
+
+material of the face where the traceline hit,
+0 if nothing was hit. texname gets the stripped
+name the game looked up, can be NULL
+==================
+*/
+char PM_TraceMaterial( physent_t *pe, vec3_t start, vec3_t end, findmaterial_t pfnFind, char *texname )
+{
+	msurface_t	*surf = PM_TraceSurface( pe, start, end );
+
+	if( texname ) texname[0] = '\0';
+
+	if( !surf || !surf->texinfo || !surf->texinfo->texture )
+		return 0;
+
+	if( texname ) PM_MaterialName( surf->texinfo->texture, texname );
+
+	return PM_TextureMaterial( surf->texinfo->texture, pfnFind );
+}
+
+/*
+==================
+PM_InitMaterials
+
+look up the materials of all the model textures
+at once, submodels share them with the world
+==================
+*/
+void PM_InitMaterials( model_t *mod, findmaterial_t pfnFind )
+{
+	int	i;
+
+	if( !mod || mod->type != mod_brush || !pfnFind )
+		return;
+
+	for( i = 0; i < mod->numtextures; i++ )
+		PM_TextureMaterial( mod->textures[i], pfnFind );
+}
+
 /*
 ==================
 PM_TestLine_r
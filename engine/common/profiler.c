@@ -0,0 +1,571 @@
+/*
+profiler.c - hierarchical frame profiler
+Copyright (C) 2018 Uncle Mike
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "mathlib.h"
+
+/*
+=============================================================================
+
+	FRAME PROFILER
+
+	code marks zones with Prof_Begin\Prof_End pairs. every thread writes
+	the markers into a private ring, so recording is a few stores without
+	any locks. main thread brackets each host frame: "prof_dump" converts
+	the last frames of all the rings into chrome://tracing json and
+	"prof_stats" prints per-zone percentiles over the recorded frames.
+	nothing is recorded while prof_enable is 0
+
+=============================================================================
+*/
+#define PROF_MAX_THREADS	( MAX_JOB_THREADS + 8 )	// job workers, mixer and others
+#define PROF_MAX_ZONES	256
+#define PROF_MAX_DEPTH	32
+#define PROF_MAX_FRAMES	256			// frame bounds kept for dump and stats
+#define PROF_RING_SIZE	32768			// events per thread, must be power of two
+#define PROF_RING_MASK	( PROF_RING_SIZE - 1 )
+
+typedef struct
+{
+	double		time;
+	int		zone;
+	qboolean		end;
+} profevent_t;
+
+typedef struct
+{
+	DWORD		threadId;
+	char		name[32];
+	profevent_t	*events;			// [PROF_RING_SIZE]
+	LONG		head;			// total events written
+} profthread_t;
+
+typedef struct
+{
+	double		start;
+	double		end;
+} profframe_t;
+
+typedef struct
+{
+	volatile qboolean	active;
+	qboolean		initialized;
+	CRITICAL_SECTION	lock;			// zone and thread registration
+	DWORD		tls;			// profthread_t of the caller
+
+	char		zones[PROF_MAX_ZONES][32];
+	volatile LONG	numzones;
+
+	profthread_t	threads[PROF_MAX_THREADS];
+	volatile LONG	numthreads;
+
+	profframe_t	frames[PROF_MAX_FRAMES];
+	int		numframes;		// total frames recorded
+	double		framestart;
+} profiler_t;
+
+static const char *prof_zone_names[PROF_ENGINE_ZONES] =
+{
+	"Host_Frame",
+	"SV_ReadPackets",
+	"SV_Physics",
+	"StartFrame",
+	"SV_Physics_Entity",
+	"SV_SendClientMessages",
+	"Netchan_Transmit",
+	"CL_ReadPackets",
+	"CL_PredictMovement",
+	"CL_LinkPacketEntities",
+	"SCR_UpdateScreen",
+	"SND_UpdateSound",
+	"S_MixerThread",
+	"Sys_ParallelFor",
+};
+
+static profiler_t	prof;
+CVAR_DEFINE_AUTO( prof_enable, "0", 0, "record profiler zones for prof_dump and prof_stats" );
+
+/*
+================
+Prof_RegisterThread
+
+claim a ring for the calling thread
+================
+*/
+static profthread_t *Prof_RegisterThread( const char *name )
+{
+	profthread_t	*pt;
+
+	EnterCriticalSection( &prof.lock );
+
+	if( prof.numthreads >= PROF_MAX_THREADS )
+	{
+		LeaveCriticalSection( &prof.lock );
+		return NULL;
+	}
+
+	pt = &prof.threads[prof.numthreads];
+	pt->threadId = GetCurrentThreadId();
+	Q_snprintf( pt->name, sizeof( pt->name ), "%s %i", name, prof.numthreads );
+	TlsSetValue( prof.tls, pt );
+
+	// publish after the slot is filled
+	InterlockedIncrement( &prof.numthreads );
+	LeaveCriticalSection( &prof.lock );
+
+	return pt;
+}
+
+/*
+================
+Prof_ThreadName
+
+name the calling thread in the dumps
+================
+*/
+void Prof_ThreadName( const char *name )
+{
+	profthread_t	*pt;
+
+	if( !prof.initialized )
+		return;
+
+	pt = (profthread_t *)TlsGetValue( prof.tls );
+
+	if( pt ) Q_snprintf( pt->name, sizeof( pt->name ), "%s %i", name, pt - prof.threads );
+	else Prof_RegisterThread( name );
+}
+
+/*
+================
+Prof_Zone
+
+returns the zone id for name, new zones are allocated on first call.
+callers are expected to keep the id
+================
+*/
+int Prof_Zone( const char *name )
+{
+	int	i;
+
+	if( !prof.initialized || !COM_CheckString( name ))
+		return -1;
+
+	EnterCriticalSection( &prof.lock );
+
+	for( i = 0; i < prof.numzones; i++ )
+	{
+		if( !Q_strcmp( prof.zones[i], name ))
+			break;
+	}
+
+	if( i == prof.numzones )
+	{
+		if( prof.numzones < PROF_MAX_ZONES )
+		{
+			Q_strncpy( prof.zones[i], name, sizeof( prof.zones[i] ));
+			InterlockedIncrement( &prof.numzones );
+		}
+		else i = -1;
+	}
+
+	LeaveCriticalSection( &prof.lock );
+
+	return i;
+}
+
+/*
+================
+Prof_Mark
+================
+*/
+static void Prof_Mark( int zone, qboolean end )
+{
+	profthread_t	*pt;
+	profevent_t	*ev;
+
+	if( !prof.active || zone < 0 || zone >= prof.numzones )
+		return;
+
+	pt = (profthread_t *)TlsGetValue( prof.tls );
+	if( !pt ) pt = Prof_RegisterThread( "thread" );
+	if( !pt || !pt->events ) return;
+
+	ev = &pt->events[pt->head & PROF_RING_MASK];
+	ev->time = Sys_DoubleTime();
+	ev->zone = zone;
+	ev->end = end;
+	pt->head++;
+}
+
+/*
+================
+Prof_Begin
+================
+*/
+void Prof_Begin( int zone )
+{
+	Prof_Mark( zone, false );
+}
+
+/*
+================
+Prof_End
+================
+*/
+void Prof_End( int zone )
+{
+	Prof_Mark( zone, true );
+}
+
+/*
+================
+Prof_FrameBegin
+
+turns recording on and off between frames
+================
+*/
+void Prof_FrameBegin( void )
+{
+	int	i;
+
+	if( !prof.initialized )
+		return;
+
+	if( prof_enable.value == 0.0f )
+	{
+		prof.active = false;
+		return;
+	}
+
+	if( !prof.active )
+	{
+		// rings are allocated for every slot at once,
+		// so workers never touch the allocator
+		for( i = 0; i < PROF_MAX_THREADS; i++ )
+		{
+			if( !prof.threads[i].events )
+				prof.threads[i].events = Z_Calloc( sizeof( profevent_t ) * PROF_RING_SIZE );
+		}
+		prof.active = true;
+	}
+
+	prof.framestart = Sys_DoubleTime();
+	Prof_Begin( PROF_FRAME );
+}
+
+/*
+================
+Prof_FrameEnd
+================
+*/
+void Prof_FrameEnd( void )
+{
+	profframe_t	*frame;
+
+	if( !prof.active )
+		return;
+
+	Prof_End( PROF_FRAME );
+
+	frame = &prof.frames[prof.numframes % PROF_MAX_FRAMES];
+	frame->start = prof.framestart;
+	frame->end = Sys_DoubleTime();
+	prof.numframes++;
+}
+
+/*
+================
+Prof_FirstEvent
+
+oldest event of the ring that wasn't overwritten
+================
+*/
+static LONG Prof_FirstEvent( profthread_t *pt )
+{
+	return Q_max( 0, pt->head - PROF_RING_SIZE );
+}
+
+/*
+================
+Prof_FrameWindow
+
+clamp the count of the last frames to the recorded ones.
+NOTE: the rings may hold less events, then early frames are partial
+================
+*/
+static int Prof_FrameWindow( int count )
+{
+	return bound( 1, count, Q_min( prof.numframes, PROF_MAX_FRAMES ));
+}
+
+/*
+================
+Prof_Dump_f
+
+write the last frames as chrome trace events
+================
+*/
+static void Prof_Dump_f( void )
+{
+	const char	*filename = "profile.json";
+	profthread_t	*pt;
+	profevent_t	*ev;
+	qboolean		active;
+	double		t0, t1;
+	int		depth;
+	int		i, count;
+	LONG		j;
+	file_t		*f;
+
+	if( !prof.numframes )
+	{
+		Con_Printf( "no frames recorded, set prof_enable 1 first\n" );
+		return;
+	}
+
+	count = Prof_FrameWindow( Cmd_Argc() > 1 ? Q_atoi( Cmd_Argv( 1 )) : 32 );
+	if( Cmd_Argc() > 2 ) filename = Cmd_Argv( 2 );
+
+	f = FS_Open( filename, "w", true );
+	if( !f )
+	{
+		Con_Printf( S_ERROR "couldn't write %s\n", filename );
+		return;
+	}
+
+	// pause recording so the rings stay still
+	active = prof.active;
+	prof.active = false;
+
+	t0 = prof.frames[(prof.numframes - count) % PROF_MAX_FRAMES].start;
+	t1 = prof.frames[(prof.numframes - 1) % PROF_MAX_FRAMES].end;
+
+	FS_Printf( f, "{\"traceEvents\":[\n" );
+	FS_Printf( f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"%s\"}}", host.type == HOST_DEDICATED ? "server" : "engine" );
+
+	for( i = 0; i < prof.numthreads; i++ )
+	{
+		pt = &prof.threads[i];
+		if( !pt->events ) continue;
+
+		FS_Printf( f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s\"}}", i, pt->name );
+
+		for( j = Prof_FirstEvent( pt ), depth = 0; j < pt->head; j++ )
+		{
+			ev = &pt->events[j & PROF_RING_MASK];
+			if( ev->time < t0 || ev->time > t1 )
+				continue;
+
+			// ends of the zones that began before the window are dropped
+			if( ev->end )
+			{
+				if( depth <= 0 ) continue;
+				depth--;
+			}
+			else depth++;
+
+			FS_Printf( f, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%i}",
+				prof.zones[ev->zone], ev->end ? 'E' : 'B', ( ev->time - t0 ) * 1000000.0, i );
+		}
+	}
+
+	FS_Printf( f, "\n],\"displayTimeUnit\":\"ms\"}\n" );
+	FS_Close( f );
+
+	prof.active = active;
+
+	Con_Printf( "wrote %i frames (%.2f ms) to %s\n", count, ( t1 - t0 ) * 1000.0, filename );
+}
+
+/*
+================
+Prof_CompareTimes
+================
+*/
+static int Prof_CompareTimes( const void *a, const void *b )
+{
+	double	ta = *(const double *)a;
+	double	tb = *(const double *)b;
+
+	if( ta < tb ) return -1;
+	return ( ta > tb );
+}
+
+/*
+================
+Prof_Stats_f
+
+percentiles of the time per frame spent in each zone,
+nested zones of the same thread are counted once
+================
+*/
+static void Prof_Stats_f( void )
+{
+	struct { int zone; double time; } stack[PROF_MAX_DEPTH];
+	double		*totals, *column, t0, t1;
+	int		i, k, count, depth, frame, used;
+	profthread_t	*pt;
+	profevent_t	*ev;
+	profframe_t	*fr;
+	qboolean		active;
+	LONG		j;
+
+	if( !prof.numframes )
+	{
+		Con_Printf( "no frames recorded, set prof_enable 1 first\n" );
+		return;
+	}
+
+	count = Prof_FrameWindow( Cmd_Argc() > 1 ? Q_atoi( Cmd_Argv( 1 )) : PROF_MAX_FRAMES );
+	totals = Z_Calloc( sizeof( double ) * count * prof.numzones );
+	column = Z_Malloc( sizeof( double ) * count );
+
+	active = prof.active;
+	prof.active = false;
+
+	t0 = prof.frames[(prof.numframes - count) % PROF_MAX_FRAMES].start;
+	t1 = prof.frames[(prof.numframes - 1) % PROF_MAX_FRAMES].end;
+
+	for( i = 0; i < prof.numthreads; i++ )
+	{
+		pt = &prof.threads[i];
+		if( !pt->events ) continue;
+
+		for( j = Prof_FirstEvent( pt ), depth = 0, frame = 0; j < pt->head; j++ )
+		{
+			ev = &pt->events[j & PROF_RING_MASK];
+			if( ev->time < t0 || ev->time > t1 )
+				continue;
+
+			if( !ev->end )
+			{
+				if( depth < PROF_MAX_DEPTH )
+				{
+					stack[depth].zone = ev->zone;
+					stack[depth].time = ev->time;
+				}
+				depth++;
+				continue;
+			}
+
+			if( depth <= 0 ) continue; // began before the window
+			if( --depth >= PROF_MAX_DEPTH ) continue;
+
+			// find the frame where the zone began, events are in time order
+			for( ; frame < count - 1; frame++ )
+			{
+				fr = &prof.frames[(prof.numframes - count + frame) % PROF_MAX_FRAMES];
+				if( stack[depth].time < fr->end ) break;
+			}
+
+			// count the recursive zones only once
+			for( k = 0; k < depth; k++ )
+			{
+				if( stack[k].zone == stack[depth].zone )
+					break;
+			}
+
+			if( k == depth ) totals[frame * prof.numzones + stack[depth].zone] += ev->time - stack[depth].time;
+		}
+	}
+
+	prof.active = active;
+
+	Con_Printf( "%i frames, time per frame in ms:\n", count );
+	Con_Printf( "zone                        p50     p95     p99     max\n" );
+
+	for( k = 0; k < prof.numzones; k++ )
+	{
+		for( frame = used = 0; frame < count; frame++ )
+		{
+			column[frame] = totals[frame * prof.numzones + k];
+			if( column[frame] > 0.0 ) used++;
+		}
+
+		if( !used ) continue;
+
+		qsort( column, count, sizeof( double ), Prof_CompareTimes );
+
+		Con_Printf( "%-24s %7.3f %7.3f %7.3f %7.3f\n", prof.zones[k],
+			column[(count - 1) * 50 / 100] * 1000.0,
+			column[(count - 1) * 95 / 100] * 1000.0,
+			column[(count - 1) * 99 / 100] * 1000.0,
+			column[count - 1] * 1000.0 );
+	}
+
+	Z_Free( column );
+	Z_Free( totals );
+}
+
+/*
+================
+Prof_Init
+================
+*/
+void Prof_Init( void )
+{
+	int	i;
+
+	memset( &prof, 0, sizeof( prof ));
+
+	prof.tls = TlsAlloc();
+	if( prof.tls == TLS_OUT_OF_INDEXES )
+		return;
+
+	InitializeCriticalSection( &prof.lock );
+	prof.initialized = true;
+
+	// engine zones have fixed ids
+	for( i = 0; i < PROF_ENGINE_ZONES; i++ )
+		Prof_Zone( prof_zone_names[i] );
+
+	Prof_ThreadName( "main" );
+
+	Cvar_RegisterVariable( &prof_enable );
+	Cmd_AddCommand( "prof_dump", Prof_Dump_f, "write the last frames to chrome trace json: prof_dump [frames] [file]" );
+	Cmd_AddCommand( "prof_stats", Prof_Stats_f, "print zone percentiles over the recorded frames: prof_stats [frames]" );
+}
+
+/*
+================
+Prof_Shutdown
+
+all the other threads are stopped already
+================
+*/
+void Prof_Shutdown( void )
+{
+	int	i;
+
+	if( !prof.initialized )
+		return;
+
+	prof.active = false;
+	prof.initialized = false;
+
+	Cmd_RemoveCommand( "prof_dump" );
+	Cmd_RemoveCommand( "prof_stats" );
+
+	for( i = 0; i < PROF_MAX_THREADS; i++ )
+	{
+		if( prof.threads[i].events )
+			Z_Free( prof.threads[i].events );
+	}
+
+	DeleteCriticalSection( &prof.lock );
+	TlsFree( prof.tls );
+	memset( &prof, 0, sizeof( prof ));
+}
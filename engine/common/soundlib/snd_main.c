@@ -91,16 +91,24 @@ wavdata_t *FS_LoadSound( const char *filename, const byte *buffer, size_t size )
 		if( anyformat || !Q_stricmp( ext, format->ext ))
 		{
 			Q_sprintf( path, format->formatstring, loadname, "", format->ext );
-			f = FS_LoadFile( path, &filesize, false );
+			f = FS_MapFile( path, &filesize, false );
 			if( f && filesize > 0 )
 			{
-				if( format->loadfunc( path, f, filesize ))
+				qboolean	loaded;
+
+				sound.mapfile = true;
+				loaded = format->loadfunc( path, f, filesize );
+				sound.mapfile = false;
+
+				if( loaded )
 				{
-					Mem_Free(f); // release buffer
+					// loader can use the view as sound buffer
+					if( !FBitSet( sound.flags, SOUND_MAPPED ))
+						FS_UnmapFile( f ); // release buffer
 					return SoundPack(); // loaded
 				}
-				else Mem_Free(f); // release buffer 
 			}
+			FS_UnmapFile( f ); // release buffer
 		}
 	}
 
@@ -133,7 +141,12 @@ free WAV buffer
 void FS_FreeSound( wavdata_t *pack )
 {
 	if( !pack ) return;
-	if( pack->buffer ) Mem_Free( pack->buffer );
+	if( pack->buffer )
+	{
+		if( FBitSet( pack->flags, SOUND_MAPPED ))
+			FS_UnmapFile( pack->buffer );
+		else Mem_Free( pack->buffer );
+	}
 	Mem_Free( pack );
 }
 
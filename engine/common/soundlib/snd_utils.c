@@ -222,7 +222,11 @@ qboolean Sound_Process( wavdata_t **wav, int rate, int width, uint flags )
 	{
 		if( Sound_ResampleInternal( snd, snd->rate, snd->width, rate, width ))
 		{
-			Mem_Free( snd->buffer );		// free original image buffer
+			// free original sound buffer
+			if( FBitSet( snd->flags, SOUND_MAPPED ))
+				FS_UnmapFile( snd->buffer );
+			else Mem_Free( snd->buffer );
+			ClearBits( snd->flags, SOUND_MAPPED );
 			snd->buffer = Sound_Copy( snd->size );	// unzone buffer (don't touch image.tempbuffer)
 		}
 		else
@@ -279,9 +279,18 @@ qboolean Sound_LoadWAV( const char *name, const byte *buffer, size_t filesize )
 
 	// Load the data
 	sound.size = sound.samples * sound.width * sound.channels;
-	sound.wav = Mem_Malloc( host.soundpool, sound.size );
 
-	memcpy( sound.wav, buffer + (iff_dataPtr - buffer), sound.size );
+	if( sound.mapfile && ( iff_dataPtr + sound.size ) <= ( buffer + filesize ))
+	{
+		// file view is a private copy, use it directly
+		sound.wav = (byte *)iff_dataPtr;
+		SetBits( sound.flags, SOUND_MAPPED );
+	}
+	else
+	{
+		sound.wav = Mem_Malloc( host.soundpool, sound.size );
+		memcpy( sound.wav, buffer + (iff_dataPtr - buffer), sound.size );
+	}
 
 	// now convert 8-bit sounds to signed
 	if( sound.width == 1 )
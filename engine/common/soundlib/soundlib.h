@@ -55,6 +55,7 @@ typedef struct sndlib_s
 	uint		flags;		// additional sound flags
 	size_t		size;		// sound unpacked size (for bounds checking)
 	byte		*wav;		// sound pointer (see sound_type for details)
+	qboolean		mapfile;		// source buffer is a file view and may be kept as sound pointer
 
 	byte		*tempbuffer;	// for convert operations
 	int		cmd_flags;
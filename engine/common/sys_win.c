@@ -39,6 +39,260 @@ double Sys_DoubleTime( void )
 	return (double)( CurrentTime.QuadPart - g_ClockStart.QuadPart ) / (double)( g_PerformanceFrequency.QuadPart );
 }
 
+/*
+================
+Sys_CPUFeatures
+
+returns a mask of cpu extensions,
+-nosimd forces the reference code
+================
+*/
+uint Sys_CPUFeatures( void )
+{
+	static qboolean	init = false;
+	static uint	features = 0;
+	dword		flags = 0;
+
+	if( init ) return features;
+	init = true;
+
+	if( Sys_CheckParm( "-nosimd" ))
+		return features;
+#ifdef _M_IX86
+	__asm
+	{
+		pushfd			; check for cpuid instruction
+		pop	eax
+		mov	ecx, eax
+		xor	eax, 0x200000
+		push	eax
+		popfd
+		pushfd
+		pop	eax
+		xor	eax, ecx
+		jz	no_cpuid
+		push	ebx
+		mov	eax, 1
+		cpuid
+		mov	flags, edx
+		pop	ebx
+no_cpuid:
+	}
+#endif
+	if( flags & BIT( 23 )) SetBits( features, CPU_MMX );
+	if( flags & BIT( 25 )) SetBits( features, CPU_SSE );
+	if( flags & BIT( 26 )) SetBits( features, CPU_SSE2 );
+
+	return features;
+}
+
+/*
+=============================================================================
+
+	JOB THREADS
+
+	small fork-join pool for frame synchronous work. Sys_ParallelFor
+	hands out item indices through an interlocked counter, the caller
+	takes part in the job and returns when every item is done
+=============================================================================
+*/
+typedef struct
+{
+	HANDLE		hThread;
+	HANDLE		hStart;		// signalled when a job is posted
+	DWORD		threadId;
+	int		slot;		// thread index passed to the job
+} jobthread_t;
+
+typedef struct
+{
+	jobthread_t	workers[MAX_JOB_THREADS-1];
+	int		numworkers;
+	HANDLE		hDone;		// signalled by the last worker that leaves the job
+	DWORD		owner;		// only this thread can post jobs
+	volatile LONG	next;		// next item to take
+	volatile LONG	running;		// workers still inside the job
+	volatile LONG	shutdown;
+	qboolean		busy;		// nested jobs are running inplace
+	jobfunc_t		func;
+	void		*data;
+	LONG		count;
+} jobpool_t;
+
+static jobpool_t	jobs;
+
+static void Sys_RunJobItems( int slot )
+{
+	LONG	index;
+
+	Prof_Begin( PROF_JOBS );
+
+	while(( index = InterlockedIncrement( &jobs.next ) - 1 ) < jobs.count )
+		jobs.func( jobs.data, index, slot );
+
+	Prof_End( PROF_JOBS );
+}
+
+static DWORD WINAPI Sys_JobThread( void *arg )
+{
+	jobthread_t	*worker = (jobthread_t *)arg;
+
+	Prof_ThreadName( "job" );
+
+	while( 1 )
+	{
+		WaitForSingleObject( worker->hStart, INFINITE );
+		if( jobs.shutdown ) break;
+
+		Sys_RunJobItems( worker->slot );
+
+		if( InterlockedDecrement( &jobs.running ) == 0 )
+			SetEvent( jobs.hDone );
+	}
+
+	return 0;
+}
+
+/*
+================
+Sys_InitJobs
+
+start one worker per spare cpu,
+-nojobs keeps all the work on the main thread
+================
+*/
+void Sys_InitJobs( void )
+{
+	SYSTEM_INFO	info;
+	jobthread_t	*worker;
+	int		i, count;
+
+	memset( &jobs, 0, sizeof( jobs ));
+	jobs.owner = GetCurrentThreadId();
+
+	GetSystemInfo( &info );
+	count = bound( 0, (int)info.dwNumberOfProcessors - 1, MAX_JOB_THREADS - 1 );
+	if( Sys_CheckParm( "-nojobs" )) count = 0;
+	if( count <= 0 ) return;
+
+	jobs.hDone = CreateEvent( NULL, FALSE, FALSE, NULL );
+	if( !jobs.hDone ) return;
+
+	for( i = 0; i < count; i++ )
+	{
+		worker = &jobs.workers[jobs.numworkers];
+		worker->slot = jobs.numworkers + 1;
+		worker->hStart = CreateEvent( NULL, FALSE, FALSE, NULL );
+		if( !worker->hStart ) break;
+
+		worker->hThread = CreateThread( NULL, 0, Sys_JobThread, worker, 0, &worker->threadId );
+
+		if( !worker->hThread )
+		{
+			CloseHandle( worker->hStart );
+			break;
+		}
+		jobs.numworkers++;
+	}
+}
+
+/*
+================
+Sys_ShutdownJobs
+================
+*/
+void Sys_ShutdownJobs( void )
+{
+	int	i;
+
+	jobs.shutdown = true;
+
+	for( i = 0; i < jobs.numworkers; i++ )
+	{
+		SetEvent( jobs.workers[i].hStart );
+		WaitForSingleObject( jobs.workers[i].hThread, INFINITE );
+		CloseHandle( jobs.workers[i].hThread );
+		CloseHandle( jobs.workers[i].hStart );
+	}
+
+	if( jobs.hDone ) CloseHandle( jobs.hDone );
+	memset( &jobs, 0, sizeof( jobs ));
+}
+
+/*
+================
+Sys_JobThreads
+
+number of thread slots a job can use,
+size per-thread scratch buffers with this
+================
+*/
+int Sys_JobThreads( void )
+{
+	return jobs.numworkers + 1;
+}
+
+/*
+================
+Sys_JobSlot
+
+thread slot of the caller, main thread is 0
+================
+*/
+int Sys_JobSlot( void )
+{
+	DWORD	id = GetCurrentThreadId();
+	int	i;
+
+	for( i = 0; i < jobs.numworkers; i++ )
+	{
+		if( jobs.workers[i].threadId == id )
+			return jobs.workers[i].slot;
+	}
+
+	return 0;
+}
+
+/*
+================
+Sys_ParallelFor
+
+call func for every index in [0, count) across the job threads.
+Nested calls and calls from other threads are running inplace
+================
+*/
+void Sys_ParallelFor( jobfunc_t func, void *data, int count )
+{
+	int	i, active;
+
+	if( count <= 0 ) return;
+
+	active = Q_min( jobs.numworkers, count - 1 );
+
+	if( active <= 0 || jobs.busy || GetCurrentThreadId() != jobs.owner )
+	{
+		int	slot = Sys_JobSlot();
+
+		for( i = 0; i < count; i++ )
+			func( data, i, slot );
+		return;
+	}
+
+	jobs.func = func;
+	jobs.data = data;
+	jobs.count = count;
+	jobs.next = 0;
+	jobs.running = active;
+	jobs.busy = true;
+
+	for( i = 0; i < active; i++ )
+		SetEvent( jobs.workers[i].hStart );
+
+	Sys_RunJobItems( 0 );
+	WaitForSingleObject( jobs.hDone, INFINITE );
+	jobs.busy = false;
+}
+
 /*
 ================
 Sys_GetClipboardData
@@ -43,6 +43,42 @@ typedef vec_t		matrix4x4[4][4];
 
 #define ASSERT( exp )	if(!( exp )) Sys_Error( "assert failed at %s:%i\n", __FILE__, __LINE__ )
 
+// cpu extensions that can be used by engine kernels (see Sys_CPUFeatures)
+#define CPU_MMX		BIT( 0 )
+#define CPU_SSE		BIT( 1 )
+#define CPU_SSE2		BIT( 2 )
+
+// compiler can emit SSE2 intrinsics (VC6 requires the Processor Pack)
+#if defined( _M_IX86 ) && ( _MSC_VER > 1200 || _MSC_FULL_VER >= 12008804 )
+#define XASH_SSE2
+#endif
+
+// worker threads for Sys_ParallelFor, including the main thread
+#define MAX_JOB_THREADS	8
+
+// job callback, thread is the slot in [0, Sys_JobThreads())
+typedef void (*jobfunc_t)( void *data, int index, int thread );
+
+// profiler zones of the engine, game dlls allocate the others with Prof_Zone
+typedef enum
+{
+	PROF_FRAME = 0,
+	PROF_SV_READPACKETS,
+	PROF_SV_PHYSICS,
+	PROF_SV_STARTFRAME,
+	PROF_SV_ENTITIES,
+	PROF_SV_SENDMESSAGES,
+	PROF_NETCHAN_TRANSMIT,
+	PROF_CL_READPACKETS,
+	PROF_CL_PREDICT,
+	PROF_CL_LINKENTITIES,
+	PROF_CL_UPDATESCREEN,
+	PROF_CL_SOUND,
+	PROF_MIXER,
+	PROF_JOBS,
+	PROF_ENGINE_ZONES
+} profzone_t;
+
 /*
 ========================================================================
 internal dll's loader
@@ -68,6 +104,20 @@ typedef struct dll_info_s
 
 void Sys_Sleep( int msec );
 double Sys_DoubleTime( void );
+uint Sys_CPUFeatures( void );
+void Sys_InitJobs( void );
+void Sys_ShutdownJobs( void );
+int Sys_JobThreads( void );
+int Sys_JobSlot( void );
+void Sys_ParallelFor( jobfunc_t func, void *data, int count );
+void Prof_Init( void );
+void Prof_Shutdown( void );
+void Prof_ThreadName( const char *name );
+int Prof_Zone( const char *name );
+void Prof_Begin( int zone );
+void Prof_End( int zone );
+void Prof_FrameBegin( void );
+void Prof_FrameEnd( void );
 char *Sys_GetClipboardData( void );
 char *Sys_GetCurrentUser( void );
 int Sys_CheckParm( const char *parm );
@@ -324,6 +324,10 @@ SOURCE=.\client\gl_rpart.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\client\gl_rsimd.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\client\gl_rsurf.c
 # End Source File
 # Begin Source File
@@ -372,6 +376,10 @@ SOURCE=.\common\imagelib\img_quant.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\common\imagelib\img_simd.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\common\imagelib\img_tga.c
 # End Source File
 # Begin Source File
@@ -452,6 +460,10 @@ SOURCE=.\common\pm_trace.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\common\profiler.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\client\s_backend.c
 # End Source File
 # Begin Source File
@@ -476,10 +488,18 @@ SOURCE=.\client\s_mouth.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\client\s_simd.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\client\s_stream.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\client\s_thread.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\client\s_utils.c
 # End Source File
 # Begin Source File
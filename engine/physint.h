@@ -58,6 +58,17 @@ typedef struct areanode_s
 	link_t		portal_edicts;
 } areanode_t;
 
+// one line of a pfnTraceLines batch
+typedef struct linetrace_s
+{
+	float		start[3];
+	float		end[3];
+	int		type;		// same as fNoMonsters of pfnTraceLine (0x100 to ignore glass)
+	edict_t		*ignore;
+	float		fraction;		// returned
+	edict_t		*ent;		// returned, world when nothing was hit
+} linetrace_t;
+
 typedef struct server_physics_api_s
 {
 	// unlink edict from old position and link onto new
@@ -106,6 +117,22 @@ typedef struct server_physics_api_s
 	const byte	*(*pfnLoadImagePixels)( const char *filename, int *width, int *height );
 
 	const char*	(*pfnGetModelName)( int modelindex );
+
+	// job threads (parallel loops run on the calling thread when there are no workers)
+	int		(*pfnJobThreads)( void );
+	void		(*pfnParallelFor)( void (*func)( void *data, int index, int thread ), void *data, int count );
+	// thread-safe trace against world and brush entities, sets *serial when pfnTrace must be used instead
+	trace_t		(*pfnTraceBrushes)( const float *p0, float *mins, float *maxs, const float *p1, int type, edict_t *e, int *serial );
+	// entities touching the box with any of the flagmask bits, in edict order. Returns the full count, fills up to maxcount
+	int		(*pfnEntitiesInBox)( int flagmask, const float *mins, const float *maxs, edict_t **list, int maxcount );
+	// pfnTraceLine for many lines at once, doesn't set the trace globals
+	void		(*pfnTraceLines)( linetrace_t *lines, int count );
+	// materials.txt type of the texture pfnTraceTexture would return, 0 if nothing was hit
+	char		(*pfnTraceMaterial)( edict_t *pTextureEntity, const float *v1, const float *v2 );
+	// engine profiler: get the zone id once, then mark it around the code (see prof_dump and prof_stats)
+	int		(*pfnProfZone)( const char *name );
+	void		(*pfnProfBegin)( int zone );
+	void		(*pfnProfEnd)( int zone );
 } server_physics_api_t;
 
 // physic callbacks
@@ -159,6 +186,12 @@ typedef struct physics_interface_s
 	void		*(*SV_HullForBsp)( edict_t *ent, const float *mins, const float *maxs, float *offset );
 	// handle player custom think function
 	int		(*SV_PlayerThink)( edict_t *ent, float frametime, double time );
+	// per-client part of pfnAddToFullPack: should entity be sent to this host (both SV_CheckFullPack and SV_EntityState are required)
+	int		(*SV_CheckFullPack)( int e, edict_t *ent, edict_t *host, int hostflags, int player, unsigned char *pSet );
+	// build the network state of entity, shared by all clients. Called again only when ent->v was changed
+	void		(*SV_EntityState)( struct entity_state_s *state, int e, edict_t *ent, int player );
+	// optional: change the shared state for a particular host (e.g. owner-only effects)
+	void		(*SV_CustomizeEntityState)( struct entity_state_s *state, int e, edict_t *ent, edict_t *host, int hostflags );
 } physics_interface_t;
 
 #endif//PHYSINT_H
\ No newline at end of file
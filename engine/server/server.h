@@ -105,6 +105,15 @@ typedef struct
 	entity_state_t	baseline;
 } sv_baseline_t;
 
+// network state of edict shared by all clients
+typedef struct
+{
+	int		sendframe;	// svs.sendframe when it was validated last time
+	qboolean		valid;		// state was built from v
+	entvars_t		v;		// copy of ent->v to detect changes
+	entity_state_t	state;
+} sv_packstate_t;
+
 typedef struct
 {
 	qboolean		active;
@@ -366,6 +375,8 @@ typedef struct
 	entity_state_t	*packet_entities;		// [num_client_entities]
 	entity_state_t	*baselines;		// [GI->max_edicts]
 	entity_state_t	*static_entities;		// [MAX_STATIC_ENTITIES];
+	sv_packstate_t	*packstates;		// [GI->max_edicts]
+	int		sendframe;		// incremented each SV_SendClientMessages
 
 	double		last_heartbeat;
 	challenge_t	challenges[MAX_CHALLENGES];	// to prevent invalid IPs from connecting
@@ -646,16 +657,21 @@ qboolean SV_PlayerIsFrozen( edict_t *pClient );
 //
 void SV_ClearWorld( void );
 void SV_UnlinkEdict( edict_t *ent );
+void SV_LinkUnplacedEdict( edict_t *ent );
 void SV_ClipMoveToEntity( edict_t *ent, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, trace_t *trace );
 void SV_CustomClipMoveToEntity( edict_t *ent, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, trace_t *trace );
 trace_t SV_TraceHull( edict_t *ent, int hullNum, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end );
 trace_t SV_Move( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int type, edict_t *e, qboolean monsterclip );
 trace_t SV_MoveNoEnts( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int type, edict_t *e );
 trace_t SV_MoveNormal( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int type, edict_t *e );
+trace_t SV_MoveBrushes( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int type, edict_t *e, int *serial );
+void SV_TraceLines( linetrace_t *lines, int count );
 const char *SV_TraceTexture( edict_t *ent, const vec3_t start, const vec3_t end );
+char SV_TraceMaterial( edict_t *ent, const float *start, const float *end );
 msurface_t *SV_TraceSurface( edict_t *ent, const vec3_t start, const vec3_t end );
 trace_t SV_MoveToss( edict_t *tossent, edict_t *ignore );
 void SV_LinkEdict( edict_t *ent, qboolean touch_triggers );
+int SV_EntitiesInBox( int flagmask, const float *mins, const float *maxs, edict_t **list, int maxcount );
 void SV_TouchLinks( edict_t *ent, areanode_t *node );
 int SV_TruePointContents( const vec3_t p );
 int SV_PointContents( const vec3_t p );
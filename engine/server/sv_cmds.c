@@ -874,6 +874,30 @@ void SV_EntityInfo_f( void )
 	}
 }
 
+/*
+===============
+SV_FuncLookupBenchmark_f
+
+time game dll export lookups for
+a number of restored entities
+===============
+*/
+void SV_FuncLookupBenchmark_f( void )
+{
+	int	count = 10000;
+
+	if( !svgame.hInstance )
+	{
+		Con_Printf( "^3no game dll loaded.\n" );
+		return;
+	}
+
+	if( Cmd_Argc() > 1 )
+		count = max( 1, Q_atoi( Cmd_Argv( 1 )));
+
+	COM_FunctionLookupBenchmark( svgame.hInstance, count );
+}
+
 /*
 ==================
 SV_InitHostCommands
@@ -917,6 +941,7 @@ void SV_InitOperatorCommands( void )
 	Cmd_AddCommand( "entpatch", SV_EntPatch_f, "write entity patch to allow external editing" );
 	Cmd_AddCommand( "edict_usage", SV_EdictUsage_f, "show info about edicts usage" );
 	Cmd_AddCommand( "entity_info", SV_EntityInfo_f, "show more info about edicts" );
+	Cmd_AddCommand( "func_lookup_benchmark", SV_FuncLookupBenchmark_f, "time game dll export lookups <entities>" );
 	Cmd_AddCommand( "shutdownserver", SV_KillServer_f, "shutdown current server" );
 	Cmd_AddCommand( "changelevel", SV_ChangeLevel_f, "change level" );
 	Cmd_AddCommand( "changelevel2", SV_ChangeLevel2_f, "smooth change level" );
@@ -951,6 +976,7 @@ void SV_KillOperatorCommands( void )
 	Cmd_RemoveCommand( "entpatch" );
 	Cmd_RemoveCommand( "edict_usage" );
 	Cmd_RemoveCommand( "entity_info" );
+	Cmd_RemoveCommand( "func_lookup_benchmark" );
 	Cmd_RemoveCommand( "shutdownserver" );
 	Cmd_RemoveCommand( "changelevel" );
 	Cmd_RemoveCommand( "changelevel2" );
@@ -48,6 +48,33 @@ static int SV_EntityNumbers( const void *a, const void *b )
 	return 1;
 }
 
+/*
+=============
+SV_EntityPackState
+
+network state of edict is built once per frame
+and only if entvars was changed since the last time
+=============
+*/
+static entity_state_t *SV_EntityPackState( int e, edict_t *ent, qboolean player )
+{
+	sv_packstate_t	*pack = &svs.packstates[e];
+
+	if( pack->valid && pack->sendframe == svs.sendframe )
+		return &pack->state; // already validated by another client
+
+	pack->sendframe = svs.sendframe;
+
+	if( pack->valid && !memcmp( &pack->v, &ent->v, sizeof( entvars_t )))
+		return &pack->state; // nothing changed
+
+	svgame.physFuncs.SV_EntityState( &pack->state, e, ent, player );
+	pack->v = ent->v;
+	pack->valid = true;
+
+	return &pack->state;
+}
+
 /*
 =============
 SV_AddEntitiesToPacket
@@ -62,6 +89,7 @@ static void SV_AddEntitiesToPacket( edict_t *pViewEnt, edict_t *pClient, client_
 	qboolean		fullvis = false;
 	sv_client_t	*cl = NULL;
 	qboolean		player;
+	qboolean		added;
 	entity_state_t	*state;
 	int		e;
 
@@ -123,7 +151,21 @@ static void SV_AddEntitiesToPacket( edict_t *pViewEnt, edict_t *pClient, client_
 		state = &ents->entities[ents->num_entities];
 
 		// add entity to the net packet
-		if( svgame.dllFuncs.pfnAddToFullPack( state, e, ent, pClient, sv.hostflags, player, pset ))
+		if( svgame.physFuncs.SV_CheckFullPack && svgame.physFuncs.SV_EntityState )
+		{
+			added = svgame.physFuncs.SV_CheckFullPack( e, ent, pClient, sv.hostflags, player, pset );
+
+			if( added )
+			{
+				*state = *SV_EntityPackState( e, ent, player );
+
+				if( svgame.physFuncs.SV_CustomizeEntityState )
+					svgame.physFuncs.SV_CustomizeEntityState( state, e, ent, pClient, sv.hostflags );
+			}
+		}
+		else added = svgame.dllFuncs.pfnAddToFullPack( state, e, ent, pClient, sv.hostflags, player, pset );
+
+		if( added )
 		{
 			// to prevent adds it twice through portals
 			SETVISBIT( ents->sended, e );
@@ -845,6 +887,9 @@ void SV_SendClientMessages( void )
 
 	SV_UpdateToReliableMessages ();
 
+	// entity states shared between clients must be validated again
+	svs.sendframe++;
+
 	// send a message to each connected client
 	for( i = 0, sv.current_client = svs.clients; i < svs.maxclients; i++, sv.current_client++ )
 	{
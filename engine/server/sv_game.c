@@ -92,7 +92,7 @@ entavrs table for FindEntityByString
 */
 TYPEDESCRIPTION *SV_GetEntvarsDescirption( int number )
 {
-	if( number < 0 && number >= ENTVARS_COUNT )
+	if( number < 0 || number >= ENTVARS_COUNT )
 		return NULL;
 	return &gEntvarsDescription[number];
 }
@@ -2944,6 +2944,7 @@ void *pfnPvAllocEntPrivateData( edict_t *pEdict, long cb )
 	{
 		// a poke646 have memory corrupt in somewhere - this is trashed last sixteen bytes :(
 		pEdict->pvPrivateData = Mem_Calloc( svgame.mempool, (cb + 15) & ~15 );
+		SV_LinkUnplacedEdict( pEdict );
 	}
 
 	return pEdict->pvPrivateData;
@@ -4757,6 +4758,8 @@ void SV_UnloadProgs( void )
 	Z_Free( svs.static_entities );
 	Z_Free( svs.baselines );
 	svs.baselines = NULL;
+	Z_Free( svs.packstates );
+	svs.packstates = NULL;
 
 	// remove server cmds
 	SV_KillOperatorCommands();
@@ -4885,6 +4888,7 @@ qboolean SV_LoadProgs( const char *name )
 	svgame.edicts = Mem_Calloc( svgame.mempool, sizeof( edict_t ) * GI->max_edicts );
 	svs.static_entities = Z_Calloc( sizeof( entity_state_t ) * MAX_STATIC_ENTITIES );
 	svs.baselines = Z_Calloc( sizeof( entity_state_t ) * GI->max_edicts );
+	svs.packstates = Z_Calloc( sizeof( sv_packstate_t ) * GI->max_edicts );
 	svgame.numEntities = svs.maxclients + 1; // clients + world
 
 	for( i = 0, e = svgame.edicts; i < GI->max_edicts; i++, e++ )
@@ -16,6 +16,7 @@ GNU General Public License for more details.
 #include "common.h"
 #include "server.h"
 #include "net_encode.h"
+#include "pm_local.h"
 
 int SV_UPDATE_BACKUP = SINGLEPLAYER_BACKUP;
 
@@ -799,6 +800,7 @@ qboolean SV_SpawnServer( const char *mapname, const char *startspot, qboolean ba
 	// clearing all the baselines
 	memset( svs.static_entities, 0, sizeof( entity_state_t ) * MAX_STATIC_ENTITIES );
 	memset( svs.baselines, 0, sizeof( entity_state_t ) * GI->max_edicts );
+	memset( svs.packstates, 0, sizeof( sv_packstate_t ) * GI->max_edicts );
 
 	// make cvars consistant
 	if( coop.value ) Cvar_SetValue( "deathmatch", 0 );
@@ -843,6 +845,7 @@ qboolean SV_SpawnServer( const char *mapname, const char *startspot, qboolean ba
 	Q_snprintf( sv.model_precache[WORLD_INDEX], sizeof( sv.model_precache[0] ), "maps/%s.bsp", sv.name );
 	SetBits( sv.model_precache_flags[WORLD_INDEX], RES_FATALIFMISSING );
 	sv.worldmodel = sv.models[WORLD_INDEX] = Mod_LoadWorld( sv.model_precache[WORLD_INDEX], true );
+	PM_InitMaterials( sv.worldmodel, svgame.dllFuncs.pfnPM_FindTextureType );
 	CRC32_MapFile( &sv.worldmapCRC, sv.model_precache[WORLD_INDEX], svs.maxclients > 1 );
 
 	if( FBitSet( host.features, ENGINE_QUAKE_COMPATIBLE ) && FS_FileExists( "progs.dat", false ))
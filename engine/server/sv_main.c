@@ -619,7 +619,9 @@ void Host_ServerFrame( void )
 	SV_CheckCmdTimes ();
 
 	// read packets from clients
+	Prof_Begin( PROF_SV_READPACKETS );
 	SV_ReadPackets ();
+	Prof_End( PROF_SV_READPACKETS );
 
 	// refresh physic movevars on the client side
 	SV_UpdateMovevars ( false );
@@ -634,7 +636,9 @@ void Host_ServerFrame( void )
 	if( !SV_RunGameFrame ()) return;
 		
 	// send messages back to the clients that had packets read this frame
+	Prof_Begin( PROF_SV_SENDMESSAGES );
 	SV_SendClientMessages ();
+	Prof_End( PROF_SV_SENDMESSAGES );
 
 	// clear edict flags for next frame
 	SV_PrepWorldFrame ();
@@ -643,6 +647,26 @@ void Host_ServerFrame( void )
 	Master_Heartbeat ();
 }
 
+/*
+==================
+Host_ServerPackets
+
+dedicated server reads the packets
+as soon as they come between the frames
+==================
+*/
+qboolean Host_ServerPackets( void )
+{
+	if( !svs.initialized )
+		return false;
+
+	Prof_Begin( PROF_SV_READPACKETS );
+	SV_ReadPackets ();
+	Prof_End( PROF_SV_READPACKETS );
+
+	return true;
+}
+
 /*
 ==================
 Host_SetServerState
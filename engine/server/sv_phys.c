@@ -1777,14 +1777,19 @@ void SV_Physics( void )
 	edict_t	*ent;
 	int    	i;
 	
+	Prof_Begin( PROF_SV_PHYSICS );
+
 	SV_CheckAllEnts ();
 
 	svgame.globals->time = sv.time;
 
 	// let the progs know that a new frame has started
+	Prof_Begin( PROF_SV_STARTFRAME );
 	svgame.dllFuncs.pfnStartFrame();
+	Prof_End( PROF_SV_STARTFRAME );
 
 	// treat each object in turn
+	Prof_Begin( PROF_SV_ENTITIES );
 	for( i = 0; i < svgame.numEntities; i++ )
 	{
 		ent = EDICT_NUM( i );
@@ -1797,6 +1802,7 @@ void SV_Physics( void )
 
 		SV_Physics_Entity( ent );
 	}
+	Prof_End( PROF_SV_ENTITIES );
 
 	if( svgame.globals->force_retouch != 0.0f )
 		svgame.globals->force_retouch--;
@@ -1812,6 +1818,8 @@ void SV_Physics( void )
 
 	// decrement svgame.numEntities if the highest number entities died
 	for( ; EDICT_NUM( svgame.numEntities - 1 )->free; svgame.numEntities-- );
+
+	Prof_End( PROF_SV_PHYSICS );
 }
 
 /*
@@ -2032,6 +2040,15 @@ static server_physics_api_t gPhysicsAPI =
 	COM_SaveFile,
 	pfnLoadImagePixels,
 	pfnGetModelName,
+	Sys_JobThreads,
+	Sys_ParallelFor,
+	SV_MoveBrushes,
+	SV_EntitiesInBox,
+	SV_TraceLines,
+	SV_TraceMaterial,
+	Prof_Zone,
+	Prof_Begin,
+	Prof_End,
 };
 
 /*
@@ -480,6 +480,17 @@ static const char *pfnTraceTexture( int ground, float *vstart, float *vend )
 	return PM_TraceTexture( pe, vstart, vend );
 }			
 
+static char pfnTraceMaterial( int ground, float *vstart, float *vend, char *texname )
+{
+	physent_t *pe;
+
+	if( ground < 0 || ground >= svgame.pmove->numphysent )
+		return 0; // bad ground
+
+	pe = &svgame.pmove->physents[ground];
+	return PM_TraceMaterial( pe, vstart, vend, svgame.dllFuncs.pfnPM_FindTextureType, texname );
+}
+
 static void pfnPlaySound( int channel, const char *sample, float volume, float attenuation, int fFlags, int pitch )
 {
 	edict_t	*ent;
@@ -611,6 +622,7 @@ void SV_InitClientMove( void )
 	svgame.pmove->PM_TestPlayerPositionEx = pfnTestPlayerPositionEx;
 	svgame.pmove->PM_TraceLineEx = pfnTraceLineEx;
 	svgame.pmove->PM_TraceSurface = pfnTraceSurface;
+	svgame.pmove->PM_TraceMaterial = pfnTraceMaterial;
 
 	// initalize pmove
 	svgame.dllFuncs.pfnPM_Init( svgame.pmove );
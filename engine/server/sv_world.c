@@ -30,8 +30,11 @@ typedef struct moveclip_s
 	int		type;		// move type
 	qboolean		ignoretrans;
 	qboolean		monsterclip;
+	qboolean		serial;		// SV_MoveBrushes reached something it can't clip
 } moveclip_t;
 
+#define SV_TRACELINE_BATCH	8	// fewer lines than this aren't worth waking the job threads
+
 /*
 ===============================================================================
 
@@ -407,6 +410,7 @@ ENTITY AREA CHECKING
 */
 static int	iTouchLinkSemaphore = 0;	// prevent recursion when SV_TouchLinks is active
 areanode_t	sv_areanodes[AREA_NODES];
+static link_t	sv_nonsolid_edicts[AREA_NODES];	// SOLID_NOT, only for SV_EntitiesInBox
 static int	sv_numareanodes;
 
 /*
@@ -428,6 +432,7 @@ areanode_t *SV_CreateAreaNode( int depth, vec3_t mins, vec3_t maxs )
 	ClearLink( &anode->trigger_edicts );
 	ClearLink( &anode->solid_edicts );
 	ClearLink( &anode->portal_edicts );
+	ClearLink( &sv_nonsolid_edicts[anode - sv_areanodes] );
 	
 	if( depth == AREA_DEPTH )
 	{
@@ -474,6 +479,7 @@ void SV_ClearWorld( void )
 	}
 
 	memset( sv_areanodes, 0, sizeof( sv_areanodes ));
+	memset( sv_nonsolid_edicts, 0, sizeof( sv_nonsolid_edicts ));
 	iTouchLinkSemaphore = 0;
 	sv_numareanodes = 0;
 
@@ -495,6 +501,22 @@ void SV_UnlinkEdict( edict_t *ent )
 	ent->area.next = NULL;
 }
 
+/*
+===============
+SV_LinkUnplacedEdict
+
+edicts that get private data before their first SV_LinkEdict
+wait on the root node, so SV_EntitiesInBox still finds them
+===============
+*/
+void SV_LinkUnplacedEdict( edict_t *ent )
+{
+	if( ent->area.prev || ent == svgame.edicts || !sv_numareanodes )
+		return;
+
+	InsertLinkBefore( &ent->area, &sv_nonsolid_edicts[0] );
+}
+
 /*
 ====================
 SV_TouchLinks
@@ -665,10 +687,6 @@ void SV_LinkEdict( edict_t *ent, qboolean touch_triggers )
 		}
 	}
 
-	// ignore non-solid bodies
-	if( ent->v.solid == SOLID_NOT && ent->v.skin >= CONTENTS_EMPTY )
-		return;
-
 	// find the first node that the ent's box crosses
 	node = sv_areanodes;
 
@@ -683,7 +701,13 @@ void SV_LinkEdict( edict_t *ent, qboolean touch_triggers )
 	}
 	
 	// link it in	
-	if( ent->v.solid == SOLID_TRIGGER )
+	if( ent->v.solid == SOLID_NOT && ent->v.skin >= CONTENTS_EMPTY )
+	{
+		// non-solid bodies are only kept for SV_EntitiesInBox
+		InsertLinkBefore( &ent->area, &sv_nonsolid_edicts[node - sv_areanodes] );
+		return;
+	}
+	else if( ent->v.solid == SOLID_TRIGGER )
 		InsertLinkBefore( &ent->area, &node->trigger_edicts );
 	else if( ent->v.solid == SOLID_PORTAL )
 		InsertLinkBefore( &ent->area, &node->portal_edicts );
@@ -700,6 +724,125 @@ void SV_LinkEdict( edict_t *ent, qboolean touch_triggers )
 /*
 ===============================================================================
 
+ENTITY QUERIES
+
+===============================================================================
+*/
+typedef struct
+{
+	const float	*mins, *maxs;
+	int		flagmask;
+	int		count;
+} areaquery_t;
+
+static edict_t	*sv_queryedicts[MAX_EDICTS];
+
+/*
+====================
+SV_EdictNumbers
+
+edicts are one array, so this keeps them in index order
+====================
+*/
+static int SV_EdictNumbers( const void *a, const void *b )
+{
+	edict_t	*ent1 = *(edict_t **)a;
+	edict_t	*ent2 = *(edict_t **)b;
+
+	if( ent1 < ent2 )
+		return -1;
+	return ( ent1 > ent2 );
+}
+
+/*
+====================
+SV_QueryLinks
+====================
+*/
+static void SV_QueryLinks( link_t *start, areaquery_t *aq )
+{
+	link_t	*l;
+	edict_t	*check;
+
+	for( l = start->next; l != start; l = l->next )
+	{
+		check = EDICT_FROM_AREA( l );
+
+		if( check->free || !check->pvPrivateData )
+			continue;
+
+		if( aq->flagmask && !FBitSet( check->v.flags, aq->flagmask ))
+			continue;
+
+		if( aq->mins[0] > check->v.absmax[0] || aq->mins[1] > check->v.absmax[1] || aq->mins[2] > check->v.absmax[2] )
+			continue;
+
+		if( aq->maxs[0] < check->v.absmin[0] || aq->maxs[1] < check->v.absmin[1] || aq->maxs[2] < check->v.absmin[2] )
+			continue;
+
+		if( aq->count == MAX_EDICTS )
+			return;
+
+		sv_queryedicts[aq->count++] = check;
+	}
+}
+
+/*
+====================
+SV_QueryAreaNode
+====================
+*/
+static void SV_QueryAreaNode( areanode_t *node, areaquery_t *aq )
+{
+	SV_QueryLinks( &node->solid_edicts, aq );
+	SV_QueryLinks( &node->trigger_edicts, aq );
+	SV_QueryLinks( &node->portal_edicts, aq );
+	SV_QueryLinks( &sv_nonsolid_edicts[node - sv_areanodes], aq );
+
+	if( node->axis == -1 ) return;
+
+	// touching boxes count, same as in the game's own scan
+	if( aq->maxs[node->axis] > node->dist )
+		SV_QueryAreaNode( node->children[0], aq );
+	if( aq->mins[node->axis] < node->dist )
+		SV_QueryAreaNode( node->children[1], aq );
+}
+
+/*
+====================
+SV_EntitiesInBox
+
+Finds the edicts with private data whose absbox touches the box and
+that have any of the flagmask bits (or any flags for 0), in edict order.
+Writes up to maxcount of them and returns how many there were in total,
+so the caller can tell when the list was cut short.
+====================
+*/
+int SV_EntitiesInBox( int flagmask, const float *mins, const float *maxs, edict_t **list, int maxcount )
+{
+	areaquery_t	aq;
+
+	if( !sv.worldmodel || maxcount < 0 )
+		return 0;
+
+	aq.mins = mins;
+	aq.maxs = maxs;
+	aq.flagmask = flagmask;
+	aq.count = 0;
+
+	SV_QueryAreaNode( sv_areanodes, &aq );
+
+	if( aq.count > 1 )
+		qsort( sv_queryedicts, aq.count, sizeof( edict_t* ), SV_EdictNumbers );
+
+	if( list ) memcpy( list, sv_queryedicts, sizeof( edict_t* ) * min( aq.count, maxcount ));
+
+	return aq.count;
+}
+
+/*
+===============================================================================
+
 POINT TESTING IN HULLS
 
 ===============================================================================
@@ -1343,10 +1486,12 @@ void SV_ClipToWorldBrush( areanode_t *node, moveclip_t *clip )
 
 /*
 ==================
-SV_Move
+SV_MoveTrace
+
+same as SV_Move but leaves the trace globals alone
 ==================
 */
-trace_t SV_Move( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int type, edict_t *e, qboolean monsterclip )
+static trace_t SV_MoveTrace( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int type, edict_t *e, qboolean monsterclip )
 {
 	moveclip_t	clip;
 	vec3_t		trace_endpos;
@@ -1388,14 +1533,26 @@ trace_t SV_Move( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end,
 		SV_ClipToPortals( sv_areanodes, &clip );
 
 		clip.trace.fraction *= trace_fraction;
-		svgame.globals->trace_ent = clip.trace.ent;
 	}
 
-	SV_CopyTraceToGlobal( &clip.trace );
-
 	return clip.trace;
 }
 
+/*
+==================
+SV_Move
+==================
+*/
+trace_t SV_Move( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int type, edict_t *e, qboolean monsterclip )
+{
+	trace_t	trace;
+
+	trace = SV_MoveTrace( start, mins, maxs, end, type, e, monsterclip );
+	SV_CopyTraceToGlobal( &trace );
+
+	return trace;
+}
+
 trace_t SV_MoveNormal( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int type, edict_t *e )
 {
 	return SV_Move( start, mins, maxs, end, type, e, false );
@@ -1445,6 +1602,252 @@ trace_t SV_MoveNoEnts( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_
 	return clip.trace;
 }
 
+/*
+====================
+SV_ClipToBrushLinks
+
+same filtering as SV_ClipToEntity but clips brush entities only
+and never calls into the game. Anything else that could be hit
+marks the move as serial
+====================
+*/
+static void SV_ClipToBrushLinks( areanode_t *node, moveclip_t *clip, qboolean portals )
+{
+	link_t	*l, *next, *list;
+	edict_t	*touch;
+	model_t	*mod;
+	trace_t	trace;
+
+	list = portals ? &node->portal_edicts : &node->solid_edicts;
+
+	for( l = list->next; l != list; l = next )
+	{
+		next = l->next;
+
+		touch = EDICT_FROM_AREA( l );
+
+		if( touch->v.groupinfo && SV_IsValidEdict( clip->passedict ) && clip->passedict->v.groupinfo != 0 )
+		{
+			if( svs.groupop == GROUP_OP_AND && !FBitSet( touch->v.groupinfo, clip->passedict->v.groupinfo ))
+				continue;
+
+			if( svs.groupop == GROUP_OP_NAND && FBitSet( touch->v.groupinfo, clip->passedict->v.groupinfo ))
+				continue;
+		}
+
+		if( touch == clip->passedict || touch->v.solid == SOLID_NOT )
+			continue;
+
+		if( touch->v.solid == SOLID_BSP || touch->v.solid == SOLID_CUSTOM )
+		{
+			if( FBitSet( touch->v.flags, FL_MONSTERCLIP ) && !clip->monsterclip )
+				continue;
+		}
+		else if( clip->type == MOVE_NOMONSTERS && touch->v.movetype != MOVETYPE_PUSHSTEP )
+		{
+			continue;
+		}
+
+		mod = SV_ModelHandle( touch->v.modelindex );
+
+		if( mod && mod->type == mod_brush && clip->ignoretrans )
+		{
+			if( touch->v.rendermode != kRenderNormal && !FBitSet( touch->v.flags, FL_WORLDBRUSH ))
+				continue;
+		}
+
+		if( !BoundsIntersect( clip->boxmins, clip->boxmaxs, touch->v.absmin, touch->v.absmax ))
+			continue;
+
+		// custom filters, portals, box hulls and studio hulls are main thread only
+		if( touch->v.solid != SOLID_BSP || !mod || mod->type != mod_brush || svgame.dllFuncs2.pfnShouldCollide )
+		{
+			clip->serial = true;
+			return;
+		}
+
+		if( touch->v.movetype != MOVETYPE_PUSH && touch->v.movetype != MOVETYPE_PUSHSTEP )
+		{
+			clip->serial = true;
+			return;
+		}
+
+		if( FBitSet( touch->v.flags, FL_CLIENT|FL_FAKECLIENT ))
+		{
+			clip->serial = true;
+			return;
+		}
+
+		if( SV_IsValidEdict( clip->passedict ) && !VectorIsNull( clip->passedict->v.size ) && VectorIsNull( touch->v.size ))
+			continue;
+
+		if( clip->trace.allsolid ) return;
+
+		if( SV_IsValidEdict( clip->passedict ))
+		{
+		 	if( touch->v.owner == clip->passedict )
+				continue;
+			if( clip->passedict->v.owner == touch )
+				continue;
+		}
+
+		if( FBitSet( touch->v.flags, FL_MONSTER ))
+			SV_ClipMoveToEntity( touch, clip->start, clip->mins2, clip->maxs2, clip->end, &trace );
+		else SV_ClipMoveToEntity( touch, clip->start, clip->mins, clip->maxs, clip->end, &trace );
+
+		clip->trace = World_CombineTraces( &clip->trace, &trace, touch );
+	}
+
+	// recurse down both sides
+	if( node->axis == -1 ) return;
+
+	if( clip->boxmaxs[node->axis] > node->dist )
+	{
+		SV_ClipToBrushLinks( node->children[0], clip, portals );
+		if( clip->serial ) return;
+	}
+
+	if( clip->boxmins[node->axis] < node->dist )
+		SV_ClipToBrushLinks( node->children[1], clip, portals );
+}
+
+/*
+==================
+SV_MoveBrushes
+
+thread-safe version of SV_Move for the world and brush entities.
+Doesn't touch the globals or call into the game dll. If the move
+reaches an entity that only SV_Move can clip, *serial is set and
+the result must be thrown away and traced again on the main thread
+==================
+*/
+trace_t SV_MoveBrushes( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int type, edict_t *e, int *serial )
+{
+	moveclip_t	clip;
+	vec3_t		trace_endpos;
+	float		trace_fraction;
+
+	memset( &clip, 0, sizeof( moveclip_t ));
+
+	if( svgame.physFuncs.SV_HullForBsp != NULL )
+	{
+		// game selects the hulls
+		clip.trace.fraction = 1.0f;
+		VectorCopy( end, clip.trace.endpos );
+		if( serial ) *serial = true;
+		return clip.trace;
+	}
+
+	SV_ClipMoveToEntity( EDICT_NUM( 0 ), start, mins, maxs, end, &clip.trace );
+
+	if( clip.trace.fraction != 0.0f )
+	{
+		VectorCopy( clip.trace.endpos, trace_endpos );
+		trace_fraction = clip.trace.fraction;
+		clip.trace.fraction = 1.0f;
+		clip.start = start;
+		clip.end = trace_endpos;
+		clip.type = (type & 0xFF);
+		clip.ignoretrans = type >> 8;
+		clip.monsterclip = false;
+		clip.passedict = (e) ? e : EDICT_NUM( 0 );
+		clip.mins = mins;
+		clip.maxs = maxs;
+
+		if( clip.type == MOVE_MISSILE )
+		{
+			VectorSet( clip.mins2, -15.0f, -15.0f, -15.0f );
+			VectorSet( clip.maxs2,  15.0f,  15.0f,  15.0f );
+		}
+		else
+		{
+			VectorCopy( mins, clip.mins2 );
+			VectorCopy( maxs, clip.maxs2 );
+		}
+
+		World_MoveBounds( start, clip.mins2, clip.maxs2, trace_endpos, clip.boxmins, clip.boxmaxs );
+		SV_ClipToBrushLinks( sv_areanodes, &clip, false );
+		if( !clip.serial ) SV_ClipToBrushLinks( sv_areanodes, &clip, true );
+
+		clip.trace.fraction *= trace_fraction;
+	}
+
+	if( serial ) *serial = clip.serial;
+
+	return clip.trace;
+}
+
+/*
+==================
+SV_TraceLineJob
+
+lines that need the game dll or the globals are left for the main thread
+==================
+*/
+static void SV_TraceLineJob( void *data, int index, int thread )
+{
+	linetrace_t	*line = (linetrace_t *)data + index;
+	int		serial = false;
+	trace_t		trace;
+
+	trace = SV_MoveBrushes( line->start, vec3_origin, vec3_origin, line->end, line->type, line->ignore, &serial );
+
+	if( serial )
+	{
+		line->ent = NULL;
+		return;
+	}
+
+	line->fraction = trace.fraction;
+	line->ent = SV_IsValidEdict( trace.ent ) ? trace.ent : svgame.edicts;
+}
+
+/*
+==================
+SV_TraceLines
+
+runs a batch of pfnTraceLine's on the job threads. The lines
+SV_MoveBrushes can't finish are traced again here with SV_MoveTrace.
+Unlike pfnTraceLine the trace globals are left alone
+==================
+*/
+void SV_TraceLines( linetrace_t *lines, int count )
+{
+	trace_t	trace;
+	int	i;
+#ifdef _DEBUG
+	globalvars_t	saved;
+#endif
+	if( count <= 0 ) return;
+#ifdef _DEBUG
+	saved = *svgame.globals;
+#endif
+
+	if( count >= SV_TRACELINE_BATCH )
+	{
+		Sys_ParallelFor( SV_TraceLineJob, lines, count );
+	}
+	else
+	{
+		for( i = 0; i < count; i++ )
+			SV_TraceLineJob( lines, i, 0 );
+	}
+
+	for( i = 0; i < count; i++ )
+	{
+		if( lines[i].ent != NULL )
+			continue;
+
+		trace = SV_MoveTrace( lines[i].start, vec3_origin, vec3_origin, lines[i].end, lines[i].type, lines[i].ignore, false );
+		lines[i].fraction = trace.fraction;
+		lines[i].ent = SV_IsValidEdict( trace.ent ) ? trace.ent : svgame.edicts;
+	}
+#ifdef _DEBUG
+	// trace_allsolid through trace_flags
+	Assert( !memcmp( &saved.trace_allsolid, &svgame.globals->trace_allsolid, (byte *)&saved.changelevel - (byte *)&saved.trace_allsolid ));
+#endif
+}
+
 /*
 ==================
 SV_TraceSurface
@@ -1499,6 +1902,23 @@ const char *SV_TraceTexture( edict_t *ent, const vec3_t start, const vec3_t end
 	return surf->texinfo->texture->name;
 }
 
+/*
+==================
+SV_TraceMaterial
+
+materials.txt type of the face where the traceline hit
+==================
+*/
+char SV_TraceMaterial( edict_t *ent, const float *start, const float *end )
+{
+	msurface_t	*surf = SV_TraceSurface( ent, start, end );
+
+	if( !surf || !surf->texinfo )
+		return 0;
+
+	return PM_TextureMaterial( surf->texinfo->texture, svgame.dllFuncs.pfnPM_FindTextureType );
+}
+
 /*
 ==================
 SV_MoveToss
@@ -217,5 +217,6 @@ typedef struct playermove_s
 	int		(*PM_TestPlayerPositionEx) (float *pos, pmtrace_t *ptrace, int (*pfnIgnore)( physent_t *pe ));
 	struct pmtrace_s	*(*PM_TraceLineEx)( float *start, float *end, int flags, int usehulll, int (*pfnIgnore)( physent_t *pe ));
 	struct msurface_s	*(*PM_TraceSurface)( int ground, float *vstart, float *vend );
+	char		(*PM_TraceMaterial)( int ground, float *vstart, float *vend, char *texname );	// materials.txt type of the hit texture, texname gets its stripped name
 } playermove_t;
 #endif//PM_DEFS_H
\ No newline at end of file
@@ -146,6 +146,10 @@ static char grgchTextureType[CTEXTURESMAX];
 
 int g_onladder = 0;
 
+// set by the dlls at init when the engine reports PM_TraceMaterial and EV_TraceMaterial,
+// older engines don't have the members, so they can't be tested for NULL
+int g_tracematerial = 0;
+
 void PM_SwapTextures( int i, int j )
 {
 	char chTemp;
@@ -468,6 +472,16 @@ void PM_CatagorizeTextureType( void )
 	pmove->sztexturename[0] = '\0';
 	pmove->chtexturetype = CHAR_TEX_CONCRETE;
 
+	// engine keeps the material of each texture, don't search materials.txt every step
+	if ( g_tracematerial )
+	{
+		char chTextureType = pmove->PM_TraceMaterial( pmove->onground, start, end, pmove->sztexturename );
+
+		if ( chTextureType )
+			pmove->chtexturetype = chTextureType;
+		return;
+	}
+
 	pTextureName = pmove->PM_TraceTexture( pmove->onground, start, end );
 	if ( !pTextureName )
 		return;
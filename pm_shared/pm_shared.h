@@ -20,6 +20,8 @@ void PM_Init( struct playermove_s *ppmove );
 void PM_Move( struct playermove_s *ppmove, int server );
 char PM_FindTextureType( char *name );
 
+extern int g_tracematerial;
+
 // Spectator Movement modes (stored in pev->iuser1, so the physics code can get at them)
 #define OBS_NONE			0
 #define OBS_CHASE_LOCKED		1